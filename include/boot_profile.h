@@ -0,0 +1,39 @@
+#ifndef BOOT_PROFILE_H
+    #define BOOT_PROFILE_H
+
+    #include <Arduino.h>
+    #include <esp_system.h>
+
+    #define BOOT_MAX_PHASES 12
+
+    // Time spent in each phase of setup(), so a slow restart (DHCP, WiFi scan,
+    // serial reopen) can be told apart from a slow bus. A phase ends with
+    // mark() and the next one starts right there; the first one starts when
+    // the esp_timer starts, shortly after reset.
+    class BootProfile{
+        private:
+            const char *_names[BOOT_MAX_PHASES];
+            uint32_t _ends[BOOT_MAX_PHASES];
+            uint8_t _count;
+            esp_reset_reason_t _resetReason;
+            bool _fastPath;
+        public:
+            BootProfile();
+            void begin();
+            // name is kept as a pointer, pass a string literal
+            void mark(const char *name);
+            // fast boot used the cached lease and access point
+            void setFastPath(bool fastPath);
+            bool getFastPath();
+            // restart after a watchdog, panic or ESP.restart() (not a power-on)
+            bool isWarmReset();
+            const char *getResetReason();
+            uint8_t getCount();
+            const char *getName(uint8_t index);
+            // ms
+            uint32_t getDuration(uint8_t index);
+            uint32_t getTotal();
+    };
+
+    extern BootProfile bootProfile;
+#endif /* BOOT_PROFILE_H */
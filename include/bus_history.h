@@ -0,0 +1,87 @@
+#ifndef BUS_HISTORY_H
+    #define BUS_HISTORY_H
+
+    #include <Arduino.h>
+
+    // buckets per ring: the last minute in seconds, the last hour in minutes
+    #define HISTORY_LENGTH 60
+    // latency histogram of the open bucket, for the p95
+    #define HISTORY_BINS 24
+
+    enum HistoryRange : uint8_t{
+        HISTORY_SECONDS,
+        HISTORY_MINUTES,
+        HISTORY_RANGES
+    };
+
+    enum HistoryField : uint8_t{
+        HISTORY_REQUESTS,
+        HISTORY_BYTES,
+        HISTORY_TIMEOUTS,
+        HISTORY_CRC_ERRORS,
+        // us
+        HISTORY_AVG_LATENCY,
+        HISTORY_P95_LATENCY,
+        HISTORY_FIELDS
+    };
+
+    struct HistoryBucket{
+        uint32_t requests;
+        // sent and received, crc included
+        uint32_t bytes;
+        uint32_t timeouts;
+        uint32_t crcErrors;
+        uint32_t avgLatency;
+        uint32_t p95Latency;
+    };
+
+    // One ring of closed buckets plus the open one, each covering period ms.
+    class HistoryRing{
+        private:
+            uint32_t _period;
+            // millis() at the start of the open bucket
+            uint32_t _openAt;
+            uint8_t _next;
+            uint8_t _count;
+            HistoryBucket _buckets[HISTORY_LENGTH];
+            // open bucket
+            uint32_t _requests;
+            uint32_t _bytes;
+            uint32_t _timeouts;
+            uint32_t _crcErrors;
+            uint32_t _latencySum;
+            uint32_t _latencyMax;
+            uint16_t _bins[HISTORY_BINS];
+            void close();
+        public:
+            HistoryRing(uint32_t period);
+            // closes every bucket that ended before now, idle ones stay zero
+            void advance(uint32_t now);
+            void add(uint16_t bytes, uint32_t latency, bool timeout, bool crcError);
+            // closed buckets only, oldest first, returns the count
+            uint8_t copy(HistoryField field, uint32_t *values);
+            uint32_t getPeriod();
+    };
+
+    // Per-second and per-minute aggregates of the RTU bus for the last hour in
+    // fixed memory, so slowdowns can be matched with plant events without an
+    // external monitoring system. Written by the RTU client after every bus
+    // transaction (virtual slaves excluded, like the message counters).
+    class BusHistory{
+        private:
+            portMUX_TYPE _lock;
+            HistoryRing _rings[HISTORY_RANGES];
+            void printSparkline(Print &out, const uint32_t *values, uint8_t count);
+        public:
+            BusHistory();
+            void record(uint16_t bytes, uint32_t latency, bool timeout, bool crcError);
+            uint8_t getSeries(HistoryRange range, HistoryField field, uint32_t *values);
+            // columns per range, oldest bucket first
+            void printJson(Print &out);
+            // table rows with an inline SVG sparkline per field and range
+            void printSparklines(Print &out);
+            static const char *fieldName(uint8_t field);
+    };
+
+    extern BusHistory busHistory;
+#endif /* BUS_HISTORY_H */
@@ -4,16 +4,37 @@
     #include <Preferences.h>
     #define debugSerial Serial
     #define modbusSerial Serial2
-    #define DEBUG
+    // DEBUG (serial boot messages) is set per environment in platformio.ini
+
+    // last DHCP lease (IPAddress values) and WiFi access point, for fast boot.
+    // obtained is time() when the lease was granted or renewed: the RTC keeps
+    // counting through the warm resets fast boot is used after
+    struct NetworkCache{
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint8_t reserved;
+        uint32_t obtained;
+        // s
+        uint32_t leaseTime;
+    };
 
     class Config{
         private:
             Preferences *_prefs;
             int16_t _tcpPort;
             uint32_t _tcpTimeout;
+            uint8_t _tcpMaxInFlight;
+            String _coalesceUnits;
+            uint16_t _coalesceWindow;
             unsigned long _modbusBaudRate;
             uint32_t _modbusConfig;
             int8_t _modbusRtsPin;
+            bool _modbusHwRs485;
+            uint8_t _modbusRxTimeout;
             unsigned long _serialBaudRate;
             uint32_t _serialConfig;
             String _webPassword;
@@ -22,6 +43,41 @@
             IPAddress _staticGateway;
             IPAddress _staticSubnet;
             IPAddress _staticDns;
+            bool _mqttEnabled;
+            String _mqttHost;
+            uint16_t _mqttPort;
+            String _mqttUser;
+            String _mqttPassword;
+            String _mqttTopic;
+            uint32_t _mqttPollInterval;
+            uint32_t _mqttSnapshotInterval;
+            String _mqttTags;
+            bool _encInterrupt;
+            int8_t _netCore;
+            uint8_t _netPriority;
+            int8_t _rtuCore;
+            uint8_t _rtuPriority;
+            uint8_t _logLevel;
+            bool _logBinary;
+            uint8_t _traceSize;
+            String _simUnits;
+            uint16_t _simDelay;
+            uint8_t _simExceptionRate;
+            uint8_t _simTimeoutRate;
+            uint16_t _tcpConnectionRate;
+            uint16_t _tcpAddressRate;
+            uint8_t _tcpBurst;
+            String _tcpWeights;
+            uint8_t _tcpMaxClients;
+            uint16_t _tcpEvictIdle;
+            uint16_t _tcpKeepAlive;
+            bool _fastBoot;
+            NetworkCache _networkCache;
+            bool _networkCached;
+            bool _wifiPowerSave;
+            int8_t _wifiTxPower;
+            bool _wifiFastReconnect;
+            uint8_t _diagUnit;
         public:
             Config();
             void begin(Preferences *prefs);
@@ -29,6 +85,12 @@
             void setTcpPort(uint16_t value);
             uint32_t getTcpTimeout();
             void setTcpTimeout(uint32_t value);
+            uint8_t getTcpMaxInFlight();
+            void setTcpMaxInFlight(uint8_t value);
+            String getCoalesceUnits();
+            void setCoalesceUnits(String value);
+            uint16_t getCoalesceWindow();
+            void setCoalesceWindow(uint16_t value);
             uint32_t getModbusConfig();
             unsigned long getModbusBaudRate();
             void setModbusBaudRate(unsigned long value);
@@ -40,6 +102,10 @@
             void setModbusStopBits(uint8_t value);
             int8_t getModbusRtsPin();
             void setModbusRtsPin(int8_t value);
+            bool getModbusHwRs485();
+            void setModbusHwRs485(bool value);
+            uint8_t getModbusRxTimeout();
+            void setModbusRxTimeout(uint8_t value);
             uint32_t getSerialConfig();
             unsigned long getSerialBaudRate();
             void setSerialBaudRate(unsigned long value);
@@ -63,6 +129,111 @@
             void setStaticSubnet(IPAddress value);
             IPAddress getStaticDns();
             void setStaticDns(IPAddress value);
+
+            // MQTT publisher settings
+            bool getMqttEnabled();
+            void setMqttEnabled(bool value);
+            String getMqttHost();
+            void setMqttHost(String value);
+            uint16_t getMqttPort();
+            void setMqttPort(uint16_t value);
+            String getMqttUser();
+            void setMqttUser(String value);
+            String getMqttPassword();
+            void setMqttPassword(String value);
+            String getMqttTopic();
+            void setMqttTopic(String value);
+            uint32_t getMqttPollInterval();
+            void setMqttPollInterval(uint32_t value);
+            uint32_t getMqttSnapshotInterval();
+            void setMqttSnapshotInterval(uint32_t value);
+            String getMqttTags();
+            void setMqttTags(String value);
+
+            // ENC28J60 settings
+            bool getEncInterrupt();
+            void setEncInterrupt(bool value);
+
+            // Task placement (core -1 = no affinity)
+            int8_t getNetCore();
+            void setNetCore(int8_t value);
+            uint8_t getNetPriority();
+            void setNetPriority(uint8_t value);
+            int8_t getRtuCore();
+            void setRtuCore(int8_t value);
+            uint8_t getRtuPriority();
+            void setRtuPriority(uint8_t value);
+
+            // Event log (0 = off, 1 = error ... 4 = debug)
+            uint8_t getLogLevel();
+            void setLogLevel(uint8_t value);
+            bool getLogBinary();
+            void setLogBinary(bool value);
+
+            // Bridge trace buffer in KB (0 = off)
+            uint8_t getTraceSize();
+            void setTraceSize(uint8_t value);
+
+            // Virtual slaves answering in place of the RTU bus
+            String getSimUnits();
+            void setSimUnits(String value);
+            uint16_t getSimDelay();
+            void setSimDelay(uint16_t value);
+            uint8_t getSimExceptionRate();
+            void setSimExceptionRate(uint8_t value);
+            uint8_t getSimTimeoutRate();
+            void setSimTimeoutRate(uint8_t value);
+
+            // Bridge rate limits in requests/s (0 = off) and bus share weights
+            uint16_t getTcpConnectionRate();
+            void setTcpConnectionRate(uint16_t value);
+            uint16_t getTcpAddressRate();
+            void setTcpAddressRate(uint16_t value);
+            uint8_t getTcpBurst();
+            void setTcpBurst(uint8_t value);
+            String getTcpWeights();
+            void setTcpWeights(String value);
+
+            // Bridge connections: limit, idle time (ms) after which the least
+            // recently active one gives way to a new client, keepalive idle (s, 0 = off)
+            uint8_t getTcpMaxClients();
+            void setTcpMaxClients(uint8_t value);
+            uint16_t getTcpEvictIdle();
+            void setTcpEvictIdle(uint16_t value);
+            uint16_t getTcpKeepAlive();
+            void setTcpKeepAlive(uint16_t value);
+
+            // Fast boot: after a warm reset reuse the cached lease and access
+            // point instead of DHCP and a WiFi scan
+            bool getFastBoot();
+            void setFastBoot(bool value);
+            bool getNetworkCache(NetworkCache &cache);
+            // written only when it differs from the stored one (flash wear)
+            void setNetworkCache(const NetworkCache &cache);
+            void clearNetworkCache();
+
+            // WiFi radio: modem sleep, TX power in 0.25 dBm (wifi_power_t) and
+            // reconnect to the last access point without a scan
+            bool getWifiPowerSave();
+            void setWifiPowerSave(bool value);
+            int8_t getWifiTxPower();
+            void setWifiTxPower(int8_t value);
+            bool getWifiFastReconnect();
+            void setWifiFastReconnect(bool value);
+
+            // unit id the gateway answers itself with its diagnostics (0 = off),
+            // only the reserved ids 248-255 so it never hides a slave on the bus.
+            // Anything else is ignored
+            uint8_t getDiagUnit();
+            void setDiagUnit(int value);
+
+            // register map records, read from flash on demand (up to 1.8 KB)
+            size_t getRegisterMap(void *data, size_t size);
+            // size 0 removes the map
+            void setRegisterMap(const void *data, size_t size);
+
+            // unit lists like "1,5,10-12" as a bitmap of 256 units
+            static void parseUnits(String text, uint32_t *units);
     };
     #ifdef DEBUG
     #define dbg(x...) debugSerial.print(x);
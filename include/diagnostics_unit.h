@@ -0,0 +1,74 @@
+#ifndef DIAGNOSTICS_UNIT_H
+    #define DIAGNOSTICS_UNIT_H
+
+    #include <Arduino.h>
+    #include <ModbusTypeDefs.h>
+    #include "status_snapshot.h"
+
+    // FC43/14 device identification, build flags may override them
+    #ifndef DIAG_VENDOR_NAME
+        #define DIAG_VENDOR_NAME "ESP32 Modbus Gateway"
+    #endif
+    #ifndef DIAG_REVISION
+        #define DIAG_REVISION __DATE__
+    #endif
+    #define DIAG_PRODUCT_NAME "ESP32 Modbus RTU/TCP Gateway"
+    #ifdef USE_ENC28J60
+        #define DIAG_PRODUCT_CODE "MBGW-ENC28J60"
+    #else
+        #define DIAG_PRODUCT_CODE "MBGW-WIFI"
+    #endif
+
+    // Input register map (FC04, FC03 reads the same registers). 32 bit values
+    // take two registers, high word first.
+    #define DIAG_MAP_VERSION 1
+    #define DIAG_REG_VERSION 0
+    #define DIAG_REG_UPTIME 1           // s
+    #define DIAG_REG_HEAP_FREE 3        // bytes
+    #define DIAG_REG_HEAP_MIN_FREE 5    // bytes
+    #define DIAG_REG_RTU_MESSAGES 7
+    #define DIAG_REG_RTU_ERRORS 9
+    #define DIAG_REG_RTU_PENDING 11     // callers waiting for the bus
+    #define DIAG_REG_IN_FLIGHT 12       // bridge transactions queued or on the bus
+    #define DIAG_REG_CLIENTS 13
+    #define DIAG_REG_BRIDGE_MESSAGES 14
+    #define DIAG_REG_BRIDGE_ERRORS 16
+    #define DIAG_REG_UNIT_COUNT 18
+    #define DIAG_REG_SNAPSHOT_AGE 19    // ms
+    // one block per RTU unit seen: unit id, state (0 online, 1 offline),
+    // requests (2), errors (2), average latency in 0.1 ms, timeouts
+    #define DIAG_REG_UNITS 20
+    #define DIAG_UNIT_REGS 8
+    #define DIAG_REGISTERS (DIAG_REG_UNITS + RTU_MAX_UNIT_STATS * DIAG_UNIT_REGS)
+
+    // A Modbus unit of the gateway itself, answered by the bridge in the
+    // network task without a transaction slot or bus time. Registers come
+    // from the status snapshot, so a SCADA poll costs the same as /status.json.
+    // Also answers FC08 (diagnostics counters) and FC43/14 (device identification).
+    class DiagnosticsUnit{
+        private:
+            uint8_t _unit;
+            // FC08 counters count from these values (sub-function 0x0A clears)
+            uint32_t _baseMessages;
+            uint32_t _baseCommErrors;
+            uint32_t _baseExceptions;
+            uint32_t _requests;
+            uint8_t _response[MODBUS_MAX_PDU + 1];
+            uint16_t readRegisters(const uint8_t *pdu, uint16_t len);
+            uint16_t diagnostics(const uint8_t *pdu, uint16_t len);
+            uint16_t identification(const uint8_t *pdu, uint16_t len);
+            uint16_t exception(uint8_t function, Modbus::Error error);
+            static uint16_t registerValue(const StatusSnapshot &s, uint16_t address);
+            static const char *objectValue(uint8_t id);
+        public:
+            DiagnosticsUnit();
+            // 0 = off. Requests for this unit never reach the bus, a slave with
+            // the same id can no longer be reached through the gateway.
+            void begin(uint8_t unit);
+            uint8_t getUnit();
+            uint32_t getRequests();
+            // pdu is [unit, fc, data...], the returned response stays valid
+            // until the next call (network task only)
+            const uint8_t *execute(const uint8_t *pdu, uint16_t len, uint16_t &responseLen);
+    };
+#endif /* DIAGNOSTICS_UNIT_H */
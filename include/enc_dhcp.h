@@ -0,0 +1,65 @@
+#ifndef ENC_DHCP_H
+#define ENC_DHCP_H
+
+#include <Arduino.h>
+#include <EthernetENC.h>
+
+// ожидание ответа сервера и число повторов до паузы ENC_DHCP_RETRY
+#define ENC_DHCP_RESPONSE_TIMEOUT 2000
+#define ENC_DHCP_RETRIES 3
+#define ENC_DHCP_RETRY 60000
+
+// Клиент DHCP рядом с уже запущенным стеком uIP: Ethernet.begin(mac) заново
+// инициализировал бы uIP и закрыл сокеты моста, а DhcpClass ждет ответа
+// секундами и не отдает срок аренды. step() вызывается под uipLock на каждом
+// проходе задачи сети и никогда не ждет: отправляет запрос или разбирает
+// пришедший ответ. Сначала запрашивает текущий адрес (INIT-REBOOT), на NAK
+// начинает с DISCOVER, после ACK продлевает аренду на половине срока.
+class EncDhcp {
+public:
+    EncDhcp();
+    void begin(const uint8_t *mac);
+    // true на каждый полученный ACK
+    bool step();
+    IPAddress getLocalIp();
+    IPAddress getSubnetMask();
+    IPAddress getGatewayIp();
+    IPAddress getDnsServerIp();
+    // срок аренды из ответа сервера, с
+    uint32_t getLeaseTime();
+
+private:
+    enum State : uint8_t {
+        DHCP_IDLE,
+        DHCP_REBOOTING,
+        DHCP_SELECTING,
+        DHCP_REQUESTING,
+        DHCP_BOUND,
+        DHCP_RENEWING
+    };
+
+    EthernetUDP _udp;
+    uint8_t _mac[6];
+    State _state;
+    // состояние, в которое возвращаемся после паузы
+    State _retryState;
+    bool _open;
+    uint32_t _xid;
+    uint8_t _attempts;
+    uint32_t _sentAt;
+    uint32_t _waitUntil;
+    uint32_t _leaseTime;
+    IPAddress _ip;
+    IPAddress _offered;
+    IPAddress _server;
+    IPAddress _subnet;
+    IPAddress _gateway;
+    IPAddress _dns;
+
+    void send(uint8_t type);
+    void transmit(State state);
+    // тип сообщения из ответа на наш xid, 0 если пакет не наш
+    uint8_t receive();
+};
+
+#endif
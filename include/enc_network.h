@@ -0,0 +1,55 @@
+#ifndef ENC_NETWORK_H
+#define ENC_NETWORK_H
+
+#include <Arduino.h>
+#include <EthernetENC.h>
+#include "config.h"
+#include "enc_dhcp.h"
+#include "pages_ethernet_awot.h"
+#include "tcp_bridge.h"
+
+// Обслуживание стека uIP в отдельной задаче, которую будит линия INT ENC28J60.
+// Таймаут ожидания равен UIP_PERIODIC_TIMER, чтобы таймеры TCP продолжали работать
+// и при отсутствии входящих пакетов.
+// uIP не потокобезопасен: задача enc28j60 (или loop() без прерываний), задача
+// MQTT и снимок состояния обращаются к стеку только под этим мьютексом
+extern SemaphoreHandle_t uipLock;
+
+// С быстрой загрузкой каждая аренда DHCP (первая и продления) пишется в кэш
+// сети вместе со сроком из ответа сервера. После появления линка EncDhcp
+// запрашивает аренду текущего адреса и дальше продлевает ее, не останавливая
+// задачу; если сервер выдал другой адрес, шлюз сохраняет его и перезагружается.
+class EncNetwork {
+public:
+    EncNetwork();
+    void begin(int8_t intPin, EthernetWebUI *webUI, TcpBridge *bridge, int8_t core, uint8_t priority);
+    // до Ethernet.begin()
+    void setLeaseCache(const uint8_t *mac, Config *config);
+    // запросить аренду текущего адреса, когда будет линк
+    void requestLease();
+    // Ethernet.maintain() и шаг DHCP, только под uipLock
+    void maintain();
+    bool isRunning();
+    uint32_t getIrqWakeups();
+    uint32_t getTimerWakeups();
+
+private:
+    static void IRAM_ATTR isr();
+    static void task(void *arg);
+    void run();
+
+    static TaskHandle_t _task;
+    int8_t _intPin;
+    EthernetWebUI *_webUI;
+    TcpBridge *_bridge;
+    volatile uint32_t _irqWakeups;
+    volatile uint32_t _timerWakeups;
+    Config *_config;
+    uint8_t _mac[6];
+    bool _renew;
+    EncDhcp _dhcp;
+
+    void cacheLease();
+};
+
+#endif
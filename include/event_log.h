@@ -0,0 +1,75 @@
+#ifndef EVENT_LOG_H
+    #define EVENT_LOG_H
+
+    #include <Arduino.h>
+    #include "event_log_events.h"
+
+    #define ELOG_ERROR 1
+    #define ELOG_WARN 2
+    #define ELOG_INFO 3
+    #define ELOG_DEBUG 4
+
+    // compile time ceiling: calls above it compile to nothing, including their strings
+    #ifndef ELOG_MAX_LEVEL
+        #ifdef DEBUG
+            #define ELOG_MAX_LEVEL ELOG_DEBUG
+        #else
+            #define ELOG_MAX_LEVEL ELOG_WARN
+        #endif
+    #endif
+
+    #define EVENT_LOG_RECORDS 128
+
+    struct LogRecord{
+        uint32_t timestamp;
+        uint16_t event;
+        uint8_t level;
+        uint8_t argc;
+        uintptr_t args[EVENT_LOG_MAX_ARGS];
+    };
+
+    // Non blocking event log: callers only copy the event id and its raw arguments
+    // into a ring buffer, a low priority task formats (or encodes) and prints them.
+    // String arguments must be literals or otherwise outlive the record.
+    class EventLog{
+        private:
+            Print *_out;
+            volatile uint8_t _level;
+            bool _binary;
+            LogRecord _records[EVENT_LOG_RECORDS];
+            volatile uint16_t _head;
+            volatile uint16_t _tail;
+            volatile uint32_t _dropped;
+            portMUX_TYPE _lock;
+            TaskHandle_t _task;
+            static void task(void *arg);
+            void drain();
+            void printText(const LogRecord &record);
+            void printBinary(const LogRecord &record);
+            void push(uint8_t level, uint16_t event, uint8_t argc, const uintptr_t *args);
+            static uintptr_t toArg(const char *value){ return (uintptr_t)value; }
+            static uintptr_t toArg(const IPAddress &value){ return (uint32_t)value; }
+            // String buffers may be gone before the record is printed
+            static uintptr_t toArg(const String &value) = delete;
+            template <typename T> static uintptr_t toArg(T value){ return (uintptr_t)value; }
+        public:
+            EventLog();
+            void begin(Print *out, uint8_t level, bool binary);
+            void setLevel(uint8_t level);
+            uint8_t getLevel();
+            bool isBinary();
+            uint32_t getDropped();
+            bool enabled(uint8_t level){ return level <= _level; }
+
+            template <typename... Args>
+            void write(uint8_t level, uint16_t event, Args... args){
+                static_assert(sizeof...(args) <= EVENT_LOG_MAX_ARGS, "too many log arguments");
+                uintptr_t values[] = {0, toArg(args)...};
+                push(level, event, sizeof...(args), values + 1);
+            }
+    };
+
+    extern EventLog eventLog;
+
+    #define elog(level, event, ...) do{ if ((level) <= ELOG_MAX_LEVEL && eventLog.enabled(level)) eventLog.write(level, event, ##__VA_ARGS__); }while(0)
+#endif /* EVENT_LOG_H */
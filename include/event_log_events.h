@@ -0,0 +1,47 @@
+#ifndef EVENT_LOG_EVENTS_H
+    #define EVENT_LOG_EVENTS_H
+
+    // Table of all binary log events, shared by the firmware and tools/logdecode.
+    // Never reorder or remove entries: the position is the id on the wire.
+    // Supported conversions: %u %d %x %s (string literal) %I (IPv4 address) %%
+    #define EVENT_LOG_EVENTS(X) \
+        X(EV_LOG_DROPPED,         "[log] %u records dropped") \
+        X(EV_WEB_GET,             "[webserver] GET %s") \
+        X(EV_WEB_POST,            "[webserver] POST %s") \
+        X(EV_CONFIG_SAVED,        "[webserver] saved %s") \
+        X(EV_OTA_PROGRESS,        "[webserver] OTA progress %u") \
+        X(EV_HEAP,                "[loop] Free heap: %u bytes, largest block %u, Mode: %s") \
+        X(EV_BRIDGE_CONNECT,      "[bridge] client %u connected from %I") \
+        X(EV_BRIDGE_DISCONNECT,   "[bridge] client %u disconnected") \
+        X(EV_BRIDGE_TIMEOUT,      "[bridge] client %u timeout") \
+        X(EV_BRIDGE_NO_SLOT,      "[bridge] no free connection slot for %I") \
+        X(EV_BRIDGE_FRAMING,      "[bridge] client %u framing error, protocol %u length %u") \
+        X(EV_MQTT_CONNECTING,     "[mqtt] connecting") \
+        X(EV_MQTT_CONNECTED,      "[mqtt] connected") \
+        X(EV_MQTT_CONNECT_FAILED, "[mqtt] connect failed, state %d") \
+        X(EV_MQTT_READ_ERROR,     "[mqtt] read unit %u fc %u address %u failed: %x") \
+        X(EV_HEAP_LOW,            "[heap] largest free block low: free %u, largest %u") \
+        X(EV_ALLOC_FAILED,        "[heap] %u allocations failed, last %u bytes") \
+        X(EV_BRIDGE_REJECT,       "[bridge] client %u unit %u fc %u rejected: %s") \
+        X(EV_BRIDGE_EVICT,        "[bridge] client %u idle for %u ms, evicted for %I") \
+        X(EV_BOOT,                "[boot] ready in %u ms after %s reset, fast boot %s") \
+        X(EV_WIFI_LOST,           "[wifi] connection lost, channel %u") \
+        X(EV_WIFI_RECONNECTED,    "[wifi] reconnected in %u ms (%s)") \
+        X(EV_LEASE,               "[network] DHCP lease %I for %u s") \
+        X(EV_LEASE_MOVED,         "[network] DHCP moved the address to %I, restarting")
+
+    #define EVENT_LOG_ENUM(id, format) id,
+    #define EVENT_LOG_FORMAT(id, format) format,
+
+    enum LogEvent{
+        EVENT_LOG_EVENTS(EVENT_LOG_ENUM)
+        EV_COUNT
+    };
+
+    // binary frame: sync bytes, payload length, payload
+    // payload: u32 timestamp (ms), u16 event, u8 level, u8 argc, args...
+    // args: %s as u8 length + bytes, everything else as u32 (little endian)
+    #define EVENT_LOG_SYNC1 0xa5
+    #define EVENT_LOG_SYNC2 0x5a
+    #define EVENT_LOG_MAX_ARGS 4
+#endif /* EVENT_LOG_EVENTS_H */
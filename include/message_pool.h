@@ -0,0 +1,82 @@
+#ifndef MESSAGE_POOL_H
+    #define MESSAGE_POOL_H
+
+    #include <atomic>
+    #include <stdint.h>
+    #include <stdlib.h>
+
+    // Fixed arena of N message buffers of SIZE bytes, handed out through a
+    // lock-free bitmap so any task may acquire and release. When the arena is
+    // exhausted the buffer comes from the heap instead and is counted as a
+    // fallback, so undersized pools show up in the statistics.
+    template <size_t SIZE, size_t N>
+    class MessagePool{
+        static_assert(N > 0 && N <= 32, "MessagePool holds 1 to 32 buffers");
+        private:
+            alignas(4) uint8_t _blocks[N][SIZE];
+            std::atomic<uint32_t> _free;
+            std::atomic<uint32_t> _inUse;
+            std::atomic<uint32_t> _highWater;
+            std::atomic<uint32_t> _acquired;
+            std::atomic<uint32_t> _fallbacks;
+            std::atomic<uint32_t> _failures;
+
+            bool owns(const uint8_t *buffer) const{
+                return buffer >= &_blocks[0][0] && buffer < &_blocks[0][0] + sizeof(_blocks);
+            }
+        public:
+            MessagePool()
+                :_free(N == 32 ? UINT32_MAX : (1UL << N) - 1)
+                ,_inUse(0)
+                ,_highWater(0)
+                ,_acquired(0)
+                ,_fallbacks(0)
+                ,_failures(0)
+            {}
+
+            // returns NULL only if the heap fallback fails too
+            uint8_t *acquire(){
+                uint8_t *buffer = nullptr;
+                auto free = _free.load(std::memory_order_relaxed);
+                while (free){
+                    auto bit = __builtin_ctz(free);
+                    if (_free.compare_exchange_weak(free, free & ~(1UL << bit), std::memory_order_acquire)){
+                        buffer = _blocks[bit];
+                        break;
+                    }
+                }
+                if (!buffer){
+                    buffer = (uint8_t*)malloc(SIZE);
+                    if (!buffer){
+                        _failures++;
+                        return nullptr;
+                    }
+                    _fallbacks++;
+                }
+                _acquired++;
+                auto inUse = ++_inUse;
+                auto highWater = _highWater.load(std::memory_order_relaxed);
+                while (inUse > highWater && !_highWater.compare_exchange_weak(highWater, inUse));
+                return buffer;
+            }
+
+            void release(uint8_t *buffer){
+                if (!buffer) return;
+                _inUse--;
+                if (owns(buffer)){
+                    _free.fetch_or(1UL << ((buffer - &_blocks[0][0]) / SIZE), std::memory_order_release);
+                }
+                else{
+                    ::free(buffer);
+                }
+            }
+
+            static constexpr size_t blockSize(){ return SIZE; }
+            static constexpr size_t capacity(){ return N; }
+            uint32_t inUse() const{ return _inUse; }
+            uint32_t highWater() const{ return _highWater; }
+            uint32_t acquired() const{ return _acquired; }
+            uint32_t fallbacks() const{ return _fallbacks; }
+            uint32_t failures() const{ return _failures; }
+    };
+#endif /* MESSAGE_POOL_H */
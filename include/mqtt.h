@@ -0,0 +1,82 @@
+#ifndef MQTT_H
+    #define MQTT_H
+
+    #include <Arduino.h>
+    #include <Client.h>
+    #include <PubSubClient.h>
+    #include <vector>
+    #include "config.h"
+    #include "rtu_client.h"
+    #include "event_log.h"
+
+    // max. number of tags packed into one publish
+    #define MQTT_BATCH_TAGS 16
+    // max. registers read in one request when tags are grouped
+    #define MQTT_MAX_SPAN 64
+    #define MQTT_BUFFER_SIZE 1024
+    #define MQTT_RECONNECT_INTERVAL 5000
+
+    struct MqttTag{
+        String name;
+        uint8_t unit;
+        uint8_t function;
+        uint16_t address;
+        uint16_t deadband;
+        uint16_t value;
+        bool valid;
+    };
+
+    // one modbus request covering a run of tags (same unit/fc, close addresses)
+    struct MqttReadGroup{
+        uint8_t unit;
+        uint8_t function;
+        uint16_t address;
+        uint16_t count;
+        size_t first;
+        size_t last;
+    };
+
+    class MqttPublisher{
+        private:
+            Config *_config;
+            RtuClient *_rtu;
+            PubSubClient _mqtt;
+            TaskHandle_t _task;
+            // taken around every client call when the network stack is not
+            // thread safe (uIP on ENC28J60), NULL with lwIP
+            SemaphoreHandle_t _netLock;
+            volatile bool _connected;
+            std::vector<MqttTag> _tags;
+            std::vector<MqttReadGroup> _groups;
+            // PubSubClient keeps the pointer it is given, not a copy
+            String _host;
+            String _clientId;
+            String _payload;
+            uint8_t _batchCount;
+            bool _batchSnapshot;
+            unsigned long _lastConnect;
+            unsigned long _lastSnapshot;
+            uint32_t _publishCount;
+            uint32_t _readErrors;
+            static void task(void *arg);
+            void run();
+            bool connect();
+            void parseTags(String text);
+            void buildGroups();
+            void poll(bool snapshot);
+            void addToBatch(MqttTag &tag, bool snapshot);
+            void flushBatch();
+            void lockNetwork();
+            void unlockNetwork();
+        public:
+            MqttPublisher(Client &client);
+            // before begin()
+            void setNetworkLock(SemaphoreHandle_t lock);
+            void begin(Config *config, RtuClient *rtu);
+            // state after the last loop, does not touch the client
+            bool connected();
+            uint32_t getPublishCount();
+            uint32_t getReadErrors();
+            size_t getTagCount();
+    };
+#endif /* MQTT_H */
@@ -3,19 +3,28 @@
 
     #include <WiFiManager.h>
     #include <ESPAsyncWebServer.h>
-    #include <ModbusBridgeWiFi.h>
-    #include <ModbusClientRTU.h>
     #include <Update.h>
     #include "config.h"
     #include "debug.h"
+    #include "event_log.h"
+    #include "telemetry.h"
+    #include "mqtt.h"
+    #include "rtu_client.h"
+    #include "tcp_bridge.h"
+    #include "trace_recorder.h"
+    #include "boot_profile.h"
+    #include "status_snapshot.h"
+    #include "bus_history.h"
+    #include "register_map.h"
 
-    void setupPages(AsyncWebServer* server, ModbusClientRTU *rtu, ModbusBridgeWiFi *bridge, Config *config, WiFiManager *wm);
+    void setupPages(AsyncWebServer* server, RtuClient *rtu, TcpBridge *bridge, Config *config, WiFiManager *wm, MqttPublisher *mqtt);
     void sendResponseHeader(AsyncResponseStream *response, const char *title, bool inlineStyle = false);
     void sendResponseTrailer(AsyncResponseStream *response);
     void sendButton(AsyncResponseStream *response, const char *title, const char *action, const char *css = "");
     void sendTableRow(AsyncResponseStream *response, const char *name, uint32_t value);
     void sendTableRow(AsyncResponseStream *response, const char *name, String value);
     void sendDebugForm(AsyncResponseStream *response, String slaveId, String reg, String function, String count);
+    void sendMapForm(AsyncResponseStream *response, String text);
     void sendMinCss(AsyncResponseStream *response);
     const String ErrorName(Modbus::Error code);
     const String WiFiQuality(int rssiValue);
@@ -3,25 +3,40 @@
 
 #include <EthernetENC.h>
 #include <aWOT.h>
-#include <ModbusBridgeEthernet.h>
-#include <ModbusClientRTU.h>
 #include "config.h"
+#include "rtu_client.h"
+#include "tcp_bridge.h"
+#include "event_log.h"
+#include "telemetry.h"
+#include "boot_profile.h"
+#include "status_snapshot.h"
+#include "bus_history.h"
+#include "register_map.h"
+
+class EncNetwork;
 
 class EthernetWebUI {
 public:
-    void begin(ModbusClientRTU *rtu, ModbusBridgeEthernet *bridge, Config *config);
+    void begin(RtuClient *rtu, TcpBridge *bridge, Config *config, EncNetwork *network);
     void loop();
 
 private:
     static EthernetServer server;
     static Application app;
-    static ModbusClientRTU *g_rtu;
-    static ModbusBridgeEthernet *g_bridge;
+    static RtuClient *g_rtu;
+    static TcpBridge *g_bridge;
     static Config *g_config;
+    static EncNetwork *g_network;
     
     // Обработчики маршрутов
     static void handleRoot(Request &req, Response &res);
     static void handleStatus(Request &req, Response &res);
+    static void handleStatusJson(Request &req, Response &res);
+    static void handleHistoryJson(Request &req, Response &res);
+    static void handleApiMap(Request &req, Response &res);
+    static void handleApiMapPost(Request &req, Response &res);
+    static void handleApiRead(Request &req, Response &res);
+    static void handleMetrics(Request &req, Response &res);
     static void handleConfig(Request &req, Response &res);
     static void handleConfigPost(Request &req, Response &res);
     static void handleDebug(Request &req, Response &res);
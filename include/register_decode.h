@@ -0,0 +1,112 @@
+#ifndef REGISTER_DECODE_H
+    #define REGISTER_DECODE_H
+
+    #include <stdint.h>
+    #include <string.h>
+
+    // name of a register map tag including the terminating 0
+    #define REGMAP_NAME_LEN 16
+
+    enum RegisterType : uint8_t{
+        REG_BOOL,       // coil or discrete input (fc 1, 2)
+        REG_INT16,
+        REG_UINT16,
+        REG_INT32,
+        REG_UINT32,
+        REG_FLOAT32,
+        REG_STRING,     // length registers, two characters each
+        REG_TYPES
+    };
+
+    // order flags, 0 is ABCD (big endian words, high word first, the Modbus default)
+    #define REG_SWAP_BYTES 0x01     // BADC
+    #define REG_SWAP_WORDS 0x02     // CDAB, both flags DCBA
+
+    // One register map entry as stored in flash (28 bytes)
+    struct RegisterTag{
+        char name[REGMAP_NAME_LEN];
+        uint8_t unit;
+        uint8_t function;
+        uint16_t address;
+        uint8_t type;
+        uint8_t order;
+        // registers of a string
+        uint8_t length;
+        uint8_t reserved;
+        float scale;
+    };
+
+    // registers (bits for fc 1, 2) a tag covers
+    static inline uint16_t registerCount(const RegisterTag &tag){
+        switch (tag.type){
+            case REG_INT32:
+            case REG_UINT32:
+            case REG_FLOAT32:
+                return 2;
+            case REG_STRING:
+                return tag.length;
+            default:
+                return 1;
+        }
+    }
+
+    static inline uint16_t registerWord(const uint8_t *data, uint16_t index, uint8_t order){
+        data += index * 2;
+        return order & REG_SWAP_BYTES ? data[0] | (data[1] << 8) : (data[0] << 8) | data[1];
+    }
+
+    static inline uint32_t registerDword(const uint8_t *data, uint16_t index, uint8_t order){
+        uint32_t first = registerWord(data, index, order);
+        uint32_t second = registerWord(data, index + 1, order);
+        return order & REG_SWAP_WORDS ? (second << 16) | first : (first << 16) | second;
+    }
+
+    // Value of a numeric or bool tag. data holds the bytes of a read response
+    // after the byte count, offset is the tag's distance from the first
+    // register (bit) read. Integers stay exact (32 bit fit a double), the
+    // scale is applied unless it is 1.
+    static inline double decodeRegister(const RegisterTag &tag, const uint8_t *data, uint16_t offset){
+        double value;
+        switch (tag.type){
+            case REG_BOOL:
+                return (data[offset / 8] >> (offset % 8)) & 1;
+            case REG_INT16:
+                value = (int16_t)registerWord(data, offset, tag.order);
+                break;
+            case REG_UINT16:
+                value = registerWord(data, offset, tag.order);
+                break;
+            case REG_INT32:
+                value = (int32_t)registerDword(data, offset, tag.order);
+                break;
+            case REG_UINT32:
+                value = registerDword(data, offset, tag.order);
+                break;
+            case REG_FLOAT32:{
+                uint32_t bits = registerDword(data, offset, tag.order);
+                float real;
+                memcpy(&real, &bits, sizeof(real));
+                value = real;
+                break;
+            }
+            default:
+                return 0;
+        }
+        return tag.scale == 1.0f ? value : value * tag.scale;
+    }
+
+    // Characters of a string tag (high byte first unless REG_SWAP_BYTES) up to
+    // the first 0, trailing blanks removed. size must be at least 2 * length + 1.
+    static inline uint16_t decodeString(const RegisterTag &tag, const uint8_t *data, uint16_t offset, char *text, uint16_t size){
+        uint16_t len = 0;
+        for (uint16_t i = 0; i < tag.length && len + 2 < size; i++){
+            uint16_t word = registerWord(data, offset + i, tag.order);
+            text[len++] = word >> 8;
+            text[len++] = word & 0xff;
+        }
+        text[len] = 0;
+        len = strlen(text);
+        while (len > 0 && text[len - 1] == ' ') text[--len] = 0;
+        return len;
+    }
+#endif /* REGISTER_DECODE_H */
@@ -0,0 +1,74 @@
+#ifndef REGISTER_MAP_H
+    #define REGISTER_MAP_H
+
+    #include <Arduino.h>
+    #include <vector>
+    #include "config.h"
+    #include "register_decode.h"
+    #include "rtu_client.h"
+
+    #define REGMAP_MAX_TAGS 64
+    // per read: registers for fc 3/4, bits for fc 1/2 (both fill 250 bytes)
+    #define REGMAP_MAX_REGISTERS 125
+    #define REGMAP_MAX_BITS 2000
+    // unread registers (bits) a read may span to save a request
+    #define REGMAP_DEFAULT_GAP 8
+    // largest CSV or JSON upload accepted (64 tags of JSON fit)
+    #define REGMAP_MAX_UPLOAD 8192
+    // /api/read blocks the web server task: at most this many RTU reads, which
+    // together wait at most REGMAP_READ_BUDGET ms for the bus and the answers,
+    // the tags left over answer "timeout"
+    #define REGMAP_MAX_READS 8
+    #define REGMAP_READ_BUDGET 1000
+
+    // one RTU request covering tags [first, last] of a planned selection
+    struct RegisterRead{
+        uint8_t unit;
+        uint8_t function;
+        uint16_t address;
+        uint16_t count;
+        uint8_t first;
+        uint8_t last;
+    };
+
+    // Typed register map for the HTTP API. Uploaded as CSV
+    // ("name,unit,fc,address,type[,order[,scale]]" per line) or as a JSON array
+    // of objects with the same keys, kept in flash as an array of fixed size
+    // RegisterTag records. A read of several tags is planned into the fewest
+    // RTU requests (same unit and function code, at most 125 registers apart)
+    // and answered with decoded, scaled values.
+    //
+    // Used from the web server task only, so there is no lock.
+    class RegisterMap{
+        private:
+            Config *_config;
+            uint8_t _count;
+            RegisterTag _tags[REGMAP_MAX_TAGS];
+            static bool parseTag(String *fields, uint8_t count, RegisterTag &tag, String &error);
+            static bool parseCsv(const String &text, std::vector<RegisterTag> &tags, String &error);
+            static bool parseJson(const String &text, std::vector<RegisterTag> &tags, String &error);
+            static const char *typeName(uint8_t type);
+            static const char *orderName(uint8_t order);
+            static void printValue(Print &out, const RegisterTag &tag, const uint8_t *data, uint16_t offset);
+            int16_t find(const String &name);
+        public:
+            RegisterMap();
+            // loads the map saved in flash
+            void begin(Config *config);
+            // replaces and saves the map, nothing changes if an entry is invalid
+            bool load(const String &text, String &error);
+            uint8_t getCount();
+            void printCsv(Print &out);
+            void printJson(Print &out);
+            // sorts selection (tag indexes) and merges it into reads, gaps of
+            // more than maxGap unread registers start a new read. Returns the
+            // number of reads.
+            uint8_t plan(uint8_t *selection, uint8_t count, uint16_t maxGap, RegisterRead *reads);
+            // names separated by ',' (empty: all tags), answers
+            // {"values":{...},"errors":{...},"reads":n,"ms":t} with n the RTU
+            // reads sent. A unit that timed out is not asked again
+            void read(RtuClient *rtu, const String &names, uint16_t maxGap, Print &out);
+    };
+
+    extern RegisterMap registerMap;
+#endif /* REGISTER_MAP_H */
@@ -0,0 +1,87 @@
+#ifndef RTU_CLIENT_H
+    #define RTU_CLIENT_H
+
+    #include <Arduino.h>
+    #include <atomic>
+    #include <ModbusTypeDefs.h>
+    #include "virtual_slaves.h"
+    #include "bus_history.h"
+
+    // unit + max. PDU (253 bytes) + crc
+    #define RTU_MAX_FRAME 256
+    // units with their own statistics, the least recently used one is replaced
+    #define RTU_MAX_UNIT_STATS 16
+    // consecutive timeouts after which a unit counts as offline
+    #define RTU_OFFLINE_TIMEOUTS 3
+
+    struct RtuUnitStats{
+        uint8_t unit;
+        // consecutive timeouts, offline from RTU_OFFLINE_TIMEOUTS on
+        uint8_t timeoutsInRow;
+        uint32_t requests;
+        uint32_t errors;
+        uint32_t timeouts;
+        // moving average over about 8 transactions in us
+        uint32_t latency;
+        // millis() of the last transaction
+        uint32_t lastSeen;
+    };
+
+    // Modbus RTU master working on caller supplied buffers, a transaction never
+    // touches the heap (eModbus copies every request and response into
+    // std::vectors). The bus is shared by the bridge engine, MQTT and the web UI,
+    // a mutex hands it to one caller at a time.
+    class RtuClient{
+        private:
+            HardwareSerial *_serial;
+            int8_t _rtsPin;
+            uint32_t _timeout;
+            // silent interval between frames (3.5 characters) in us
+            uint32_t _interval;
+            unsigned long _lastActivity;
+            SemaphoreHandle_t _lock;
+            // end of frame from the UART rx timeout instead of polling for
+            // 3.5 silent characters, given by the receive callback
+            bool _hardwareFraming;
+            volatile bool _rxIdle;
+            SemaphoreHandle_t _rxEvent;
+            void onRxIdle();
+            VirtualSlaves *_simulator;
+            std::atomic<uint32_t> _waiting;
+            uint32_t _messageCount;
+            uint32_t _errorCount;
+            // length of the last response, for the bus history
+            uint16_t _received;
+            portMUX_TYPE _statsLock;
+            uint8_t _unitCount;
+            RtuUnitStats _units[RTU_MAX_UNIT_STATS];
+            void account(uint8_t unit, Modbus::Error error, uint32_t latency);
+            uint8_t _frame[RTU_MAX_FRAME];
+            Modbus::Error exchange(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, uint32_t timeout, Print *trace);
+            uint16_t receive(uint32_t timeout);
+            static uint16_t frameLength(const uint8_t *frame, uint16_t len);
+            static void dump(Print *trace, const char *prefix, const uint8_t *data, uint16_t len);
+        public:
+            RtuClient(int8_t rtsPin = -1);
+            // hardwareFraming: the UART rx timeout is set up by the caller
+            // (uart_set_rx_timeout) and ends a frame
+            void begin(HardwareSerial &serial, unsigned long baudRate, bool hardwareFraming = false);
+            void setTimeout(uint32_t timeout);
+            // units handled by the simulator never reach the bus
+            void setSimulator(VirtualSlaves *simulator);
+            VirtualSlaves *getSimulator();
+            // pdu holds [unit, fc, data...] without crc and is overwritten by the
+            // response, size is the capacity of the buffer. A timeout (ms, at
+            // most the configured one) also bounds the wait for the bus, which
+            // is otherwise waited for as long as it takes
+            Modbus::Error transact(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, Print *trace = NULL, uint32_t timeout = 0);
+            // fc 1..4 read, response is [unit, fc, byte count, data...]
+            Modbus::Error read(uint8_t unit, uint8_t function, uint16_t address, uint16_t count, uint8_t *response, uint16_t size, uint16_t &responseLen, Print *trace = NULL, uint32_t timeout = 0);
+            static uint16_t crc16(const uint8_t *data, uint16_t len);
+            uint32_t getMessageCount();
+            uint32_t getErrorCount();
+            uint32_t pendingRequests();
+            // per unit latency and health (virtual slaves included), returns the count
+            uint8_t getUnitStats(RtuUnitStats *stats);
+    };
+#endif /* RTU_CLIENT_H */
@@ -0,0 +1,47 @@
+#ifndef SPSC_QUEUE_H
+    #define SPSC_QUEUE_H
+
+    #include <atomic>
+    #include <stddef.h>
+
+    // Lock-free single producer / single consumer ring buffer.
+    // Exactly one task may call push() and exactly one task may call pop().
+    // Everything written before push() is visible to the consumer after pop().
+    template <typename T, size_t N>
+    class SpscQueue{
+        static_assert(N > 1 && (N & (N - 1)) == 0, "SpscQueue size must be a power of 2");
+        private:
+            T _items[N];
+            std::atomic<size_t> _head; // next item to pop, owned by the consumer
+            std::atomic<size_t> _tail; // next free slot, owned by the producer
+        public:
+            SpscQueue()
+                :_head(0)
+                ,_tail(0)
+            {}
+
+            bool push(const T &item){
+                auto tail = _tail.load(std::memory_order_relaxed);
+                if (tail - _head.load(std::memory_order_acquire) >= N) return false;
+                _items[tail & (N - 1)] = item;
+                _tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool pop(T &item){
+                auto head = _head.load(std::memory_order_relaxed);
+                if (head == _tail.load(std::memory_order_acquire)) return false;
+                item = _items[head & (N - 1)];
+                _head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            size_t size() const{
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+            }
+
+            bool empty() const{
+                return size() == 0;
+            }
+    };
+#endif /* SPSC_QUEUE_H */
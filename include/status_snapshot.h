@@ -0,0 +1,139 @@
+#ifndef STATUS_SNAPSHOT_H
+    #define STATUS_SNAPSHOT_H
+
+    #include <Arduino.h>
+    #include "boot_profile.h"
+    #include "config.h"
+    #include "mqtt.h"
+    #include "rtu_client.h"
+    #include "tcp_bridge.h"
+    #include "telemetry.h"
+    #include "trace_recorder.h"
+
+    #define STATUS_INTERVAL 1000
+
+    class EncNetwork;
+    class WifiSupervisor;
+
+    // Everything the status views (HTML, JSON, metrics, the diagnostics unit)
+    // show, collected in one pass so a request costs only the serialization
+    // (no driver calls, string building or counter walks in the serving task).
+    struct StatusSnapshot{
+        // millis() of the refresh
+        uint32_t time;
+        // network: SSID and RSSI on WiFi, empty and 0 on Ethernet
+        char ssid[33];
+        int8_t rssi;
+        char mac[18];
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        // WiFi radio and reconnects
+        bool wifiPowerSave;
+        float wifiTxPower;
+        bool wifiFastReconnect;
+        uint32_t wifiReconnects;
+        uint32_t wifiScanReconnects;
+        uint32_t wifiLastReconnect;
+        uint32_t wifiMaxReconnect;
+        uint32_t wifiDowntime;
+        // ENC28J60 network task
+        uint32_t encIrqWakeups;
+        uint32_t encTimerWakeups;
+        // rtu side
+        uint32_t rtuMessages;
+        uint32_t rtuPending;
+        uint32_t rtuErrors;
+        uint8_t simUnits;
+        uint32_t simRequests;
+        uint32_t simInjected;
+        // per unit latency and health
+        uint8_t unitCount;
+        RtuUnitStats units[RTU_MAX_UNIT_STATS];
+        // bridge
+        uint32_t bridgeMessages;
+        uint32_t bridgeErrors;
+        uint32_t clients;
+        uint32_t clientsAccepted;
+        uint32_t clientsEvicted;
+        uint32_t clientsRefused;
+        uint32_t inFlight;
+        uint32_t rejected[REJECT_REASONS];
+        uint32_t coalescedWrites;
+        uint32_t coalescedFrames;
+        uint32_t sharedReads;
+        uint32_t poolInUse;
+        uint32_t poolHighWater;
+        uint32_t poolFallbacks;
+        // connection slots, client[i] is only valid where clientValid[i] is set
+        uint8_t maxClients;
+        bool clientValid[TCP_BRIDGE_MAX_CLIENTS];
+        BridgeClientStats client[TCP_BRIDGE_MAX_CLIENTS];
+        // trace recorder
+        bool traceEnabled;
+        uint32_t traceRecords;
+        uint32_t traceUsed;
+        uint32_t traceDropped;
+        // MQTT
+        bool mqttEnabled;
+        bool mqttConnected;
+        uint32_t mqttTags;
+        uint32_t mqttPublishes;
+        uint32_t mqttReadErrors;
+        // heap and stacks (telemetry)
+        uint32_t heapFree;
+        uint32_t heapMinFree;
+        uint32_t heapLargestBlock;
+        uint32_t heapMinLargestBlock;
+        uint8_t heapFragmentation;
+        uint32_t allocFailures;
+        uint8_t taskCount;
+        TaskStackStats tasks[TELEMETRY_MAX_TASKS];
+        // boot profile, phase names are string literals
+        const char *bootResetReason;
+        bool bootFastPath;
+        uint8_t bootPhaseCount;
+        const char *bootPhaseNames[BOOT_MAX_PHASES];
+        uint32_t bootPhaseMs[BOOT_MAX_PHASES];
+        uint32_t bootMs;
+    };
+
+    // Refreshes the snapshot every STATUS_INTERVAL ms in a low priority task.
+    // Short readers (the diagnostics unit) use it between lock() and unlock();
+    // a refresh fills a second copy and only holds the lock to swap it in.
+    // Views that write to a socket format a copy taken with beginView(), so a
+    // slow client never holds up the refresh or the bridge. The locks exist
+    // from construction, so views served before begin() see an empty snapshot.
+    class StatusSnapshots{
+        private:
+            TaskHandle_t _task;
+            SemaphoreHandle_t _lock;
+            SemaphoreHandle_t _viewLock;
+            StatusSnapshot _snapshots[2];
+            StatusSnapshot _view;
+            uint8_t _current;
+            RtuClient *_rtu;
+            TcpBridge *_bridge;
+            MqttPublisher *_mqtt;
+            Config *_config;
+            EncNetwork *_network;
+            WifiSupervisor *_wifi;
+            static void task(void *arg);
+            void collect(StatusSnapshot &snapshot);
+            void refresh();
+        public:
+            StatusSnapshots();
+            // network and wifi: the one of the build, the other is nullptr
+            void begin(RtuClient *rtu, TcpBridge *bridge, MqttPublisher *mqtt, Config *config, EncNetwork *network, WifiSupervisor *wifi);
+            // the latest snapshot, valid until unlock()
+            const StatusSnapshot &lock();
+            void unlock();
+            // a copy of the latest snapshot, valid until endView()
+            const StatusSnapshot &beginView();
+            void endView();
+            void printJson(Print &out);
+            void printMetrics(Print &out);
+    };
+
+    extern StatusSnapshots statusSnapshots;
+#endif /* STATUS_SNAPSHOT_H */
@@ -0,0 +1,284 @@
+#ifndef TCP_BRIDGE_H
+    #define TCP_BRIDGE_H
+
+    #include <Arduino.h>
+    #include "config.h"
+    #include "message_pool.h"
+    #include "rtu_client.h"
+    #include "spsc_queue.h"
+    #include "event_log.h"
+    #include "trace_recorder.h"
+
+    #ifdef USE_ENC28J60
+        #include <EthernetENC.h>
+        typedef EthernetServer BridgeServer;
+        typedef EthernetClient BridgeClient;
+    #else
+        #include <WiFi.h>
+        typedef WiFiServer BridgeServer;
+        typedef WiFiClient BridgeClient;
+    #endif
+
+    #define TCP_BRIDGE_MAX_CLIENTS 4
+    #define TCP_BRIDGE_MAX_INFLIGHT 8
+    #define TCP_BRIDGE_MAX_TRANSACTIONS (TCP_BRIDGE_MAX_CLIENTS * TCP_BRIDGE_MAX_INFLIGHT)
+    // MBAP header (7 bytes) + max. PDU (253 bytes)
+    #define MBAP_HEADER_SIZE 7
+    #define MODBUS_MAX_ADU 260
+    #define MODBUS_MAX_PDU 253
+    // pending fc06 -> fc16 write batches (one per unit)
+    #define TCP_BRIDGE_MAX_BATCHES 4
+    // fc16 allows 123 registers per request
+    #define TCP_BRIDGE_MAX_BATCH_REGS 123
+    // request/response buffers kept in the arena, more in-flight transactions
+    // fall back to the heap
+    #define TCP_BRIDGE_POOL_BLOCKS 16
+    // keepalive probes after the configured idle time: interval (s) and count
+    #define TCP_BRIDGE_KEEPALIVE_INTERVAL 5
+    #define TCP_BRIDGE_KEEPALIVE_COUNT 3
+    // per address bus share weights from the config
+    #define TCP_BRIDGE_MAX_WEIGHTS 8
+
+    class DiagnosticsUnit;
+
+    // reasons a request is answered by the bridge instead of reaching the bus
+    enum BridgeReject{
+        REJECT_FRAMING,     // mbap protocol id or length, the connection is closed
+        REJECT_UNIT,        // broadcast or unit above 247
+        REJECT_FUNCTION,    // reserved or undefined function code
+        REJECT_LENGTH,      // pdu length or byte count does not fit the function code
+        REJECT_QUANTITY,    // quantity outside the limits of the function code
+        REJECT_ADDRESS,     // address + quantity beyond 65535
+        REJECT_REASONS
+    };
+
+    // request budget, refilled continuously at the configured rate up to the burst size
+    struct TokenBucket{
+        // in 1/1000 requests
+        uint32_t tokens;
+        unsigned long updated;
+    };
+
+    // rate limit shared by all connections from one address
+    struct ClientAddress{
+        uint32_t ip;
+        uint8_t connections;
+        TokenBucket bucket;
+    };
+
+    struct BridgeConnection{
+        BridgeClient client;
+        bool active;
+        uint16_t generation;
+        uint8_t inFlight;
+        unsigned long lastActivity;
+        unsigned long connected;
+        uint32_t ip;
+        int8_t address;
+        uint8_t weight;
+        TokenBucket bucket;
+        uint32_t requests;
+        uint32_t dropped;
+        uint16_t rxLen;
+        uint8_t rx[MODBUS_MAX_ADU];
+    };
+
+    // one request travelling from a tcp connection to the rtu bus and back.
+    // data (a pool buffer of MODBUS_MAX_PDU + 1 bytes) holds the request
+    // [unit, fc, ...] and is overwritten by the response
+    struct BridgeTransaction{
+        bool used;
+        // set by the network task when the connection closed, the engine
+        // drops the transaction instead of sending it
+        volatile bool cancelled;
+        uint8_t connection;
+        uint16_t generation;
+        uint16_t transactionId;
+        uint8_t unit;
+        uint8_t function;
+        unsigned long start;
+        // time spent on the rtu bus in us
+        uint32_t busTime;
+        // next member of a coalesced write, -1 if none
+        int8_t next;
+        // next transaction waiting for the bus from the same connection
+        int8_t queueNext;
+        // first read answered from this transaction's response, -1 if none.
+        // Followers have no buffer of their own (data is NULL)
+        int8_t duplicate;
+        // address and quantity of a read, the request bytes in data are
+        // overwritten by the engine
+        uint8_t range[4];
+        // writes to the unit accepted up to this one, a read is only shared
+        // with a leader that no write was accepted after
+        uint16_t writeSequence;
+        uint16_t len;
+        uint8_t *data;
+    };
+
+    // consecutive single register writes of one unit waiting to be sent as one fc16
+    struct WriteBatch{
+        bool open;
+        uint8_t unit;
+        uint16_t address;
+        uint8_t count;
+        int8_t first;
+        int8_t last;
+        unsigned long opened;
+    };
+
+    // engine side of a connection: transactions waiting for the bus and the
+    // bus time used, owned by the rtu engine task
+    struct BridgeShare{
+        int8_t head;
+        int8_t tail;
+        uint8_t queued;
+        uint16_t generation;
+        // bus time divided by the weight, in us (wraps, compared as a difference)
+        uint32_t pass;
+        uint32_t busTime;
+        uint16_t busRemainder;
+    };
+
+    struct BridgeClientStats{
+        uint32_t ip;
+        uint8_t weight;
+        uint8_t inFlight;
+        uint8_t queued;
+        uint32_t requests;
+        uint32_t dropped;
+        // ms on the rtu bus since the client connected
+        uint32_t busTime;
+        // ms since the client connected and since it last sent or received
+        uint32_t connected;
+        uint32_t idle;
+    };
+
+    // Modbus TCP server forwarding to the RTU client. Unlike the eModbus bridge,
+    // requests are not answered one at a time: up to maxInFlight transactions per
+    // connection are queued and answered with their own transaction id as soon
+    // as they complete.
+    //
+    // A read identical to one already queued or on the bus (same unit, function
+    // code, address and quantity) is not sent again, it is answered from the
+    // response of the first one (single flight).
+    //
+    // Bus time is shared between the connections by weighted fair queueing:
+    // the engine keeps a queue per connection and always serves the one that
+    // used the least bus time relative to its weight, so a master polling in
+    // a tight loop cannot starve the others. Token buckets per connection and
+    // per client address limit the request rate, requests beyond it are
+    // answered with exception 0x06 (server busy).
+    //
+    // Threading: the network task (tcp sockets) and the rtu engine task (bus
+    // transactions) run on separate cores and only exchange transaction slot
+    // indexes through two lock-free single producer / single consumer queues.
+    class TcpBridge{
+        private:
+            BridgeServer *_server;
+            RtuClient *_rtu;
+            DiagnosticsUnit *_diagnostics;
+            uint32_t _timeout;
+            uint8_t _maxClients;
+            uint8_t _maxInFlight;
+            SpscQueue<uint8_t, 64> _requests;
+            SpscQueue<uint8_t, 64> _completed;
+            MessagePool<MODBUS_MAX_PDU + 1, TCP_BRIDGE_POOL_BLOCKS> _pool;
+            TaskHandle_t _task;
+            TaskHandle_t _engine;
+            TaskHandle_t _poller;
+            int8_t _netCore;
+            uint8_t _netPriority;
+            int8_t _rtuCore;
+            uint8_t _rtuPriority;
+            uint32_t _messageCount;
+            uint32_t _errorCount;
+            uint32_t _coalescedWrites;
+            uint32_t _coalescedFrames;
+            uint32_t _sharedReads;
+            uint16_t _writeSequence[256];
+            uint16_t _evictIdle;
+            uint16_t _keepAlive;
+            uint32_t _accepted;
+            uint32_t _evicted;
+            uint32_t _refused;
+            uint16_t _coalesceWindow;
+            uint32_t _coalesceUnits[8];
+            uint32_t _rejected[REJECT_REASONS];
+            uint16_t _connectionRate;
+            uint16_t _addressRate;
+            uint8_t _burst;
+            uint8_t _weightCount;
+            uint32_t _weightIps[TCP_BRIDGE_MAX_WEIGHTS];
+            uint8_t _weights[TCP_BRIDGE_MAX_WEIGHTS];
+            ClientAddress _addresses[TCP_BRIDGE_MAX_CLIENTS];
+            BridgeShare _shares[TCP_BRIDGE_MAX_CLIENTS];
+            uint32_t _pass;
+            WriteBatch _batches[TCP_BRIDGE_MAX_BATCHES];
+            BridgeConnection _connections[TCP_BRIDGE_MAX_CLIENTS];
+            BridgeTransaction _transactions[TCP_BRIDGE_MAX_TRANSACTIONS];
+            static void task(void *arg);
+            static void engineTask(void *arg);
+            void execute(uint8_t slot);
+            void drop(int8_t slot);
+            int16_t schedule();
+            void charge(uint8_t index, uint32_t busTime);
+            bool admit(BridgeConnection &connection);
+            bool take(TokenBucket &bucket, uint16_t rate, unsigned long now);
+            void accept();
+            void receive(uint8_t index);
+            bool dispatch(uint8_t index);
+            static int8_t validate(const uint8_t *pdu, uint16_t len, Modbus::Error &error);
+            void reject(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint8_t reason, Modbus::Error error);
+            void answerLocally(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint16_t len);
+            void complete();
+            void finish(uint8_t slot);
+            void close(uint8_t index);
+            void cancel(uint8_t index);
+            int16_t allocate();
+            void enqueue(int16_t slot);
+            void submit(int16_t slot);
+            void fail(int16_t slot, Modbus::Error error);
+            bool coalesce(int16_t slot);
+            bool share(int16_t slot);
+            void respond(BridgeTransaction &transaction, const uint8_t *pdu, uint16_t len, uint32_t busTime);
+            void flushBatch(WriteBatch &batch);
+            void flushBatches(bool expiredOnly, uint8_t unit = 0);
+            bool isCoalesced(uint8_t unit);
+            void sendException(uint8_t index, uint16_t transactionId, uint8_t unit, uint8_t function, Modbus::Error error);
+            void send(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint16_t len);
+        public:
+            TcpBridge();
+            void start(RtuClient *rtu, uint16_t port, uint8_t maxClients, uint32_t timeout, uint8_t maxInFlight, bool ownTask = true);
+            void setTasks(int8_t netCore, uint8_t netPriority, int8_t rtuCore, uint8_t rtuPriority);
+            void poll();
+            void setWriteCoalescing(String units, uint16_t window);
+            // requests per second per connection and per address (0 = unlimited),
+            // weights as "192.168.1.10=4,192.168.1.20=2" (default 1)
+            void setClientLimits(uint16_t connectionRate, uint16_t addressRate, uint8_t burst, String weights);
+            // must be called before start(): idle ms after which the least recently
+            // active connection is closed for a new client at the limit, keepalive
+            // idle in s (0 = off, WiFi only, uIP has no keepalive)
+            void setConnectionLimits(uint16_t evictIdle, uint16_t keepAlive);
+            // requests for its unit are answered in the network task, never queued
+            void setDiagnostics(DiagnosticsUnit *diagnostics);
+            uint8_t getMaxClients();
+            uint32_t getAcceptedClients();
+            uint32_t getEvictedClients();
+            uint32_t getRefusedClients();
+            // false if there is no client on that connection
+            bool getClientStats(uint8_t index, BridgeClientStats &stats);
+            uint32_t getCoalescedWrites();
+            uint32_t getCoalescedFrames();
+            uint32_t getSharedReads();
+            uint32_t getPoolInUse();
+            uint32_t getPoolHighWater();
+            uint32_t getPoolFallbacks();
+            uint32_t getMessageCount();
+            uint32_t getErrorCount();
+            uint32_t getRejected(uint8_t reason);
+            static const char *rejectName(uint8_t reason);
+            uint32_t activeClients();
+            uint32_t pendingTransactions();
+    };
+#endif /* TCP_BRIDGE_H */
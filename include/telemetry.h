@@ -0,0 +1,56 @@
+#ifndef TELEMETRY_H
+    #define TELEMETRY_H
+
+    #include <Arduino.h>
+    #include <esp_heap_caps.h>
+    #include "event_log.h"
+
+    #define TELEMETRY_MAX_TASKS 16
+    #define TELEMETRY_INTERVAL 1000
+    // warn when the largest free block drops below this (fragmentation)
+    #define TELEMETRY_LOW_BLOCK 8192
+
+    struct TaskStackStats{
+        char name[configMAX_TASK_NAME_LEN];
+        // lowest stack high-water mark seen, in bytes
+        uint32_t minFree;
+        bool alive;
+    };
+
+    // Samples heap and task stack usage in a low priority task so that a slow
+    // leak or fragmentation shows up long before an allocation fails.
+    class Telemetry{
+        private:
+            TaskHandle_t _task;
+            portMUX_TYPE _lock;
+            uint32_t _freeHeap;
+            uint32_t _minFreeHeap;
+            uint32_t _largestBlock;
+            uint32_t _minLargestBlock;
+            uint32_t _reportedFailures;
+            bool _lowBlock;
+            uint8_t _taskCount;
+            TaskStackStats _tasks[TELEMETRY_MAX_TASKS];
+            static volatile uint32_t _allocFailures;
+            static volatile uint32_t _lastFailedSize;
+            static void allocFailed(size_t size, uint32_t caps, const char *function);
+            static void task(void *arg);
+            void sampleHeap();
+            void sampleTasks();
+        public:
+            Telemetry();
+            void begin();
+            void sample();
+            uint32_t getFreeHeap();
+            uint32_t getMinFreeHeap();
+            uint32_t getLargestBlock();
+            uint32_t getMinLargestBlock();
+            uint8_t getFragmentation();
+            uint32_t getAllocFailures();
+            uint32_t getLastFailedSize();
+            uint8_t getTaskCount();
+            TaskStackStats getTask(uint8_t index);
+    };
+
+    extern Telemetry telemetry;
+#endif /* TELEMETRY_H */
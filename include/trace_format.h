@@ -0,0 +1,21 @@
+#ifndef TRACE_FORMAT_H
+    #define TRACE_FORMAT_H
+
+    // Bridge traffic trace, shared by the firmware and tools/trace.
+    // All values little endian.
+    //
+    // file header: "MBTR", u8 version, 3 reserved bytes, u32 dropped records
+    // record: u8 type, u8 connection, u16 transaction id, u32 time (us),
+    //         u32 bus time (us, responses only), u8 pdu length, pdu
+    // pdu: [unit, fc, data...] as on the bus, without crc
+    //
+    // Requests are recorded when they leave the receive buffer, responses when
+    // they are sent back. The bus time of a response is the time the rtu engine
+    // spent on the transaction (0 for answers the gateway made up itself).
+    #define TRACE_MAGIC "MBTR"
+    #define TRACE_VERSION 1
+    #define TRACE_FILE_HEADER_SIZE 12
+    #define TRACE_RECORD_HEADER_SIZE 13
+    #define TRACE_REQUEST 'Q'
+    #define TRACE_RESPONSE 'R'
+#endif /* TRACE_FORMAT_H */
@@ -0,0 +1,58 @@
+#ifndef TRACE_RECORDER_H
+    #define TRACE_RECORDER_H
+
+    #include <Arduino.h>
+    #include "trace_format.h"
+
+    // Position of a download in the trace: the file header, then the records
+    // one at a time, each copied out of the ring under a short lock.
+    struct TraceCursor{
+        // stream offsets (bytes ever recorded) of the next record and of the
+        // end of the ring when the download started
+        uint32_t position;
+        uint32_t end;
+        uint16_t staged;
+        uint16_t sent;
+        uint8_t data[TRACE_RECORD_HEADER_SIZE + UINT8_MAX];
+    };
+
+    // Records the bridge's request/response stream into a RAM ring (the oldest
+    // records are overwritten) for download from the web UI and replay with
+    // tools/trace. Recording never blocks the bridge: while a download copies a
+    // record out of the ring the new record is dropped and counted instead.
+    class TraceRecorder{
+        private:
+            uint8_t *_buffer;
+            uint32_t _size;
+            uint32_t _head;
+            uint32_t _tail;
+            uint32_t _used;
+            // bytes ever recorded, the stream offset of _head
+            uint32_t _total;
+            uint32_t _records;
+            uint32_t _dropped;
+            SemaphoreHandle_t _lock;
+            void put(const uint8_t *data, uint32_t len);
+            void get(uint32_t pos, uint8_t *data, uint32_t len);
+            bool stageRecord(TraceCursor &cursor);
+        public:
+            TraceRecorder();
+            // size in bytes, 0 leaves recording off
+            void begin(uint32_t size);
+            bool enabled(){ return _buffer != NULL; }
+            void record(uint8_t type, uint8_t connection, uint16_t transactionId, uint32_t busTime, const uint8_t *pdu, uint8_t len);
+            // starts a download of the trace file (header and the records
+            // recorded so far, oldest first)
+            void beginRead(TraceCursor &cursor);
+            // next up to len bytes of the file, 0 at its end. Records
+            // overwritten meanwhile are skipped.
+            size_t read(TraceCursor &cursor, uint8_t *data, size_t len);
+            void clear();
+            uint32_t getRecords();
+            uint32_t getUsed();
+            uint32_t getSize();
+            uint32_t getDropped();
+    };
+
+    extern TraceRecorder traceRecorder;
+#endif /* TRACE_RECORDER_H */
@@ -0,0 +1,50 @@
+#ifndef VIRTUAL_SLAVES_H
+    #define VIRTUAL_SLAVES_H
+
+    #include <Arduino.h>
+    #include <ModbusTypeDefs.h>
+
+    #define SIM_MAX_UNITS 8
+    // per unit and table: coils/discrete inputs and holding/input registers
+    #define SIM_BITS 1024
+    #define SIM_REGISTERS 256
+
+    struct SimUnit{
+        uint8_t id;
+        uint32_t requests;
+        uint8_t coils[SIM_BITS / 8];
+        uint8_t discreteInputs[SIM_BITS / 8];
+        uint16_t holdingRegisters[SIM_REGISTERS];
+        uint16_t inputRegisters[SIM_REGISTERS];
+    };
+
+    // In-memory slaves answering in place of the RTU bus, so the network side
+    // (bridge, web UI, MQTT) can be loaded at full rate without serial devices.
+    // Each unit has its own register tables; input registers hold their address
+    // except register 0, which counts the requests the unit served. Answers are
+    // delayed by a fixed time and a share of them can be turned into exceptions
+    // (0x04 server device failure) or timeouts.
+    class VirtualSlaves{
+        private:
+            SimUnit *_units;
+            uint8_t _count;
+            uint16_t _delay;
+            uint8_t _exceptionRate;
+            uint8_t _timeoutRate;
+            SemaphoreHandle_t _lock;
+            uint32_t _requests;
+            uint32_t _injected;
+            SimUnit *find(uint8_t unit);
+            uint8_t execute(SimUnit &unit, uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen);
+        public:
+            VirtualSlaves();
+            // units as "1,5,10-12" (at most SIM_MAX_UNITS), delay in ms, rates in percent
+            void begin(String units, uint16_t delay, uint8_t exceptionRate, uint8_t timeoutRate);
+            bool handles(uint8_t unit);
+            // same contract as RtuClient::transact, timeout is the client's response timeout
+            Modbus::Error transact(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, uint32_t timeout);
+            uint8_t getUnitCount();
+            uint32_t getRequests();
+            uint32_t getInjectedErrors();
+    };
+#endif /* VIRTUAL_SLAVES_H */
@@ -0,0 +1,70 @@
+#ifndef WIFI_SUPERVISOR_H
+    #define WIFI_SUPERVISOR_H
+
+    #include <Arduino.h>
+    #include <WiFi.h>
+    #include "config.h"
+    #include "event_log.h"
+
+    #define WIFI_SUPERVISOR_INTERVAL 50
+    // a connect attempt that is not through after this is retried
+    #define WIFI_RECONNECT_TIMEOUT 2000
+    // every n-th attempt scans all channels, in case the access point moved
+    #define WIFI_RECONNECT_SCAN_EVERY 3
+
+    // Applies the radio settings (modem sleep, TX power) and, with fast
+    // reconnect, replaces the core's auto reconnect: after a connection loss
+    // the station rejoins the access point it was last connected to by BSSID
+    // and channel, which skips the scan of all channels. Reconnect count and
+    // durations are kept for the status page.
+    // With fast boot every DHCP lease (the first one, renewals, a new address)
+    // is written to the network cache. A station started on the cached lease
+    // keeps that address while the DHCP client asks for it once the station is
+    // up; the client then renews the lease like any other.
+    class WifiSupervisor{
+        private:
+            TaskHandle_t _task;
+            String _ssid;
+            String _password;
+            uint8_t _bssid[6];
+            int32_t _channel;
+            bool _pinned;
+            bool _powerSave;
+            bool _connected;
+            uint32_t _lostAt;
+            uint32_t _attemptAt;
+            uint8_t _attempts;
+            bool _attemptPinned;
+            uint32_t _reconnects;
+            uint32_t _scanReconnects;
+            uint32_t _lastReconnect;
+            uint32_t _maxReconnect;
+            uint32_t _downtime;
+            Config *_config;
+            bool _renew;
+            bool _leaseKnown;
+            uint32_t _leaseUsed;
+            static void task(void *arg);
+            void run();
+            void attempt(uint32_t now);
+            void keepLease();
+        public:
+            WifiSupervisor();
+            // call when connected; txPower in 0.25 dBm (wifi_power_t)
+            void begin(bool powerSave, int8_t txPower, bool fastReconnect);
+            // before begin(); renew when the station runs on the cached lease
+            void setLeaseCache(Config *config, bool renew);
+            bool getPowerSave();
+            // dBm
+            float getTxPower();
+            bool isFastReconnect();
+            uint32_t getReconnects();
+            // reconnects that needed a full scan
+            uint32_t getScanReconnects();
+            // ms from the loss to the next connect
+            uint32_t getLastReconnect();
+            uint32_t getMaxReconnect();
+            // ms without connection, including the current outage
+            uint32_t getDowntime();
+    };
+#endif /* WIFI_SUPERVISOR_H */
@@ -0,0 +1,74 @@
+#include "boot_profile.h"
+
+BootProfile bootProfile;
+
+BootProfile::BootProfile()
+    :_count(0)
+    ,_resetReason(ESP_RST_UNKNOWN)
+    ,_fastPath(false)
+{}
+
+void BootProfile::begin(){
+    _resetReason = esp_reset_reason();
+}
+
+void BootProfile::mark(const char *name){
+    if (_count >= BOOT_MAX_PHASES) return;
+    _names[_count] = name;
+    _ends[_count] = esp_timer_get_time();
+    _count++;
+}
+
+void BootProfile::setFastPath(bool fastPath){
+    _fastPath = fastPath;
+}
+
+bool BootProfile::getFastPath(){
+    return _fastPath;
+}
+
+bool BootProfile::isWarmReset(){
+    switch (_resetReason){
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char *BootProfile::getResetReason(){
+    switch (_resetReason){
+        case ESP_RST_POWERON: return "power-on";
+        case ESP_RST_EXT: return "external";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "interrupt watchdog";
+        case ESP_RST_TASK_WDT: return "task watchdog";
+        case ESP_RST_WDT: return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep sleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_SDIO: return "sdio";
+        default: return "unknown";
+    }
+}
+
+uint8_t BootProfile::getCount(){
+    return _count;
+}
+
+const char *BootProfile::getName(uint8_t index){
+    return index < _count ? _names[index] : "";
+}
+
+uint32_t BootProfile::getDuration(uint8_t index){
+    if (index >= _count) return 0;
+    return (_ends[index] - (index > 0 ? _ends[index - 1] : 0)) / 1000;
+}
+
+uint32_t BootProfile::getTotal(){
+    return _count > 0 ? _ends[_count - 1] / 1000 : 0;
+}
@@ -0,0 +1,189 @@
+#include "bus_history.h"
+
+BusHistory busHistory;
+
+// upper bounds of the latency bins in us, half an octave apart from 250 us to
+// 512 ms, the last bin takes the rest
+static const uint32_t binBounds[HISTORY_BINS - 1] = {
+    250, 354, 500, 707, 1000, 1414, 2000, 2828, 4000, 5657, 8000, 11314,
+    16000, 22627, 32000, 45255, 64000, 90510, 128000, 181019, 256000, 362039, 512000
+};
+
+static const char *fieldNames[HISTORY_FIELDS] = {"requests", "bytes", "timeouts", "crcErrors", "avgUs", "p95Us"};
+static const char *fieldLabels[HISTORY_FIELDS] = {"Requests", "Bytes", "Timeouts", "CRC Errors", "Latency Avg", "Latency p95"};
+
+HistoryRing::HistoryRing(uint32_t period)
+    :_period(period)
+    ,_openAt(0)
+    ,_next(0)
+    ,_count(0)
+    ,_buckets()
+    ,_requests(0)
+    ,_bytes(0)
+    ,_timeouts(0)
+    ,_crcErrors(0)
+    ,_latencySum(0)
+    ,_latencyMax(0)
+    ,_bins()
+{}
+
+void HistoryRing::advance(uint32_t now){
+    uint32_t elapsed = now - _openAt;
+    if (elapsed < _period) return;
+    uint32_t periods = elapsed / _period;
+    // after a long gap only the last HISTORY_LENGTH buckets matter
+    if (periods > HISTORY_LENGTH + 1){
+        _openAt += (periods - HISTORY_LENGTH - 1) * _period;
+        periods = HISTORY_LENGTH + 1;
+    }
+    while (periods-- > 0){
+        close();
+        _openAt += _period;
+    }
+}
+
+void HistoryRing::close(){
+    auto &bucket = _buckets[_next];
+    bucket.requests = _requests;
+    bucket.bytes = _bytes;
+    bucket.timeouts = _timeouts;
+    bucket.crcErrors = _crcErrors;
+    bucket.avgLatency = _requests ? _latencySum / _requests : 0;
+    // upper bound of the bin holding the 95th percentile, never above the slowest one
+    bucket.p95Latency = 0;
+    uint32_t rank = (_requests * 95 + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < HISTORY_BINS && _requests; i++){
+        seen += _bins[i];
+        if (seen >= rank){
+            bucket.p95Latency = i < HISTORY_BINS - 1 ? min(binBounds[i], _latencyMax) : _latencyMax;
+            break;
+        }
+    }
+    _next = (_next + 1) % HISTORY_LENGTH;
+    if (_count < HISTORY_LENGTH) _count++;
+    _requests = 0;
+    _bytes = 0;
+    _timeouts = 0;
+    _crcErrors = 0;
+    _latencySum = 0;
+    _latencyMax = 0;
+    memset(_bins, 0, sizeof(_bins));
+}
+
+void HistoryRing::add(uint16_t bytes, uint32_t latency, bool timeout, bool crcError){
+    _requests++;
+    _bytes += bytes;
+    if (timeout) _timeouts++;
+    if (crcError) _crcErrors++;
+    _latencySum += latency;
+    _latencyMax = max(_latencyMax, latency);
+    uint8_t bin = 0;
+    while (bin < HISTORY_BINS - 1 && latency > binBounds[bin]) bin++;
+    if (_bins[bin] < UINT16_MAX) _bins[bin]++;
+}
+
+uint8_t HistoryRing::copy(HistoryField field, uint32_t *values){
+    uint8_t first = (_next + HISTORY_LENGTH - _count) % HISTORY_LENGTH;
+    for (uint8_t i = 0; i < _count; i++){
+        auto &bucket = _buckets[(first + i) % HISTORY_LENGTH];
+        switch (field){
+            case HISTORY_REQUESTS: values[i] = bucket.requests; break;
+            case HISTORY_BYTES: values[i] = bucket.bytes; break;
+            case HISTORY_TIMEOUTS: values[i] = bucket.timeouts; break;
+            case HISTORY_CRC_ERRORS: values[i] = bucket.crcErrors; break;
+            case HISTORY_AVG_LATENCY: values[i] = bucket.avgLatency; break;
+            default: values[i] = bucket.p95Latency; break;
+        }
+    }
+    return _count;
+}
+
+uint32_t HistoryRing::getPeriod(){
+    return _period;
+}
+
+BusHistory::BusHistory()
+    :_lock(portMUX_INITIALIZER_UNLOCKED)
+    ,_rings{HistoryRing(1000), HistoryRing(60000)}
+{}
+
+// called by the RTU client with the bus lock held, a few adds and compares
+void BusHistory::record(uint16_t bytes, uint32_t latency, bool timeout, bool crcError){
+    uint32_t now = millis();
+    portENTER_CRITICAL(&_lock);
+    for (auto &ring : _rings){
+        ring.advance(now);
+        ring.add(bytes, latency, timeout, crcError);
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint8_t BusHistory::getSeries(HistoryRange range, HistoryField field, uint32_t *values){
+    uint32_t now = millis();
+    portENTER_CRITICAL(&_lock);
+    // an idle bus records nothing, close its buckets here
+    _rings[range].advance(now);
+    uint8_t count = _rings[range].copy(field, values);
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+// {"seconds":{"period":1000,"requests":[...],...},"minutes":{...}}, one
+// series copied at a time so the lock is never held while sending
+void BusHistory::printJson(Print &out){
+    static const char *rangeNames[HISTORY_RANGES] = {"seconds", "minutes"};
+    uint32_t values[HISTORY_LENGTH];
+    out.print('{');
+    for (uint8_t range = 0; range < HISTORY_RANGES; range++){
+        out.printf("%s\"%s\":{\"period\":%u", range ? "," : "", rangeNames[range], _rings[range].getPeriod());
+        for (uint8_t field = 0; field < HISTORY_FIELDS; field++){
+            uint8_t count = getSeries((HistoryRange)range, (HistoryField)field, values);
+            out.printf(",\"%s\":[", fieldNames[field]);
+            for (uint8_t i = 0; i < count; i++){
+                out.printf(i ? ",%u" : "%u", values[i]);
+            }
+            out.print(']');
+        }
+        out.print('}');
+    }
+    out.print('}');
+}
+
+void BusHistory::printSparklines(Print &out){
+    static const char *rangeUnits[HISTORY_RANGES] = {"s", "min"};
+    static const char *rangeSpans[HISTORY_RANGES] = {"1 min", "1 h"};
+    uint32_t values[HISTORY_LENGTH];
+    for (uint8_t range = 0; range < HISTORY_RANGES; range++){
+        for (uint8_t field = 0; field < HISTORY_FIELDS; field++){
+            uint8_t count = getSeries((HistoryRange)range, (HistoryField)field, values);
+            bool latency = field >= HISTORY_AVG_LATENCY;
+            out.printf("<tr><td>Bus %s %s%s (last %s):</td><td>", fieldLabels[field], latency ? "ms" : "per ", latency ? "" : rangeUnits[range], rangeSpans[range]);
+            if (count == 0){
+                out.print("-</td></tr>");
+                continue;
+            }
+            printSparkline(out, values, count);
+            uint32_t peak = 0;
+            for (uint8_t i = 0; i < count; i++) peak = max(peak, values[i]);
+            if (latency) out.printf(" %.1f (max %.1f)</td></tr>", values[count - 1] / 1000.0, peak / 1000.0);
+            else out.printf(" %u (max %u)</td></tr>", values[count - 1], peak);
+        }
+    }
+}
+
+// newest bucket at the right edge, scaled to the largest value
+void BusHistory::printSparkline(Print &out, const uint32_t *values, uint8_t count){
+    uint32_t peak = 1;
+    for (uint8_t i = 0; i < count; i++) peak = max(peak, values[i]);
+    out.printf("<svg width=\"120\" height=\"20\" viewBox=\"0 0 %u 20\" preserveAspectRatio=\"none\" style=\"vertical-align:middle\">"
+        "<polyline fill=\"none\" stroke=\"currentColor\" vector-effect=\"non-scaling-stroke\" points=\"", HISTORY_LENGTH - 1);
+    for (uint8_t i = 0; i < count; i++){
+        out.printf("%u,%u ", HISTORY_LENGTH - count + i, 19 - (uint32_t)((uint64_t)values[i] * 18 / peak));
+    }
+    out.print("\"/></svg>");
+}
+
+const char *BusHistory::fieldName(uint8_t field){
+    return field < HISTORY_FIELDS ? fieldNames[field] : "";
+}
@@ -4,9 +4,14 @@ Config::Config()
     :_prefs(NULL)
     ,_tcpPort(502)
     ,_tcpTimeout(10000)
+    ,_tcpMaxInFlight(4)
+    ,_coalesceUnits("")
+    ,_coalesceWindow(20)
     ,_modbusBaudRate(9600)
     ,_modbusConfig(SERIAL_8N1)
     ,_modbusRtsPin(-1)
+    ,_modbusHwRs485(false)
+    ,_modbusRxTimeout(4)
     ,_serialBaudRate(115200)
     ,_serialConfig(SERIAL_8N1)
     ,_webPassword("")
@@ -15,6 +20,41 @@ Config::Config()
     ,_staticGateway(192, 168, 1, 1)
     ,_staticSubnet(255, 255, 255, 0)
     ,_staticDns(192, 168, 1, 1)
+    ,_mqttEnabled(false)
+    ,_mqttHost("")
+    ,_mqttPort(1883)
+    ,_mqttUser("")
+    ,_mqttPassword("")
+    ,_mqttTopic("modbusgw")
+    ,_mqttPollInterval(1000)
+    ,_mqttSnapshotInterval(60)
+    ,_mqttTags("")
+    ,_encInterrupt(true)
+    ,_netCore(0)
+    ,_netPriority(3)
+    ,_rtuCore(1)
+    ,_rtuPriority(4)
+    ,_logLevel(3)
+    ,_logBinary(false)
+    ,_traceSize(0)
+    ,_simUnits("")
+    ,_simDelay(0)
+    ,_simExceptionRate(0)
+    ,_simTimeoutRate(0)
+    ,_tcpConnectionRate(0)
+    ,_tcpAddressRate(0)
+    ,_tcpBurst(10)
+    ,_tcpWeights("")
+    ,_tcpMaxClients(1)
+    ,_tcpEvictIdle(2000)
+    ,_tcpKeepAlive(30)
+    ,_fastBoot(false)
+    ,_networkCache()
+    ,_networkCached(false)
+    ,_wifiPowerSave(true)
+    ,_wifiTxPower(78)
+    ,_wifiFastReconnect(true)
+    ,_diagUnit(0)
 {}
 
 void Config::begin(Preferences *prefs)
@@ -22,9 +62,14 @@ void Config::begin(Preferences *prefs)
     _prefs = prefs;
     _tcpPort = _prefs->getUShort("tcpPort", _tcpPort);
     _tcpTimeout = _prefs->getULong("tcpTimeout", _tcpTimeout);
+    _tcpMaxInFlight = _prefs->getUChar("tcpMaxInFlight", _tcpMaxInFlight);
+    _coalesceUnits = _prefs->getString("coalesceUnits", _coalesceUnits);
+    _coalesceWindow = _prefs->getUShort("coalesceWindow", _coalesceWindow);
     _modbusBaudRate = _prefs->getULong("modbusBaudRate", _modbusBaudRate);
     _modbusConfig = _prefs->getULong("modbusConfig", _modbusConfig);
     _modbusRtsPin = _prefs->getChar("modbusRtsPin", _modbusRtsPin);
+    _modbusHwRs485 = _prefs->getBool("modbusHwRs485", _modbusHwRs485);
+    _modbusRxTimeout = _prefs->getUChar("modbusRxTout", _modbusRxTimeout);
     _serialBaudRate = _prefs->getULong("serialBaudRate", _serialBaudRate);
     _serialConfig = _prefs->getULong("serialConfig", _serialConfig);
     _webPassword = _prefs->getString("webPassword", _webPassword);
@@ -35,6 +80,64 @@ void Config::begin(Preferences *prefs)
     _staticGateway = _prefs->getUInt("staticGw", (uint32_t)_staticGateway);
     _staticSubnet = _prefs->getUInt("staticSn", (uint32_t)_staticSubnet);
     _staticDns = _prefs->getUInt("staticDns", (uint32_t)_staticDns);
+
+    // MQTT settings
+    _mqttEnabled = _prefs->getBool("mqttEnabled", _mqttEnabled);
+    _mqttHost = _prefs->getString("mqttHost", _mqttHost);
+    _mqttPort = _prefs->getUShort("mqttPort", _mqttPort);
+    _mqttUser = _prefs->getString("mqttUser", _mqttUser);
+    _mqttPassword = _prefs->getString("mqttPass", _mqttPassword);
+    _mqttTopic = _prefs->getString("mqttTopic", _mqttTopic);
+    _mqttPollInterval = _prefs->getULong("mqttPollMs", _mqttPollInterval);
+    _mqttSnapshotInterval = _prefs->getULong("mqttSnapSec", _mqttSnapshotInterval);
+    _mqttTags = _prefs->getString("mqttTags", _mqttTags);
+
+    // ENC28J60 settings
+    _encInterrupt = _prefs->getBool("encInterrupt", _encInterrupt);
+
+    // Task placement
+    _netCore = _prefs->getChar("netCore", _netCore);
+    _netPriority = _prefs->getUChar("netPrio", _netPriority);
+    _rtuCore = _prefs->getChar("rtuCore", _rtuCore);
+    _rtuPriority = _prefs->getUChar("rtuPrio", _rtuPriority);
+
+    // Event log
+    _logLevel = _prefs->getUChar("logLevel", _logLevel);
+    _logBinary = _prefs->getBool("logBinary", _logBinary);
+
+    // Bridge trace
+    _traceSize = _prefs->getUChar("traceSize", _traceSize);
+
+    // Virtual slaves
+    _simUnits = _prefs->getString("simUnits", _simUnits);
+    _simDelay = _prefs->getUShort("simDelay", _simDelay);
+    _simExceptionRate = _prefs->getUChar("simExcPct", _simExceptionRate);
+    _simTimeoutRate = _prefs->getUChar("simTimeoutPct", _simTimeoutRate);
+
+    // Bridge rate limits and bus share
+    _tcpConnectionRate = _prefs->getUShort("tcpConnRate", _tcpConnectionRate);
+    _tcpAddressRate = _prefs->getUShort("tcpIpRate", _tcpAddressRate);
+    _tcpBurst = _prefs->getUChar("tcpBurst", _tcpBurst);
+    _tcpWeights = _prefs->getString("tcpWeights", _tcpWeights);
+
+    // Bridge connections
+    _tcpMaxClients = _prefs->getUChar("tcpMaxClients", _tcpMaxClients);
+    _tcpEvictIdle = _prefs->getUShort("tcpEvictMs", _tcpEvictIdle);
+    _tcpKeepAlive = _prefs->getUShort("tcpKeepAlive", _tcpKeepAlive);
+
+    // Fast boot
+    _fastBoot = _prefs->getBool("fastBoot", _fastBoot);
+    _networkCached = _prefs->isKey("netCache") && _prefs->getBytesLength("netCache") == sizeof(_networkCache)
+        && _prefs->getBytes("netCache", &_networkCache, sizeof(_networkCache)) == sizeof(_networkCache);
+
+    // WiFi radio
+    _wifiPowerSave = _prefs->getBool("wifiPowerSave", _wifiPowerSave);
+    _wifiTxPower = _prefs->getChar("wifiTxPower", _wifiTxPower);
+    _wifiFastReconnect = _prefs->getBool("wifiFastRecon", _wifiFastReconnect);
+
+    // Diagnostics unit
+    _diagUnit = _prefs->getUChar("diagUnit", _diagUnit);
+    if (_diagUnit != 0 && _diagUnit < 248) _diagUnit = 0;
 }
 
 uint16_t Config::getTcpPort(){
@@ -57,6 +160,37 @@ void Config::setTcpTimeout(uint32_t value){
     _prefs->putULong("tcpTimeout", _tcpTimeout);
 }
 
+uint8_t Config::getTcpMaxInFlight(){
+    return _tcpMaxInFlight;
+}
+
+void Config::setTcpMaxInFlight(uint8_t value){
+    if (value == 0) value = 1;
+    if (_tcpMaxInFlight == value) return;
+    _tcpMaxInFlight = value;
+    _prefs->putUChar("tcpMaxInFlight", _tcpMaxInFlight);
+}
+
+String Config::getCoalesceUnits(){
+    return _coalesceUnits;
+}
+
+void Config::setCoalesceUnits(String value){
+    if (_coalesceUnits == value) return;
+    _coalesceUnits = value;
+    _prefs->putString("coalesceUnits", _coalesceUnits);
+}
+
+uint16_t Config::getCoalesceWindow(){
+    return _coalesceWindow;
+}
+
+void Config::setCoalesceWindow(uint16_t value){
+    if (_coalesceWindow == value) return;
+    _coalesceWindow = value;
+    _prefs->putUShort("coalesceWindow", _coalesceWindow);
+}
+
 uint32_t Config::getModbusConfig(){
     return _modbusConfig;
 }
@@ -118,6 +252,27 @@ void Config::setModbusRtsPin(int8_t value){
     _prefs->putChar("modbusRtsPin", _modbusRtsPin);
 }
 
+bool Config::getModbusHwRs485(){
+    return _modbusHwRs485;
+}
+
+void Config::setModbusHwRs485(bool value){
+    if (_modbusHwRs485 == value) return;
+    _modbusHwRs485 = value;
+    _prefs->putBool("modbusHwRs485", _modbusHwRs485);
+}
+
+uint8_t Config::getModbusRxTimeout(){
+    return _modbusRxTimeout;
+}
+
+void Config::setModbusRxTimeout(uint8_t value){
+    if (value == 0) value = 1;
+    if (_modbusRxTimeout == value) return;
+    _modbusRxTimeout = value;
+    _prefs->putUChar("modbusRxTout", _modbusRxTimeout);
+}
+
 uint32_t Config::getSerialConfig(){
     return _serialConfig;
 }
@@ -227,3 +382,404 @@ void Config::setStaticDns(IPAddress value) {
     _staticDns = value;
     _prefs->putUInt("staticDns", (uint32_t)_staticDns);
 }
+
+// MQTT configuration methods
+bool Config::getMqttEnabled() {
+    return _mqttEnabled;
+}
+
+void Config::setMqttEnabled(bool value) {
+    if (_mqttEnabled == value) return;
+    _mqttEnabled = value;
+    _prefs->putBool("mqttEnabled", _mqttEnabled);
+}
+
+String Config::getMqttHost() {
+    return _mqttHost;
+}
+
+void Config::setMqttHost(String value) {
+    if (_mqttHost == value) return;
+    _mqttHost = value;
+    _prefs->putString("mqttHost", _mqttHost);
+}
+
+uint16_t Config::getMqttPort() {
+    return _mqttPort;
+}
+
+void Config::setMqttPort(uint16_t value) {
+    if (_mqttPort == value) return;
+    _mqttPort = value;
+    _prefs->putUShort("mqttPort", _mqttPort);
+}
+
+String Config::getMqttUser() {
+    return _mqttUser;
+}
+
+void Config::setMqttUser(String value) {
+    if (_mqttUser == value) return;
+    _mqttUser = value;
+    _prefs->putString("mqttUser", _mqttUser);
+}
+
+String Config::getMqttPassword() {
+    return _mqttPassword;
+}
+
+void Config::setMqttPassword(String value) {
+    if (_mqttPassword == value) return;
+    _mqttPassword = value;
+    _prefs->putString("mqttPass", _mqttPassword);
+}
+
+String Config::getMqttTopic() {
+    return _mqttTopic;
+}
+
+void Config::setMqttTopic(String value) {
+    if (_mqttTopic == value) return;
+    _mqttTopic = value;
+    _prefs->putString("mqttTopic", _mqttTopic);
+}
+
+uint32_t Config::getMqttPollInterval() {
+    return _mqttPollInterval;
+}
+
+void Config::setMqttPollInterval(uint32_t value) {
+    if (_mqttPollInterval == value) return;
+    _mqttPollInterval = value;
+    _prefs->putULong("mqttPollMs", _mqttPollInterval);
+}
+
+uint32_t Config::getMqttSnapshotInterval() {
+    return _mqttSnapshotInterval;
+}
+
+void Config::setMqttSnapshotInterval(uint32_t value) {
+    if (_mqttSnapshotInterval == value) return;
+    _mqttSnapshotInterval = value;
+    _prefs->putULong("mqttSnapSec", _mqttSnapshotInterval);
+}
+
+String Config::getMqttTags() {
+    return _mqttTags;
+}
+
+void Config::setMqttTags(String value) {
+    if (_mqttTags == value) return;
+    _mqttTags = value;
+    _prefs->putString("mqttTags", _mqttTags);
+}
+
+// ENC28J60 configuration methods
+bool Config::getEncInterrupt() {
+    return _encInterrupt;
+}
+
+void Config::setEncInterrupt(bool value) {
+    if (_encInterrupt == value) return;
+    _encInterrupt = value;
+    _prefs->putBool("encInterrupt", _encInterrupt);
+}
+
+// Task placement methods
+int8_t Config::getNetCore() {
+    return _netCore;
+}
+
+void Config::setNetCore(int8_t value) {
+    if (value > 1) value = -1;
+    if (_netCore == value) return;
+    _netCore = value;
+    _prefs->putChar("netCore", _netCore);
+}
+
+uint8_t Config::getNetPriority() {
+    return _netPriority;
+}
+
+void Config::setNetPriority(uint8_t value) {
+    if (value < 1) value = 1;
+    if (value > configMAX_PRIORITIES - 1) value = configMAX_PRIORITIES - 1;
+    if (_netPriority == value) return;
+    _netPriority = value;
+    _prefs->putUChar("netPrio", _netPriority);
+}
+
+int8_t Config::getRtuCore() {
+    return _rtuCore;
+}
+
+void Config::setRtuCore(int8_t value) {
+    if (value > 1) value = -1;
+    if (_rtuCore == value) return;
+    _rtuCore = value;
+    _prefs->putChar("rtuCore", _rtuCore);
+}
+
+uint8_t Config::getRtuPriority() {
+    return _rtuPriority;
+}
+
+void Config::setRtuPriority(uint8_t value) {
+    if (value < 1) value = 1;
+    if (value > configMAX_PRIORITIES - 1) value = configMAX_PRIORITIES - 1;
+    if (_rtuPriority == value) return;
+    _rtuPriority = value;
+    _prefs->putUChar("rtuPrio", _rtuPriority);
+}
+
+// Event log configuration methods
+uint8_t Config::getLogLevel() {
+    return _logLevel;
+}
+
+void Config::setLogLevel(uint8_t value) {
+    if (value > 4) value = 4;
+    if (_logLevel == value) return;
+    _logLevel = value;
+    _prefs->putUChar("logLevel", _logLevel);
+}
+
+bool Config::getLogBinary() {
+    return _logBinary;
+}
+
+void Config::setLogBinary(bool value) {
+    if (_logBinary == value) return;
+    _logBinary = value;
+    _prefs->putBool("logBinary", _logBinary);
+}
+
+uint8_t Config::getTraceSize() {
+    return _traceSize;
+}
+
+void Config::setTraceSize(uint8_t value) {
+    if (value > 64) value = 64;
+    if (_traceSize == value) return;
+    _traceSize = value;
+    _prefs->putUChar("traceSize", _traceSize);
+}
+
+String Config::getSimUnits() {
+    return _simUnits;
+}
+
+void Config::setSimUnits(String value) {
+    if (_simUnits == value) return;
+    _simUnits = value;
+    _prefs->putString("simUnits", _simUnits);
+}
+
+uint16_t Config::getSimDelay() {
+    return _simDelay;
+}
+
+void Config::setSimDelay(uint16_t value) {
+    if (_simDelay == value) return;
+    _simDelay = value;
+    _prefs->putUShort("simDelay", _simDelay);
+}
+
+uint8_t Config::getSimExceptionRate() {
+    return _simExceptionRate;
+}
+
+void Config::setSimExceptionRate(uint8_t value) {
+    if (value > 100) value = 100;
+    if (_simExceptionRate == value) return;
+    _simExceptionRate = value;
+    _prefs->putUChar("simExcPct", _simExceptionRate);
+}
+
+uint8_t Config::getSimTimeoutRate() {
+    return _simTimeoutRate;
+}
+
+void Config::setSimTimeoutRate(uint8_t value) {
+    if (value > 100) value = 100;
+    if (_simTimeoutRate == value) return;
+    _simTimeoutRate = value;
+    _prefs->putUChar("simTimeoutPct", _simTimeoutRate);
+}
+
+uint16_t Config::getTcpConnectionRate() {
+    return _tcpConnectionRate;
+}
+
+void Config::setTcpConnectionRate(uint16_t value) {
+    if (_tcpConnectionRate == value) return;
+    _tcpConnectionRate = value;
+    _prefs->putUShort("tcpConnRate", _tcpConnectionRate);
+}
+
+uint16_t Config::getTcpAddressRate() {
+    return _tcpAddressRate;
+}
+
+void Config::setTcpAddressRate(uint16_t value) {
+    if (_tcpAddressRate == value) return;
+    _tcpAddressRate = value;
+    _prefs->putUShort("tcpIpRate", _tcpAddressRate);
+}
+
+uint8_t Config::getTcpBurst() {
+    return _tcpBurst;
+}
+
+void Config::setTcpBurst(uint8_t value) {
+    if (value < 1) value = 1;
+    if (_tcpBurst == value) return;
+    _tcpBurst = value;
+    _prefs->putUChar("tcpBurst", _tcpBurst);
+}
+
+String Config::getTcpWeights() {
+    return _tcpWeights;
+}
+
+void Config::setTcpWeights(String value) {
+    if (_tcpWeights == value) return;
+    _tcpWeights = value;
+    _prefs->putString("tcpWeights", _tcpWeights);
+}
+
+uint8_t Config::getTcpMaxClients() {
+    return _tcpMaxClients;
+}
+
+void Config::setTcpMaxClients(uint8_t value) {
+    if (value == 0) value = 1;
+    if (_tcpMaxClients == value) return;
+    _tcpMaxClients = value;
+    _prefs->putUChar("tcpMaxClients", _tcpMaxClients);
+}
+
+uint16_t Config::getTcpEvictIdle() {
+    return _tcpEvictIdle;
+}
+
+void Config::setTcpEvictIdle(uint16_t value) {
+    if (_tcpEvictIdle == value) return;
+    _tcpEvictIdle = value;
+    _prefs->putUShort("tcpEvictMs", _tcpEvictIdle);
+}
+
+uint16_t Config::getTcpKeepAlive() {
+    return _tcpKeepAlive;
+}
+
+void Config::setTcpKeepAlive(uint16_t value) {
+    if (_tcpKeepAlive == value) return;
+    _tcpKeepAlive = value;
+    _prefs->putUShort("tcpKeepAlive", _tcpKeepAlive);
+}
+
+bool Config::getFastBoot() {
+    return _fastBoot;
+}
+
+void Config::setFastBoot(bool value) {
+    if (_fastBoot == value) return;
+    _fastBoot = value;
+    _prefs->putBool("fastBoot", _fastBoot);
+    if (!_fastBoot) clearNetworkCache();
+}
+
+bool Config::getNetworkCache(NetworkCache &cache) {
+    if (!_networkCached) return false;
+    cache = _networkCache;
+    return true;
+}
+
+void Config::setNetworkCache(const NetworkCache &cache) {
+    if (_networkCached && memcmp(&_networkCache, &cache, sizeof(cache)) == 0) return;
+    _networkCache = cache;
+    _networkCached = true;
+    _prefs->putBytes("netCache", &_networkCache, sizeof(_networkCache));
+}
+
+void Config::clearNetworkCache() {
+    if (!_networkCached) return;
+    _networkCached = false;
+    _prefs->remove("netCache");
+}
+
+bool Config::getWifiPowerSave() {
+    return _wifiPowerSave;
+}
+
+void Config::setWifiPowerSave(bool value) {
+    if (_wifiPowerSave == value) return;
+    _wifiPowerSave = value;
+    _prefs->putBool("wifiPowerSave", _wifiPowerSave);
+}
+
+int8_t Config::getWifiTxPower() {
+    return _wifiTxPower;
+}
+
+void Config::setWifiTxPower(int8_t value) {
+    if (_wifiTxPower == value) return;
+    _wifiTxPower = value;
+    _prefs->putChar("wifiTxPower", _wifiTxPower);
+}
+
+bool Config::getWifiFastReconnect() {
+    return _wifiFastReconnect;
+}
+
+void Config::setWifiFastReconnect(bool value) {
+    if (_wifiFastReconnect == value) return;
+    _wifiFastReconnect = value;
+    _prefs->putBool("wifiFastRecon", _wifiFastReconnect);
+}
+
+uint8_t Config::getDiagUnit() {
+    return _diagUnit;
+}
+
+void Config::setDiagUnit(int value) {
+    if (value != 0 && (value < 248 || value > 255)) return;
+    if (_diagUnit == value) return;
+    _diagUnit = value;
+    _prefs->putUChar("diagUnit", _diagUnit);
+}
+
+size_t Config::getRegisterMap(void *data, size_t size) {
+    if (!_prefs->isKey("regMap")) return 0;
+    size_t length = _prefs->getBytesLength("regMap");
+    if (length == 0 || length > size) return 0;
+    return _prefs->getBytes("regMap", data, length);
+}
+
+void Config::setRegisterMap(const void *data, size_t size) {
+    if (size == 0){
+        _prefs->remove("regMap");
+        return;
+    }
+    _prefs->putBytes("regMap", data, size);
+}
+
+void Config::parseUnits(String text, uint32_t *units) {
+    memset(units, 0, 8 * sizeof(uint32_t));
+    int start = 0;
+    while (start < (int)text.length()){
+        auto end = text.indexOf(',', start);
+        if (end < 0) end = text.length();
+        auto item = text.substring(start, end);
+        start = end + 1;
+        item.trim();
+        if (item.length() == 0) continue;
+        auto dash = item.indexOf('-');
+        long from = item.toInt();
+        long to = dash < 0 ? from : item.substring(dash + 1).toInt();
+        for (long unit = max(from, 1L); unit <= min(to, 247L); unit++){
+            units[unit / 32] |= 1UL << (unit % 32);
+        }
+    }
+}
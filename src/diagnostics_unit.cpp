@@ -0,0 +1,213 @@
+#include "diagnostics_unit.h"
+
+// FC08 sub-functions (Modbus application protocol 6.8)
+#define DIAG_RETURN_QUERY_DATA 0x00
+#define DIAG_RESTART_COMMUNICATIONS 0x01
+#define DIAG_CLEAR_COUNTERS 0x0A
+#define DIAG_BUS_MESSAGE_COUNT 0x0B
+#define DIAG_BUS_COMM_ERROR_COUNT 0x0C
+#define DIAG_BUS_EXCEPTION_COUNT 0x0D
+#define DIAG_SERVER_MESSAGE_COUNT 0x0E
+
+// FC43 MEI type and FC43/14 read device id codes
+#define MEI_READ_DEVICE_ID 0x0E
+#define DEVICE_ID_BASIC 0x01
+#define DEVICE_ID_REGULAR 0x02
+#define DEVICE_ID_EXTENDED 0x03
+#define DEVICE_ID_INDIVIDUAL 0x04
+// regular identification, stream and individual access
+#define DEVICE_ID_CONFORMITY 0x82
+#define DEVICE_ID_LAST_BASIC 0x02
+#define DEVICE_ID_LAST_REGULAR 0x06
+
+DiagnosticsUnit::DiagnosticsUnit()
+    :_unit(0)
+    ,_baseMessages(0)
+    ,_baseCommErrors(0)
+    ,_baseExceptions(0)
+    ,_requests(0)
+{}
+
+void DiagnosticsUnit::begin(uint8_t unit){
+    _unit = unit;
+}
+
+uint8_t DiagnosticsUnit::getUnit(){
+    return _unit;
+}
+
+uint32_t DiagnosticsUnit::getRequests(){
+    return _requests;
+}
+
+const uint8_t *DiagnosticsUnit::execute(const uint8_t *pdu, uint16_t len, uint16_t &responseLen){
+    _requests++;
+    _response[0] = pdu[0];
+    switch (pdu[1]){
+        case Modbus::FunctionCode::READ_HOLD_REGISTER:
+        case Modbus::FunctionCode::READ_INPUT_REGISTER:
+            responseLen = readRegisters(pdu, len);
+            break;
+        case Modbus::FunctionCode::DIAGNOSTICS_SERIAL:
+            responseLen = diagnostics(pdu, len);
+            break;
+        case Modbus::FunctionCode::ENCAPSULATED_INTERFACE:
+            responseLen = identification(pdu, len);
+            break;
+        default:
+            responseLen = exception(pdu[1], Modbus::Error::ILLEGAL_FUNCTION);
+            break;
+    }
+    return _response;
+}
+
+uint16_t DiagnosticsUnit::readRegisters(const uint8_t *pdu, uint16_t len){
+    if (len != 6) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    uint16_t address = (pdu[2] << 8) | pdu[3];
+    uint16_t quantity = (pdu[4] << 8) | pdu[5];
+    if (quantity < 1 || quantity > 125) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    if (address + quantity > DIAG_REGISTERS) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_ADDRESS);
+    _response[1] = pdu[1];
+    _response[2] = quantity * 2;
+    auto &s = statusSnapshots.lock();
+    for (uint16_t i = 0; i < quantity; i++){
+        uint16_t value = registerValue(s, address + i);
+        _response[3 + i * 2] = value >> 8;
+        _response[4 + i * 2] = value & 0xff;
+    }
+    statusSnapshots.unlock();
+    return 3 + quantity * 2;
+}
+
+uint16_t DiagnosticsUnit::registerValue(const StatusSnapshot &s, uint16_t address){
+    uint32_t value = 0;
+    // 32 bit values: the first register holds the high word
+    uint16_t word = 0;
+    if (address >= DIAG_REG_UNITS){
+        uint8_t index = (address - DIAG_REG_UNITS) / DIAG_UNIT_REGS;
+        uint8_t offset = (address - DIAG_REG_UNITS) % DIAG_UNIT_REGS;
+        if (index >= s.unitCount) return 0;
+        auto &unit = s.units[index];
+        switch (offset){
+            case 0: return unit.unit;
+            case 1: return unit.timeoutsInRow >= RTU_OFFLINE_TIMEOUTS ? 1 : 0;
+            case 2: case 3: value = unit.requests; word = offset - 2; break;
+            case 4: case 5: value = unit.errors; word = offset - 4; break;
+            case 6: return min(unit.latency / 100, (uint32_t)UINT16_MAX);
+            default: return min(unit.timeouts, (uint32_t)UINT16_MAX);
+        }
+        return word ? value & 0xffff : value >> 16;
+    }
+    switch (address){
+        case DIAG_REG_VERSION: return DIAG_MAP_VERSION;
+        case DIAG_REG_UPTIME: case DIAG_REG_UPTIME + 1: value = s.time / 1000; word = address - DIAG_REG_UPTIME; break;
+        case DIAG_REG_HEAP_FREE: case DIAG_REG_HEAP_FREE + 1: value = s.heapFree; word = address - DIAG_REG_HEAP_FREE; break;
+        case DIAG_REG_HEAP_MIN_FREE: case DIAG_REG_HEAP_MIN_FREE + 1: value = s.heapMinFree; word = address - DIAG_REG_HEAP_MIN_FREE; break;
+        case DIAG_REG_RTU_MESSAGES: case DIAG_REG_RTU_MESSAGES + 1: value = s.rtuMessages; word = address - DIAG_REG_RTU_MESSAGES; break;
+        case DIAG_REG_RTU_ERRORS: case DIAG_REG_RTU_ERRORS + 1: value = s.rtuErrors; word = address - DIAG_REG_RTU_ERRORS; break;
+        case DIAG_REG_RTU_PENDING: return min(s.rtuPending, (uint32_t)UINT16_MAX);
+        case DIAG_REG_IN_FLIGHT: return min(s.inFlight, (uint32_t)UINT16_MAX);
+        case DIAG_REG_CLIENTS: return s.clients;
+        case DIAG_REG_BRIDGE_MESSAGES: case DIAG_REG_BRIDGE_MESSAGES + 1: value = s.bridgeMessages; word = address - DIAG_REG_BRIDGE_MESSAGES; break;
+        case DIAG_REG_BRIDGE_ERRORS: case DIAG_REG_BRIDGE_ERRORS + 1: value = s.bridgeErrors; word = address - DIAG_REG_BRIDGE_ERRORS; break;
+        case DIAG_REG_UNIT_COUNT: return s.unitCount;
+        case DIAG_REG_SNAPSHOT_AGE: return min((uint32_t)(millis() - s.time), (uint32_t)UINT16_MAX);
+        default: return 0;
+    }
+    return word ? value & 0xffff : value >> 16;
+}
+
+// the bus counters are the gateway's TCP side: messages received, framing
+// errors and exception responses, 16 bit and counted since the last clear
+uint16_t DiagnosticsUnit::diagnostics(const uint8_t *pdu, uint16_t len){
+    if (len < 6) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    uint16_t subFunction = (pdu[2] << 8) | pdu[3];
+    uint16_t data = (pdu[4] << 8) | pdu[5];
+    auto &s = statusSnapshots.lock();
+    uint32_t messages = s.bridgeMessages;
+    uint32_t commErrors = s.rejected[REJECT_FRAMING];
+    uint32_t exceptions = s.bridgeErrors;
+    statusSnapshots.unlock();
+    uint32_t value;
+    switch (subFunction){
+        case DIAG_RETURN_QUERY_DATA:
+            memcpy(_response + 1, pdu + 1, len - 1);
+            return len;
+        case DIAG_RESTART_COMMUNICATIONS:
+            // nothing to restart, only the counters are cleared
+            if (data != 0x0000 && data != 0xff00) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+            // fall through
+        case DIAG_CLEAR_COUNTERS:
+            _baseMessages = messages;
+            _baseCommErrors = commErrors;
+            _baseExceptions = exceptions;
+            _requests = 0;
+            memcpy(_response + 1, pdu + 1, 5);
+            return 6;
+        case DIAG_BUS_MESSAGE_COUNT: value = messages - _baseMessages; break;
+        case DIAG_BUS_COMM_ERROR_COUNT: value = commErrors - _baseCommErrors; break;
+        case DIAG_BUS_EXCEPTION_COUNT: value = exceptions - _baseExceptions; break;
+        case DIAG_SERVER_MESSAGE_COUNT: value = _requests; break;
+        default:
+            return exception(pdu[1], Modbus::Error::ILLEGAL_FUNCTION);
+    }
+    if (len != 6 || data != 0) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    memcpy(_response + 1, pdu + 1, 3);
+    _response[4] = value >> 8;
+    _response[5] = value & 0xff;
+    return 6;
+}
+
+const char *DiagnosticsUnit::objectValue(uint8_t id){
+    switch (id){
+        case 0x00: return DIAG_VENDOR_NAME;
+        case 0x01: return DIAG_PRODUCT_CODE;
+        case 0x02: return DIAG_REVISION;
+        case 0x04: return DIAG_PRODUCT_NAME;
+        case 0x05: return ESP.getChipModel();
+        default: return nullptr;
+    }
+}
+
+uint16_t DiagnosticsUnit::identification(const uint8_t *pdu, uint16_t len){
+    if (len != 5 || pdu[2] != MEI_READ_DEVICE_ID) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    uint8_t code = pdu[3];
+    uint8_t id = pdu[4];
+    if (code < DEVICE_ID_BASIC || code > DEVICE_ID_INDIVIDUAL) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_VALUE);
+    uint8_t last = code == DEVICE_ID_BASIC ? DEVICE_ID_LAST_BASIC : DEVICE_ID_LAST_REGULAR;
+    if (code == DEVICE_ID_INDIVIDUAL){
+        if (!objectValue(id)) return exception(pdu[1], Modbus::Error::ILLEGAL_DATA_ADDRESS);
+        last = id;
+    }
+    // a stream starting at an unknown object starts over at the first one
+    else if (id > last) id = 0;
+    memcpy(_response + 1, pdu + 1, 3);
+    _response[4] = DEVICE_ID_CONFORMITY;
+    _response[5] = 0x00;
+    _response[6] = 0x00;
+    _response[7] = 0;
+    uint16_t pos = 8;
+    for (; id <= last; id++){
+        auto value = objectValue(id);
+        if (!value) continue;
+        uint8_t length = min(strlen(value), (size_t)UINT8_MAX);
+        if (pos + 2 + length > MODBUS_MAX_PDU + 1){
+            // the rest in the next request, starting with this object
+            _response[5] = 0xff;
+            _response[6] = id;
+            break;
+        }
+        _response[pos++] = id;
+        _response[pos++] = length;
+        memcpy(_response + pos, value, length);
+        pos += length;
+        _response[7]++;
+    }
+    return pos;
+}
+
+uint16_t DiagnosticsUnit::exception(uint8_t function, Modbus::Error error){
+    _response[1] = function | 0x80;
+    _response[2] = (uint8_t)error;
+    return 3;
+}
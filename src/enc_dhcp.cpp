@@ -0,0 +1,237 @@
+#ifdef USE_ENC28J60
+#include "enc_dhcp.h"
+#include <esp_system.h>
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+
+#define DHCP_DISCOVER 1
+#define DHCP_OFFER 2
+#define DHCP_REQUEST 3
+#define DHCP_ACK 5
+#define DHCP_NAK 6
+
+#define DHCP_OPTION_SUBNET 1
+#define DHCP_OPTION_ROUTER 3
+#define DHCP_OPTION_DNS 6
+#define DHCP_OPTION_REQUESTED_IP 50
+#define DHCP_OPTION_LEASE_TIME 51
+#define DHCP_OPTION_MESSAGE_TYPE 53
+#define DHCP_OPTION_SERVER_ID 54
+#define DHCP_OPTION_PARAMETERS 55
+#define DHCP_OPTION_END 255
+
+// op..giaddr и chaddr, затем sname и file (192 байта нулей) и magic cookie
+#define DHCP_HEADER_SIZE 44
+#define DHCP_LEGACY_SIZE 192
+static const uint8_t magicCookie[4] = {0x63, 0x82, 0x53, 0x63};
+
+EncDhcp::EncDhcp()
+    :_mac()
+    ,_state(DHCP_IDLE)
+    ,_retryState(DHCP_IDLE)
+    ,_open(false)
+    ,_xid(0)
+    ,_attempts(0)
+    ,_sentAt(0)
+    ,_waitUntil(0)
+    ,_leaseTime(0)
+{}
+
+void EncDhcp::begin(const uint8_t *mac) {
+    memcpy(_mac, mac, sizeof(_mac));
+    _ip = Ethernet.localIP();
+    _attempts = 0;
+    _waitUntil = millis();
+    _state = DHCP_IDLE;
+    _retryState = DHCP_REBOOTING;
+}
+
+IPAddress EncDhcp::getLocalIp() {
+    return _ip;
+}
+
+IPAddress EncDhcp::getSubnetMask() {
+    return _subnet;
+}
+
+IPAddress EncDhcp::getGatewayIp() {
+    return _gateway;
+}
+
+IPAddress EncDhcp::getDnsServerIp() {
+    return _dns;
+}
+
+uint32_t EncDhcp::getLeaseTime() {
+    return _leaseTime;
+}
+
+bool EncDhcp::step() {
+    uint32_t now = millis();
+    switch (_state) {
+        case DHCP_IDLE:
+        case DHCP_BOUND:
+            // пауза после неудачи или половина срока аренды (T1)
+            if (_retryState == DHCP_IDLE || (int32_t)(now - _waitUntil) < 0) return false;
+            _attempts = 0;
+            _xid = esp_random();
+            transmit(_retryState);
+            return false;
+        default:
+            break;
+    }
+    uint8_t type = receive();
+    if (type == DHCP_OFFER && _state == DHCP_SELECTING) {
+        _attempts = 0;
+        transmit(DHCP_REQUESTING);
+        return false;
+    }
+    if (type == DHCP_NAK) {
+        // адрес больше не наш: новая аренда, возможно с другим адресом
+        _attempts = 0;
+        _xid = esp_random();
+        transmit(DHCP_SELECTING);
+        return false;
+    }
+    if (type == DHCP_ACK && _state != DHCP_SELECTING) {
+        _udp.stop();
+        _open = false;
+        _ip = _offered;
+        _state = DHCP_BOUND;
+        _retryState = DHCP_RENEWING;
+        // без option 51 аренда считается истекшей: продлеваем через минуту
+        _waitUntil = now + (_leaseTime ? _leaseTime * 500UL : ENC_DHCP_RETRY);
+        return true;
+    }
+    if (now - _sentAt < ENC_DHCP_RESPONSE_TIMEOUT) return false;
+    if (_attempts < ENC_DHCP_RETRIES) {
+        transmit(_state);
+        return false;
+    }
+    // сервер молчит: закрываем сокет и повторим позже с того же шага
+    _udp.stop();
+    _open = false;
+    _retryState = _state == DHCP_RENEWING ? DHCP_RENEWING : DHCP_REBOOTING;
+    _state = _retryState == DHCP_RENEWING ? DHCP_BOUND : DHCP_IDLE;
+    _waitUntil = now + ENC_DHCP_RETRY;
+    return false;
+}
+
+void EncDhcp::transmit(State state) {
+    if (!_open) {
+        _open = _udp.begin(DHCP_CLIENT_PORT);
+    }
+    _state = state;
+    _attempts++;
+    _sentAt = millis();
+    send(state == DHCP_SELECTING ? DHCP_DISCOVER : DHCP_REQUEST);
+}
+
+void EncDhcp::send(uint8_t type) {
+    uint8_t header[DHCP_HEADER_SIZE] = {};
+    header[0] = 1;  // BOOTREQUEST
+    header[1] = 1;  // Ethernet
+    header[2] = 6;
+    header[4] = _xid >> 24;
+    header[5] = _xid >> 16;
+    header[6] = _xid >> 8;
+    header[7] = _xid;
+    // ответ широковещательный: адрес в стеке может уже не быть нашим
+    header[10] = 0x80;
+    if (_state == DHCP_RENEWING) {
+        for (uint8_t i = 0; i < 4; i++) header[12 + i] = _ip[i];
+    }
+    memcpy(header + 28, _mac, sizeof(_mac));
+
+    uint8_t options[32];
+    uint8_t len = 0;
+    options[len++] = DHCP_OPTION_MESSAGE_TYPE;
+    options[len++] = 1;
+    options[len++] = type;
+    if (_state == DHCP_REBOOTING || _state == DHCP_REQUESTING) {
+        IPAddress requested = _state == DHCP_REBOOTING ? _ip : _offered;
+        options[len++] = DHCP_OPTION_REQUESTED_IP;
+        options[len++] = 4;
+        for (uint8_t i = 0; i < 4; i++) options[len++] = requested[i];
+    }
+    if (_state == DHCP_REQUESTING) {
+        options[len++] = DHCP_OPTION_SERVER_ID;
+        options[len++] = 4;
+        for (uint8_t i = 0; i < 4; i++) options[len++] = _server[i];
+    }
+    options[len++] = DHCP_OPTION_PARAMETERS;
+    options[len++] = 4;
+    options[len++] = DHCP_OPTION_SUBNET;
+    options[len++] = DHCP_OPTION_ROUTER;
+    options[len++] = DHCP_OPTION_DNS;
+    options[len++] = DHCP_OPTION_LEASE_TIME;
+    options[len++] = DHCP_OPTION_END;
+
+    uint8_t zeros[32] = {};
+    _udp.beginPacket(IPAddress(255, 255, 255, 255), DHCP_SERVER_PORT);
+    _udp.write(header, sizeof(header));
+    for (uint8_t i = 0; i < DHCP_LEGACY_SIZE / sizeof(zeros); i++) {
+        _udp.write(zeros, sizeof(zeros));
+    }
+    _udp.write(magicCookie, sizeof(magicCookie));
+    _udp.write(options, len);
+    _udp.endPacket();
+}
+
+static uint32_t toU32(const uint8_t *data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+uint8_t EncDhcp::receive() {
+    if (!_open || _udp.parsePacket() <= 0) return 0;
+    uint8_t header[DHCP_HEADER_SIZE];
+    uint8_t buffer[32];
+    if (_udp.read(header, sizeof(header)) != sizeof(header) || header[0] != 2
+        || toU32(header + 4) != _xid || memcmp(header + 28, _mac, sizeof(_mac)) != 0) {
+        _udp.flush();
+        return 0;
+    }
+    for (uint8_t i = 0; i < DHCP_LEGACY_SIZE / sizeof(buffer); i++) {
+        _udp.read(buffer, sizeof(buffer));
+    }
+    if (_udp.read(buffer, 4) != 4 || memcmp(buffer, magicCookie, 4) != 0) {
+        _udp.flush();
+        return 0;
+    }
+    uint8_t type = 0;
+    IPAddress yiaddr(header[16], header[17], header[18], header[19]);
+    // поля из ответа, в членах только после того, как он целиком прочитан
+    IPAddress server = _server, subnet = _subnet, gateway = _gateway, dns = _dns;
+    uint32_t leaseTime = 0;
+    for (;;) {
+        int code = _udp.read();
+        if (code < 0 || code == DHCP_OPTION_END) break;
+        if (code == 0) continue;
+        int len = _udp.read();
+        if (len < 0) break;
+        uint8_t kept = min(len, (int)sizeof(buffer));
+        if (_udp.read(buffer, kept) != kept) break;
+        for (int i = kept; i < len; i++) _udp.read();
+        switch (code) {
+            case DHCP_OPTION_MESSAGE_TYPE: if (kept >= 1) type = buffer[0]; break;
+            case DHCP_OPTION_SERVER_ID: if (kept >= 4) server = IPAddress(buffer[0], buffer[1], buffer[2], buffer[3]); break;
+            case DHCP_OPTION_SUBNET: if (kept >= 4) subnet = IPAddress(buffer[0], buffer[1], buffer[2], buffer[3]); break;
+            case DHCP_OPTION_ROUTER: if (kept >= 4) gateway = IPAddress(buffer[0], buffer[1], buffer[2], buffer[3]); break;
+            case DHCP_OPTION_DNS: if (kept >= 4) dns = IPAddress(buffer[0], buffer[1], buffer[2], buffer[3]); break;
+            case DHCP_OPTION_LEASE_TIME: if (kept >= 4) leaseTime = toU32(buffer); break;
+            default: break;
+        }
+    }
+    _udp.flush();
+    if (type == DHCP_OFFER || type == DHCP_ACK) {
+        _offered = yiaddr;
+        _server = server;
+        _subnet = subnet;
+        _gateway = gateway;
+        _dns = dns;
+        if (type == DHCP_ACK) _leaseTime = leaseTime;
+    }
+    return type;
+}
+#endif /* USE_ENC28J60 */
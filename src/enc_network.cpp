@@ -0,0 +1,136 @@
+#ifdef USE_ENC28J60
+#include "enc_network.h"
+#include <time.h>
+#include "event_log.h"
+
+#ifndef UIP_PERIODIC_TIMER
+  #define UIP_PERIODIC_TIMER 50
+#endif
+
+// ENC28J60 обрабатывает за один tick() один пакет, поэтому ограничиваем
+// число повторов, пока INT остается в LOW, чтобы не блокировать другие задачи
+#define ENC_MAX_BURST 8
+
+TaskHandle_t EncNetwork::_task = NULL;
+SemaphoreHandle_t uipLock = NULL;
+
+EncNetwork::EncNetwork()
+    :_intPin(-1)
+    ,_webUI(nullptr)
+    ,_bridge(nullptr)
+    ,_irqWakeups(0)
+    ,_timerWakeups(0)
+    ,_config(nullptr)
+    ,_mac()
+    ,_renew(false)
+{}
+
+void EncNetwork::begin(int8_t intPin, EthernetWebUI *webUI, TcpBridge *bridge, int8_t core, uint8_t priority) {
+    _intPin = intPin;
+    _webUI = webUI;
+    _bridge = bridge;
+    xTaskCreatePinnedToCore(task, "enc28j60", 4096, this, priority, &_task, core < 0 ? tskNO_AFFINITY : core);
+    // INT активен по низкому уровню, пакет в буфере = спад линии
+    attachInterrupt(digitalPinToInterrupt(_intPin), isr, FALLING);
+    dbg("[ethernet] interrupt mode on INT pin ");
+    dbgln(_intPin);
+}
+
+bool EncNetwork::isRunning() {
+    return _task != NULL;
+}
+
+uint32_t EncNetwork::getIrqWakeups() {
+    return _irqWakeups;
+}
+
+uint32_t EncNetwork::getTimerWakeups() {
+    return _timerWakeups;
+}
+
+void EncNetwork::setLeaseCache(const uint8_t *mac, Config *config) {
+    memcpy(_mac, mac, sizeof(_mac));
+    _config = config;
+}
+
+void EncNetwork::requestLease() {
+    _renew = true;
+}
+
+void EncNetwork::maintain() {
+    Ethernet.maintain();
+    if (!_config) return;
+    if (_renew) {
+        if (Ethernet.linkStatus() != LinkON) return;
+        _renew = false;
+        _dhcp.begin(_mac);
+    }
+    if (!_dhcp.step()) return;
+    if (_dhcp.getLocalIp() != Ethernet.localIP()) {
+        // адрес из кэша больше не наш: сохраняем новый и начинаем с него
+        NetworkCache cache;
+        memset(&cache, 0, sizeof(cache));
+        cache.ip = _dhcp.getLocalIp();
+        cache.gateway = _dhcp.getGatewayIp();
+        cache.subnet = _dhcp.getSubnetMask();
+        cache.dns = _dhcp.getDnsServerIp();
+        cache.obtained = time(nullptr);
+        cache.leaseTime = _dhcp.getLeaseTime();
+        _config->setNetworkCache(cache);
+        elog(ELOG_WARN, EV_LEASE_MOVED, _dhcp.getLocalIp());
+        delay(100);
+        ESP.restart();
+    }
+    cacheLease();
+}
+
+// аренда без option 51 записывается со сроком 0 и для быстрой загрузки не годится
+void EncNetwork::cacheLease() {
+    if (!_config->getFastBoot()) return;
+    NetworkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.ip = Ethernet.localIP();
+    cache.gateway = Ethernet.gatewayIP();
+    cache.subnet = Ethernet.subnetMask();
+    cache.dns = Ethernet.dnsServerIP();
+    cache.obtained = time(nullptr);
+    cache.leaseTime = _dhcp.getLeaseTime();
+    _config->setNetworkCache(cache);
+    elog(ELOG_INFO, EV_LEASE, Ethernet.localIP(), _dhcp.getLeaseTime());
+}
+
+void IRAM_ATTR EncNetwork::isr() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void EncNetwork::task(void *arg) {
+    static_cast<EncNetwork*>(arg)->run();
+}
+
+void EncNetwork::run() {
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UIP_PERIODIC_TIMER)) > 0) {
+            _irqWakeups++;
+        } else {
+            _timerWakeups++;
+        }
+        xSemaphoreTake(uipLock, portMAX_DELAY);
+        maintain();
+        // пока в буфере есть пакеты, линия остается в LOW и нового спада не будет
+        for (uint8_t i = 0; i < ENC_MAX_BURST && digitalRead(_intPin) == LOW; i++) {
+            maintain();
+        }
+        if (digitalRead(_intPin) == LOW) {
+            xTaskNotifyGive(_task);
+        }
+        // мост будит задачу уведомлением, когда RTU ответ готов к отправке
+        _bridge->poll();
+        if (_webUI) {
+            _webUI->loop();
+        }
+        xSemaphoreGive(uipLock);
+    }
+}
+#endif /* USE_ENC28J60 */
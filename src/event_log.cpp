@@ -0,0 +1,159 @@
+#include "event_log.h"
+
+EventLog eventLog;
+
+static const char *const eventFormats[] = {
+    EVENT_LOG_EVENTS(EVENT_LOG_FORMAT)
+};
+
+EventLog::EventLog()
+    :_out(NULL)
+    ,_level(ELOG_INFO)
+    ,_binary(false)
+    ,_head(0)
+    ,_tail(0)
+    ,_dropped(0)
+    ,_lock(portMUX_INITIALIZER_UNLOCKED)
+    ,_task(NULL)
+{}
+
+void EventLog::begin(Print *out, uint8_t level, bool binary){
+    _out = out;
+    setLevel(level);
+    _binary = binary;
+    if (!_task){
+        xTaskCreate(task, "elog", 3072, this, 1, &_task);
+    }
+}
+
+// levels above the compile time ceiling are compiled out anyway
+void EventLog::setLevel(uint8_t level){
+    _level = min(level, (uint8_t)ELOG_MAX_LEVEL);
+}
+
+uint8_t EventLog::getLevel(){
+    return _level;
+}
+
+bool EventLog::isBinary(){
+    return _binary;
+}
+
+uint32_t EventLog::getDropped(){
+    return _dropped;
+}
+
+// may be called from any task, never blocks: a full ring drops the new record
+void EventLog::push(uint8_t level, uint16_t event, uint8_t argc, const uintptr_t *args){
+    auto timestamp = millis();
+    portENTER_CRITICAL(&_lock);
+    uint16_t next = (_head + 1) % EVENT_LOG_RECORDS;
+    if (next == _tail){
+        _dropped++;
+        portEXIT_CRITICAL(&_lock);
+        return;
+    }
+    auto &record = _records[_head];
+    record.timestamp = timestamp;
+    record.event = event;
+    record.level = level;
+    record.argc = argc;
+    for (uint8_t i = 0; i < argc; i++) record.args[i] = args[i];
+    _head = next;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void EventLog::task(void *arg){
+    auto log = static_cast<EventLog*>(arg);
+    for (;;){
+        log->drain();
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+}
+
+void EventLog::drain(){
+    uint32_t reported = 0;
+    while (_tail != _head){
+        // only this task moves the tail, the record is stable until then
+        auto record = _records[_tail];
+        _tail = (_tail + 1) % EVENT_LOG_RECORDS;
+        if (record.event >= EV_COUNT) continue;
+        if (_binary) printBinary(record);
+        else printText(record);
+    }
+    portENTER_CRITICAL(&_lock);
+    reported = _dropped;
+    _dropped = 0;
+    portEXIT_CRITICAL(&_lock);
+    if (reported > 0){
+        LogRecord record = {(uint32_t)millis(), EV_LOG_DROPPED, ELOG_WARN, 1, {reported}};
+        if (_binary) printBinary(record);
+        else printText(record);
+    }
+}
+
+void EventLog::printText(const LogRecord &record){
+    char line[160];
+    size_t pos = snprintf(line, sizeof(line), "%lu ", (unsigned long)record.timestamp);
+    uint8_t arg = 0;
+    for (auto format = eventFormats[record.event]; *format && pos < sizeof(line) - 1; format++){
+        if (*format != '%' || !format[1]){
+            line[pos++] = *format;
+            continue;
+        }
+        auto kind = *++format;
+        if (kind == '%'){
+            line[pos++] = '%';
+            continue;
+        }
+        auto value = arg < record.argc ? record.args[arg++] : 0;
+        auto room = sizeof(line) - pos;
+        int len = 0;
+        switch (kind){
+            case 'u': len = snprintf(line + pos, room, "%lu", (unsigned long)value); break;
+            case 'd': len = snprintf(line + pos, room, "%ld", (long)(int32_t)value); break;
+            case 'x': len = snprintf(line + pos, room, "%lx", (unsigned long)value); break;
+            case 's': len = snprintf(line + pos, room, "%s", value ? (const char*)value : ""); break;
+            case 'I': len = snprintf(line + pos, room, "%u.%u.%u.%u",
+                (unsigned)(value & 0xff), (unsigned)((value >> 8) & 0xff),
+                (unsigned)((value >> 16) & 0xff), (unsigned)((value >> 24) & 0xff)); break;
+        }
+        if (len > 0) pos = min(pos + len, sizeof(line) - 1);
+    }
+    line[pos] = 0;
+    _out->println(line);
+}
+
+void EventLog::printBinary(const LogRecord &record){
+    uint8_t frame[3 + 8 + EVENT_LOG_MAX_ARGS * 65];
+    uint16_t len = 3;
+    auto put32 = [&](uint32_t value){
+        for (uint8_t i = 0; i < 4; i++) frame[len++] = value >> (8 * i);
+    };
+    put32(record.timestamp);
+    frame[len++] = record.event;
+    frame[len++] = record.event >> 8;
+    frame[len++] = record.level;
+    frame[len++] = record.argc;
+    uint8_t arg = 0;
+    for (auto format = eventFormats[record.event]; *format && arg < record.argc; format++){
+        if (*format != '%' || !format[1]) continue;
+        auto kind = *++format;
+        if (kind == '%') continue;
+        auto value = record.args[arg++];
+        if (kind == 's'){
+            auto text = value ? (const char*)value : "";
+            uint8_t textLen = min(strlen(text), (size_t)64);
+            frame[len++] = textLen;
+            memcpy(frame + len, text, textLen);
+            len += textLen;
+        }
+        else{
+            put32(value);
+        }
+    }
+    frame[0] = EVENT_LOG_SYNC1;
+    frame[1] = EVENT_LOG_SYNC2;
+    frame[2] = len - 3;
+    _out->write(frame, len);
+}
@@ -2,48 +2,140 @@
 
 #ifdef USE_ENC28J60
   #include <EthernetENC.h>
-  #include <ModbusBridgeEthernet.h>
   #include "pages_ethernet_awot.h"
+  #include "enc_network.h"
   #define NETWORK_TYPE "Ethernet"
 #else
   #include <AsyncTCP.h>
   #include <WiFiManager.h>
   #include <ESPAsyncWebServer.h>
   #include "pages.h"
+  #include "wifi_supervisor.h"
   #define NETWORK_TYPE "WiFi"
 #endif
 
 #include <Preferences.h>
-#include <Logging.h>
-#include <ModbusClientRTU.h>
+#include <driver/uart.h>
 #include "config.h"
+#include "mqtt.h"
+#include "rtu_client.h"
+#include "tcp_bridge.h"
+#include "event_log.h"
+#include "telemetry.h"
+#include "trace_recorder.h"
+#include "virtual_slaves.h"
+#include "boot_profile.h"
+#include "diagnostics_unit.h"
+#include "register_map.h"
+
+// Сколько ждать линк (Ethernet) и подключения по сохраненной точке доступа (WiFi)
+#define ENC_LINK_TIMEOUT 1000
+#define FAST_BOOT_WIFI_TIMEOUT 3000
+
+bool configMode = false; // Режим работы: false = Modbus TCP, true = Web Config
 
 #ifdef USE_ENC28J60
   EthernetWebUI webUI;
-  bool configMode = false; // Режим работы: false = Modbus TCP, true = Web Config
+  EncNetwork network;
 #else
   AsyncWebServer webServer(80);
   WiFiManager wm;
+  WifiSupervisor wifiSupervisor;
 #endif
 
 Config config;
 Preferences prefs;
-ModbusClientRTU *MBclient;
+RtuClient *MBclient;
 
+TcpBridge MBbridge;
+VirtualSlaves simSlaves;
+DiagnosticsUnit diagnostics;
 #ifdef USE_ENC28J60
-  ModbusBridgeEthernet MBbridge;
+  EthernetClient mqttNet;
 #else
-  ModbusBridgeWiFi MBbridge;
+  WiFiClient mqttNet;
 #endif
+MqttPublisher mqtt(mqttNet);
 
 void setup() {
+  bootProfile.begin();
   debugSerial.begin(115200);
   dbgln();
   dbgln("[config] load")
   prefs.begin("modbusRtuGw");
   config.begin(&prefs);
-  debugSerial.end();
-  debugSerial.begin(config.getSerialBaudRate(), config.getSerialConfig());
+  // Переоткрываем порт только если настройки отличаются от загрузочных
+  if (config.getSerialBaudRate() != 115200 || config.getSerialConfig() != SERIAL_8N1) {
+    debugSerial.end();
+    debugSerial.begin(config.getSerialBaudRate(), config.getSerialConfig());
+  }
+  eventLog.begin(&debugSerial, config.getLogLevel(), config.getLogBinary());
+  telemetry.begin();
+  traceRecorder.begin(config.getTraceSize() * 1024UL);
+  registerMap.begin(&config);
+  bootProfile.mark("config");
+
+  // RTU готов до сети, чтобы мост стартовал сразу после появления линка
+  dbgln("[modbus] start");
+
+  // Буфер приема на два полных кадра RTU
+  modbusSerial.setRxBufferSize(RTU_MAX_FRAME * 2);
+#if defined(RX_PIN) && defined(TX_PIN)
+  // use rx and tx-pins if defined in platformio.ini
+  modbusSerial.begin(config.getModbusBaudRate(), config.getModbusConfig(), RX_PIN, TX_PIN );
+  dbgln("Use user defined RX/TX pins");
+#else
+  // otherwise use default pins for hardware-serial2
+  modbusSerial.begin(config.getModbusBaudRate(), config.getModbusConfig());
+#endif
+
+  if (config.getModbusHwRs485() && config.getModbusRtsPin() >= 0) {
+    // UART сам управляет RTS (направлением драйвера) и по таймауту приема
+    // (тишина в линии, в символах) сразу отдает кадр, без программных задержек
+    uart_set_pin(UART_NUM_2, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, config.getModbusRtsPin(), UART_PIN_NO_CHANGE);
+    uart_set_mode(UART_NUM_2, UART_MODE_RS485_HALF_DUPLEX);
+    uart_set_rx_timeout(UART_NUM_2, config.getModbusRxTimeout());
+    MBclient = new RtuClient(-1);
+    dbgln("[modbus] hardware RS-485 half-duplex mode");
+  } else {
+    MBclient = new RtuClient(config.getModbusRtsPin());
+  }
+  MBclient->setTimeout(5000); // Увеличен таймаут до 5000 мс для стабильности
+  // Конец кадра по таймауту приема UART (событие будит задачу RTU), иначе программный t3.5
+  MBclient->begin(modbusSerial, config.getModbusBaudRate(), config.getModbusHwRs485() && config.getModbusRtsPin() >= 0);
+  simSlaves.begin(config.getSimUnits(), config.getSimDelay(), config.getSimExceptionRate(), config.getSimTimeoutRate());
+  if (simSlaves.getUnitCount() > 0) {
+    // эти адреса отвечают из памяти, шина RS-485 для них не используется
+    MBclient->setSimulator(&simSlaves);
+    dbg("[modbus] virtual slaves: ");
+    dbgln(config.getSimUnits());
+  }
+  
+  dbg("[modbus] RTU config: ");
+  dbg(config.getModbusBaudRate());
+  dbg(" baud, ");
+  dbg(config.getModbusDataBits());
+  dbg(" data bits, parity ");
+  dbg(config.getModbusParity());
+  dbg(", stop bits ");
+  dbg(config.getModbusStopBits());
+  dbg(", RTS pin ");
+  dbg(config.getModbusRtsPin());
+  dbg(config.getModbusHwRs485() ? " (UART)" : " (GPIO)");
+  dbg(", RX timeout ");
+  dbg(config.getModbusRxTimeout());
+  dbgln(" symbols");
+  // Тестовый запрос отключен - он может влиять на состояние bridge
+  // dbgln("[modbus] Testing RTU connection to slave 1...");
+  dbgln("[modbus] RTU test skipped - will respond to TCP requests");
+  bootProfile.mark("rtu");
+
+  // Быстрая загрузка: после сторожевого таймера или перезагрузки берем
+  // прошлую аренду DHCP и точку доступа из NVS, пока аренда не истекла.
+  // time() идет от включения питания и не сбрасывается при теплом рестарте
+  NetworkCache cache;
+  auto fastBoot = config.getFastBoot() && bootProfile.isWarmReset() && config.getNetworkCache(cache)
+    && (uint32_t)time(nullptr) - cache.obtained < cache.leaseTime;
   
 #ifdef USE_ENC28J60
   // Проверяем режим работы по GPIO15 (джампер/кнопка)
@@ -51,7 +143,7 @@ void setup() {
   // GPIO15 = HIGH (не закорочен) = рабочий режим (только Modbus TCP)
   #define CONFIG_MODE_PIN 15
   pinMode(CONFIG_MODE_PIN, INPUT_PULLUP);
-  delay(100); // Даем время стабилизироваться
+  delay(1); // Подтяжка заряжает вход за микросекунды
   configMode = (digitalRead(CONFIG_MODE_PIN) == LOW);
   
   if (configMode) {
@@ -72,7 +164,6 @@ void setup() {
   
   // ВАЖНО: Отключаем WiFi чтобы избежать конфликта с lwIP
   WiFi.mode(WIFI_OFF);
-  delay(100);
   
   // Настройка пинов для ENC28J60
   #ifndef ENC_CS_PIN
@@ -87,10 +178,10 @@ void setup() {
   
   // Настройка RESET пина
   pinMode(ENC_RESET_PIN, OUTPUT);
+  // Импульс сброса от 400 нс, готовность генератора (CLKRDY) Ethernet.begin проверяет сам
   digitalWrite(ENC_RESET_PIN, LOW);
-  delay(10);
+  delay(1);
   digitalWrite(ENC_RESET_PIN, HIGH);
-  delay(100);
   
   dbg("ENC28J60 pins - CS: ");
   dbg(ENC_CS_PIN);
@@ -102,17 +193,44 @@ void setup() {
   // Настройка INT пина (прерывание)
   pinMode(ENC_INT_PIN, INPUT_PULLUP);
   
+  // До первого обращения к uIP: стек обслуживают несколько задач
+  uipLock = xSemaphoreCreateMutex();
+  mqtt.setNetworkLock(uipLock);
+
   // Инициализация Ethernet с MAC адресом
   uint8_t mac[6] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
   
   dbgln("Initializing ENC28J60...");
   
-  if (config.getUseDhcp()) {
+  // Аренды DHCP со сроком из ответа сервера пишет в кэш задача сети
+  network.setLeaseCache(mac, &config);
+  fastBoot = fastBoot && config.getUseDhcp();
+  if (fastBoot) {
+    dbgln("Fast boot: reusing the last DHCP lease");
+    Ethernet.begin(mac, IPAddress(cache.ip), IPAddress(cache.dns), IPAddress(cache.gateway), IPAddress(cache.subnet));
+    for (auto start = millis(); Ethernet.linkStatus() != LinkON && millis() - start < ENC_LINK_TIMEOUT; ) {
+      delay(10);
+    }
+    // Без линка аренду не проверить: как и на WiFi, забываем кэш и идем через DHCP
+    fastBoot = Ethernet.linkStatus() == LinkON;
+    if (fastBoot) {
+      network.requestLease();
+    } else {
+      dbgln("[ethernet] fast boot failed, back to DHCP");
+      config.clearNetworkCache();
+    }
+  }
+  if (fastBoot) {
+    // Адрес уже есть, аренду запросит задача сети
+  } else if (config.getUseDhcp()) {
     dbgln("Using DHCP...");
     if (Ethernet.begin(mac) == 0) {
       dbgln("DHCP failed! Using static IP as fallback");
       Ethernet.begin(mac, config.getStaticIp(), config.getStaticDns(), 
                      config.getStaticGateway(), config.getStaticSubnet());
+    } else if (config.getFastBoot()) {
+      // срок аренды для кэша DhcpClass не отдает, его узнает задача сети
+      network.requestLease();
     }
   } else {
     dbgln("Using static IP...");
@@ -120,7 +238,10 @@ void setup() {
                    config.getStaticGateway(), config.getStaticSubnet());
   }
   
-  delay(1000);
+  // Ждем линк вместо фиксированной паузы
+  for (auto start = millis(); Ethernet.linkStatus() != LinkON && millis() - start < ENC_LINK_TIMEOUT; ) {
+    delay(10);
+  }
   dbg("IP address: ");
   dbgln(Ethernet.localIP());
   dbg("Gateway: ");
@@ -132,62 +253,76 @@ void setup() {
   dbgln("[wifi] start");
   WiFi.mode(WIFI_STA);
   wm.setClass("invert");
-  auto reboot = false;
-  wm.setAPCallback([&reboot](WiFiManager *wifiManager){reboot = true;});
-  wm.autoConnect();
-  if (reboot){
-    ESP.restart();
+  if (fastBoot) {
+    // Без сканирования и DHCP: известные BSSID, канал и адрес. Не сохраняем
+    // в NVS WiFi, иначе обычное подключение потом будет привязано к BSSID
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    WiFi.persistent(false);
+    WiFi.begin(wm.getWiFiSSID().c_str(), wm.getWiFiPass().c_str(), cache.channel, cache.bssid);
+    WiFi.persistent(true);
+    for (auto start = millis(); WiFi.status() != WL_CONNECTED && millis() - start < FAST_BOOT_WIFI_TIMEOUT; ) {
+      delay(10);
+    }
+    fastBoot = WiFi.status() == WL_CONNECTED;
+    if (!fastBoot) {
+      dbgln("[wifi] fast boot failed, back to DHCP");
+      WiFi.disconnect();
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+      config.clearNetworkCache();
+    }
+  }
+  if (!fastBoot) {
+    auto reboot = false;
+    wm.setAPCallback([&reboot](WiFiManager *wifiManager){reboot = true;});
+    wm.autoConnect();
+    if (reboot){
+      ESP.restart();
+    }
   }
+  // Аренду DHCP в кэш пишет супервизор, после быстрой загрузки он же
+  // запускает DHCP, не снимая адрес из кэша, чтобы аренда продлевалась
+  wifiSupervisor.setLeaseCache(&config, fastBoot);
+  // Без modem sleep кадры не ждут следующего DTIM, задержка TCP стабильнее
+  wifiSupervisor.begin(config.getWifiPowerSave(), config.getWifiTxPower(), config.getWifiFastReconnect());
   dbgln("[wifi] finished");
 #endif
-  dbgln("[modbus] start");
+  bootProfile.setFastPath(fastBoot);
+  bootProfile.mark("network");
 
-  // Уровень логирования (WARNING = только ошибки)
-  MBUlogLvl = LOG_LEVEL_WARNING;
-  RTUutils::prepareHardwareSerial(modbusSerial);
-#if defined(RX_PIN) && defined(TX_PIN)
-  // use rx and tx-pins if defined in platformio.ini
-  modbusSerial.begin(config.getModbusBaudRate(), config.getModbusConfig(), RX_PIN, TX_PIN );
-  dbgln("Use user defined RX/TX pins");
-#else
-  // otherwise use default pins for hardware-serial2
-  modbusSerial.begin(config.getModbusBaudRate(), config.getModbusConfig());
-#endif
-
-  MBclient = new ModbusClientRTU(config.getModbusRtsPin());
-  MBclient->setTimeout(5000); // Увеличен таймаут до 5000 мс для стабильности
-  MBclient->begin(modbusSerial, 1);
-  
-  dbg("[modbus] RTU config: ");
-  dbg(config.getModbusBaudRate());
-  dbg(" baud, ");
-  dbg(config.getModbusDataBits());
-  dbg(" data bits, parity ");
-  dbg(config.getModbusParity());
-  dbg(", stop bits ");
-  dbg(config.getModbusStopBits());
-  dbg(", RTS pin ");
-  dbgln(config.getModbusRtsPin());
-  // Тестовый запрос отключен - он может влиять на состояние bridge
-  // dbgln("[modbus] Testing RTU connection to slave 1...");
-  dbgln("[modbus] RTU test skipped - will respond to TCP requests");
   
   // Запускаем Modbus TCP только в рабочем режиме
   if (!configMode) {
-    for (uint8_t i = 1; i < 248; i++)
-    {
-      MBbridge.attachServer(i, i, ANY_FUNCTION_CODE, MBclient);
-    }  
-    MBbridge.start(config.getTcpPort(), 1, config.getTcpTimeout());
+    MBbridge.setWriteCoalescing(config.getCoalesceUnits(), config.getCoalesceWindow());
+    MBbridge.setClientLimits(config.getTcpConnectionRate(), config.getTcpAddressRate(), config.getTcpBurst(), config.getTcpWeights());
+    MBbridge.setConnectionLimits(config.getTcpEvictIdle(), config.getTcpKeepAlive());
+    // Собственный unit шлюза для SCADA, отвечает сам мост без обращения к шине
+    diagnostics.begin(config.getDiagUnit());
+    MBbridge.setDiagnostics(&diagnostics);
+    // сеть и RTU на разных ядрах, обмен через lock-free очереди
+    MBbridge.setTasks(config.getNetCore(), config.getNetPriority(), config.getRtuCore(), config.getRtuPriority());
+#ifdef USE_ENC28J60
+    // uIP не потокобезопасен: мост опрашивает та же задача, что обслуживает стек
+    MBbridge.start(MBclient, config.getTcpPort(), config.getTcpMaxClients(), config.getTcpTimeout(), config.getTcpMaxInFlight(), false);
+#else
+    MBbridge.start(MBclient, config.getTcpPort(), config.getTcpMaxClients(), config.getTcpTimeout(), config.getTcpMaxInFlight());
+#endif
     dbg("[modbus] TCP bridge started on port ");
     dbg(config.getTcpPort());
-    dbg(", max clients: 1, timeout ");
+    dbg(", max clients: ");
+    dbg(MBbridge.getMaxClients());
+    dbg(", timeout ");
     dbg(config.getTcpTimeout());
-    dbgln(" ms");
+    dbg(" ms, in-flight per client ");
+    dbgln(config.getTcpMaxInFlight());
     dbgln("[modbus] Note: uIP configured for 4 max TCP connections");
   } else {
     dbgln("[modbus] TCP bridge DISABLED in config mode");
   }
+  bootProfile.mark("bridge");
+
+  if (!configMode) {
+    mqtt.begin(&config, MBclient);
+  }
   
   dbg("[modbus] Free heap: ");
   dbg(ESP.getFreeHeap());
@@ -198,7 +333,7 @@ void setup() {
   dbgln("[webserver] start");
 #ifdef USE_ENC28J60
   if (configMode) {
-    webUI.begin(MBclient, &MBbridge, &config);
+    webUI.begin(MBclient, &MBbridge, &config, &network);
     dbgln("[webserver] Web UI ENABLED for configuration");
     dbg("[webserver] Access at: http://");
     dbgln(Ethernet.localIP());
@@ -207,11 +342,26 @@ void setup() {
     dbgln("[webserver] Short GPIO15 to GND and reboot for config");
   }
 #else
-  setupPages(&webServer, MBclient, &MBbridge, &config, &wm);
+  setupPages(&webServer, MBclient, &MBbridge, &config, &wm, &mqtt);
   webServer.begin();
 #endif
   dbgln("[webserver] finished");
+
+#ifdef USE_ENC28J60
+  // Обслуживание стека по прерыванию INT вместо опроса в loop()
+  if (config.getEncInterrupt()) {
+    network.begin(ENC_INT_PIN, configMode ? &webUI : nullptr, &MBbridge, config.getNetCore(), config.getNetPriority());
+  }
+#endif
   
+  // Снимок состояния для страниц статуса, JSON и метрик
+#ifdef USE_ENC28J60
+  statusSnapshots.begin(MBclient, &MBbridge, &mqtt, &config, &network, nullptr);
+#else
+  statusSnapshots.begin(MBclient, &MBbridge, &mqtt, &config, nullptr, &wifiSupervisor);
+#endif
+  bootProfile.mark("web");
+  elog(ELOG_INFO, EV_BOOT, bootProfile.getTotal(), bootProfile.getResetReason(), bootProfile.getFastPath() ? "yes" : "no");
   dbgln("[setup] finished");
 }
 
@@ -219,24 +369,31 @@ void loop() {
 #ifdef USE_ENC28J60
   static unsigned long lastMemCheck = 0;
   
-  // Поддержка Ethernet соединения
-  Ethernet.maintain();
-  
-  // Обрабатываем веб-запросы только в режиме настройки
-  if (configMode) {
-    webUI.loop();
+  // В режиме прерываний стек обслуживает задача enc28j60
+  if (!network.isRunning()) {
+    // Поддержка Ethernet соединения
+    xSemaphoreTake(uipLock, portMAX_DELAY);
+    network.maintain();
+    MBbridge.poll();
+    
+    // Обрабатываем веб-запросы только в режиме настройки
+    if (configMode) {
+      webUI.loop();
+    }
+    xSemaphoreGive(uipLock);
   }
   
   // Мониторинг памяти каждые 10 секунд
   if (millis() - lastMemCheck > 10000) {
     lastMemCheck = millis();
-    dbg("[loop] Free heap: ");
-    dbg(ESP.getFreeHeap());
-    dbg(" bytes, Mode: ");
-    dbgln(configMode ? "CONFIG" : "WORK");
+    elog(ELOG_DEBUG, EV_HEAP, telemetry.getFreeHeap(), telemetry.getLargestBlock(), configMode ? "CONFIG" : "WORK");
   }
   
   // Даем время другим задачам FreeRTOS
-  yield();
+  if (network.isRunning()) {
+    delay(100);
+  } else {
+    yield();
+  }
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "mqtt.h"
+#include <algorithm>
+
+MqttPublisher::MqttPublisher(Client &client)
+    :_config(NULL)
+    ,_rtu(NULL)
+    ,_mqtt(client)
+    ,_task(NULL)
+    ,_netLock(NULL)
+    ,_connected(false)
+    ,_batchCount(0)
+    ,_batchSnapshot(false)
+    ,_lastConnect(0)
+    ,_lastSnapshot(0)
+    ,_publishCount(0)
+    ,_readErrors(0)
+{}
+
+void MqttPublisher::begin(Config *config, RtuClient *rtu){
+    _config = config;
+    _rtu = rtu;
+    if (!_config->getMqttEnabled() || _config->getMqttHost().equals("")){
+        dbgln("[mqtt] disabled");
+        return;
+    }
+    parseTags(_config->getMqttTags());
+    buildGroups();
+    _clientId = "modbusgw-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+    _payload.reserve(MQTT_BUFFER_SIZE);
+    _mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+    _host = _config->getMqttHost();
+    _mqtt.setServer(_host.c_str(), _config->getMqttPort());
+    dbg("[mqtt] ");
+    dbg(_tags.size());
+    dbg(" tags in ");
+    dbg(_groups.size());
+    dbgln(" requests");
+    xTaskCreate(task, "mqtt", 4096, this, 1, &_task);
+}
+
+void MqttPublisher::setNetworkLock(SemaphoreHandle_t lock){
+    _netLock = lock;
+}
+
+bool MqttPublisher::connected(){
+    return _connected;
+}
+
+void MqttPublisher::lockNetwork(){
+    if (_netLock) xSemaphoreTake(_netLock, portMAX_DELAY);
+}
+
+void MqttPublisher::unlockNetwork(){
+    if (_netLock) xSemaphoreGive(_netLock);
+}
+
+uint32_t MqttPublisher::getPublishCount(){
+    return _publishCount;
+}
+
+uint32_t MqttPublisher::getReadErrors(){
+    return _readErrors;
+}
+
+size_t MqttPublisher::getTagCount(){
+    return _tags.size();
+}
+
+void MqttPublisher::task(void *arg){
+    static_cast<MqttPublisher*>(arg)->run();
+}
+
+void MqttPublisher::run(){
+    auto interval = pdMS_TO_TICKS(max(_config->getMqttPollInterval(), (uint32_t)10));
+    auto snapshotInterval = _config->getMqttSnapshotInterval() * 1000;
+    auto lastWake = xTaskGetTickCount();
+    for (;;){
+        // RTU reads in poll() run without the network lock, only the client
+        // calls take it
+        lockNetwork();
+        _connected = _mqtt.connected();
+        if (!_connected){
+            if (_lastConnect == 0 || millis() - _lastConnect > MQTT_RECONNECT_INTERVAL){
+                _lastConnect = millis();
+                if (connect()){
+                    // always start a session with a full picture
+                    _lastSnapshot = 0;
+                    _connected = true;
+                }
+            }
+        }
+        unlockNetwork();
+        if (_connected){
+            auto snapshot = _lastSnapshot == 0 || (snapshotInterval > 0 && millis() - _lastSnapshot >= snapshotInterval);
+            poll(snapshot);
+            if (snapshot) _lastSnapshot = max(millis(), 1UL);
+            lockNetwork();
+            _mqtt.loop();
+            _connected = _mqtt.connected();
+            unlockNetwork();
+        }
+        vTaskDelayUntil(&lastWake, interval);
+    }
+}
+
+bool MqttPublisher::connect(){
+    auto user = _config->getMqttUser();
+    auto pass = _config->getMqttPassword();
+    auto status = _config->getMqttTopic() + "/status";
+    elog(ELOG_DEBUG, EV_MQTT_CONNECTING);
+    auto ok = _mqtt.connect(_clientId.c_str(),
+        user.equals("") ? NULL : user.c_str(),
+        pass.equals("") ? NULL : pass.c_str(),
+        status.c_str(), 0, true, "offline");
+    if (!ok){
+        elog(ELOG_WARN, EV_MQTT_CONNECT_FAILED, _mqtt.state());
+        return false;
+    }
+    _mqtt.publish(status.c_str(), "online", true);
+    elog(ELOG_INFO, EV_MQTT_CONNECTED);
+    return true;
+}
+
+// tags are given as "name,unit,fc,address[,deadband]" separated by newline or ';'
+void MqttPublisher::parseTags(String text){
+    _tags.clear();
+    text.replace('\r', '\n');
+    text.replace(';', '\n');
+    int start = 0;
+    while (start < (int)text.length()){
+        auto end = text.indexOf('\n', start);
+        if (end < 0) end = text.length();
+        auto line = text.substring(start, end);
+        start = end + 1;
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+        String fields[5];
+        int count = 0;
+        int pos = 0;
+        while (count < 5){
+            auto comma = line.indexOf(',', pos);
+            fields[count++] = comma < 0 ? line.substring(pos) : line.substring(pos, comma);
+            if (comma < 0) break;
+            pos = comma + 1;
+        }
+        if (count < 4){
+            dbg("[mqtt] invalid tag: ");
+            dbgln(line);
+            continue;
+        }
+        MqttTag tag;
+        for (auto &field : fields) field.trim();
+        tag.name = fields[0];
+        tag.unit = fields[1].toInt();
+        tag.function = fields[2].toInt();
+        tag.address = fields[3].toInt();
+        tag.deadband = count > 4 ? fields[4].toInt() : 0;
+        tag.value = 0;
+        tag.valid = false;
+        if (tag.unit < 1 || tag.unit > 247 || tag.function < 1 || tag.function > 4){
+            dbg("[mqtt] invalid tag: ");
+            dbgln(line);
+            continue;
+        }
+        _tags.push_back(tag);
+    }
+}
+
+// merge tags of the same unit and function code into as few requests as possible
+void MqttPublisher::buildGroups(){
+    _groups.clear();
+    std::stable_sort(_tags.begin(), _tags.end(), [](const MqttTag &a, const MqttTag &b){
+        if (a.unit != b.unit) return a.unit < b.unit;
+        if (a.function != b.function) return a.function < b.function;
+        return a.address < b.address;
+    });
+    for (size_t i = 0; i < _tags.size(); i++){
+        auto &tag = _tags[i];
+        if (!_groups.empty()){
+            auto &group = _groups.back();
+            if (group.unit == tag.unit && group.function == tag.function && tag.address - group.address < MQTT_MAX_SPAN){
+                group.count = tag.address - group.address + 1;
+                group.last = i;
+                continue;
+            }
+        }
+        MqttReadGroup group;
+        group.unit = tag.unit;
+        group.function = tag.function;
+        group.address = tag.address;
+        group.count = 1;
+        group.first = i;
+        group.last = i;
+        _groups.push_back(group);
+    }
+}
+
+void MqttPublisher::poll(bool snapshot){
+    uint8_t answer[RTU_MAX_FRAME];
+    for (auto &group : _groups){
+        uint16_t size;
+        auto error = _rtu->read(group.unit, group.function, group.address, group.count, answer, sizeof(answer), size);
+        if (error != Modbus::Error::SUCCESS){
+            _readErrors++;
+            elog(ELOG_DEBUG, EV_MQTT_READ_ERROR, group.unit, group.function, group.address, (uint8_t)error);
+            for (auto i = group.first; i <= group.last; i++) _tags[i].valid = false;
+            continue;
+        }
+        auto isBits = group.function <= 2;
+        for (auto i = group.first; i <= group.last; i++){
+            auto &tag = _tags[i];
+            uint16_t offset = tag.address - group.address;
+            uint16_t value;
+            if (isBits){
+                if (size <= 3 + offset / 8) continue;
+                value = (answer[3 + offset / 8] >> (offset % 8)) & 1;
+            }
+            else{
+                if (size <= 4 + offset * 2) continue;
+                value = (answer[3 + offset * 2] << 8) | answer[4 + offset * 2];
+            }
+            auto delta = value > tag.value ? value - tag.value : tag.value - value;
+            if (snapshot || !tag.valid || (delta > 0 && delta >= tag.deadband)){
+                tag.value = value;
+                tag.valid = true;
+                addToBatch(tag, snapshot);
+            }
+        }
+    }
+    flushBatch();
+}
+
+void MqttPublisher::addToBatch(MqttTag &tag, bool snapshot){
+    // keep room for the closing braces
+    if (_batchCount >= MQTT_BATCH_TAGS || _payload.length() + tag.name.length() + 16 > MQTT_BUFFER_SIZE - 64){
+        flushBatch();
+    }
+    if (_batchCount == 0){
+        _batchSnapshot = snapshot;
+        _payload = "{\"ts\":";
+        _payload += millis();
+        _payload += ",\"values\":{";
+    }
+    else{
+        _payload += ',';
+    }
+    _payload += '"';
+    _payload += tag.name;
+    _payload += "\":";
+    _payload += tag.value;
+    _batchCount++;
+}
+
+void MqttPublisher::flushBatch(){
+    if (_batchCount == 0) return;
+    _payload += "}}";
+    auto topic = _config->getMqttTopic() + (_batchSnapshot ? "/snapshot" : "/values");
+    lockNetwork();
+    if (_mqtt.publish(topic.c_str(), _payload.c_str())){
+        _publishCount++;
+    }
+    unlockNetwork();
+    _batchCount = 0;
+}
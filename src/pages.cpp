@@ -6,58 +6,168 @@
 #define WEB_PASS_PLACEHOLDER "****"
 
 
-void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *bridge, Config *config, WiFiManager *wm){
+void setupPages(AsyncWebServer *server, RtuClient *rtu, TcpBridge *bridge, Config *config, WiFiManager *wm, MqttPublisher *mqtt){
   server->on("/", HTTP_GET, [config](AsyncWebServerRequest *request){
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Main");
     sendButton(response, "Status", "status");
     sendButton(response, "Config", "config");
     sendButton(response, "Debug", "debug");
+    sendButton(response, "Register map", "map");
     sendButton(response, "Firmware update", "update");
     sendButton(response, "WiFi reset", "wifi", "r");
     sendButton(response, "Reboot", "reboot", "r");
     sendResponseTrailer(response);
     request->send(response);
   });
-  server->on("/status", HTTP_GET, [rtu, bridge, config](AsyncWebServerRequest *request){
+  server->on("/status", HTTP_GET, [config](AsyncWebServerRequest *request){
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /status");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/status");
+    auto refresh = request->hasParam("refresh") ? request->getParam("refresh")->value().toInt() : 0;
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Status");
     response->print("<table>");
 
-    // show ESP infos...
+    // everything below comes from the snapshot of the status task
+    auto &s = statusSnapshots.beginView();
     sendTableRow(response, "ESP Uptime (sec)", esp_timer_get_time() / 1000000);
-    sendTableRow(response, "ESP SSID", WiFi.SSID());
-    sendTableRow(response, "ESP RSSI", WiFi.RSSI());
-    sendTableRow(response, "ESP WiFi Quality", WiFiQuality(WiFi.RSSI()));
-    sendTableRow(response, "ESP MAC", WiFi.macAddress());
-    sendTableRow(response, "ESP IP",  WiFi.localIP().toString() );
-
-    sendTableRow(response, "RTU Messages", rtu->getMessageCount());
-    sendTableRow(response, "RTU Pending Messages", rtu->pendingRequests());
-    sendTableRow(response, "RTU Errors", rtu->getErrorCount());
-    sendTableRow(response, "Bridge Message", bridge->getMessageCount());
-    sendTableRow(response, "Bridge Clients", bridge->activeClients());
-    sendTableRow(response, "Bridge Errors", bridge->getErrorCount());
+    sendTableRow(response, "ESP SSID", s.ssid);
+    sendTableRow(response, "ESP RSSI", s.rssi);
+    sendTableRow(response, "ESP WiFi Quality", WiFiQuality(s.rssi));
+    sendTableRow(response, "ESP MAC", s.mac);
+    sendTableRow(response, "ESP IP", IPAddress(s.ip).toString());
+    sendTableRow(response, "WiFi Power Save", s.wifiPowerSave ? "on" : "off");
+    sendTableRow(response, "WiFi TX Power (dBm)", String(s.wifiTxPower, 1));
+    sendTableRow(response, "WiFi Fast Reconnect", s.wifiFastReconnect ? "on" : "off");
+    sendTableRow(response, "WiFi Reconnects", s.wifiReconnects);
+    sendTableRow(response, "WiFi Reconnects With Scan", s.wifiScanReconnects);
+    sendTableRow(response, "WiFi Last Reconnect (ms)", s.wifiLastReconnect);
+    sendTableRow(response, "WiFi Max Reconnect (ms)", s.wifiMaxReconnect);
+    sendTableRow(response, "WiFi Downtime (ms)", s.wifiDowntime);
+
+    sendTableRow(response, "RTU Messages", s.rtuMessages);
+    sendTableRow(response, "RTU Pending Messages", s.rtuPending);
+    sendTableRow(response, "RTU Errors", s.rtuErrors);
+    for (uint8_t i = 0; i < s.unitCount; i++){
+      auto &unit = s.units[i];
+      response->printf("<tr><td>RTU Unit %u:</td><td>%s, requests %u, errors %u, timeouts %u, latency %.1f ms</td></tr>",
+        unit.unit, unit.timeoutsInRow >= RTU_OFFLINE_TIMEOUTS ? "offline" : "online", unit.requests, unit.errors, unit.timeouts, unit.latency / 1000.0);
+    }
+    if (s.simUnits > 0){
+      sendTableRow(response, "Virtual Slave Units", s.simUnits);
+      sendTableRow(response, "Virtual Slave Requests", s.simRequests);
+      sendTableRow(response, "Virtual Slave Injected Errors", s.simInjected);
+    }
+    sendTableRow(response, "Bridge Message", s.bridgeMessages);
+    sendTableRow(response, "Bridge Clients", s.clients);
+    sendTableRow(response, "Bridge Clients Accepted", s.clientsAccepted);
+    sendTableRow(response, "Bridge Clients Evicted", s.clientsEvicted);
+    sendTableRow(response, "Bridge Clients Refused", s.clientsRefused);
+    sendTableRow(response, "Bridge In-flight", s.inFlight);
+    sendTableRow(response, "Bridge Errors", s.bridgeErrors);
+    for (uint8_t i = 0; i < REJECT_REASONS; i++){
+      response->printf("<tr><td>Bridge Rejected %s:</td><td>%u</td></tr>", TcpBridge::rejectName(i), s.rejected[i]);
+    }
+    sendTableRow(response, "Bridge Combined Writes", s.coalescedWrites);
+    sendTableRow(response, "Bridge Combined Frames", s.coalescedFrames);
+    sendTableRow(response, "Bridge Shared Reads", s.sharedReads);
+    sendTableRow(response, "Bridge Buffers In Use", s.poolInUse);
+    sendTableRow(response, "Bridge Buffers High Water", s.poolHighWater);
+    sendTableRow(response, "Bridge Buffer Heap Fallbacks", s.poolFallbacks);
+    for (uint8_t i = 0; i < s.maxClients; i++){
+      if (!s.clientValid[i]) continue;
+      auto &client = s.client[i];
+      response->printf("<tr><td>Bridge Client %u %s:</td><td>up %u s, idle %u ms, weight %u, in-flight %u (queued %u), requests %u, dropped %u, bus %u ms</td></tr>",
+        i, IPAddress(client.ip).toString().c_str(), client.connected / 1000, client.idle, client.weight, client.inFlight, client.queued, client.requests, client.dropped, client.busTime);
+    }
+    if (s.traceEnabled){
+      sendTableRow(response, "Trace Records", s.traceRecords);
+      sendTableRow(response, "Trace Bytes Used", s.traceUsed);
+      sendTableRow(response, "Trace Dropped", s.traceDropped);
+    }
+    if (s.mqttEnabled){
+      sendTableRow(response, "MQTT Connected", s.mqttConnected ? "yes" : "no");
+      sendTableRow(response, "MQTT Tags", s.mqttTags);
+      sendTableRow(response, "MQTT Publishes", s.mqttPublishes);
+      sendTableRow(response, "MQTT Read Errors", s.mqttReadErrors);
+    }
+    sendTableRow(response, "Boot Reset Reason", s.bootResetReason);
+    sendTableRow(response, "Boot Fast Path", s.bootFastPath ? "yes" : "no");
+    for (uint8_t i = 0; i < s.bootPhaseCount; i++){
+      response->printf("<tr><td>Boot %s (ms):</td><td>%u</td></tr>", s.bootPhaseNames[i], s.bootPhaseMs[i]);
+    }
+    sendTableRow(response, "Boot Total (ms)", s.bootMs);
+    sendTableRow(response, "Heap Free", s.heapFree);
+    sendTableRow(response, "Heap Min Free", s.heapMinFree);
+    sendTableRow(response, "Heap Largest Block", s.heapLargestBlock);
+    sendTableRow(response, "Heap Min Largest Block", s.heapMinLargestBlock);
+    sendTableRow(response, "Heap Fragmentation (%)", s.heapFragmentation);
+    sendTableRow(response, "Heap Alloc Failures", s.allocFailures);
+    for (uint8_t i = 0; i < s.taskCount; i++){
+      if (!s.tasks[i].alive) continue;
+      response->printf("<tr><td>Stack Free %s:</td><td>%u</td></tr>", s.tasks[i].name, s.tasks[i].minFree);
+    }
+    statusSnapshots.endView();
     response->print("<tr><td>&nbsp;</td><td></td></tr>");
     sendTableRow(response, "Build time", __DATE__ " " __TIME__);
+    response->print("</table>");
+    // per second and per minute over the last hour, also at /history.json
+    response->print("<h3>Bus history</h3><table>");
+    busHistory.printSparklines(*response);
     response->print("</table><p></p>");
+    if (refresh > 0){
+      response->printf("<script>setTimeout(function(){location.reload()},%ld)</script>", refresh * 1000L);
+      sendButton(response, "Stop refresh", "status");
+    }
+    else{
+      response->print("<form method=\"get\" action=\"status\">"
+          "<input type=\"hidden\" name=\"refresh\" value=\"5\">"
+          "<button>Auto refresh</button>"
+        "</form>"
+        "<p></p>");
+    }
     sendButton(response, "Back", "/");
     sendResponseTrailer(response);
     request->send(response);
   });
+  server->on("/status.json", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/status.json");
+    auto *response = request->beginResponseStream("application/json");
+    statusSnapshots.printJson(*response);
+    request->send(response);
+  });
+  server->on("/history.json", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/history.json");
+    auto *response = request->beginResponseStream("application/json");
+    busHistory.printJson(*response);
+    request->send(response);
+  });
+  server->on("/metrics", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/metrics");
+    auto *response = request->beginResponseStream("text/plain; version=0.0.4");
+    statusSnapshots.printMetrics(*response);
+    request->send(response);
+  });
   server->on("/reboot", HTTP_GET, [config](AsyncWebServerRequest *request){
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /reboot");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/reboot");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Really?");
     sendButton(response, "Back", "/");
@@ -71,7 +181,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] POST /reboot");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/reboot");
     request->redirect("/");
     dbgln("[webserver] rebooting...")
     ESP.restart();
@@ -81,7 +191,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /config");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/config");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Modbus TCP");
     response->print("<form method=\"post\">");
@@ -100,6 +210,94 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
         "</td>"
         "<td>");
     response->printf("<input type=\"number\" min=\"1\" id=\"tt\" name=\"tt\" value=\"%d\">", config->getTcpTimeout());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"tf\">In-flight requests per client</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"%d\" id=\"tf\" name=\"tf\" value=\"%d\">", TCP_BRIDGE_MAX_INFLIGHT, config->getTcpMaxInFlight());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mc\">Max clients</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"%d\" id=\"mc\" name=\"mc\" value=\"%d\">", TCP_BRIDGE_MAX_CLIENTS, config->getTcpMaxClients());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"ei\">Replace a client idle for (ms)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"65535\" id=\"ei\" name=\"ei\" value=\"%d\">", config->getTcpEvictIdle());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"ka\">TCP keepalive after (s, 0 = off)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"7200\" id=\"ka\" name=\"ka\" value=\"%d\">", config->getTcpKeepAlive());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"cu\">FC06 to FC16 units (e.g. 1,5-7)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"cu\" name=\"cu\" value=\"%s\">", config->getCoalesceUnits().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"cw\">Write combining window (ms)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"1000\" id=\"cw\" name=\"cw\" value=\"%d\">", config->getCoalesceWindow());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"rc\">Requests/s per connection (0 = no limit)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"65535\" id=\"rc\" name=\"rc\" value=\"%d\">", config->getTcpConnectionRate());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"ri\">Requests/s per client IP (0 = no limit)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"65535\" id=\"ri\" name=\"ri\" value=\"%d\">", config->getTcpAddressRate());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"rb\">Request burst</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"255\" id=\"rb\" name=\"rb\" value=\"%d\">", config->getTcpBurst());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"rw\">Bus share weights (ip=weight,...)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"rw\" name=\"rw\" value=\"%s\">", config->getTcpWeights().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"du\">Diagnostics unit (248-255, 0 = off)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" inputmode=\"numeric\" pattern=\"0|24[89]|25[0-5]\" title=\"0 or 248-255\" id=\"du\" name=\"du\" value=\"%d\">", config->getDiagUnit());
     response->print("</td>"
         "</tr>"
         "</table>"
@@ -168,6 +366,97 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
             "</select>"
           "</td>"
         "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mh4\">Hardware RS-485 (UART RTS)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"mh4\" name=\"mh4\" value=\"1\"%s>", config->getModbusHwRs485() ? " checked" : "");
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mx\">RX timeout (symbols)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"126\" id=\"mx\" name=\"mx\" value=\"%d\">", config->getModbusRxTimeout());
+    response->print("</td>"
+        "</tr>"
+        "</table>"
+        "<h3>WiFi (after reboot)</h3>"
+        "<table>"
+        "<tr>"
+          "<td>"
+            "<label for=\"ps\">Power save (modem sleep)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"ps\" name=\"ps\" value=\"1\"%s>", config->getWifiPowerSave() ? " checked" : "");
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"tx\">TX power</label>"
+          "</td>"
+          "<td>");
+    response->printf("<select id=\"tx\" name=\"tx\" data-value=\"%d\">", config->getWifiTxPower());
+    response->print("<option value=\"78\">19.5 dBm</option>"
+              "<option value=\"76\">19 dBm</option>"
+              "<option value=\"74\">18.5 dBm</option>"
+              "<option value=\"68\">17 dBm</option>"
+              "<option value=\"60\">15 dBm</option>"
+              "<option value=\"52\">13 dBm</option>"
+              "<option value=\"44\">11 dBm</option>"
+              "<option value=\"34\">8.5 dBm</option>"
+              "<option value=\"28\">7 dBm</option>"
+              "<option value=\"20\">5 dBm</option>"
+              "<option value=\"8\">2 dBm</option>"
+              "<option value=\"-4\">-1 dBm</option>"
+            "</select>"
+          "</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"fr\">Fast reconnect to the last access point</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"fr\" name=\"fr\" value=\"1\"%s>", config->getWifiFastReconnect() ? " checked" : "");
+    response->print("</td>"
+        "</tr>"
+        "</table>"
+        "<h3>Virtual slaves (after reboot)</h3>"
+        "<table>"
+        "<tr>"
+          "<td>"
+            "<label for=\"vu\">Simulated units (e.g. 1,5-7)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"vu\" name=\"vu\" value=\"%s\">", config->getSimUnits().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"vd\">Response delay (ms)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"10000\" id=\"vd\" name=\"vd\" value=\"%d\">", config->getSimDelay());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"ve\">Exceptions (%)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"100\" id=\"ve\" name=\"ve\" value=\"%d\">", config->getSimExceptionRate());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"vt\">Timeouts (%)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"100\" id=\"vt\" name=\"vt\" value=\"%d\">", config->getSimTimeoutRate());
+    response->print("</td>"
+        "</tr>"
         "</table>"
         "<h3>Serial (Debug)</h3>"
         "<table>"
@@ -211,6 +500,156 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
             "</select>"
           "</td>"
         "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"lv\">Log level</label>"
+          "</td>"
+          "<td>");
+    response->printf("<select id=\"lv\" name=\"lv\" data-value=\"%d\">", config->getLogLevel());
+    response->print("<option value=\"0\">Off</option>"
+              "<option value=\"1\">Error</option>"
+              "<option value=\"2\">Warning</option>"
+              "<option value=\"3\">Info</option>"
+              "<option value=\"4\">Debug</option>"
+            "</select>"
+          "</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"lb\">Binary log (tools/logdecode)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"lb\" name=\"lb\" value=\"1\"%s>", config->getLogBinary() ? " checked" : "");
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"tk\">Bridge trace buffer (KB, 0 = off)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" max=\"64\" id=\"tk\" name=\"tk\" value=\"%d\">", config->getTraceSize());
+    response->print("</td>"
+        "</tr>"
+        "</table>");
+
+    response->print("<h3>Tasks</h3>"
+        "<table>"
+        "<tr>"
+          "<td>"
+            "<label for=\"nc\">Network core</label>"
+          "</td>"
+          "<td>");
+    response->printf("<select id=\"nc\" name=\"nc\" data-value=\"%d\">", config->getNetCore());
+    response->print("<option value=\"-1\">Any</option>"
+              "<option value=\"0\">0</option>"
+              "<option value=\"1\">1</option>"
+            "</select>"
+          "</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"np\">Network priority</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"%d\" id=\"np\" name=\"np\" value=\"%d\">", configMAX_PRIORITIES - 1, config->getNetPriority());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"rc\">RTU core</label>"
+          "</td>"
+          "<td>");
+    response->printf("<select id=\"rc\" name=\"rc\" data-value=\"%d\">", config->getRtuCore());
+    response->print("<option value=\"-1\">Any</option>"
+              "<option value=\"0\">0</option>"
+              "<option value=\"1\">1</option>"
+            "</select>"
+          "</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"rp\">RTU priority</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"%d\" id=\"rp\" name=\"rp\" value=\"%d\">", configMAX_PRIORITIES - 1, config->getRtuPriority());
+    response->print("</td>"
+        "</tr>"
+        "</table>");
+
+    response->print("<h3>MQTT</h3>"
+        "<table>"
+        "<tr>"
+          "<td>"
+            "<label for=\"me\">Enabled</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"me\" name=\"me\" value=\"1\"%s>", config->getMqttEnabled() ? " checked" : "");
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mh\">Broker</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"mh\" name=\"mh\" value=\"%s\">", config->getMqttHost().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mo\">Port</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"1\" max=\"65535\" id=\"mo\" name=\"mo\" value=\"%d\">", config->getMqttPort());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mu\">User</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"mu\" name=\"mu\" value=\"%s\">", config->getMqttUser().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mw\">Password</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"password\" id=\"mw\" name=\"mw\" value=\"%s\">", WEB_PASS_PLACEHOLDER);
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mt\">Topic</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"text\" id=\"mt\" name=\"mt\" value=\"%s\">", config->getMqttTopic().c_str());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mi\">Poll interval (ms)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"10\" id=\"mi\" name=\"mi\" value=\"%d\">", config->getMqttPollInterval());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mn\">Snapshot interval (s)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"number\" min=\"0\" id=\"mn\" name=\"mn\" value=\"%d\">", config->getMqttSnapshotInterval());
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"mg\">Tags<br/>name,unit,fc,addr,deadband</label>"
+          "</td>"
+          "<td>");
+    response->printf("<textarea id=\"mg\" name=\"mg\" rows=\"6\">%s</textarea>", config->getMqttTags().c_str());
+    response->print("</td>"
+        "</tr>"
         "</table>");
     
     response->print(        "<h3>Other</h3>"
@@ -221,6 +660,14 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
           "</td>"
           "<td>");
     response->printf("<input type=\"password\" min=\"0\" id=\"wp\" name=\"wp\" value=\"%s\">", WEB_PASS_PLACEHOLDER); // we're not returning configured password to user instead we're sending placeholder
+    response->print("</td>"
+        "</tr>"
+        "<tr>"
+          "<td>"
+            "<label for=\"fb\">Fast boot (reuse last WiFi lease after a reset)</label>"
+          "</td>"
+          "<td>");
+    response->printf("<input type=\"checkbox\" id=\"fb\" name=\"fb\" value=\"1\"%s>", config->getFastBoot() ? " checked" : "");
     response->print("</td>"
         "</tr>"
         "</table>");
@@ -243,70 +690,210 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] POST /config");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/config");
     if (request->hasParam("tp", true)){
       auto port = request->getParam("tp", true)->value().toInt();
       config->setTcpPort(port);
-      dbgln("[webserver] saved port");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "port");
     }
     if (request->hasParam("tt", true)){
       auto timeout = request->getParam("tt", true)->value().toInt();
       config->setTcpTimeout(timeout);
-      dbgln("[webserver] saved timeout");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "timeout");
+    }
+    if (request->hasParam("tf", true)){
+      auto inFlight = request->getParam("tf", true)->value().toInt();
+      config->setTcpMaxInFlight(inFlight);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "in-flight limit");
+    }
+    if (request->hasParam("mc", true)){
+      auto clients = request->getParam("mc", true)->value().toInt();
+      config->setTcpMaxClients(clients);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "max clients");
+    }
+    if (request->hasParam("ei", true)){
+      auto idle = request->getParam("ei", true)->value().toInt();
+      config->setTcpEvictIdle(idle);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "client eviction");
+    }
+    if (request->hasParam("ka", true)){
+      auto keepAlive = request->getParam("ka", true)->value().toInt();
+      config->setTcpKeepAlive(keepAlive);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "keepalive");
+    }
+    if (request->hasParam("cu", true)){
+      config->setCoalesceUnits(request->getParam("cu", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "write combining units");
+    }
+    if (request->hasParam("cw", true)){
+      auto window = request->getParam("cw", true)->value().toInt();
+      config->setCoalesceWindow(window);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "write combining window");
+    }
+    if (request->hasParam("rc", true)){
+      auto rate = request->getParam("rc", true)->value().toInt();
+      config->setTcpConnectionRate(rate);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "connection rate limit");
+    }
+    if (request->hasParam("ri", true)){
+      auto rate = request->getParam("ri", true)->value().toInt();
+      config->setTcpAddressRate(rate);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "client rate limit");
+    }
+    if (request->hasParam("du", true)){
+      auto unit = request->getParam("du", true)->value().toInt();
+      config->setDiagUnit(unit);
+      if (config->getDiagUnit() == unit) elog(ELOG_INFO, EV_CONFIG_SAVED, "diagnostics unit");
+    }
+    if (request->hasParam("rb", true)){
+      auto burst = request->getParam("rb", true)->value().toInt();
+      config->setTcpBurst(burst);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "request burst");
+    }
+    if (request->hasParam("rw", true)){
+      config->setTcpWeights(request->getParam("rw", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "bus share weights");
     }
     if (request->hasParam("mb", true)){
       auto baud = request->getParam("mb", true)->value().toInt();
       config->setModbusBaudRate(baud);
-      dbgln("[webserver] saved modbus baud rate");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus baud rate");
     }
     if (request->hasParam("md", true)){
       auto data = request->getParam("md", true)->value().toInt();
       config->setModbusDataBits(data);
-      dbgln("[webserver] saved modbus data bits");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus data bits");
     }
     if (request->hasParam("mp", true)){
       auto parity = request->getParam("mp", true)->value().toInt();
       config->setModbusParity(parity);
-      dbgln("[webserver] saved modbus parity");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus parity");
     }
     if (request->hasParam("ms", true)){
       auto stop = request->getParam("ms", true)->value().toInt();
       config->setModbusStopBits(stop);
-      dbgln("[webserver] saved modbus stop bits");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus stop bits");
     }
     if (request->hasParam("mr", true)){
       auto rts = request->getParam("mr", true)->value().toInt();
       config->setModbusRtsPin(rts);
-      dbgln("[webserver] saved modbus rts pin");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus rts pin");
+    }
+    if (request->hasParam("mx", true)){
+      auto timeout = request->getParam("mx", true)->value().toInt();
+      config->setModbusHwRs485(request->hasParam("mh4", true));
+      config->setModbusRxTimeout(timeout);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "modbus rs485 mode");
+    }
+    if (request->hasParam("tx", true)){
+      auto power = request->getParam("tx", true)->value().toInt();
+      config->setWifiTxPower(power);
+      config->setWifiPowerSave(request->hasParam("ps", true));
+      config->setWifiFastReconnect(request->hasParam("fr", true));
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "wifi");
+    }
+    if (request->hasParam("vu", true)){
+      config->setSimUnits(request->getParam("vu", true)->value());
+      config->setSimDelay(request->getParam("vd", true)->value().toInt());
+      config->setSimExceptionRate(request->getParam("ve", true)->value().toInt());
+      config->setSimTimeoutRate(request->getParam("vt", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "virtual slaves");
     }
     if (request->hasParam("sb", true)){
       auto baud = request->getParam("sb", true)->value().toInt();
       config->setSerialBaudRate(baud);
-      dbgln("[webserver] saved serial baud rate");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "serial baud rate");
     }
     if (request->hasParam("sd", true)){
       auto data = request->getParam("sd", true)->value().toInt();
       config->setSerialDataBits(data);
-      dbgln("[webserver] saved serial data bits");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "serial data bits");
     }
     if (request->hasParam("sp", true)){
       auto parity = request->getParam("sp", true)->value().toInt();
       config->setSerialParity(parity);
-      dbgln("[webserver] saved serial parity");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "serial parity");
     }
     if (request->hasParam("ss", true)){
       auto stop = request->getParam("ss", true)->value().toInt();
       config->setSerialStopBits(stop);
-      dbgln("[webserver] saved serial stop bits");
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "serial stop bits");
+    }
+    if (request->hasParam("lv", true)){
+      config->setLogLevel(request->getParam("lv", true)->value().toInt());
+      config->setLogBinary(request->hasParam("lb", true));
+      eventLog.setLevel(config->getLogLevel());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "log level");
+    }
+    if (request->hasParam("tk", true)){
+      config->setTraceSize(request->getParam("tk", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "trace buffer");
+    }
+    if (request->hasParam("nc", true)){
+      config->setNetCore(request->getParam("nc", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "network core");
+    }
+    if (request->hasParam("np", true)){
+      config->setNetPriority(request->getParam("np", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "network priority");
+    }
+    if (request->hasParam("rc", true)){
+      config->setRtuCore(request->getParam("rc", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "rtu core");
+    }
+    if (request->hasParam("rp", true)){
+      config->setRtuPriority(request->getParam("rp", true)->value().toInt());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "rtu priority");
+    }
+    if (request->hasParam("mh", true)){
+      config->setMqttEnabled(request->hasParam("me", true));
+      config->setMqttHost(request->getParam("mh", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt broker");
+    }
+    if (request->hasParam("mo", true)){
+      auto port = request->getParam("mo", true)->value().toInt();
+      config->setMqttPort(port);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt port");
+    }
+    if (request->hasParam("mu", true)){
+      config->setMqttUser(request->getParam("mu", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt user");
+    }
+    if (request->hasParam("mw", true)){
+      String mw = request->getParam("mw", true)->value();
+      if (!mw.equals(WEB_PASS_PLACEHOLDER)) {
+        config->setMqttPassword(mw);
+        elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt password");
+      }
+    }
+    if (request->hasParam("mt", true)){
+      config->setMqttTopic(request->getParam("mt", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt topic");
+    }
+    if (request->hasParam("mi", true)){
+      auto interval = request->getParam("mi", true)->value().toInt();
+      config->setMqttPollInterval(interval);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt poll interval");
+    }
+    if (request->hasParam("mn", true)){
+      auto interval = request->getParam("mn", true)->value().toInt();
+      config->setMqttSnapshotInterval(interval);
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt snapshot interval");
+    }
+    if (request->hasParam("mg", true)){
+      config->setMqttTags(request->getParam("mg", true)->value());
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "mqtt tags");
     }
     if (request->hasParam("wp", true)){
       String wp = request->getParam("wp", true)->value();
       if (!wp.equals(WEB_PASS_PLACEHOLDER)) { // if we get default value prefilled in the wp input we're not changing current one
         config->setWebPassword(wp);
-        dbgln("[webserver] saved web password");
+        elog(ELOG_INFO, EV_CONFIG_SAVED, "web password");
       } else {
         dbgln("[webserver] web password not changed");
       }
+      config->setFastBoot(request->hasParam("fb", true));
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "fast boot");
     }
     request->redirect("/");    
   });
@@ -314,10 +901,17 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /debug");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/debug");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Debug");
     sendDebugForm(response, "1", "1", "3", "1");
+    if (traceRecorder.enabled()){
+      sendButton(response, "Download trace", "trace");
+      response->print("<form method=\"post\" action=\"trace\">"
+          "<button class=\"r\">Clear trace</button>"
+        "</form>"
+        "<p></p>");
+    }
     sendButton(response, "Back", "/");
     sendResponseTrailer(response);
     request->send(response);
@@ -326,7 +920,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] POST /debug");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/debug");
     String slaveId = "1";
     if (request->hasParam("slave", true)){
       slaveId = request->getParam("slave", true)->value();
@@ -346,18 +940,13 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Debug");
     response->print("<pre>");
-    auto previous = LOGDEVICE;
-    auto previousLevel = MBUlogLvl;
-    auto debug = WebPrint(previous, response);
-    LOGDEVICE = &debug;
-    MBUlogLvl = LOG_LEVEL_DEBUG;
-    ModbusMessage answer = rtu->syncRequest(0xdeadbeef, slaveId.toInt(), func.toInt(), reg.toInt(), count.toInt());
-    MBUlogLvl = previousLevel;
-    LOGDEVICE = previous;
+    auto debug = WebPrint(&debugSerial, response);
+    uint8_t answer[RTU_MAX_FRAME];
+    uint16_t answerLen;
+    auto error = rtu->read(slaveId.toInt(), func.toInt(), reg.toInt(), count.toInt(), answer, sizeof(answer), answerLen, &debug);
     response->print("</pre>");
-    auto error = answer.getError();
-    if (error == SUCCESS){
-      auto count = answer[2];
+    if (error == Modbus::Error::SUCCESS){
+      auto count = min((uint16_t)answer[2], (uint16_t)(answerLen - 3));
       response->print("<span >Answer: 0x");
       for (size_t i = 0; i < count; i++)
       {
@@ -373,11 +962,108 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     sendResponseTrailer(response);
     request->send(response);
   });
+  server->on("/trace", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/trace");
+    // pulled from the ring as the socket drains, no copy of the whole trace
+    auto cursor = std::make_shared<TraceCursor>();
+    traceRecorder.beginRead(*cursor);
+    auto *response = request->beginChunkedResponse("application/octet-stream", [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return traceRecorder.read(*cursor, buffer, maxLen);
+    });
+    response->addHeader("Content-Disposition", "attachment; filename=\"gateway.mbtr\"");
+    request->send(response);
+  });
+  server->on("/trace", HTTP_POST, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_POST, "/trace");
+    traceRecorder.clear();
+    request->redirect("/debug");
+  });
+  server->on("/map", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/map");
+    auto *response = request->beginResponseStream("text/html");
+    sendResponseHeader(response, "Register map");
+    sendMapForm(response, "");
+    sendButton(response, "Back", "/");
+    sendResponseTrailer(response);
+    request->send(response);
+  });
+  server->on("/map", HTTP_POST, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_POST, "/map");
+    String error;
+    if (request->hasParam("rm", true)){
+      if (registerMap.load(request->getParam("rm", true)->value(), error)){
+        elog(ELOG_INFO, EV_CONFIG_SAVED, "register map");
+      }
+    }
+    auto *response = request->beginResponseStream("text/html");
+    sendResponseHeader(response, "Register map");
+    if (error.isEmpty()){
+      response->printf("<p>%u tags saved</p>", registerMap.getCount());
+      sendMapForm(response, "");
+    }
+    else{
+      response->printf("<p class=\"e\">Not saved: %s</p>", error.c_str());
+      sendMapForm(response, request->getParam("rm", true)->value());
+    }
+    sendButton(response, "Back", "/");
+    sendResponseTrailer(response);
+    request->send(response);
+  });
+  server->on("/api/map", HTTP_GET, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/api/map");
+    auto *response = request->beginResponseStream("application/json");
+    registerMap.printJson(*response);
+    request->send(response);
+  });
+  // raw CSV or JSON body, collected in _tempObject (freed with the request)
+  server->on("/api/map", HTTP_POST, [config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_POST, "/api/map");
+    String error = "empty body";
+    if (request->_tempObject && registerMap.load((const char *)request->_tempObject, error)){
+      elog(ELOG_INFO, EV_CONFIG_SAVED, "register map");
+      request->send(200, "application/json", "{\"tags\":" + String(registerMap.getCount()) + "}");
+      return;
+    }
+    request->send(400, "application/json", "{\"error\":\"" + error + "\"}");
+  }, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+    if (total > REGMAP_MAX_UPLOAD) return;
+    if (index == 0) request->_tempObject = calloc(total + 1, 1);
+    if (request->_tempObject && index + len <= total) memcpy((uint8_t *)request->_tempObject + index, data, len);
+  });
+  server->on("/api/read", HTTP_GET, [rtu, config](AsyncWebServerRequest *request){
+    
+    ADMIN_WEB_PASS;
+
+    elog(ELOG_DEBUG, EV_WEB_GET, "/api/read");
+    String tags = request->hasParam("tags") ? request->getParam("tags")->value() : "";
+    uint16_t gap = request->hasParam("gap") ? request->getParam("gap")->value().toInt() : REGMAP_DEFAULT_GAP;
+    auto *response = request->beginResponseStream("application/json");
+    registerMap.read(rtu, tags, gap, *response);
+    request->send(response);
+  });
   server->on("/update", HTTP_GET, [config](AsyncWebServerRequest *request){
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /update");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/update");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "Firmware Update");
     response->print("<form method=\"post\" enctype=\"multipart/form-data\">"
@@ -416,7 +1102,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbg("[webserver] OTA progress ");dbgln(index);
+    elog(ELOG_DEBUG, EV_OTA_PROGRESS, index);
     if (!index) {
       //TODO add MD5 Checksum and Update.setMD5
       int cmd = (filename == "filesystem") ? U_SPIFFS : U_FLASH;
@@ -444,7 +1130,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] GET /wifi");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/wifi");
     auto *response = request->beginResponseStream("text/html");
     sendResponseHeader(response, "WiFi reset");
     response->print("<p class=\"e\">"
@@ -463,7 +1149,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     
     ADMIN_WEB_PASS;
 
-    dbgln("[webserver] POST /wifi");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/wifi");
     request->redirect("/");
     wm->erase();
     dbgln("[webserver] erased wifi config");
@@ -472,7 +1158,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
     dbgln("[webserver] rebooted...");
   });
   server->on("/favicon.ico", [](AsyncWebServerRequest *request){
-    dbgln("[webserver] GET /favicon.ico");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/favicon.ico");
     request->send(204);//TODO add favicon
   });
   server->on("/style.css", [config](AsyncWebServerRequest *request){
@@ -483,7 +1169,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
         return;
       }
     }
-    dbgln("[webserver] GET /style.css");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/style.css");
     auto *response = request->beginResponseStream("text/css");
     sendMinCss(response);
     response->print(
@@ -497,7 +1183,7 @@ void setupPages(AsyncWebServer *server, ModbusClientRTU *rtu, ModbusBridgeWiFi *
       "text-align:left;"
       "width:100%;"
     "}"
-    "input{"
+    "input,textarea{"
       "width:100%;"
     "}"
     ".e{"
@@ -647,6 +1333,29 @@ void sendDebugForm(AsyncResponseStream *response, String slaveId, String reg, St
       "</script>");
 }
 
+// text is a rejected upload shown again, empty shows the saved map
+void sendMapForm(AsyncResponseStream *response, String text){
+    response->print("<form method=\"post\">"
+      "<p>One tag per line: name,unit,fc,address,type[,order[,scale]]<br>"
+      "type: bool (fc 1, 2), int16, uint16, int32, uint32, float32, string:N (N registers)<br>"
+      "order: ABCD (default), BADC, CDAB, DCBA</p>"
+      "<textarea id=\"rm\" name=\"rm\" rows=\"16\" cols=\"60\">");
+    if (text.isEmpty()){
+      registerMap.printCsv(*response);
+    }
+    else{
+      text.replace("&", "&amp;");
+      text.replace("<", "&lt;");
+      response->print(text);
+    }
+    response->print("</textarea>"
+      "<p></p>"
+      "<button class=\"r\">Save</button>"
+      "</form>"
+      "<p></p>");
+    sendButton(response, "Read all", "api/read");
+}
+
 const String ErrorName(Modbus::Error code)
 {
     switch (code)
@@ -1,12 +1,14 @@
 #include "pages_ethernet_awot.h"
+#include "enc_network.h"
 #include <Update.h>
 
 // Статические члены класса
 EthernetServer EthernetWebUI::server(80);
 Application EthernetWebUI::app;
-ModbusClientRTU *EthernetWebUI::g_rtu = nullptr;
-ModbusBridgeEthernet *EthernetWebUI::g_bridge = nullptr;
+RtuClient *EthernetWebUI::g_rtu = nullptr;
+TcpBridge *EthernetWebUI::g_bridge = nullptr;
 Config *EthernetWebUI::g_config = nullptr;
+EncNetwork *EthernetWebUI::g_network = nullptr;
 
 // CSS стили (встроенные для избежания дополнительного запроса)
 const char* CSS_STYLE = 
@@ -46,7 +48,7 @@ const char* CSS_STYLE =
         "text-align:left;"
         "width:100%;"
     "}"
-    "input{"
+    "input,textarea{"
         "width:100%;"
     "}"
     ".e{"
@@ -57,14 +59,21 @@ const char* CSS_STYLE =
     "}"
     "</style>";
 
-void EthernetWebUI::begin(ModbusClientRTU *rtu, ModbusBridgeEthernet *bridge, Config *config) {
+void EthernetWebUI::begin(RtuClient *rtu, TcpBridge *bridge, Config *config, EncNetwork *network) {
     g_rtu = rtu;
     g_bridge = bridge;
     g_config = config;
+    g_network = network;
     
     // Настройка маршрутов
     app.get("/", &handleRoot);
     app.get("/status", &handleStatus);
+    app.get("/status.json", &handleStatusJson);
+    app.get("/history.json", &handleHistoryJson);
+    app.get("/api/map", &handleApiMap);
+    app.post("/api/map", &handleApiMapPost);
+    app.get("/api/read", &handleApiRead);
+    app.get("/metrics", &handleMetrics);
     app.get("/config", &handleConfig);
     app.post("/config", &handleConfigPost);
     app.get("/debug", &handleDebug);
@@ -146,7 +155,7 @@ String EthernetWebUI::button(const char *title, const char *href, const char *cs
 void EthernetWebUI::handleRoot(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/");
     
     res.set("Content-Type", "text/html; charset=utf-8");
     res.set("Connection", "close");
@@ -164,7 +173,10 @@ void EthernetWebUI::handleRoot(Request &req, Response &res) {
 void EthernetWebUI::handleStatus(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /status");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/status");
+    
+    char buf[150];
+    long refresh = req.query("refresh", buf, sizeof(buf)) ? atol(buf) : 0;
     
     res.set("Content-Type", "text/html; charset=utf-8");
     res.set("Connection", "close");
@@ -173,60 +185,236 @@ void EthernetWebUI::handleStatus(Request &req, Response &res) {
     res.print(htmlHeader("System Status"));
     res.print(F("<table>"));
     
-    // Отправляем каждую строку отдельно, используя char буфер
-    char buf[150];
+    // Все значения из снимка задачи status, здесь только форматирование
+    auto &s = statusSnapshots.beginView();
     
     sprintf(buf, "<tr><td>Uptime:</td><td>%lu s</td></tr>", (unsigned long)(esp_timer_get_time() / 1000000));
     res.print(buf);
     
-    uint8_t mac[6];
-    Ethernet.macAddress(mac);
-    sprintf(buf, "<tr><td>MAC:</td><td>%02X:%02X:%02X:%02X:%02X:%02X</td></tr>", 
-            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    sprintf(buf, "<tr><td>MAC:</td><td>%s</td></tr>", s.mac);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>IP:</td><td>%s</td></tr>", IPAddress(s.ip).toString().c_str());
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>Gateway:</td><td>%s</td></tr>", IPAddress(s.gateway).toString().c_str());
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>Subnet:</td><td>%s</td></tr>", IPAddress(s.subnet).toString().c_str());
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RTU Messages:</td><td>%u</td></tr>", s.rtuMessages);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RTU Pending:</td><td>%u</td></tr>", s.rtuPending);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>IP:</td><td>%s</td></tr>", Ethernet.localIP().toString().c_str());
+    sprintf(buf, "<tr><td>RTU Errors:</td><td>%u</td></tr>", s.rtuErrors);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>Gateway:</td><td>%s</td></tr>", Ethernet.gatewayIP().toString().c_str());
+    // Задержка и состояние по каждому unit на шине
+    for (uint8_t i = 0; i < s.unitCount; i++) {
+        auto &unit = s.units[i];
+        snprintf(buf, sizeof(buf), "<tr><td>Unit %u:</td><td>%s, req %u, err %u, timeouts %u, %.1f ms</td></tr>",
+            unit.unit, unit.timeoutsInRow >= RTU_OFFLINE_TIMEOUTS ? "offline" : "online", unit.requests, unit.errors, unit.timeouts, unit.latency / 1000.0);
+        res.print(buf);
+    }
+    
+    sprintf(buf, "<tr><td>TCP Messages:</td><td>%u</td></tr>", s.bridgeMessages);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>Subnet:</td><td>%s</td></tr>", Ethernet.subnetMask().toString().c_str());
+    sprintf(buf, "<tr><td>TCP Active:</td><td>%u</td></tr>", s.clients);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>RTU Messages:</td><td>%u</td></tr>", g_rtu->getMessageCount());
+    sprintf(buf, "<tr><td>TCP Clients:</td><td>%u accepted, %u evicted, %u refused</td></tr>", s.clientsAccepted, s.clientsEvicted, s.clientsRefused);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>RTU Pending:</td><td>%u</td></tr>", g_rtu->pendingRequests());
+    sprintf(buf, "<tr><td>TCP In-flight:</td><td>%u</td></tr>", s.inFlight);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>RTU Errors:</td><td>%u</td></tr>", g_rtu->getErrorCount());
+    sprintf(buf, "<tr><td>TCP Errors:</td><td>%u</td></tr>", s.bridgeErrors);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>TCP Messages:</td><td>%u</td></tr>", g_bridge->getMessageCount());
+    // Запросы, отклонённые мостом до очереди RTU, по причинам
+    for (uint8_t i = 0; i < REJECT_REASONS; i++) {
+        sprintf(buf, "<tr><td>TCP Rejected %s:</td><td>%u</td></tr>", TcpBridge::rejectName(i), s.rejected[i]);
+        res.print(buf);
+    }
+    
+    sprintf(buf, "<tr><td>Combined Writes:</td><td>%u</td></tr>", s.coalescedWrites);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>TCP Active:</td><td>%u</td></tr>", g_bridge->activeClients());
+    sprintf(buf, "<tr><td>Shared Reads:</td><td>%u</td></tr>", s.sharedReads);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>TCP Errors:</td><td>%u</td></tr>", g_bridge->getErrorCount());
+    sprintf(buf, "<tr><td>TCP Buffers:</td><td>%u (max %u, heap %u)</td></tr>", s.poolInUse, s.poolHighWater, s.poolFallbacks);
     res.print(buf);
     
-    sprintf(buf, "<tr><td>RAM Free:</td><td>%u bytes</td></tr>", ESP.getFreeHeap());
+    // Очередь, отброшенные запросы и время шины по клиентам
+    for (uint8_t i = 0; i < s.maxClients; i++) {
+        if (!s.clientValid[i]) continue;
+        auto &client = s.client[i];
+        snprintf(buf, sizeof(buf), "<tr><td>Client %s:</td><td>", IPAddress(client.ip).toString().c_str());
+        res.print(buf);
+        snprintf(buf, sizeof(buf), "up %u s, idle %u ms, queued %u/%u, dropped %u, bus %u ms</td></tr>", client.connected / 1000, client.idle, client.queued, client.inFlight, client.dropped, client.busTime);
+        res.print(buf);
+    }
+    
+    sprintf(buf, "<tr><td>ENC IRQ Wakeups:</td><td>%u</td></tr>", s.encIrqWakeups);
     res.print(buf);
     
+    sprintf(buf, "<tr><td>ENC Timer Wakeups:</td><td>%u</td></tr>", s.encTimerWakeups);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RAM Free:</td><td>%u bytes</td></tr>", s.heapFree);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RAM Min Free:</td><td>%u bytes</td></tr>", s.heapMinFree);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RAM Largest Block:</td><td>%u (min %u) bytes</td></tr>", s.heapLargestBlock, s.heapMinLargestBlock);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>RAM Fragmentation:</td><td>%u %%</td></tr>", s.heapFragmentation);
+    res.print(buf);
+    
+    sprintf(buf, "<tr><td>Alloc Failures:</td><td>%u</td></tr>", s.allocFailures);
+    res.print(buf);
+    
+    // Минимальный свободный стек каждой задачи за время работы
+    for (uint8_t i = 0; i < s.taskCount; i++) {
+        if (!s.tasks[i].alive) continue;
+        sprintf(buf, "<tr><td>Stack %s:</td><td>%u bytes</td></tr>", s.tasks[i].name, s.tasks[i].minFree);
+        res.print(buf);
+    }
+    
+    // Длительность этапов загрузки
+    sprintf(buf, "<tr><td>Boot:</td><td>%u ms after %s reset, fast boot %s</td></tr>", s.bootMs, s.bootResetReason, s.bootFastPath ? "yes" : "no");
+    res.print(buf);
+    for (uint8_t i = 0; i < s.bootPhaseCount; i++) {
+        sprintf(buf, "<tr><td>Boot %s:</td><td>%u ms</td></tr>", s.bootPhaseNames[i], s.bootPhaseMs[i]);
+        res.print(buf);
+    }
+    statusSnapshots.endView();
+    
     sprintf(buf, "<tr><td>Build:</td><td>%s %s</td></tr>", __DATE__, __TIME__);
     res.print(buf);
     
+    res.print(F("</table>"));
+    // Нагрузка и ошибки шины за последний час, те же данные в /history.json
+    res.print(F("<h3>Bus history</h3><table>"));
+    busHistory.printSparklines(res);
     res.print(F("</table><p></p>"));
+    // Автообновление: страница строится из снимка, частые запросы дешевые
+    if (refresh > 0) {
+        sprintf(buf, "<script>setTimeout(function(){location.reload()},%ld)</script>", refresh * 1000L);
+        res.print(buf);
+        res.print(button("Stop refresh", "/status", ""));
+    } else {
+        res.print(F("<form method='get' action='/status'><input type='hidden' name='refresh' value='5'><button>Auto refresh</button></form><p></p>"));
+    }
     res.print(button("Back", "/", ""));
     res.print(htmlFooter());
 }
 
+void EthernetWebUI::handleStatusJson(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_GET, "/status.json");
+    
+    res.set("Content-Type", "application/json");
+    res.set("Connection", "close");
+    statusSnapshots.printJson(res);
+}
+
+void EthernetWebUI::handleHistoryJson(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_GET, "/history.json");
+    
+    res.set("Content-Type", "application/json");
+    res.set("Connection", "close");
+    busHistory.printJson(res);
+}
+
+// Карта регистров в JSON
+void EthernetWebUI::handleApiMap(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_GET, "/api/map");
+    
+    res.set("Content-Type", "application/json");
+    res.set("Connection", "close");
+    registerMap.printJson(res);
+}
+
+// Загрузка карты регистров: тело запроса целиком в CSV или JSON
+void EthernetWebUI::handleApiMapPost(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_POST, "/api/map");
+    
+    res.set("Content-Type", "application/json");
+    res.set("Connection", "close");
+    int contentLength = req.left();
+    if (contentLength <= 0 || contentLength > REGMAP_MAX_UPLOAD) {
+        res.status(400);
+        res.print(F("{\"error\":\"empty or too large body\"}"));
+        return;
+    }
+    
+    String text;
+    text.reserve(contentLength);
+    uint8_t buff[128];
+    while (text.length() < (unsigned int)contentLength && req.available()) {
+        int len = req.read(buff, sizeof(buff));
+        if (len > 0) text.concat((const char *)buff, len);
+    }
+    
+    String error;
+    if (!registerMap.load(text, error)) {
+        res.status(400);
+        res.print("{\"error\":\"" + error + "\"}");
+        return;
+    }
+    elog(ELOG_INFO, EV_CONFIG_SAVED, "register map");
+    char buf[32];
+    sprintf(buf, "{\"tags\":%u}", registerMap.getCount());
+    res.print(buf);
+}
+
+// Чтение тегов карты: ?tags=a,b&gap=N, без tags читаются все
+void EthernetWebUI::handleApiRead(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_GET, "/api/read");
+    
+    char tags[512] = "";
+    char buf[16];
+    uint16_t gap = REGMAP_DEFAULT_GAP;
+    req.query("tags", tags, sizeof(tags));
+    if (req.query("gap", buf, sizeof(buf))) gap = atoi(buf);
+    
+    res.set("Content-Type", "application/json");
+    res.set("Connection", "close");
+    registerMap.read(g_rtu, tags, gap, res);
+}
+
+// Метрики в текстовом формате Prometheus
+void EthernetWebUI::handleMetrics(Request &req, Response &res) {
+    if (!checkAuth(req, res)) return;
+    
+    elog(ELOG_DEBUG, EV_WEB_GET, "/metrics");
+    
+    res.set("Content-Type", "text/plain; version=0.0.4");
+    res.set("Connection", "close");
+    statusSnapshots.printMetrics(res);
+}
+
 void EthernetWebUI::handleConfig(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /config");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/config");
     
     String page = htmlHeader("Configuration");
     page += F("<form method='post'>");
@@ -234,6 +422,16 @@ void EthernetWebUI::handleConfig(Request &req, Response &res) {
     page += F("<h3>Modbus TCP</h3><table>");
     page += "<tr><td>TCP Port:</td><td><input type='number' name='tp' min='1' max='65535' value='" + String(g_config->getTcpPort()) + "'></td></tr>";
     page += "<tr><td>Timeout (ms):</td><td><input type='number' name='tt' min='1' value='" + String(g_config->getTcpTimeout()) + "'></td></tr>";
+    page += "<tr><td>FC06&rarr;FC16 units:</td><td><input type='text' name='cu' placeholder='1,5-7' value='" + g_config->getCoalesceUnits() + "'></td></tr>";
+    page += "<tr><td>Combine window (ms):</td><td><input type='number' name='cw' min='0' max='1000' value='" + String(g_config->getCoalesceWindow()) + "'></td></tr>";
+    page += "<tr><td>In-flight/client:</td><td><input type='number' name='tf' min='1' max='" + String(TCP_BRIDGE_MAX_INFLIGHT) + "' value='" + String(g_config->getTcpMaxInFlight()) + "'></td></tr>";
+    page += "<tr><td>Max clients:</td><td><input type='number' name='mc' min='1' max='" + String(TCP_BRIDGE_MAX_CLIENTS) + "' value='" + String(g_config->getTcpMaxClients()) + "'></td></tr>";
+    page += "<tr><td>Replace idle after (ms):</td><td><input type='number' name='ei' min='0' max='65535' value='" + String(g_config->getTcpEvictIdle()) + "'></td></tr>";
+    page += "<tr><td>Req/s per connection:</td><td><input type='number' name='rc' min='0' max='65535' value='" + String(g_config->getTcpConnectionRate()) + "'></td></tr>";
+    page += "<tr><td>Req/s per IP:</td><td><input type='number' name='ri' min='0' max='65535' value='" + String(g_config->getTcpAddressRate()) + "'></td></tr>";
+    page += "<tr><td>Request burst:</td><td><input type='number' name='rb' min='1' max='255' value='" + String(g_config->getTcpBurst()) + "'></td></tr>";
+    page += "<tr><td>Bus weights:</td><td><input type='text' name='rw' placeholder='192.168.1.10=4' value='" + g_config->getTcpWeights() + "'></td></tr>";
+    page += "<tr><td>Diagnostics unit (248-255, 0 = off):</td><td><input type='text' inputmode='numeric' pattern='0|24[89]|25[0-5]' title='0 or 248-255' name='du' value='" + String(g_config->getDiagUnit()) + "'></td></tr>";
     page += F("</table>");
     
     page += F("<h3>Modbus RTU</h3><table>");
@@ -252,6 +450,17 @@ void EthernetWebUI::handleConfig(Request &req, Response &res) {
     page += F("<option value='25'>GPIO25</option><option value='26'>GPIO26</option><option value='27'>GPIO27</option>");
     page += F("<option value='32'>GPIO32</option><option value='33'>GPIO33</option>");
     page += F("</select></td></tr>");
+    page += F("<tr><td>HW RS-485:</td><td><input type='checkbox' name='mh4' value='1'");
+    if (g_config->getModbusHwRs485()) page += F(" checked");
+    page += F("></td></tr>");
+    page += "<tr><td>RX Timeout (sym):</td><td><input type='number' name='mx' min='1' max='126' value='" + String(g_config->getModbusRxTimeout()) + "'></td></tr>";
+    page += F("</table>");
+
+    page += F("<h3>Virtual Slaves</h3><table>");
+    page += "<tr><td>Units:</td><td><input type='text' name='vu' placeholder='1,5-7' value='" + g_config->getSimUnits() + "'></td></tr>";
+    page += "<tr><td>Delay (ms):</td><td><input type='number' name='vd' min='0' max='10000' value='" + String(g_config->getSimDelay()) + "'></td></tr>";
+    page += "<tr><td>Exceptions (%):</td><td><input type='number' name='ve' min='0' max='100' value='" + String(g_config->getSimExceptionRate()) + "'></td></tr>";
+    page += "<tr><td>Timeouts (%):</td><td><input type='number' name='vt' min='0' max='100' value='" + String(g_config->getSimTimeoutRate()) + "'></td></tr>";
     page += F("</table>");
     
     page += F("<h3>Serial Debug</h3><table>");
@@ -263,6 +472,34 @@ void EthernetWebUI::handleConfig(Request &req, Response &res) {
     page += F("<tr><td>Stop Bits:</td><td><select name='ss' id='ss'>");
     page += F("<option value='1'>1</option><option value='2'>1.5</option><option value='3'>2</option>");
     page += F("</select></td></tr>");
+    page += F("<tr><td>Log Level:</td><td><select name='lv' id='lv'>");
+    page += F("<option value='0'>Off</option><option value='1'>Error</option><option value='2'>Warning</option><option value='3'>Info</option><option value='4'>Debug</option>");
+    page += F("</select></td></tr>");
+    page += F("<tr><td>Binary Log:</td><td><input type='checkbox' name='lb' value='1'");
+    if (g_config->getLogBinary()) page += F(" checked");
+    page += F("></td></tr>");
+    page += "<tr><td>Trace Buffer (KB):</td><td><input type='number' name='tk' min='0' max='64' value='" + String(g_config->getTraceSize()) + "'></td></tr>";
+    page += F("</table>");
+    
+    page += F("<h3>Tasks</h3><table>");
+    page += F("<tr><td>Network Core:</td><td><select name='nc' id='nc'><option value='-1'>Any</option><option value='0'>0</option><option value='1'>1</option></select></td></tr>");
+    page += "<tr><td>Network Priority:</td><td><input type='number' name='np' min='1' max='24' value='" + String(g_config->getNetPriority()) + "'></td></tr>";
+    page += F("<tr><td>RTU Core:</td><td><select name='rc' id='rc'><option value='-1'>Any</option><option value='0'>0</option><option value='1'>1</option></select></td></tr>");
+    page += "<tr><td>RTU Priority:</td><td><input type='number' name='rp' min='1' max='24' value='" + String(g_config->getRtuPriority()) + "'></td></tr>";
+    page += F("</table>");
+    
+    page += F("<h3>MQTT</h3><table>");
+    page += F("<tr><td>Enabled:</td><td><input type='checkbox' name='me' value='1'");
+    if (g_config->getMqttEnabled()) page += F(" checked");
+    page += F("></td></tr>");
+    page += "<tr><td>Broker:</td><td><input type='text' name='mh' value='" + g_config->getMqttHost() + "'></td></tr>";
+    page += "<tr><td>Port:</td><td><input type='number' name='mo' min='1' max='65535' value='" + String(g_config->getMqttPort()) + "'></td></tr>";
+    page += "<tr><td>User:</td><td><input type='text' name='mu' value='" + g_config->getMqttUser() + "'></td></tr>";
+    page += F("<tr><td>Password:</td><td><input type='password' name='mw' placeholder='Leave empty to keep'></td></tr>");
+    page += "<tr><td>Topic:</td><td><input type='text' name='mt' value='" + g_config->getMqttTopic() + "'></td></tr>";
+    page += "<tr><td>Poll (ms):</td><td><input type='number' name='mi' min='10' value='" + String(g_config->getMqttPollInterval()) + "'></td></tr>";
+    page += "<tr><td>Snapshot (s):</td><td><input type='number' name='mn' min='0' value='" + String(g_config->getMqttSnapshotInterval()) + "'></td></tr>";
+    page += "<tr><td>Tags:</td><td><textarea name='mg' rows='6' placeholder='name,unit,fc,addr,deadband'>" + g_config->getMqttTags() + "</textarea></td></tr>";
     page += F("</table>");
     
     page += F("<h3>Web Interface</h3><table>");
@@ -279,6 +516,9 @@ void EthernetWebUI::handleConfig(Request &req, Response &res) {
     page += "document.getElementById('mr').value='" + String(g_config->getModbusRtsPin()) + "';";
     page += "document.getElementById('sp').value='" + String(g_config->getSerialParity()) + "';";
     page += "document.getElementById('ss').value='" + String(g_config->getSerialStopBits()) + "';";
+    page += "document.getElementById('lv').value='" + String(g_config->getLogLevel()) + "';";
+    page += "document.getElementById('nc').value='" + String(g_config->getNetCore()) + "';";
+    page += "document.getElementById('rc').value='" + String(g_config->getRtuCore()) + "';";
     page += "</script>";
     
     page += htmlFooter();
@@ -291,23 +531,66 @@ void EthernetWebUI::handleConfig(Request &req, Response &res) {
 void EthernetWebUI::handleConfigPost(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] POST /config");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/config");
     
     char buf[32];
     if (req.query("tp", buf, sizeof(buf))) g_config->setTcpPort(atoi(buf));
     if (req.query("tt", buf, sizeof(buf))) g_config->setTcpTimeout(atoi(buf));
+    if (req.query("tf", buf, sizeof(buf))) g_config->setTcpMaxInFlight(atoi(buf));
+    if (req.query("cu", buf, sizeof(buf))) g_config->setCoalesceUnits(String(buf));
+    if (req.query("cw", buf, sizeof(buf))) g_config->setCoalesceWindow(atoi(buf));
+    if (req.query("mc", buf, sizeof(buf))) g_config->setTcpMaxClients(atoi(buf));
+    if (req.query("ei", buf, sizeof(buf))) g_config->setTcpEvictIdle(atoi(buf));
+    if (req.query("rc", buf, sizeof(buf))) g_config->setTcpConnectionRate(atoi(buf));
+    if (req.query("ri", buf, sizeof(buf))) g_config->setTcpAddressRate(atoi(buf));
+    if (req.query("rb", buf, sizeof(buf))) g_config->setTcpBurst(atoi(buf));
+    char weights[128];
+    if (req.query("rw", weights, sizeof(weights))) g_config->setTcpWeights(String(weights));
+    if (req.query("du", buf, sizeof(buf))) g_config->setDiagUnit(atoi(buf));
     if (req.query("mb", buf, sizeof(buf))) g_config->setModbusBaudRate(atol(buf));
     if (req.query("md", buf, sizeof(buf))) g_config->setModbusDataBits(atoi(buf));
     if (req.query("mp", buf, sizeof(buf))) g_config->setModbusParity(atoi(buf));
     if (req.query("ms", buf, sizeof(buf))) g_config->setModbusStopBits(atoi(buf));
     if (req.query("mr", buf, sizeof(buf))) g_config->setModbusRtsPin(atoi(buf));
+    if (req.query("mx", buf, sizeof(buf))) {
+        g_config->setModbusRxTimeout(atoi(buf));
+        g_config->setModbusHwRs485(req.query("mh4", buf, sizeof(buf)));
+    }
+    if (req.query("vu", buf, sizeof(buf))) g_config->setSimUnits(String(buf));
+    if (req.query("vd", buf, sizeof(buf))) g_config->setSimDelay(atoi(buf));
+    if (req.query("ve", buf, sizeof(buf))) g_config->setSimExceptionRate(atoi(buf));
+    if (req.query("vt", buf, sizeof(buf))) g_config->setSimTimeoutRate(atoi(buf));
     if (req.query("sb", buf, sizeof(buf))) g_config->setSerialBaudRate(atol(buf));
     if (req.query("sd", buf, sizeof(buf))) g_config->setSerialDataBits(atoi(buf));
     if (req.query("sp", buf, sizeof(buf))) g_config->setSerialParity(atoi(buf));
     if (req.query("ss", buf, sizeof(buf))) g_config->setSerialStopBits(atoi(buf));
+    if (req.query("lv", buf, sizeof(buf))) {
+        g_config->setLogLevel(atoi(buf));
+        g_config->setLogBinary(req.query("lb", buf, sizeof(buf)));
+        eventLog.setLevel(g_config->getLogLevel());
+    }
+    if (req.query("tk", buf, sizeof(buf))) g_config->setTraceSize(atoi(buf));
     if (req.query("wp", buf, sizeof(buf)) && strlen(buf) > 0) {
         g_config->setWebPassword(String(buf));
     }
+    if (req.query("nc", buf, sizeof(buf))) g_config->setNetCore(atoi(buf));
+    if (req.query("np", buf, sizeof(buf))) g_config->setNetPriority(atoi(buf));
+    if (req.query("rc", buf, sizeof(buf))) g_config->setRtuCore(atoi(buf));
+    if (req.query("rp", buf, sizeof(buf))) g_config->setRtuPriority(atoi(buf));
+    if (req.query("mh", buf, sizeof(buf))) {
+        g_config->setMqttHost(String(buf));
+        g_config->setMqttEnabled(req.query("me", buf, sizeof(buf)));
+    }
+    if (req.query("mo", buf, sizeof(buf))) g_config->setMqttPort(atoi(buf));
+    if (req.query("mu", buf, sizeof(buf))) g_config->setMqttUser(String(buf));
+    if (req.query("mw", buf, sizeof(buf)) && strlen(buf) > 0) {
+        g_config->setMqttPassword(String(buf));
+    }
+    if (req.query("mt", buf, sizeof(buf))) g_config->setMqttTopic(String(buf));
+    if (req.query("mi", buf, sizeof(buf))) g_config->setMqttPollInterval(atol(buf));
+    if (req.query("mn", buf, sizeof(buf))) g_config->setMqttSnapshotInterval(atol(buf));
+    char tags[1024];
+    if (req.query("mg", tags, sizeof(tags))) g_config->setMqttTags(String(tags));
     
     res.set("Location", "/");
     res.status(303);
@@ -318,7 +601,7 @@ void EthernetWebUI::handleConfigPost(Request &req, Response &res) {
 void EthernetWebUI::handleDebug(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /debug");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/debug");
     
     String page = htmlHeader("Debug Tool");
     page += F("<form method='post'><table>");
@@ -344,7 +627,7 @@ void EthernetWebUI::handleDebug(Request &req, Response &res) {
 void EthernetWebUI::handleDebugPost(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] POST /debug");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/debug");
     
     char buf[16];
     int id = 1, fc = 3, ad = 0, cn = 1;
@@ -356,12 +639,10 @@ void EthernetWebUI::handleDebugPost(Request &req, Response &res) {
     String page = htmlHeader("Debug Result");
     
     // Выполнение Modbus запроса
-    auto previousLevel = MBUlogLvl;
-    MBUlogLvl = LOG_LEVEL_DEBUG;
-    ModbusMessage response = g_rtu->syncRequest(0xDEADBEEF, id, fc, ad, cn);
-    MBUlogLvl = previousLevel;
-    
-    Modbus::Error err = response.getError();
+    // Кадры TX/RX выводятся в отладочный порт
+    uint8_t response[RTU_MAX_FRAME];
+    uint16_t responseLen = 0;
+    Modbus::Error err = g_rtu->read(id, fc, ad, cn, response, sizeof(response), responseLen, &debugSerial);
     
     if (err == Modbus::Error::SUCCESS) {
         page += F("<h3 style='color:#5f5'>✓ SUCCESS</h3>");
@@ -371,7 +652,7 @@ void EthernetWebUI::handleDebugPost(Request &req, Response &res) {
         page += "<tr><td>Count:</td><td>" + String(cn) + "</td></tr></table>";
         
         page += F("<h4>Response Data (HEX):</h4><pre>");
-        for (size_t i = 3; i < response.size(); ++i) {
+        for (size_t i = 3; i < responseLen; ++i) {
             if (response[i] < 0x10) page += "0";
             page += String(response[i], HEX);
             page += " ";
@@ -396,7 +677,7 @@ void EthernetWebUI::handleDebugPost(Request &req, Response &res) {
 void EthernetWebUI::handleNetwork(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /network");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/network");
     
     String page = htmlHeader("Network Config");
     
@@ -411,6 +692,12 @@ void EthernetWebUI::handleNetwork(Request &req, Response &res) {
     page += F("<tr><td>Use DHCP:</td><td><input type='checkbox' name='dhcp' id='dhcp' value='1'");
     if (g_config->getUseDhcp()) page += F(" checked");
     page += F(" onchange='toggleStatic()'></td></tr>");
+    page += F("<tr><td>INT-driven ENC28J60:</td><td><input type='checkbox' name='irq' value='1'");
+    if (g_config->getEncInterrupt()) page += F(" checked");
+    page += F("></td></tr>");
+    page += F("<tr><td>Fast boot (reuse DHCP lease):</td><td><input type='checkbox' name='fb' value='1'");
+    if (g_config->getFastBoot()) page += F(" checked");
+    page += F("></td></tr>");
     page += F("</table>");
     
     page += F("<div id='static' style='display:");
@@ -456,11 +743,13 @@ void EthernetWebUI::handleNetwork(Request &req, Response &res) {
 void EthernetWebUI::handleNetworkPost(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] POST /network");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/network");
     
     char buf[32];
     bool useDhcp = req.query("dhcp", buf, sizeof(buf));
     g_config->setUseDhcp(useDhcp);
+    g_config->setEncInterrupt(req.query("irq", buf, sizeof(buf)));
+    g_config->setFastBoot(req.query("fb", buf, sizeof(buf)));
     
     if (!useDhcp) {
         if (req.query("ip", buf, sizeof(buf))) {
@@ -490,7 +779,7 @@ void EthernetWebUI::handleNetworkPost(Request &req, Response &res) {
 void EthernetWebUI::handleReboot(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /reboot");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/reboot");
     
     String page = htmlHeader("Reboot Device");
     page += F("<p>Are you sure you want to reboot the device?</p>");
@@ -506,7 +795,7 @@ void EthernetWebUI::handleReboot(Request &req, Response &res) {
 void EthernetWebUI::handleRebootPost(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] POST /reboot");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/reboot");
     
     res.set("Connection", "close");
     res.print("Rebooting...");
@@ -517,7 +806,7 @@ void EthernetWebUI::handleRebootPost(Request &req, Response &res) {
 void EthernetWebUI::handleUpdate(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] GET /update");
+    elog(ELOG_DEBUG, EV_WEB_GET, "/update");
     
     String page = htmlHeader("Firmware Update");
     page += F("<p class='e'>⚠ Warning: Do not disconnect power during update!</p>");
@@ -535,7 +824,7 @@ void EthernetWebUI::handleUpdate(Request &req, Response &res) {
 void EthernetWebUI::handleUpdatePost(Request &req, Response &res) {
     if (!checkAuth(req, res)) return;
     
-    dbgln("[webserver] POST /update - OTA");
+    elog(ELOG_DEBUG, EV_WEB_POST, "/update");
     
     // Здесь НЕ используем буферизацию String - файл слишком большой
     // Используем потоковое чтение
@@ -0,0 +1,466 @@
+#include "register_map.h"
+
+#include <algorithm>
+
+// fields of a tag in CSV order, also the JSON keys
+#define TAG_FIELDS 7
+static const char *fieldNames[TAG_FIELDS] = {"name", "unit", "fc", "address", "type", "order", "scale"};
+static const char *typeNames[REG_TYPES] = {"bool", "int16", "uint16", "int32", "uint32", "float32", "string"};
+static const char *orderNames[4] = {"ABCD", "BADC", "CDAB", "DCBA"};
+
+RegisterMap registerMap;
+
+RegisterMap::RegisterMap()
+    :_config(nullptr)
+    ,_count(0)
+{}
+
+static bool parseNumber(const String &text, long min, long max, long &value){
+    if (text.isEmpty()) return false;
+    char *end;
+    value = strtol(text.c_str(), &end, 10);
+    return *end == 0 && value >= min && value <= max;
+}
+
+static bool validName(const String &name){
+    if (name.isEmpty() || name.length() >= REGMAP_NAME_LEN) return false;
+    for (unsigned int i = 0; i < name.length(); i++){
+        char c = name[i];
+        if (!isalnum(c) && c != '_' && c != '-' && c != '.' && c != '/') return false;
+    }
+    return true;
+}
+
+bool RegisterMap::parseTag(String *fields, uint8_t count, RegisterTag &tag, String &error){
+    if (count < 5){
+        error = "expected name,unit,fc,address,type[,order[,scale]]";
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) fields[i].trim();
+    memset(&tag, 0, sizeof(tag));
+    long value;
+    if (!validName(fields[0])){
+        error = "name must be 1-15 characters of A-Z a-z 0-9 _ - . /";
+        return false;
+    }
+    strcpy(tag.name, fields[0].c_str());
+    if (!parseNumber(fields[1], 1, 247, value)){
+        error = "unit must be 1-247";
+        return false;
+    }
+    tag.unit = value;
+    if (!parseNumber(fields[2], 1, 4, value)){
+        error = "fc must be 1-4";
+        return false;
+    }
+    tag.function = value;
+    if (!parseNumber(fields[3], 0, 65535, value)){
+        error = "address must be 0-65535";
+        return false;
+    }
+    tag.address = value;
+    String type = fields[4];
+    type.toLowerCase();
+    tag.type = REG_TYPES;
+    if (type.startsWith("string:")){
+        if (!parseNumber(type.substring(7), 1, REGMAP_MAX_REGISTERS, value)){
+            error = "string length must be 1-125 registers";
+            return false;
+        }
+        tag.type = REG_STRING;
+        tag.length = value;
+    }
+    else{
+        for (uint8_t i = 0; i < REG_STRING; i++){
+            if (type == typeNames[i]) tag.type = i;
+        }
+    }
+    if (tag.type == REG_TYPES){
+        error = "type must be bool, int16, uint16, int32, uint32, float32 or string:N";
+        return false;
+    }
+    if ((tag.function <= 2) != (tag.type == REG_BOOL)){
+        error = "bool needs fc 1 or 2, the other types fc 3 or 4";
+        return false;
+    }
+    if (tag.address + registerCount(tag) > 65536){
+        error = "tag ends after address 65535";
+        return false;
+    }
+    String order = count > 5 ? fields[5] : "";
+    order.toUpperCase();
+    if (order == "" || order == "AB") tag.order = 0;
+    else if (order == "BA") tag.order = REG_SWAP_BYTES;
+    else{
+        tag.order = 4;
+        for (uint8_t i = 0; i < 4; i++){
+            if (order == orderNames[i]) tag.order = i;
+        }
+        if (tag.order == 4){
+            error = "order must be ABCD, BADC, CDAB or DCBA (AB, BA)";
+            return false;
+        }
+    }
+    tag.scale = 1.0f;
+    if (count > 6 && !fields[6].isEmpty()){
+        char *end;
+        tag.scale = strtof(fields[6].c_str(), &end);
+        if (*end != 0 || tag.scale == 0 || !isfinite(tag.scale)){
+            error = "scale must be a number other than 0";
+            return false;
+        }
+    }
+    return true;
+}
+
+// one tag per line (or separated by ';'), '#' starts a comment line and a
+// header line starting with "name," is skipped
+bool RegisterMap::parseCsv(const String &text, std::vector<RegisterTag> &tags, String &error){
+    String fields[TAG_FIELDS + 1];
+    uint16_t line = 1;
+    unsigned int start = 0;
+    while (start <= text.length()){
+        unsigned int end = start;
+        while (end < text.length() && text[end] != '\n' && text[end] != '\r' && text[end] != ';') end++;
+        uint16_t entryLine = line;
+        if (text[end] == '\n') line++;
+        String entry = text.substring(start, end);
+        start = end + 1;
+        entry.trim();
+        if (entry.isEmpty() || entry[0] == '#' || entry.startsWith("name,")) continue;
+        uint8_t count = 0;
+        int from = 0;
+        while (count <= TAG_FIELDS){
+            int comma = entry.indexOf(',', from);
+            fields[count++] = comma < 0 ? entry.substring(from) : entry.substring(from, comma);
+            if (comma < 0) break;
+            from = comma + 1;
+        }
+        RegisterTag tag;
+        if (count > TAG_FIELDS){
+            error = "too many fields";
+        }
+        else if (parseTag(fields, count, tag, error)){
+            tags.push_back(tag);
+            continue;
+        }
+        error = "line " + String(entryLine) + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+static void skipSpace(const String &text, unsigned int &pos){
+    while (pos < text.length() && isspace(text[pos])) pos++;
+}
+
+// string without escapes beyond \" and \\ (names and types never need them)
+static bool jsonString(const String &text, unsigned int &pos, String &value){
+    if (text[pos] != '"') return false;
+    value = "";
+    for (pos++; pos < text.length(); pos++){
+        char c = text[pos];
+        if (c == '"'){
+            pos++;
+            return true;
+        }
+        if (c == '\\') c = text[++pos];
+        value += c;
+    }
+    return false;
+}
+
+// Flat parser for [{"name":"t1","unit":1,"fc":3,"address":0,"type":"int16"},...],
+// values map onto the CSV fields, nested objects and arrays are refused
+bool RegisterMap::parseJson(const String &text, std::vector<RegisterTag> &tags, String &error){
+    unsigned int pos = 0;
+    uint16_t entry = 0;
+    skipSpace(text, pos);
+    if (text[pos++] != '['){
+        error = "expected a JSON array";
+        return false;
+    }
+    skipSpace(text, pos);
+    if (text[pos] == ']') return true;
+    while (pos < text.length()){
+        entry++;
+        String fields[TAG_FIELDS];
+        skipSpace(text, pos);
+        if (text[pos++] != '{'){
+            error = "entry " + String(entry) + ": expected an object";
+            return false;
+        }
+        skipSpace(text, pos);
+        while (text[pos] != '}'){
+            String key, value;
+            if (!jsonString(text, pos, key)) break;
+            skipSpace(text, pos);
+            if (text[pos++] != ':') break;
+            skipSpace(text, pos);
+            if (text[pos] == '"'){
+                if (!jsonString(text, pos, value)) break;
+            }
+            else{
+                unsigned int end = pos;
+                while (end < text.length() && text[end] != ',' && text[end] != '}' && !isspace(text[end])) end++;
+                value = text.substring(pos, end);
+                pos = end;
+                if (value.isEmpty() || value[0] == '{' || value[0] == '[') break;
+            }
+            for (uint8_t i = 0; i < TAG_FIELDS; i++){
+                if (key == fieldNames[i]) fields[i] = value;
+            }
+            if (key == "function") fields[2] = value;
+            skipSpace(text, pos);
+            if (text[pos] == ','){
+                pos++;
+                skipSpace(text, pos);
+            }
+            else if (text[pos] != '}') break;
+        }
+        if (text[pos++] != '}'){
+            error = "entry " + String(entry) + ": malformed object";
+            return false;
+        }
+        RegisterTag tag;
+        if (!parseTag(fields, TAG_FIELDS, tag, error)){
+            error = "entry " + String(entry) + ": " + error;
+            return false;
+        }
+        tags.push_back(tag);
+        skipSpace(text, pos);
+        if (text[pos] == ']') return true;
+        if (text[pos++] != ','){
+            error = "entry " + String(entry) + ": expected ',' or ']'";
+            return false;
+        }
+    }
+    error = "unterminated JSON array";
+    return false;
+}
+
+void RegisterMap::begin(Config *config){
+    _config = config;
+    _count = _config->getRegisterMap(_tags, sizeof(_tags)) / sizeof(RegisterTag);
+    // drop a map saved in another layout
+    for (uint8_t i = 0; i < _count; i++){
+        auto &tag = _tags[i];
+        tag.name[REGMAP_NAME_LEN - 1] = 0;
+        if (tag.type >= REG_TYPES || tag.function < 1 || tag.function > 4 || tag.order > 3){
+            _count = 0;
+            break;
+        }
+    }
+    dbg("[map] tags: ");
+    dbgln(_count);
+}
+
+bool RegisterMap::load(const String &text, String &error){
+    std::vector<RegisterTag> tags;
+    String trimmed = text;
+    trimmed.trim();
+    if (!(trimmed.startsWith("[") ? parseJson(trimmed, tags, error) : parseCsv(trimmed, tags, error))) return false;
+    if (tags.size() > REGMAP_MAX_TAGS){
+        error = "more than " + String(REGMAP_MAX_TAGS) + " tags";
+        return false;
+    }
+    for (size_t i = 0; i < tags.size(); i++){
+        for (size_t j = 0; j < i; j++){
+            if (strcmp(tags[i].name, tags[j].name) == 0){
+                error = "duplicate name " + String(tags[i].name);
+                return false;
+            }
+        }
+    }
+    _count = tags.size();
+    if (_count > 0) memcpy(_tags, tags.data(), _count * sizeof(RegisterTag));
+    _config->setRegisterMap(_tags, _count * sizeof(RegisterTag));
+    return true;
+}
+
+uint8_t RegisterMap::getCount(){
+    return _count;
+}
+
+int16_t RegisterMap::find(const String &name){
+    for (uint8_t i = 0; i < _count; i++){
+        if (name == _tags[i].name) return i;
+    }
+    return -1;
+}
+
+const char *RegisterMap::typeName(uint8_t type){
+    return type < REG_TYPES ? typeNames[type] : "?";
+}
+
+const char *RegisterMap::orderName(uint8_t order){
+    return orderNames[order & 3];
+}
+
+void RegisterMap::printCsv(Print &out){
+    out.print("name,unit,fc,address,type,order,scale\n");
+    for (uint8_t i = 0; i < _count; i++){
+        auto &tag = _tags[i];
+        out.printf("%s,%u,%u,%u,", tag.name, tag.unit, tag.function, tag.address);
+        if (tag.type == REG_STRING) out.printf("string:%u", tag.length);
+        else out.print(typeName(tag.type));
+        out.printf(",%s,%g\n", orderName(tag.order), tag.scale);
+    }
+}
+
+void RegisterMap::printJson(Print &out){
+    out.print("[");
+    for (uint8_t i = 0; i < _count; i++){
+        auto &tag = _tags[i];
+        out.printf("%s{\"name\":\"%s\",\"unit\":%u,\"fc\":%u,\"address\":%u,\"type\":\"",
+            i ? "," : "", tag.name, tag.unit, tag.function, tag.address);
+        if (tag.type == REG_STRING) out.printf("string:%u", tag.length);
+        else out.print(typeName(tag.type));
+        out.printf("\",\"order\":\"%s\",\"scale\":%g}", orderName(tag.order), tag.scale);
+    }
+    out.print("]");
+}
+
+uint8_t RegisterMap::plan(uint8_t *selection, uint8_t count, uint16_t maxGap, RegisterRead *reads){
+    std::sort(selection, selection + count, [this](uint8_t a, uint8_t b){
+        auto &x = _tags[a];
+        auto &y = _tags[b];
+        if (x.unit != y.unit) return x.unit < y.unit;
+        if (x.function != y.function) return x.function < y.function;
+        return x.address < y.address;
+    });
+    uint8_t readCount = 0;
+    for (uint8_t i = 0; i < count; i++){
+        auto &tag = _tags[selection[i]];
+        uint32_t end = tag.address + registerCount(tag);
+        if (readCount > 0){
+            auto &read = reads[readCount - 1];
+            uint32_t readEnd = read.address + read.count;
+            uint16_t span = read.function <= 2 ? REGMAP_MAX_BITS : REGMAP_MAX_REGISTERS;
+            // sorted, so the tag never starts before the read
+            if (read.unit == tag.unit && read.function == tag.function
+                && (tag.address <= readEnd || tag.address - readEnd <= maxGap)
+                && max(end, readEnd) - read.address <= span){
+                read.count = max(end, readEnd) - read.address;
+                read.last = i;
+                continue;
+            }
+        }
+        reads[readCount++] = {tag.unit, tag.function, tag.address, (uint16_t)(end - tag.address), i, i};
+    }
+    return readCount;
+}
+
+void RegisterMap::printValue(Print &out, const RegisterTag &tag, const uint8_t *data, uint16_t offset){
+    if (tag.type == REG_STRING){
+        char text[REGMAP_MAX_REGISTERS * 2 + 1];
+        decodeString(tag, data, offset, text, sizeof(text));
+        out.print("\"");
+        for (char *c = text; *c; c++){
+            if (*c == '"' || *c == '\\') out.printf("\\%c", *c);
+            else if ((uint8_t)*c < 0x20) out.printf("\\u%04x", (uint8_t)*c);
+            else out.print(*c);
+        }
+        out.print("\"");
+        return;
+    }
+    double value = decodeRegister(tag, data, offset);
+    if (tag.type == REG_BOOL) out.print(value ? "true" : "false");
+    else if (!isfinite(value)) out.print("null");
+    // integers print exactly, floats and scaled values with float precision
+    else if (tag.type != REG_FLOAT32 && tag.scale == 1.0f) out.printf("%.0f", value);
+    else out.printf("%.7g", value);
+}
+
+static void printError(Print &out, Modbus::Error error){
+    switch (error){
+        case Modbus::Error::TIMEOUT: out.print("\"timeout\""); return;
+        case Modbus::Error::CRC_ERROR: out.print("\"crc error\""); return;
+        default: break;
+    }
+    if (error >= Modbus::Error::ILLEGAL_FUNCTION && error <= Modbus::Error::GATEWAY_TARGET_NO_RESP) out.printf("\"exception %u\"", (uint8_t)error);
+    else out.printf("\"error 0x%02x\"", (uint8_t)error);
+}
+
+void RegisterMap::read(RtuClient *rtu, const String &names, uint16_t maxGap, Print &out){
+    uint32_t start = millis();
+    uint8_t selection[REGMAP_MAX_TAGS];
+    uint8_t count = 0;
+    bool unknown = false;
+    String list = names;
+    list.trim();
+    if (list.isEmpty()){
+        for (; count < _count; count++) selection[count] = count;
+    }
+    else{
+        int from = 0;
+        while (from >= 0){
+            int comma = list.indexOf(',', from);
+            String name = comma < 0 ? list.substring(from) : list.substring(from, comma);
+            from = comma < 0 ? -1 : comma + 1;
+            name.trim();
+            if (name.isEmpty()) continue;
+            int16_t index = find(name);
+            if (index < 0){
+                unknown = true;
+                continue;
+            }
+            if (std::find(selection, selection + count, index) == selection + count) selection[count++] = index;
+        }
+    }
+    RegisterRead reads[REGMAP_MAX_TAGS];
+    Modbus::Error results[REGMAP_MAX_TAGS];
+    uint8_t readCount = plan(selection, count, maxGap, reads);
+    uint8_t answer[RTU_MAX_FRAME];
+    uint8_t sent = 0;
+    int16_t silent = -1;
+    bool first = true;
+    out.print("{\"values\":{");
+    for (uint8_t r = 0; r < readCount; r++){
+        auto &read = reads[r];
+        uint16_t answerLen;
+        uint32_t elapsed = millis() - start;
+        // reads are sorted by unit, a unit that timed out is skipped whole
+        if (sent >= REGMAP_MAX_READS || elapsed >= REGMAP_READ_BUDGET || read.unit == silent){
+            results[r] = Modbus::Error::TIMEOUT;
+            continue;
+        }
+        sent++;
+        // a read may not wait for the bus or the answer past the budget
+        results[r] = rtu->read(read.unit, read.function, read.address, read.count, answer, sizeof(answer), answerLen, NULL, REGMAP_READ_BUDGET - elapsed);
+        uint16_t bytes = read.function <= 2 ? (read.count + 7) / 8 : read.count * 2;
+        if (results[r] == Modbus::Error::SUCCESS && (answerLen < 3 + bytes || answer[2] < bytes)) results[r] = Modbus::Error::PACKET_LENGTH_ERROR;
+        if (results[r] == Modbus::Error::TIMEOUT) silent = read.unit;
+        if (results[r] != Modbus::Error::SUCCESS) continue;
+        for (uint8_t i = read.first; i <= read.last; i++){
+            auto &tag = _tags[selection[i]];
+            out.printf("%s\"%s\":", first ? "" : ",", tag.name);
+            printValue(out, tag, answer + 3, tag.address - read.address);
+            first = false;
+        }
+    }
+    out.print("},\"errors\":{");
+    first = true;
+    for (uint8_t r = 0; r < readCount; r++){
+        if (results[r] == Modbus::Error::SUCCESS) continue;
+        for (uint8_t i = reads[r].first; i <= reads[r].last; i++){
+            out.printf("%s\"%s\":", first ? "" : ",", _tags[selection[i]].name);
+            printError(out, results[r]);
+            first = false;
+        }
+    }
+    if (unknown){
+        int from = 0;
+        while (from >= 0){
+            int comma = list.indexOf(',', from);
+            String name = comma < 0 ? list.substring(from) : list.substring(from, comma);
+            from = comma < 0 ? -1 : comma + 1;
+            name.trim();
+            // unknown names are echoed only when they are valid names
+            if (name.isEmpty() || find(name) >= 0 || !validName(name)) continue;
+            out.printf("%s\"%s\":\"unknown tag\"", first ? "" : ",", name.c_str());
+            first = false;
+        }
+    }
+    out.printf("},\"reads\":%u,\"ms\":%u}", sent, (unsigned int)(millis() - start));
+}
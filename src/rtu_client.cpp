@@ -0,0 +1,275 @@
+#include "rtu_client.h"
+#include "modbus_crc.h"
+
+RtuClient::RtuClient(int8_t rtsPin)
+    :_serial(NULL)
+    ,_rtsPin(rtsPin)
+    ,_timeout(2000)
+    ,_interval(1750)
+    ,_lastActivity(0)
+    ,_lock(NULL)
+    ,_hardwareFraming(false)
+    ,_rxIdle(false)
+    ,_rxEvent(NULL)
+    ,_simulator(NULL)
+    ,_waiting(0)
+    ,_messageCount(0)
+    ,_errorCount(0)
+    ,_received(0)
+    ,_statsLock(portMUX_INITIALIZER_UNLOCKED)
+    ,_unitCount(0)
+    ,_units()
+{}
+
+// the serial port has to be started by the caller (pins, parity, rs485 mode)
+void RtuClient::begin(HardwareSerial &serial, unsigned long baudRate, bool hardwareFraming){
+    _serial = &serial;
+    // 3.5 characters of 11 bits, fixed 1750us above 19200 baud (Modbus over serial line, 2.5.1.1)
+    _interval = baudRate > 19200 ? 1750 : 38500000UL / baudRate;
+    _lock = xSemaphoreCreateMutex();
+    _hardwareFraming = hardwareFraming;
+    if (_hardwareFraming){
+        // a semaphore, not a task notification: the bridge engine calling
+        // transact() already uses its notifications for queued requests
+        _rxEvent = xSemaphoreCreateBinary();
+        _serial->onReceive([this](){ onRxIdle(); }, true);
+    }
+    if (_rtsPin >= 0){
+        pinMode(_rtsPin, OUTPUT);
+        digitalWrite(_rtsPin, LOW);
+    }
+}
+
+// uart event task: the line has been silent for the rx timeout, everything
+// received is in the rx buffer
+void RtuClient::onRxIdle(){
+    _rxIdle = true;
+    xSemaphoreGive(_rxEvent);
+}
+
+void RtuClient::setTimeout(uint32_t timeout){
+    _timeout = timeout;
+}
+
+void RtuClient::setSimulator(VirtualSlaves *simulator){
+    _simulator = simulator;
+}
+
+VirtualSlaves *RtuClient::getSimulator(){
+    return _simulator;
+}
+
+Modbus::Error RtuClient::transact(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, Print *trace, uint32_t timeout){
+    responseLen = 0;
+    if (len < 2 || len > RTU_MAX_FRAME - 2) return Modbus::Error::PACKET_LENGTH_ERROR;
+    uint8_t unit = pdu[0];
+    bool bounded = timeout > 0;
+    if (!bounded || timeout > _timeout) timeout = _timeout;
+    if (_simulator && _simulator->handles(unit)){
+        if (trace) dump(trace, "TX (sim)", pdu, len);
+        auto start = micros();
+        auto error = _simulator->transact(pdu, len, size, responseLen, timeout);
+        account(unit, error, micros() - start);
+        if (trace) dump(trace, "RX (sim)", pdu, responseLen);
+        return error;
+    }
+    _waiting++;
+    uint32_t waitStart = millis();
+    if (xSemaphoreTake(_lock, bounded ? pdMS_TO_TICKS(timeout) : portMAX_DELAY) != pdTRUE){
+        // the bus stayed busy for the whole timeout, nothing was sent
+        _waiting--;
+        return Modbus::Error::TIMEOUT;
+    }
+    _waiting--;
+    if (bounded){
+        uint32_t waited = millis() - waitStart;
+        if (waited >= timeout){
+            xSemaphoreGive(_lock);
+            return Modbus::Error::TIMEOUT;
+        }
+        timeout -= waited;
+    }
+    auto start = micros();
+    auto error = exchange(pdu, len, size, responseLen, timeout, trace);
+    _messageCount++;
+    if (error != Modbus::Error::SUCCESS) _errorCount++;
+    auto latency = micros() - start;
+    busHistory.record(len + 2 + _received, latency, error == Modbus::Error::TIMEOUT, error == Modbus::Error::CRC_ERROR);
+    account(unit, error, latency);
+    xSemaphoreGive(_lock);
+    return error;
+}
+
+Modbus::Error RtuClient::read(uint8_t unit, uint8_t function, uint16_t address, uint16_t count, uint8_t *response, uint16_t size, uint16_t &responseLen, Print *trace, uint32_t timeout){
+    if (size < 6) return Modbus::Error::PARAMETER_LIMIT_ERROR;
+    response[0] = unit;
+    response[1] = function;
+    response[2] = address >> 8;
+    response[3] = address & 0xff;
+    response[4] = count >> 8;
+    response[5] = count & 0xff;
+    return transact(response, 6, size, responseLen, trace, timeout);
+}
+
+void RtuClient::account(uint8_t unit, Modbus::Error error, uint32_t latency){
+    // broadcasts are not answered, nothing to measure
+    if (unit == 0) return;
+    uint32_t now = millis();
+    portENTER_CRITICAL(&_statsLock);
+    RtuUnitStats *stats = nullptr;
+    for (uint8_t i = 0; i < _unitCount && !stats; i++){
+        if (_units[i].unit == unit) stats = &_units[i];
+    }
+    if (!stats){
+        if (_unitCount < RTU_MAX_UNIT_STATS) stats = &_units[_unitCount++];
+        else{
+            stats = &_units[0];
+            for (uint8_t i = 1; i < _unitCount; i++){
+                if (now - _units[i].lastSeen > now - stats->lastSeen) stats = &_units[i];
+            }
+        }
+        memset(stats, 0, sizeof(*stats));
+        stats->unit = unit;
+        stats->latency = latency;
+    }
+    stats->requests++;
+    if (error != Modbus::Error::SUCCESS) stats->errors++;
+    if (error == Modbus::Error::TIMEOUT){
+        stats->timeouts++;
+        if (stats->timeoutsInRow < UINT8_MAX) stats->timeoutsInRow++;
+    }
+    else stats->timeoutsInRow = 0;
+    stats->latency = stats->latency + ((int32_t)(latency - stats->latency)) / 8;
+    stats->lastSeen = now;
+    portEXIT_CRITICAL(&_statsLock);
+}
+
+// called with the bus lock held
+Modbus::Error RtuClient::exchange(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, uint32_t timeout, Print *trace){
+    _received = 0;
+    // keep the bus silent for 3.5 characters after the previous frame
+    while (micros() - _lastActivity < _interval) delayMicroseconds(100);
+    // drop leftovers of a late answer to an earlier request
+    while (_serial->available()) _serial->read();
+    if (_hardwareFraming){
+        _rxIdle = false;
+        xSemaphoreTake(_rxEvent, 0);
+    }
+    memcpy(_frame, pdu, len);
+    auto crc = crc16(_frame, len);
+    _frame[len] = crc & 0xff;
+    _frame[len + 1] = crc >> 8;
+    if (trace) dump(trace, "TX", _frame, len + 2);
+    if (_rtsPin >= 0) digitalWrite(_rtsPin, HIGH);
+    _serial->write(_frame, len + 2);
+    _serial->flush();
+    if (_rtsPin >= 0) digitalWrite(_rtsPin, LOW);
+    _lastActivity = micros();
+    // broadcasts are not answered
+    if (pdu[0] == 0) return Modbus::Error::SUCCESS;
+
+    auto rxLen = receive(timeout);
+    _received = rxLen;
+    if (trace) dump(trace, "RX", _frame, rxLen);
+    if (rxLen == 0) return Modbus::Error::TIMEOUT;
+    // cheap header checks first, the crc only runs over plausible frames
+    if (rxLen < 5) return Modbus::Error::PACKET_LENGTH_ERROR;
+    if (_frame[0] != pdu[0]) return Modbus::Error::SERVER_ID_MISMATCH;
+    if ((_frame[1] & 0x7f) != pdu[1]) return Modbus::Error::FC_MISMATCH;
+    auto expected = frameLength(_frame, rxLen);
+    if ((expected && rxLen != expected) || rxLen - 2 > size) return Modbus::Error::PACKET_LENGTH_ERROR;
+    crc = _frame[rxLen - 2] | (_frame[rxLen - 1] << 8);
+    if (crc != crc16(_frame, rxLen - 2)) return Modbus::Error::CRC_ERROR;
+    responseLen = rxLen - 2;
+    memcpy(pdu, _frame, responseLen);
+    // exception response: the exception code is the error
+    if (_frame[1] & 0x80) return (Modbus::Error)_frame[2];
+    return Modbus::Error::SUCCESS;
+}
+
+// read one frame: wait up to the timeout for the first byte, the frame ends
+// when it has the length its header announces or, for function codes without
+// a known length, when the line is silent for 3.5 characters (with hardware
+// framing when the UART reports its rx timeout). Returns 0 on timeout.
+uint16_t RtuClient::receive(uint32_t timeout){
+    uint16_t len = 0;
+    auto start = millis();
+    for (;;){
+        int available = _serial->available();
+        if (available > 0){
+            len += _serial->read(_frame + len, min((size_t)available, (size_t)(RTU_MAX_FRAME - len)));
+            _lastActivity = micros();
+            // too long for modbus, the tail is dropped with the next request
+            if (len >= RTU_MAX_FRAME) return len;
+            auto expected = frameLength(_frame, len);
+            if (expected && len >= expected) return len;
+            continue;
+        }
+        if (_hardwareFraming){
+            // the callback runs after the bytes reached the rx buffer, so
+            // nothing is left once it has been seen with an empty buffer
+            if (len > 0 && _rxIdle) return len;
+            uint32_t elapsed = millis() - start;
+            if (elapsed >= timeout) return len;
+            xSemaphoreTake(_rxEvent, pdMS_TO_TICKS(timeout - elapsed));
+            continue;
+        }
+        if (len > 0 && micros() - _lastActivity >= _interval) return len;
+        if (len == 0 && millis() - start >= timeout) return 0;
+        delay(1);
+    }
+}
+
+// length of a response frame including the crc as announced by its first
+// bytes, 0 while not known (too short yet or a function code without fixed layout)
+uint16_t RtuClient::frameLength(const uint8_t *frame, uint16_t len){
+    if (len < 2) return 0;
+    if (frame[1] & 0x80) return 5;
+    switch (frame[1]){
+        case Modbus::FunctionCode::READ_COIL:
+        case Modbus::FunctionCode::READ_DISCR_INPUT:
+        case Modbus::FunctionCode::READ_HOLD_REGISTER:
+        case Modbus::FunctionCode::READ_INPUT_REGISTER:
+            return len < 3 ? 0 : 5 + frame[2];
+        case Modbus::FunctionCode::WRITE_COIL:
+        case Modbus::FunctionCode::WRITE_HOLD_REGISTER:
+        case Modbus::FunctionCode::WRITE_MULT_COILS:
+        case Modbus::FunctionCode::WRITE_MULT_REGISTERS:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+uint16_t RtuClient::crc16(const uint8_t *data, uint16_t len){
+    return modbusCrc16(data, len);
+}
+
+void RtuClient::dump(Print *trace, const char *prefix, const uint8_t *data, uint16_t len){
+    trace->print(prefix);
+    trace->print(':');
+    for (uint16_t i = 0; i < len; i++){
+        trace->printf(" %02x", data[i]);
+    }
+    trace->println();
+}
+
+uint32_t RtuClient::getMessageCount(){
+    return _messageCount;
+}
+
+uint32_t RtuClient::getErrorCount(){
+    return _errorCount;
+}
+
+uint32_t RtuClient::pendingRequests(){
+    return _waiting;
+}
+
+uint8_t RtuClient::getUnitStats(RtuUnitStats *stats){
+    portENTER_CRITICAL(&_statsLock);
+    uint8_t count = _unitCount;
+    memcpy(stats, _units, count * sizeof(RtuUnitStats));
+    portEXIT_CRITICAL(&_statsLock);
+    return count;
+}
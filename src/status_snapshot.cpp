@@ -0,0 +1,280 @@
+#include "status_snapshot.h"
+#ifdef USE_ENC28J60
+  #include <EthernetENC.h>
+  #include "enc_network.h"
+#else
+  #include <WiFi.h>
+  #include "wifi_supervisor.h"
+#endif
+
+StatusSnapshots statusSnapshots;
+
+StatusSnapshots::StatusSnapshots()
+    :_task(NULL)
+    ,_lock(xSemaphoreCreateMutex())
+    ,_viewLock(xSemaphoreCreateMutex())
+    ,_snapshots()
+    ,_view()
+    ,_current(0)
+    ,_rtu(nullptr)
+    ,_bridge(nullptr)
+    ,_mqtt(nullptr)
+    ,_config(nullptr)
+    ,_network(nullptr)
+    ,_wifi(nullptr)
+{}
+
+void StatusSnapshots::begin(RtuClient *rtu, TcpBridge *bridge, MqttPublisher *mqtt, Config *config, EncNetwork *network, WifiSupervisor *wifi){
+    if (_task) return;
+    _rtu = rtu;
+    _bridge = bridge;
+    _mqtt = mqtt;
+    _config = config;
+    _network = network;
+    _wifi = wifi;
+    refresh();
+    xTaskCreate(task, "status", 3072, this, 1, &_task);
+}
+
+void StatusSnapshots::task(void *arg){
+    auto snapshots = static_cast<StatusSnapshots*>(arg);
+    for (;;){
+        vTaskDelay(pdMS_TO_TICKS(STATUS_INTERVAL));
+        snapshots->refresh();
+    }
+}
+
+// only the status task (and begin) refresh: the spare copy is never read
+void StatusSnapshots::refresh(){
+    uint8_t next = _current ^ 1;
+    collect(_snapshots[next]);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _current = next;
+    xSemaphoreGive(_lock);
+}
+
+void StatusSnapshots::collect(StatusSnapshot &s){
+    s.time = millis();
+#ifdef USE_ENC28J60
+    s.ssid[0] = 0;
+    s.rssi = 0;
+    uint8_t mac[6];
+    xSemaphoreTake(uipLock, portMAX_DELAY);
+    Ethernet.macAddress(mac);
+    s.ip = Ethernet.localIP();
+    s.gateway = Ethernet.gatewayIP();
+    s.subnet = Ethernet.subnetMask();
+    xSemaphoreGive(uipLock);
+    snprintf(s.mac, sizeof(s.mac), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    s.encIrqWakeups = _network ? _network->getIrqWakeups() : 0;
+    s.encTimerWakeups = _network ? _network->getTimerWakeups() : 0;
+#else
+    snprintf(s.ssid, sizeof(s.ssid), "%s", WiFi.SSID().c_str());
+    s.rssi = WiFi.RSSI();
+    snprintf(s.mac, sizeof(s.mac), "%s", WiFi.macAddress().c_str());
+    s.ip = WiFi.localIP();
+    s.gateway = WiFi.gatewayIP();
+    s.subnet = WiFi.subnetMask();
+    if (_wifi){
+        s.wifiPowerSave = _wifi->getPowerSave();
+        s.wifiTxPower = _wifi->getTxPower();
+        s.wifiFastReconnect = _wifi->isFastReconnect();
+        s.wifiReconnects = _wifi->getReconnects();
+        s.wifiScanReconnects = _wifi->getScanReconnects();
+        s.wifiLastReconnect = _wifi->getLastReconnect();
+        s.wifiMaxReconnect = _wifi->getMaxReconnect();
+        s.wifiDowntime = _wifi->getDowntime();
+    }
+#endif
+    s.rtuMessages = _rtu->getMessageCount();
+    s.rtuPending = _rtu->pendingRequests();
+    s.rtuErrors = _rtu->getErrorCount();
+    auto simulator = _rtu->getSimulator();
+    s.simUnits = simulator ? simulator->getUnitCount() : 0;
+    s.simRequests = simulator ? simulator->getRequests() : 0;
+    s.simInjected = simulator ? simulator->getInjectedErrors() : 0;
+    s.unitCount = _rtu->getUnitStats(s.units);
+    s.bridgeMessages = _bridge->getMessageCount();
+    s.bridgeErrors = _bridge->getErrorCount();
+    s.clients = _bridge->activeClients();
+    s.clientsAccepted = _bridge->getAcceptedClients();
+    s.clientsEvicted = _bridge->getEvictedClients();
+    s.clientsRefused = _bridge->getRefusedClients();
+    s.inFlight = _bridge->pendingTransactions();
+    for (uint8_t i = 0; i < REJECT_REASONS; i++) s.rejected[i] = _bridge->getRejected(i);
+    s.coalescedWrites = _bridge->getCoalescedWrites();
+    s.coalescedFrames = _bridge->getCoalescedFrames();
+    s.sharedReads = _bridge->getSharedReads();
+    s.poolInUse = _bridge->getPoolInUse();
+    s.poolHighWater = _bridge->getPoolHighWater();
+    s.poolFallbacks = _bridge->getPoolFallbacks();
+    s.maxClients = min(_bridge->getMaxClients(), (uint8_t)TCP_BRIDGE_MAX_CLIENTS);
+    for (uint8_t i = 0; i < s.maxClients; i++) s.clientValid[i] = _bridge->getClientStats(i, s.client[i]);
+    s.traceEnabled = traceRecorder.enabled();
+    s.traceRecords = traceRecorder.getRecords();
+    s.traceUsed = traceRecorder.getUsed();
+    s.traceDropped = traceRecorder.getDropped();
+    s.mqttEnabled = _config->getMqttEnabled();
+    s.mqttConnected = s.mqttEnabled && _mqtt->connected();
+    s.mqttTags = _mqtt->getTagCount();
+    s.mqttPublishes = _mqtt->getPublishCount();
+    s.mqttReadErrors = _mqtt->getReadErrors();
+    s.heapFree = telemetry.getFreeHeap();
+    s.heapMinFree = telemetry.getMinFreeHeap();
+    s.heapLargestBlock = telemetry.getLargestBlock();
+    s.heapMinLargestBlock = telemetry.getMinLargestBlock();
+    s.heapFragmentation = telemetry.getFragmentation();
+    s.allocFailures = telemetry.getAllocFailures();
+    s.taskCount = telemetry.getTaskCount();
+    for (uint8_t i = 0; i < s.taskCount; i++) s.tasks[i] = telemetry.getTask(i);
+    s.bootResetReason = bootProfile.getResetReason();
+    s.bootFastPath = bootProfile.getFastPath();
+    s.bootPhaseCount = bootProfile.getCount();
+    for (uint8_t i = 0; i < s.bootPhaseCount; i++){
+        s.bootPhaseNames[i] = bootProfile.getName(i);
+        s.bootPhaseMs[i] = bootProfile.getDuration(i);
+    }
+    s.bootMs = bootProfile.getTotal();
+}
+
+const StatusSnapshot &StatusSnapshots::lock(){
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    return _snapshots[_current];
+}
+
+void StatusSnapshots::unlock(){
+    xSemaphoreGive(_lock);
+}
+
+// the view lock only keeps two views from sharing the copy
+const StatusSnapshot &StatusSnapshots::beginView(){
+    xSemaphoreTake(_viewLock, portMAX_DELAY);
+    _view = lock();
+    unlock();
+    return _view;
+}
+
+void StatusSnapshots::endView(){
+    xSemaphoreGive(_viewLock);
+}
+
+static void printJsonString(Print &out, const char *text){
+    out.print('"');
+    for (; *text; text++){
+        if (*text == '"' || *text == '\\') out.print('\\');
+        if ((uint8_t)*text < 0x20) out.printf("\\u%04x", *text);
+        else out.print(*text);
+    }
+    out.print('"');
+}
+
+void StatusSnapshots::printJson(Print &out){
+    auto &s = beginView();
+    out.printf("{\"uptime\":%lu,\"age\":%lu,", (unsigned long)(esp_timer_get_time() / 1000000), (unsigned long)(millis() - s.time));
+    out.print("\"network\":{\"ssid\":");
+    printJsonString(out, s.ssid);
+    out.printf(",\"rssi\":%d,\"mac\":\"%s\",\"ip\":\"%s\",", s.rssi, s.mac, IPAddress(s.ip).toString().c_str());
+    out.printf("\"gateway\":\"%s\",\"subnet\":\"%s\"},", IPAddress(s.gateway).toString().c_str(), IPAddress(s.subnet).toString().c_str());
+#ifdef USE_ENC28J60
+    out.printf("\"enc\":{\"irqWakeups\":%u,\"timerWakeups\":%u},", s.encIrqWakeups, s.encTimerWakeups);
+#else
+    out.printf("\"wifi\":{\"powerSave\":%s,\"txPower\":%.2f,\"fastReconnect\":%s,", s.wifiPowerSave ? "true" : "false", s.wifiTxPower, s.wifiFastReconnect ? "true" : "false");
+    out.printf("\"reconnects\":%u,\"scanReconnects\":%u,\"lastReconnect\":%u,\"maxReconnect\":%u,\"downtime\":%u},",
+        s.wifiReconnects, s.wifiScanReconnects, s.wifiLastReconnect, s.wifiMaxReconnect, s.wifiDowntime);
+#endif
+    out.printf("\"rtu\":{\"messages\":%u,\"pending\":%u,\"errors\":%u,", s.rtuMessages, s.rtuPending, s.rtuErrors);
+    out.printf("\"simUnits\":%u,\"simRequests\":%u,\"simInjected\":%u,\"units\":[", s.simUnits, s.simRequests, s.simInjected);
+    for (uint8_t i = 0; i < s.unitCount; i++){
+        auto &u = s.units[i];
+        out.printf("%s{\"unit\":%u,\"requests\":%u,\"errors\":%u,\"timeouts\":%u,\"latencyUs\":%u,\"offline\":%s}",
+            i ? "," : "", u.unit, u.requests, u.errors, u.timeouts, u.latency, u.timeoutsInRow >= RTU_OFFLINE_TIMEOUTS ? "true" : "false");
+    }
+    out.print("]},");
+    out.printf("\"bridge\":{\"messages\":%u,\"errors\":%u,\"clients\":%u,\"accepted\":%u,\"evicted\":%u,\"refused\":%u,\"inFlight\":%u,",
+        s.bridgeMessages, s.bridgeErrors, s.clients, s.clientsAccepted, s.clientsEvicted, s.clientsRefused, s.inFlight);
+    out.print("\"rejected\":{");
+    for (uint8_t i = 0; i < REJECT_REASONS; i++){
+        out.printf("%s\"%s\":%u", i ? "," : "", TcpBridge::rejectName(i), s.rejected[i]);
+    }
+    out.printf("},\"combinedWrites\":%u,\"combinedFrames\":%u,\"sharedReads\":%u,", s.coalescedWrites, s.coalescedFrames, s.sharedReads);
+    out.printf("\"buffersInUse\":%u,\"buffersHighWater\":%u,\"bufferFallbacks\":%u,\"connections\":[", s.poolInUse, s.poolHighWater, s.poolFallbacks);
+    bool first = true;
+    for (uint8_t i = 0; i < s.maxClients; i++){
+        if (!s.clientValid[i]) continue;
+        auto &c = s.client[i];
+        out.printf("%s{\"slot\":%u,\"ip\":\"%s\",\"connected\":%u,\"idle\":%u,\"weight\":%u,\"inFlight\":%u,\"queued\":%u,\"requests\":%u,\"dropped\":%u,\"busTime\":%u}",
+            first ? "" : ",", i, IPAddress(c.ip).toString().c_str(), c.connected, c.idle, c.weight, c.inFlight, c.queued, c.requests, c.dropped, c.busTime);
+        first = false;
+    }
+    out.print("]},");
+    out.printf("\"trace\":{\"enabled\":%s,\"records\":%u,\"used\":%u,\"dropped\":%u},", s.traceEnabled ? "true" : "false", s.traceRecords, s.traceUsed, s.traceDropped);
+    out.printf("\"mqtt\":{\"enabled\":%s,\"connected\":%s,\"tags\":%u,\"publishes\":%u,\"readErrors\":%u},",
+        s.mqttEnabled ? "true" : "false", s.mqttConnected ? "true" : "false", s.mqttTags, s.mqttPublishes, s.mqttReadErrors);
+    out.printf("\"heap\":{\"free\":%u,\"minFree\":%u,\"largestBlock\":%u,\"minLargestBlock\":%u,\"fragmentation\":%u,\"allocFailures\":%u},",
+        s.heapFree, s.heapMinFree, s.heapLargestBlock, s.heapMinLargestBlock, s.heapFragmentation, s.allocFailures);
+    out.print("\"stackFree\":{");
+    first = true;
+    for (uint8_t i = 0; i < s.taskCount; i++){
+        if (!s.tasks[i].alive) continue;
+        out.printf("%s\"%s\":%u", first ? "" : ",", s.tasks[i].name, s.tasks[i].minFree);
+        first = false;
+    }
+    out.print("}}");
+    endView();
+}
+
+void StatusSnapshots::printMetrics(Print &out){
+    auto &s = beginView();
+    out.printf("gateway_uptime_seconds %lu\n", (unsigned long)(esp_timer_get_time() / 1000000));
+    out.printf("gateway_rtu_messages_total %u\n", s.rtuMessages);
+    out.printf("gateway_rtu_errors_total %u\n", s.rtuErrors);
+    for (uint8_t i = 0; i < s.unitCount; i++){
+        auto &u = s.units[i];
+        out.printf("gateway_rtu_unit_requests_total{unit=\"%u\"} %u\n", u.unit, u.requests);
+        out.printf("gateway_rtu_unit_errors_total{unit=\"%u\"} %u\n", u.unit, u.errors);
+        out.printf("gateway_rtu_unit_latency_us{unit=\"%u\"} %u\n", u.unit, u.latency);
+        out.printf("gateway_rtu_unit_offline{unit=\"%u\"} %u\n", u.unit, u.timeoutsInRow >= RTU_OFFLINE_TIMEOUTS ? 1 : 0);
+    }
+    out.printf("gateway_bridge_messages_total %u\n", s.bridgeMessages);
+    out.printf("gateway_bridge_errors_total %u\n", s.bridgeErrors);
+    for (uint8_t i = 0; i < REJECT_REASONS; i++){
+        out.printf("gateway_bridge_rejected_total{reason=\"%s\"} %u\n", TcpBridge::rejectName(i), s.rejected[i]);
+    }
+    out.printf("gateway_bridge_clients %u\n", s.clients);
+    out.printf("gateway_bridge_clients_accepted_total %u\n", s.clientsAccepted);
+    out.printf("gateway_bridge_clients_evicted_total %u\n", s.clientsEvicted);
+    out.printf("gateway_bridge_clients_refused_total %u\n", s.clientsRefused);
+    out.printf("gateway_bridge_buffers_in_use %u\n", s.poolInUse);
+    out.printf("gateway_bridge_buffer_fallbacks_total %u\n", s.poolFallbacks);
+    out.printf("gateway_bridge_shared_reads_total %u\n", s.sharedReads);
+    for (uint8_t i = 0; i < s.maxClients; i++){
+        if (!s.clientValid[i]) continue;
+        out.printf("gateway_bridge_client_queued{client=\"%u\"} %u\n", i, s.client[i].queued);
+        out.printf("gateway_bridge_client_dropped_total{client=\"%u\"} %u\n", i, s.client[i].dropped);
+        out.printf("gateway_bridge_client_bus_ms_total{client=\"%u\"} %u\n", i, s.client[i].busTime);
+        out.printf("gateway_bridge_client_idle_ms{client=\"%u\"} %u\n", i, s.client[i].idle);
+    }
+#ifndef USE_ENC28J60
+    out.printf("gateway_wifi_rssi_dbm %d\n", s.rssi);
+    out.printf("gateway_wifi_reconnects_total %u\n", s.wifiReconnects);
+    out.printf("gateway_wifi_scan_reconnects_total %u\n", s.wifiScanReconnects);
+    out.printf("gateway_wifi_last_reconnect_ms %u\n", s.wifiLastReconnect);
+    out.printf("gateway_wifi_downtime_ms_total %u\n", s.wifiDowntime);
+#endif
+    out.printf("gateway_heap_free_bytes %u\n", s.heapFree);
+    out.printf("gateway_heap_min_free_bytes %u\n", s.heapMinFree);
+    out.printf("gateway_heap_largest_block_bytes %u\n", s.heapLargestBlock);
+    out.printf("gateway_heap_min_largest_block_bytes %u\n", s.heapMinLargestBlock);
+    out.printf("gateway_heap_fragmentation_percent %u\n", s.heapFragmentation);
+    out.printf("gateway_alloc_failures_total %u\n", s.allocFailures);
+    for (uint8_t i = 0; i < s.taskCount; i++){
+        if (!s.tasks[i].alive) continue;
+        out.printf("gateway_task_stack_free_bytes{task=\"%s\"} %u\n", s.tasks[i].name, s.tasks[i].minFree);
+    }
+    for (uint8_t i = 0; i < s.bootPhaseCount; i++){
+        out.printf("gateway_boot_phase_ms{phase=\"%s\"} %u\n", s.bootPhaseNames[i], s.bootPhaseMs[i]);
+    }
+    out.printf("gateway_boot_ms %u\n", s.bootMs);
+    out.printf("gateway_boot_fast %u\n", s.bootFastPath ? 1 : 0);
+    endView();
+}
@@ -0,0 +1,934 @@
+#include "tcp_bridge.h"
+#include "diagnostics_unit.h"
+#ifndef USE_ENC28J60
+    #include <lwip/sockets.h>
+#endif
+
+// translate rtu client errors (timeouts, crc errors, ...) to exceptions a tcp master understands
+static uint8_t toException(Modbus::Error error){
+    if (error <= Modbus::Error::GATEWAY_TARGET_NO_RESP) return error;
+    switch (error)
+    {
+        case Modbus::Error::TIMEOUT:
+        case Modbus::Error::CRC_ERROR:
+        case Modbus::Error::SERVER_ID_MISMATCH:
+        case Modbus::Error::FC_MISMATCH:
+        case Modbus::Error::PACKET_LENGTH_ERROR:
+            return Modbus::Error::GATEWAY_TARGET_NO_RESP;
+        case Modbus::Error::REQUEST_QUEUE_FULL:
+            return Modbus::Error::SERVER_DEVICE_BUSY;
+        default:
+            return Modbus::Error::GATEWAY_PATH_UNAVAIL;
+    }
+}
+
+TcpBridge::TcpBridge()
+    :_server(nullptr)
+    ,_rtu(nullptr)
+    ,_diagnostics(nullptr)
+    ,_timeout(0)
+    ,_maxClients(1)
+    ,_maxInFlight(1)
+    ,_task(NULL)
+    ,_engine(NULL)
+    ,_poller(NULL)
+    ,_netCore(0)
+    ,_netPriority(3)
+    ,_rtuCore(1)
+    ,_rtuPriority(4)
+    ,_messageCount(0)
+    ,_errorCount(0)
+    ,_coalescedWrites(0)
+    ,_coalescedFrames(0)
+    ,_sharedReads(0)
+    ,_evictIdle(2000)
+    ,_keepAlive(0)
+    ,_accepted(0)
+    ,_evicted(0)
+    ,_refused(0)
+    ,_coalesceWindow(0)
+    ,_connectionRate(0)
+    ,_addressRate(0)
+    ,_burst(10)
+    ,_weightCount(0)
+    ,_pass(0)
+{
+    memset(_coalesceUnits, 0, sizeof(_coalesceUnits));
+    memset(_rejected, 0, sizeof(_rejected));
+    memset(_writeSequence, 0, sizeof(_writeSequence));
+    for (auto &batch : _batches){
+        batch.open = false;
+    }
+    for (auto &connection : _connections){
+        connection.active = false;
+        connection.generation = 0;
+        connection.inFlight = 0;
+        connection.rxLen = 0;
+        connection.address = -1;
+    }
+    for (auto &address : _addresses){
+        address.ip = 0;
+        address.connections = 0;
+    }
+    for (auto &share : _shares){
+        share.head = -1;
+        share.tail = -1;
+        share.queued = 0;
+        share.generation = 0;
+        share.pass = 0;
+        share.busTime = 0;
+        share.busRemainder = 0;
+    }
+    for (auto &transaction : _transactions){
+        transaction.used = false;
+        transaction.cancelled = false;
+        transaction.data = nullptr;
+    }
+}
+
+void TcpBridge::start(RtuClient *rtu, uint16_t port, uint8_t maxClients, uint32_t timeout, uint8_t maxInFlight, bool ownTask){
+    _rtu = rtu;
+    _maxClients = constrain(maxClients, 1, TCP_BRIDGE_MAX_CLIENTS);
+    _maxInFlight = constrain(maxInFlight, 1, TCP_BRIDGE_MAX_INFLIGHT);
+    _timeout = timeout;
+    _server = new BridgeServer(port);
+    _server->begin();
+    xTaskCreatePinnedToCore(engineTask, "mbrtu", 4096, this, _rtuPriority, &_engine, _rtuCore);
+    if (ownTask){
+        xTaskCreatePinnedToCore(task, "mbtcp", 4096, this, _netPriority, &_task, _netCore);
+    }
+}
+
+// must be called before start(), a negative core means no affinity
+void TcpBridge::setTasks(int8_t netCore, uint8_t netPriority, int8_t rtuCore, uint8_t rtuPriority){
+    _netCore = netCore < 0 ? tskNO_AFFINITY : netCore;
+    _netPriority = netPriority;
+    _rtuCore = rtuCore < 0 ? tskNO_AFFINITY : rtuCore;
+    _rtuPriority = rtuPriority;
+}
+
+void TcpBridge::task(void *arg){
+    auto bridge = static_cast<TcpBridge*>(arg);
+    for (;;){
+        bridge->poll();
+        // woken early when the engine completes a transaction
+        ulTaskNotifyTake(pdTRUE, 1);
+    }
+}
+
+void TcpBridge::engineTask(void *arg){
+    auto bridge = static_cast<TcpBridge*>(arg);
+    int16_t slot;
+    for (;;){
+        while ((slot = bridge->schedule()) >= 0){
+            // the slot may be reused as soon as execute() handed it back
+            auto owner = bridge->_transactions[slot].connection;
+            auto started = micros();
+            bridge->execute(slot);
+            bridge->charge(owner, micros() - started);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void TcpBridge::poll(){
+    if (!_server) return;
+    if (!_poller) _poller = xTaskGetCurrentTaskHandle();
+    complete();
+    flushBatches(true);
+    accept();
+    for (uint8_t i = 0; i < _maxClients; i++){
+        if (_connections[i].active) receive(i);
+    }
+}
+
+// units are given as "1,5,10-12", window in ms (0 disables coalescing)
+void TcpBridge::setWriteCoalescing(String units, uint16_t window){
+    Config::parseUnits(units, _coalesceUnits);
+    _coalesceWindow = window;
+}
+
+// must be called before start()
+void TcpBridge::setClientLimits(uint16_t connectionRate, uint16_t addressRate, uint8_t burst, String weights){
+    _connectionRate = connectionRate;
+    _addressRate = addressRate;
+    _burst = max(burst, (uint8_t)1);
+    _weightCount = 0;
+    int start = 0;
+    while (start < (int)weights.length() && _weightCount < TCP_BRIDGE_MAX_WEIGHTS){
+        auto end = weights.indexOf(',', start);
+        if (end < 0) end = weights.length();
+        auto item = weights.substring(start, end);
+        start = end + 1;
+        auto equals = item.indexOf('=');
+        if (equals < 0) continue;
+        auto address = item.substring(0, equals);
+        address.trim();
+        IPAddress ip;
+        long weight = item.substring(equals + 1).toInt();
+        if (!ip.fromString(address) || weight < 1) continue;
+        _weightIps[_weightCount] = (uint32_t)ip;
+        _weights[_weightCount] = min(weight, 100L);
+        _weightCount++;
+    }
+}
+
+void TcpBridge::setConnectionLimits(uint16_t evictIdle, uint16_t keepAlive){
+    _evictIdle = evictIdle;
+    _keepAlive = keepAlive;
+}
+
+void TcpBridge::setDiagnostics(DiagnosticsUnit *diagnostics){
+    _diagnostics = diagnostics;
+}
+
+uint8_t TcpBridge::getMaxClients(){
+    return _maxClients;
+}
+
+uint32_t TcpBridge::getAcceptedClients(){
+    return _accepted;
+}
+
+uint32_t TcpBridge::getEvictedClients(){
+    return _evicted;
+}
+
+uint32_t TcpBridge::getRefusedClients(){
+    return _refused;
+}
+
+bool TcpBridge::getClientStats(uint8_t index, BridgeClientStats &stats){
+    if (index >= _maxClients || !_connections[index].active) return false;
+    auto &connection = _connections[index];
+    auto &share = _shares[index];
+    stats.ip = connection.ip;
+    stats.weight = connection.weight;
+    stats.inFlight = connection.inFlight;
+    stats.requests = connection.requests;
+    stats.dropped = connection.dropped;
+    // the engine only resets its side when the first request of a new client arrives
+    bool current = share.generation == connection.generation;
+    stats.queued = current ? share.queued : 0;
+    stats.busTime = current ? share.busTime : 0;
+    auto now = millis();
+    stats.connected = now - connection.connected;
+    stats.idle = now - connection.lastActivity;
+    return true;
+}
+
+uint32_t TcpBridge::getCoalescedWrites(){
+    return _coalescedWrites;
+}
+
+uint32_t TcpBridge::getCoalescedFrames(){
+    return _coalescedFrames;
+}
+
+uint32_t TcpBridge::getSharedReads(){
+    return _sharedReads;
+}
+
+uint32_t TcpBridge::getPoolInUse(){
+    return _pool.inUse();
+}
+
+uint32_t TcpBridge::getPoolHighWater(){
+    return _pool.highWater();
+}
+
+uint32_t TcpBridge::getPoolFallbacks(){
+    return _pool.fallbacks();
+}
+
+uint32_t TcpBridge::getMessageCount(){
+    return _messageCount;
+}
+
+uint32_t TcpBridge::getErrorCount(){
+    return _errorCount;
+}
+
+uint32_t TcpBridge::getRejected(uint8_t reason){
+    return reason < REJECT_REASONS ? _rejected[reason] : 0;
+}
+
+const char *TcpBridge::rejectName(uint8_t reason){
+    static const char *const names[REJECT_REASONS] = {"framing", "unit", "function", "length", "quantity", "address"};
+    return reason < REJECT_REASONS ? names[reason] : "";
+}
+
+uint32_t TcpBridge::activeClients(){
+    uint32_t result = 0;
+    for (uint8_t i = 0; i < _maxClients; i++){
+        if (_connections[i].active) result++;
+    }
+    return result;
+}
+
+uint32_t TcpBridge::pendingTransactions(){
+    uint32_t result = 0;
+    for (auto &transaction : _transactions){
+        if (transaction.used) result++;
+    }
+    return result;
+}
+
+void TcpBridge::accept(){
+    auto client = _server->accept();
+    if (!client) return;
+    auto now = millis();
+    int8_t free = -1, oldest = -1;
+    for (uint8_t i = 0; i < _maxClients && free < 0; i++){
+        auto &connection = _connections[i];
+        if (!connection.active) free = i;
+        // a connection waiting for the bus is not idle
+        else if (connection.inFlight == 0 && (oldest < 0 || (long)(connection.lastActivity - _connections[oldest].lastActivity) < 0)) oldest = i;
+    }
+    // at the limit the least recently active connection gives way, so a master
+    // that reconnects (after a cable pull or reboot) is not locked out by its
+    // own dead connection until the tcp timeout
+    if (free < 0 && oldest >= 0 && now - _connections[oldest].lastActivity >= _evictIdle){
+        elog(ELOG_INFO, EV_BRIDGE_EVICT, oldest, now - _connections[oldest].lastActivity, client.remoteIP());
+        _evicted++;
+        close(oldest);
+        free = oldest;
+    }
+    if (free >= 0){
+        auto i = free;
+        auto &connection = _connections[i];
+        connection.client = client;
+        connection.active = true;
+        connection.generation++;
+        connection.inFlight = 0;
+        connection.rxLen = 0;
+        connection.lastActivity = now;
+        connection.connected = now;
+        connection.ip = (uint32_t)client.remoteIP();
+        connection.weight = 1;
+        for (uint8_t w = 0; w < _weightCount; w++){
+            if (_weightIps[w] == connection.ip) connection.weight = _weights[w];
+        }
+        connection.bucket.tokens = _burst * 1000UL;
+        connection.bucket.updated = millis();
+        connection.requests = 0;
+        connection.dropped = 0;
+        // connections from the same address share one bucket, it outlives a reconnect
+        connection.address = -1;
+        for (uint8_t a = 0; a < TCP_BRIDGE_MAX_CLIENTS; a++){
+            if (_addresses[a].ip == connection.ip) connection.address = a;
+        }
+        if (connection.address < 0){
+            for (uint8_t a = 0; a < TCP_BRIDGE_MAX_CLIENTS; a++){
+                if (_addresses[a].connections > 0) continue;
+                connection.address = a;
+                _addresses[a].ip = connection.ip;
+                _addresses[a].bucket = connection.bucket;
+                break;
+            }
+        }
+        _addresses[connection.address].connections++;
+#ifndef USE_ENC28J60
+        connection.client.setNoDelay(true);
+        if (_keepAlive > 0){
+            // dead peers (power loss, cable pulled) are detected without waiting for the tcp timeout
+            int fd = connection.client.fd();
+            int enable = 1, idle = _keepAlive, interval = TCP_BRIDGE_KEEPALIVE_INTERVAL, count = TCP_BRIDGE_KEEPALIVE_COUNT;
+            setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+        }
+#endif
+        _accepted++;
+        elog(ELOG_INFO, EV_BRIDGE_CONNECT, i, client.remoteIP());
+        return;
+    }
+    _refused++;
+    elog(ELOG_WARN, EV_BRIDGE_NO_SLOT, client.remoteIP());
+    client.stop();
+}
+
+void TcpBridge::receive(uint8_t index){
+    auto &connection = _connections[index];
+    if (!connection.client.connected()){
+        close(index);
+        return;
+    }
+    // stop reading at the in-flight limit, tcp flow control then throttles the master
+    while (connection.active && connection.inFlight < _maxInFlight){
+        if (dispatch(index)) continue;
+        if (!connection.active) return;
+        int available = connection.client.available();
+        if (available <= 0) break;
+        size_t room = sizeof(connection.rx) - connection.rxLen;
+        int len = connection.client.read(connection.rx + connection.rxLen, min((size_t)available, room));
+        if (len <= 0) break;
+        connection.rxLen += len;
+        connection.lastActivity = millis();
+    }
+    if (connection.active && _timeout > 0 && connection.inFlight == 0 && millis() - connection.lastActivity > _timeout){
+        elog(ELOG_INFO, EV_BRIDGE_TIMEOUT, index);
+        close(index);
+    }
+}
+
+// handle one complete request from the receive buffer, returns false if there is none
+bool TcpBridge::dispatch(uint8_t index){
+    auto &connection = _connections[index];
+    auto rx = connection.rx;
+    if (connection.rxLen < MBAP_HEADER_SIZE) return false;
+    uint16_t transactionId = (rx[0] << 8) | rx[1];
+    uint16_t protocolId = (rx[2] << 8) | rx[3];
+    uint16_t len = (rx[4] << 8) | rx[5];
+    if (protocolId != 0 || len < 2 || len > MODBUS_MAX_PDU + 1){
+        // framing is lost, there is no way to resync the stream
+        elog(ELOG_WARN, EV_BRIDGE_FRAMING, index, protocolId, len);
+        _errorCount++;
+        _rejected[REJECT_FRAMING]++;
+        close(index);
+        return false;
+    }
+    if (connection.rxLen < 6 + len) return false;
+    _messageCount++;
+    traceRecorder.record(TRACE_REQUEST, index, transactionId, 0, rx + 6, len);
+    uint8_t unit = rx[6];
+    uint8_t function = rx[7];
+    Modbus::Error error;
+    connection.requests++;
+    int8_t reason;
+    if (_diagnostics && _diagnostics->getUnit() && unit == _diagnostics->getUnit()){
+        // the gateway's own unit: no slot, no rate limit, no bus time
+        answerLocally(index, transactionId, rx + 6, len);
+    }
+    else if ((reason = validate(rx + 6, len, error)) >= 0){
+        reject(index, transactionId, rx + 6, reason, error);
+    }
+    else if (!admit(connection)){
+        connection.dropped++;
+        sendException(index, transactionId, unit, function, Modbus::Error::SERVER_DEVICE_BUSY);
+    }
+    else{
+        auto slot = allocate();
+        if (slot < 0){
+            sendException(index, transactionId, unit, function, Modbus::Error::SERVER_DEVICE_BUSY);
+        }
+        else{
+            auto &transaction = _transactions[slot];
+            transaction.used = true;
+            transaction.cancelled = false;
+            transaction.data = nullptr;
+            transaction.connection = index;
+            transaction.generation = connection.generation;
+            transaction.transactionId = transactionId;
+            transaction.unit = unit;
+            transaction.function = function;
+            transaction.start = millis();
+            transaction.busTime = 0;
+            transaction.next = -1;
+            transaction.duplicate = -1;
+            transaction.len = len;
+            memcpy(transaction.range, rx + 8, len >= 6 ? 4 : 0);
+            if (function < Modbus::FunctionCode::READ_COIL || function > Modbus::FunctionCode::READ_INPUT_REGISTER){
+                _writeSequence[unit]++;
+            }
+            transaction.writeSequence = _writeSequence[unit];
+            if (share(slot)){
+                connection.inFlight++;
+            }
+            else if ((transaction.data = _pool.acquire()) == nullptr){
+                transaction.used = false;
+                sendException(index, transactionId, unit, function, Modbus::Error::SERVER_DEVICE_BUSY);
+            }
+            else{
+                memcpy(transaction.data, rx + 6, len);
+                connection.inFlight++;
+                enqueue(slot);
+            }
+        }
+    }
+    connection.rxLen -= 6 + len;
+    memmove(rx, rx + 6 + len, connection.rxLen);
+    return true;
+}
+
+// check a request against the limits of its function code before it takes a
+// slot or bus time. Returns the BridgeReject reason and the exception to
+// answer with, -1 if the request may go to the bus. User defined function
+// codes (65-72, 100-110) are passed on unchecked.
+int8_t TcpBridge::validate(const uint8_t *pdu, uint16_t len, Modbus::Error &error){
+    uint8_t unit = pdu[0];
+    uint8_t function = pdu[1];
+    if (unit == 0 || unit > 247){
+        error = Modbus::Error::GATEWAY_PATH_UNAVAIL;
+        return REJECT_UNIT;
+    }
+    // [unit, fc, address, quantity] of the fixed size requests
+    uint16_t address = len >= 6 ? (pdu[2] << 8) | pdu[3] : 0;
+    uint16_t quantity = len >= 6 ? (pdu[4] << 8) | pdu[5] : 0;
+    uint16_t minQuantity = 1, maxQuantity = 0;
+    error = Modbus::Error::ILLEGAL_DATA_VALUE;
+    switch (function){
+        case Modbus::FunctionCode::READ_COIL:
+        case Modbus::FunctionCode::READ_DISCR_INPUT:
+            if (len != 6) return REJECT_LENGTH;
+            maxQuantity = 2000;
+            break;
+        case Modbus::FunctionCode::READ_HOLD_REGISTER:
+        case Modbus::FunctionCode::READ_INPUT_REGISTER:
+            if (len != 6) return REJECT_LENGTH;
+            maxQuantity = 125;
+            break;
+        case Modbus::FunctionCode::WRITE_COIL:
+            if (len != 6) return REJECT_LENGTH;
+            if (quantity != 0x0000 && quantity != 0xff00) return REJECT_QUANTITY;
+            return -1;
+        case Modbus::FunctionCode::WRITE_HOLD_REGISTER:
+            return len == 6 ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::WRITE_MULT_COILS:
+            if (len < 7 || len != 7 + pdu[6]) return REJECT_LENGTH;
+            maxQuantity = 1968;
+            if (quantity >= 1 && quantity <= maxQuantity && pdu[6] != (quantity + 7) / 8) return REJECT_LENGTH;
+            break;
+        case Modbus::FunctionCode::WRITE_MULT_REGISTERS:
+            if (len < 7 || len != 7 + pdu[6]) return REJECT_LENGTH;
+            maxQuantity = 123;
+            if (quantity >= 1 && quantity <= maxQuantity && pdu[6] != quantity * 2) return REJECT_LENGTH;
+            break;
+        case Modbus::FunctionCode::MASK_WRITE_REGISTER:
+            return len == 8 ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::R_W_MULT_REGISTERS:{
+            if (len < 11 || len != 11 + pdu[10]) return REJECT_LENGTH;
+            uint16_t writeAddress = (pdu[6] << 8) | pdu[7];
+            uint16_t writeQuantity = (pdu[8] << 8) | pdu[9];
+            if (writeQuantity < 1 || writeQuantity > 121) return REJECT_QUANTITY;
+            if (pdu[10] != writeQuantity * 2) return REJECT_LENGTH;
+            if (writeAddress + writeQuantity > 0x10000){
+                error = Modbus::Error::ILLEGAL_DATA_ADDRESS;
+                return REJECT_ADDRESS;
+            }
+            maxQuantity = 125;
+            break;
+        }
+        case Modbus::FunctionCode::READ_EXCEPTION_SERIAL:
+        case Modbus::FunctionCode::READ_COMM_CNT_SERIAL:
+        case Modbus::FunctionCode::READ_COMM_LOG_SERIAL:
+        case Modbus::FunctionCode::REPORT_SERVER_ID_SERIAL:
+            return len == 2 ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::DIAGNOSTICS_SERIAL:
+            // sub-function and at least one data word
+            return len >= 6 ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::READ_FILE_RECORD:
+        case Modbus::FunctionCode::WRITE_FILE_RECORD:
+            return len >= 3 && len == 3 + pdu[2] ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::READ_FIFO_QUEUE:
+            return len == 4 ? -1 : REJECT_LENGTH;
+        case Modbus::FunctionCode::ENCAPSULATED_INTERFACE:
+            return len >= 3 ? -1 : REJECT_LENGTH;
+        default:
+            if ((function >= 65 && function <= 72) || (function >= 100 && function <= 110)) return -1;
+            error = Modbus::Error::ILLEGAL_FUNCTION;
+            return REJECT_FUNCTION;
+    }
+    if (quantity < minQuantity || quantity > maxQuantity) return REJECT_QUANTITY;
+    if (address + quantity > 0x10000){
+        error = Modbus::Error::ILLEGAL_DATA_ADDRESS;
+        return REJECT_ADDRESS;
+    }
+    return -1;
+}
+
+// answer an invalid request right away, it never takes a slot or bus time
+void TcpBridge::reject(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint8_t reason, Modbus::Error error){
+    _rejected[reason]++;
+    elog(ELOG_DEBUG, EV_BRIDGE_REJECT, index, pdu[0], pdu[1], rejectName(reason));
+    sendException(index, transactionId, pdu[0], pdu[1], error);
+}
+
+void TcpBridge::answerLocally(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint16_t len){
+    uint16_t responseLen;
+    auto response = _diagnostics->execute(pdu, len, responseLen);
+    if (response[1] & 0x80) _errorCount++;
+    traceRecorder.record(TRACE_RESPONSE, index, transactionId, 0, response, responseLen);
+    send(index, transactionId, response, responseLen);
+}
+
+// take a request from the connection's and the address' token bucket,
+// false (nothing taken) if either is empty
+bool TcpBridge::admit(BridgeConnection &connection){
+    auto now = millis();
+    auto &address = _addresses[connection.address].bucket;
+    if (!take(connection.bucket, _connectionRate, now)) return false;
+    if (!take(address, _addressRate, now)){
+        if (_connectionRate > 0) connection.bucket.tokens += 1000;
+        return false;
+    }
+    return true;
+}
+
+bool TcpBridge::take(TokenBucket &bucket, uint16_t rate, unsigned long now){
+    if (rate == 0) return true;
+    uint32_t limit = _burst * 1000UL;
+    uint32_t elapsed = now - bucket.updated;
+    bucket.updated = now;
+    // anything longer than the time to fill the bucket could overflow
+    if (elapsed > limit / rate) elapsed = limit / rate;
+    bucket.tokens = min(bucket.tokens + elapsed * rate, limit);
+    if (bucket.tokens < 1000) return false;
+    bucket.tokens -= 1000;
+    return true;
+}
+
+int16_t TcpBridge::allocate(){
+    for (int16_t i = 0; i < TCP_BRIDGE_MAX_TRANSACTIONS; i++){
+        if (!_transactions[i].used) return i;
+    }
+    return -1;
+}
+
+void TcpBridge::enqueue(int16_t slot){
+    auto &transaction = _transactions[slot];
+    if (isCoalesced(transaction.unit)){
+        if (transaction.function == Modbus::FunctionCode::WRITE_HOLD_REGISTER && transaction.len == 6){
+            if (coalesce(slot)) return;
+        }
+        else{
+            // anything else for this unit must see the pending writes first
+            flushBatches(false, transaction.unit);
+        }
+    }
+    submit(slot);
+}
+
+// hand a transaction (or the first member of a coalesced write) to the rtu engine
+void TcpBridge::submit(int16_t slot){
+    if (!_requests.push(slot)){
+        fail(slot, Modbus::Error::REQUEST_QUEUE_FULL);
+        return;
+    }
+    xTaskNotifyGive(_engine);
+}
+
+// answer a transaction (and all members of a coalesced write) with an exception
+void TcpBridge::fail(int16_t slot, Modbus::Error error){
+    for (auto i = slot; i >= 0; i = _transactions[i].next){
+        auto &transaction = _transactions[i];
+        transaction.data[0] = transaction.unit;
+        transaction.data[1] = transaction.function | 0x80;
+        transaction.data[2] = toException(error);
+        transaction.len = 3;
+        finish(i);
+    }
+}
+
+// attach a read to an identical one that has not been answered yet,
+// true if the slot now waits for that response
+bool TcpBridge::share(int16_t slot){
+    auto &transaction = _transactions[slot];
+    if (transaction.function < Modbus::FunctionCode::READ_COIL || transaction.function > Modbus::FunctionCode::READ_INPUT_REGISTER) return false;
+    // a write still batched or on its way to the unit may land after the
+    // leader's read, the follower has to see it
+    for (auto &batch : _batches){
+        if (batch.open && batch.unit == transaction.unit) return false;
+    }
+    for (int16_t i = 0; i < TCP_BRIDGE_MAX_TRANSACTIONS; i++){
+        auto &other = _transactions[i];
+        if (i == slot || !other.used || other.unit != transaction.unit) continue;
+        if (other.function < Modbus::FunctionCode::READ_COIL || other.function > Modbus::FunctionCode::READ_INPUT_REGISTER) return false;
+    }
+    for (int16_t i = 0; i < TCP_BRIDGE_MAX_TRANSACTIONS; i++){
+        auto &leader = _transactions[i];
+        // followers have no buffer, writes are never leaders, a cancelled
+        // leader never reaches the bus
+        if (i == slot || !leader.used || !leader.data || leader.cancelled || leader.unit != transaction.unit || leader.function != transaction.function) continue;
+        if (memcmp(leader.range, transaction.range, sizeof(transaction.range)) != 0) continue;
+        // a write was accepted after the leader, its answer may be stale
+        if (leader.writeSequence != transaction.writeSequence) continue;
+        transaction.duplicate = leader.duplicate;
+        leader.duplicate = slot;
+        _sharedReads++;
+        return true;
+    }
+    return false;
+}
+
+bool TcpBridge::isCoalesced(uint8_t unit){
+    return _coalesceWindow > 0 && (_coalesceUnits[unit / 32] & (1UL << (unit % 32)));
+}
+
+// add a fc06 write to the unit's batch, returns false if it has to be sent on its own
+bool TcpBridge::coalesce(int16_t slot){
+    auto &transaction = _transactions[slot];
+    uint16_t address = (transaction.data[2] << 8) | transaction.data[3];
+    WriteBatch *free = nullptr;
+    for (auto &batch : _batches){
+        if (!batch.open){
+            if (!free) free = &batch;
+            continue;
+        }
+        if (batch.unit != transaction.unit) continue;
+        if (address == batch.address + batch.count && batch.count < TCP_BRIDGE_MAX_BATCH_REGS){
+            _transactions[batch.last].next = slot;
+            batch.last = slot;
+            batch.count++;
+            return true;
+        }
+        // not adjacent: keep the order, send what we have and start over
+        flushBatch(batch);
+        free = &batch;
+        break;
+    }
+    if (!free) return false;
+    free->open = true;
+    free->unit = transaction.unit;
+    free->address = address;
+    free->count = 1;
+    free->first = slot;
+    free->last = slot;
+    free->opened = millis();
+    return true;
+}
+
+void TcpBridge::flushBatches(bool expiredOnly, uint8_t unit){
+    for (auto &batch : _batches){
+        if (!batch.open) continue;
+        if (expiredOnly && millis() - batch.opened < _coalesceWindow) continue;
+        if (!expiredOnly && batch.unit != unit) continue;
+        flushBatch(batch);
+    }
+}
+
+void TcpBridge::flushBatch(WriteBatch &batch){
+    batch.open = false;
+    if (batch.count > 1){
+        _coalescedWrites += batch.count;
+        _coalescedFrames++;
+    }
+    submit(batch.first);
+}
+
+// runs in the rtu engine task, the only writer of a transaction while it is queued
+void TcpBridge::execute(uint8_t slot){
+    auto &transaction = _transactions[slot];
+    uint16_t responseLen;
+    Modbus::Error error;
+    if (transaction.next >= 0){
+        // coalesced fc06 writes: members of a closed connection are dropped,
+        // the others go out as one fc16 per run of consecutive addresses
+        int8_t i = slot;
+        while (i >= 0){
+            if (_transactions[i].cancelled){
+                auto next = _transactions[i].next;
+                drop(i);
+                i = next;
+                continue;
+            }
+            int8_t first = i;
+            uint8_t frame[MODBUS_MAX_PDU + 1];
+            frame[0] = transaction.unit;
+            frame[1] = Modbus::FunctionCode::WRITE_MULT_REGISTERS;
+            frame[2] = _transactions[first].data[2];
+            frame[3] = _transactions[first].data[3];
+            uint16_t address = (frame[2] << 8) | frame[3];
+            uint16_t len = 7;
+            for (; i >= 0 && !_transactions[i].cancelled; i = _transactions[i].next){
+                auto data = _transactions[i].data;
+                if (((data[2] << 8) | data[3]) != address + (len - 7) / 2) break;
+                frame[len++] = data[4];
+                frame[len++] = data[5];
+            }
+            uint8_t count = (len - 7) / 2;
+            frame[4] = 0;
+            frame[5] = count;
+            frame[6] = count * 2;
+            auto started = micros();
+            error = _rtu->transact(frame, len, sizeof(frame), responseLen);
+            uint32_t busTime = micros() - started;
+            // fan the fc16 result out to the original fc06 requests
+            for (int8_t j = first; j != i; ){
+                auto &member = _transactions[j];
+                // the slot is the network task's once it is pushed
+                auto next = member.next;
+                member.busTime = busTime;
+                if (error != Modbus::Error::SUCCESS){
+                    member.data[1] = member.function | 0x80;
+                    member.data[2] = toException(error);
+                    member.len = 3;
+                }
+                // on success the fc06 response is an echo of the request still in data
+                _completed.push(j);
+                j = next;
+            }
+        }
+    }
+    else if (transaction.cancelled){
+        drop(slot);
+    }
+    else{
+        // the response replaces the request in the slot buffer
+        auto started = micros();
+        error = _rtu->transact(transaction.data, transaction.len, MODBUS_MAX_PDU + 1, responseLen);
+        transaction.busTime = micros() - started;
+        if (error != Modbus::Error::SUCCESS){
+            transaction.data[0] = transaction.unit;
+            transaction.data[1] = transaction.function | 0x80;
+            transaction.data[2] = toException(error);
+            transaction.len = 3;
+        }
+        else{
+            transaction.len = responseLen;
+        }
+        _completed.push(slot);
+    }
+    if (_poller) xTaskNotifyGive(_poller);
+}
+
+// hand a cancelled transaction back unsent, the network task only releases it
+void TcpBridge::drop(int8_t slot){
+    auto &transaction = _transactions[slot];
+    transaction.busTime = 0;
+    transaction.data[0] = transaction.unit;
+    transaction.data[1] = transaction.function | 0x80;
+    transaction.data[2] = toException(Modbus::Error::GATEWAY_PATH_UNAVAIL);
+    transaction.len = 3;
+    _completed.push(slot);
+}
+
+// called by the engine: move newly submitted transactions into the per
+// connection queues and pick the next one for the bus, -1 if there is none
+int16_t TcpBridge::schedule(){
+    uint8_t slot;
+    while (_requests.pop(slot)){
+        auto &transaction = _transactions[slot];
+        auto &share = _shares[transaction.connection];
+        if (share.generation != transaction.generation){
+            // first request of a new client on this connection
+            share.generation = transaction.generation;
+            share.busTime = 0;
+            share.busRemainder = 0;
+        }
+        transaction.queueNext = -1;
+        if (share.tail < 0){
+            share.head = slot;
+            // an idle connection does not save up bus time
+            if ((int32_t)(share.pass - _pass) < 0) share.pass = _pass;
+        }
+        else{
+            _transactions[share.tail].queueNext = slot;
+        }
+        share.tail = slot;
+        share.queued++;
+    }
+    int8_t best = -1;
+    for (uint8_t i = 0; i < TCP_BRIDGE_MAX_CLIENTS; i++){
+        if (_shares[i].head < 0) continue;
+        if (best < 0 || (int32_t)(_shares[i].pass - _shares[best].pass) < 0) best = i;
+    }
+    if (best < 0) return -1;
+    auto &share = _shares[best];
+    auto next = share.head;
+    share.head = _transactions[next].queueNext;
+    if (share.head < 0) share.tail = -1;
+    share.queued--;
+    _pass = share.pass;
+    return next;
+}
+
+// account the bus time of a transaction to its connection
+void TcpBridge::charge(uint8_t index, uint32_t busTime){
+    auto &share = _shares[index];
+    share.pass += busTime / max(_connections[index].weight, (uint8_t)1);
+    busTime += share.busRemainder;
+    share.busTime += busTime / 1000;
+    share.busRemainder = busTime % 1000;
+}
+
+void TcpBridge::complete(){
+    uint8_t index;
+    while (_completed.pop(index)){
+        finish(index);
+    }
+}
+
+// send the response of a finished transaction (and of the reads waiting
+// for it) and release the slots
+void TcpBridge::finish(uint8_t index){
+    auto &transaction = _transactions[index];
+    respond(transaction, transaction.data, transaction.len, transaction.busTime);
+    for (auto i = transaction.duplicate; i >= 0; i = _transactions[i].duplicate){
+        respond(_transactions[i], transaction.data, transaction.len, 0);
+        _transactions[i].used = false;
+    }
+    _pool.release(transaction.data);
+    transaction.data = nullptr;
+    transaction.used = false;
+}
+
+void TcpBridge::respond(BridgeTransaction &transaction, const uint8_t *pdu, uint16_t len, uint32_t busTime){
+    auto &connection = _connections[transaction.connection];
+    // the connection may have been closed and reused meanwhile
+    if (!connection.active || connection.generation != transaction.generation) return;
+    if (pdu[1] & 0x80) _errorCount++;
+    traceRecorder.record(TRACE_RESPONSE, transaction.connection, transaction.transactionId, busTime, pdu, len);
+    send(transaction.connection, transaction.transactionId, pdu, len);
+    connection.inFlight--;
+}
+
+void TcpBridge::close(uint8_t index){
+    auto &connection = _connections[index];
+    connection.client.stop();
+    connection.active = false;
+    if (connection.address >= 0) _addresses[connection.address].connections--;
+    connection.address = -1;
+    connection.inFlight = 0;
+    connection.rxLen = 0;
+    cancel(index);
+    elog(ELOG_INFO, EV_BRIDGE_DISCONNECT, index);
+}
+
+// nobody reads the answers of a closed connection: its reads waiting for
+// another read's response are released at once, everything else queued,
+// batched or shared is cancelled and dropped by the engine before the bus.
+// A leader other connections' reads wait for is still sent.
+void TcpBridge::cancel(uint8_t index){
+    auto generation = _connections[index].generation;
+    for (auto &leader : _transactions){
+        if (!leader.used || !leader.data) continue;
+        auto link = &leader.duplicate;
+        while (*link >= 0){
+            auto &follower = _transactions[*link];
+            if (follower.connection == index && follower.generation == generation){
+                *link = follower.duplicate;
+                follower.used = false;
+            }
+            else{
+                link = &follower.duplicate;
+            }
+        }
+    }
+    for (auto &transaction : _transactions){
+        if (!transaction.used || !transaction.data || transaction.connection != index || transaction.generation != generation) continue;
+        if (transaction.duplicate < 0) transaction.cancelled = true;
+    }
+}
+
+void TcpBridge::sendException(uint8_t index, uint16_t transactionId, uint8_t unit, uint8_t function, Modbus::Error error){
+    uint8_t pdu[3] = {unit, (uint8_t)(function | 0x80), toException(error)};
+    _errorCount++;
+    traceRecorder.record(TRACE_RESPONSE, index, transactionId, 0, pdu, sizeof(pdu));
+    send(index, transactionId, pdu, sizeof(pdu));
+}
+
+void TcpBridge::send(uint8_t index, uint16_t transactionId, const uint8_t *pdu, uint16_t len){
+    auto &connection = _connections[index];
+    uint8_t frame[MODBUS_MAX_ADU];
+    frame[0] = transactionId >> 8;
+    frame[1] = transactionId & 0xff;
+    frame[2] = 0;
+    frame[3] = 0;
+    frame[4] = len >> 8;
+    frame[5] = len & 0xff;
+    memcpy(frame + 6, pdu, len);
+    connection.client.write(frame, 6 + len);
+    connection.lastActivity = millis();
+}
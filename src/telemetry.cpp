@@ -0,0 +1,142 @@
+#include "telemetry.h"
+
+Telemetry telemetry;
+
+volatile uint32_t Telemetry::_allocFailures = 0;
+volatile uint32_t Telemetry::_lastFailedSize = 0;
+
+Telemetry::Telemetry()
+    :_task(NULL)
+    ,_lock(portMUX_INITIALIZER_UNLOCKED)
+    ,_freeHeap(0)
+    ,_minFreeHeap(UINT32_MAX)
+    ,_largestBlock(0)
+    ,_minLargestBlock(UINT32_MAX)
+    ,_reportedFailures(0)
+    ,_lowBlock(false)
+    ,_taskCount(0)
+{}
+
+void Telemetry::begin(){
+    heap_caps_register_failed_alloc_callback(allocFailed);
+    sample();
+    if (!_task){
+        xTaskCreate(task, "telemetry", 3072, this, 1, &_task);
+    }
+}
+
+// called by the heap allocator, possibly with interrupts disabled: count only
+void Telemetry::allocFailed(size_t size, uint32_t caps, const char *function){
+    _allocFailures++;
+    _lastFailedSize = size;
+}
+
+void Telemetry::task(void *arg){
+    auto telemetry = static_cast<Telemetry*>(arg);
+    for (;;){
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_INTERVAL));
+        telemetry->sample();
+    }
+}
+
+void Telemetry::sample(){
+    sampleHeap();
+    sampleTasks();
+}
+
+void Telemetry::sampleHeap(){
+    uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    // the allocator tracks the real low water mark, between our samples too
+    uint32_t minFree = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    portENTER_CRITICAL(&_lock);
+    _freeHeap = freeHeap;
+    _minFreeHeap = min(_minFreeHeap, minFree);
+    _largestBlock = largest;
+    _minLargestBlock = min(_minLargestBlock, largest);
+    portEXIT_CRITICAL(&_lock);
+    if (largest < TELEMETRY_LOW_BLOCK && !_lowBlock){
+        elog(ELOG_WARN, EV_HEAP_LOW, freeHeap, largest);
+    }
+    _lowBlock = largest < TELEMETRY_LOW_BLOCK;
+    uint32_t failures = _allocFailures;
+    if (failures != _reportedFailures){
+        elog(ELOG_ERROR, EV_ALLOC_FAILED, failures - _reportedFailures, (uint32_t)_lastFailedSize);
+        _reportedFailures = failures;
+    }
+}
+
+// tasks are remembered by name, a task that was deleted keeps its last value
+void Telemetry::sampleTasks(){
+    TaskStatus_t status[TELEMETRY_MAX_TASKS + 8];
+    auto count = uxTaskGetSystemState(status, sizeof(status) / sizeof(status[0]), NULL);
+    portENTER_CRITICAL(&_lock);
+    for (uint8_t i = 0; i < _taskCount; i++) _tasks[i].alive = false;
+    for (UBaseType_t i = 0; i < count; i++){
+        auto name = status[i].pcTaskName;
+        uint32_t free = status[i].usStackHighWaterMark;
+        TaskStackStats *entry = NULL;
+        for (uint8_t j = 0; j < _taskCount; j++){
+            if (strncmp(_tasks[j].name, name, sizeof(_tasks[j].name)) == 0){
+                entry = &_tasks[j];
+                break;
+            }
+        }
+        if (!entry){
+            if (_taskCount >= TELEMETRY_MAX_TASKS) continue;
+            entry = &_tasks[_taskCount++];
+            strncpy(entry->name, name, sizeof(entry->name) - 1);
+            entry->name[sizeof(entry->name) - 1] = 0;
+            entry->minFree = free;
+        }
+        entry->minFree = min(entry->minFree, free);
+        entry->alive = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint32_t Telemetry::getFreeHeap(){
+    return _freeHeap;
+}
+
+uint32_t Telemetry::getMinFreeHeap(){
+    return _minFreeHeap;
+}
+
+uint32_t Telemetry::getLargestBlock(){
+    return _largestBlock;
+}
+
+uint32_t Telemetry::getMinLargestBlock(){
+    return _minLargestBlock;
+}
+
+// share of the free heap that is not usable as one block
+uint8_t Telemetry::getFragmentation(){
+    portENTER_CRITICAL(&_lock);
+    auto freeHeap = _freeHeap;
+    auto largest = _largestBlock;
+    portEXIT_CRITICAL(&_lock);
+    if (freeHeap == 0) return 0;
+    return 100 - (uint64_t)largest * 100 / freeHeap;
+}
+
+uint32_t Telemetry::getAllocFailures(){
+    return _allocFailures;
+}
+
+uint32_t Telemetry::getLastFailedSize(){
+    return _lastFailedSize;
+}
+
+uint8_t Telemetry::getTaskCount(){
+    return _taskCount;
+}
+
+TaskStackStats Telemetry::getTask(uint8_t index){
+    TaskStackStats result = {};
+    portENTER_CRITICAL(&_lock);
+    if (index < _taskCount) result = _tasks[index];
+    portEXIT_CRITICAL(&_lock);
+    return result;
+}
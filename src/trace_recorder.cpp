@@ -0,0 +1,144 @@
+#include "trace_recorder.h"
+
+TraceRecorder traceRecorder;
+
+TraceRecorder::TraceRecorder()
+    :_buffer(NULL)
+    ,_size(0)
+    ,_head(0)
+    ,_tail(0)
+    ,_used(0)
+    ,_total(0)
+    ,_records(0)
+    ,_dropped(0)
+    ,_lock(NULL)
+{}
+
+// allocated once at boot, never on the bridge path
+void TraceRecorder::begin(uint32_t size){
+    if (_buffer || size == 0) return;
+    _buffer = (uint8_t*)malloc(size);
+    if (!_buffer) return;
+    _size = size;
+    _lock = xSemaphoreCreateMutex();
+}
+
+void TraceRecorder::put(const uint8_t *data, uint32_t len){
+    for (uint32_t i = 0; i < len; i++){
+        _buffer[_head] = data[i];
+        _head = (_head + 1) % _size;
+    }
+    _used += len;
+    _total += len;
+}
+
+void TraceRecorder::get(uint32_t pos, uint8_t *data, uint32_t len){
+    for (uint32_t i = 0; i < len; i++){
+        data[i] = _buffer[(pos + i) % _size];
+    }
+}
+
+void TraceRecorder::record(uint8_t type, uint8_t connection, uint16_t transactionId, uint32_t busTime, const uint8_t *pdu, uint8_t len){
+    if (!_buffer) return;
+    uint32_t need = TRACE_RECORD_HEADER_SIZE + len;
+    if (need > _size) return;
+    uint32_t time = micros();
+    if (xSemaphoreTake(_lock, 0) != pdTRUE){
+        _dropped++;
+        return;
+    }
+    // make room by dropping the oldest records
+    while (_size - _used < need){
+        uint8_t oldLen = _buffer[(_tail + TRACE_RECORD_HEADER_SIZE - 1) % _size];
+        _tail = (_tail + TRACE_RECORD_HEADER_SIZE + oldLen) % _size;
+        _used -= TRACE_RECORD_HEADER_SIZE + oldLen;
+        _records--;
+    }
+    uint8_t header[TRACE_RECORD_HEADER_SIZE] = {
+        type, connection, (uint8_t)transactionId, (uint8_t)(transactionId >> 8),
+        (uint8_t)time, (uint8_t)(time >> 8), (uint8_t)(time >> 16), (uint8_t)(time >> 24),
+        (uint8_t)busTime, (uint8_t)(busTime >> 8), (uint8_t)(busTime >> 16), (uint8_t)(busTime >> 24),
+        len
+    };
+    put(header, sizeof(header));
+    put(pdu, len);
+    _records++;
+    xSemaphoreGive(_lock);
+}
+
+void TraceRecorder::beginRead(TraceCursor &cursor){
+    uint32_t dropped = _dropped;
+    uint8_t header[TRACE_FILE_HEADER_SIZE] = {
+        TRACE_MAGIC[0], TRACE_MAGIC[1], TRACE_MAGIC[2], TRACE_MAGIC[3], TRACE_VERSION, 0, 0, 0,
+        (uint8_t)dropped, (uint8_t)(dropped >> 8), (uint8_t)(dropped >> 16), (uint8_t)(dropped >> 24)
+    };
+    memcpy(cursor.data, header, sizeof(header));
+    cursor.staged = sizeof(header);
+    cursor.sent = 0;
+    cursor.position = 0;
+    cursor.end = 0;
+    if (!_buffer) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    cursor.position = _total - _used;
+    cursor.end = _total;
+    xSemaphoreGive(_lock);
+}
+
+// copies the record at the cursor, the lock is held for one record only
+bool TraceRecorder::stageRecord(TraceCursor &cursor){
+    if (!_buffer || (int32_t)(cursor.end - cursor.position) <= 0) return false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    uint32_t oldest = _total - _used;
+    // overwritten (or cleared) since: go on with the oldest record left
+    if ((int32_t)(cursor.position - oldest) < 0) cursor.position = oldest;
+    bool more = (int32_t)(cursor.end - cursor.position) > 0;
+    if (more){
+        uint32_t pos = (_tail + (cursor.position - oldest)) % _size;
+        uint16_t len = TRACE_RECORD_HEADER_SIZE + _buffer[(pos + TRACE_RECORD_HEADER_SIZE - 1) % _size];
+        get(pos, cursor.data, len);
+        cursor.staged = len;
+        cursor.sent = 0;
+        cursor.position += len;
+    }
+    xSemaphoreGive(_lock);
+    return more;
+}
+
+size_t TraceRecorder::read(TraceCursor &cursor, uint8_t *data, size_t len){
+    size_t written = 0;
+    while (written < len){
+        if (cursor.sent == cursor.staged && !stageRecord(cursor)) break;
+        size_t count = min(len - written, (size_t)(cursor.staged - cursor.sent));
+        memcpy(data + written, cursor.data + cursor.sent, count);
+        cursor.sent += count;
+        written += count;
+    }
+    return written;
+}
+
+void TraceRecorder::clear(){
+    if (!_buffer) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    // the head stays, stream offsets of running downloads remain valid
+    _tail = _head;
+    _used = 0;
+    _records = 0;
+    _dropped = 0;
+    xSemaphoreGive(_lock);
+}
+
+uint32_t TraceRecorder::getRecords(){
+    return _records;
+}
+
+uint32_t TraceRecorder::getUsed(){
+    return _used;
+}
+
+uint32_t TraceRecorder::getSize(){
+    return _size;
+}
+
+uint32_t TraceRecorder::getDropped(){
+    return _dropped;
+}
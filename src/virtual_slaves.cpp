@@ -0,0 +1,172 @@
+#include "virtual_slaves.h"
+#include "config.h"
+
+VirtualSlaves::VirtualSlaves()
+    :_units(NULL)
+    ,_count(0)
+    ,_delay(0)
+    ,_exceptionRate(0)
+    ,_timeoutRate(0)
+    ,_lock(NULL)
+    ,_requests(0)
+    ,_injected(0)
+{}
+
+void VirtualSlaves::begin(String units, uint16_t delay, uint8_t exceptionRate, uint8_t timeoutRate){
+    if (_units) return;
+    uint32_t selected[8];
+    Config::parseUnits(units, selected);
+    uint8_t ids[SIM_MAX_UNITS];
+    for (uint16_t unit = 1; unit <= 247 && _count < SIM_MAX_UNITS; unit++){
+        if (selected[unit / 32] & (1UL << (unit % 32))) ids[_count++] = unit;
+    }
+    if (_count == 0) return;
+    _units = (SimUnit*)calloc(_count, sizeof(SimUnit));
+    if (!_units){
+        _count = 0;
+        return;
+    }
+    for (uint8_t i = 0; i < _count; i++){
+        _units[i].id = ids[i];
+        for (uint16_t reg = 0; reg < SIM_REGISTERS; reg++){
+            _units[i].inputRegisters[reg] = reg;
+        }
+    }
+    _delay = delay;
+    _exceptionRate = min(exceptionRate, (uint8_t)100);
+    _timeoutRate = min(timeoutRate, (uint8_t)(100 - _exceptionRate));
+    _lock = xSemaphoreCreateMutex();
+}
+
+SimUnit *VirtualSlaves::find(uint8_t unit){
+    for (uint8_t i = 0; i < _count; i++){
+        if (_units[i].id == unit) return &_units[i];
+    }
+    return NULL;
+}
+
+bool VirtualSlaves::handles(uint8_t unit){
+    return find(unit) != NULL;
+}
+
+Modbus::Error VirtualSlaves::transact(uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen, uint32_t timeout){
+    responseLen = 0;
+    auto unit = find(pdu[0]);
+    if (!unit) return Modbus::Error::INVALID_SERVER;
+    if (_delay > 0) delay(_delay);
+    auto roll = esp_random() % 100;
+    uint8_t code;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _requests++;
+    unit->requests++;
+    if (roll < _timeoutRate){
+        _injected++;
+        xSemaphoreGive(_lock);
+        // no answer: the caller waits its timeout, the other units stay usable
+        delay(timeout);
+        return Modbus::Error::TIMEOUT;
+    }
+    if (roll < _timeoutRate + _exceptionRate){
+        _injected++;
+        code = Modbus::Error::SERVER_DEVICE_FAILURE;
+    }
+    else{
+        code = execute(*unit, pdu, len, size, responseLen);
+    }
+    xSemaphoreGive(_lock);
+    if (code != 0){
+        pdu[1] |= 0x80;
+        pdu[2] = code;
+        responseLen = 3;
+        return (Modbus::Error)code;
+    }
+    return Modbus::Error::SUCCESS;
+}
+
+// called with the lock held, returns 0 or the exception code
+uint8_t VirtualSlaves::execute(SimUnit &unit, uint8_t *pdu, uint16_t len, uint16_t size, uint16_t &responseLen){
+    if (len < 6) return Modbus::Error::ILLEGAL_DATA_VALUE;
+    uint8_t function = pdu[1];
+    uint16_t address = (pdu[2] << 8) | pdu[3];
+    uint16_t count = (pdu[4] << 8) | pdu[5];
+    unit.inputRegisters[0] = unit.requests;
+    switch (function){
+        case Modbus::FunctionCode::READ_COIL:
+        case Modbus::FunctionCode::READ_DISCR_INPUT:{
+            if (count < 1 || count > 2000) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            if (address + count > SIM_BITS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            uint8_t bytes = (count + 7) / 8;
+            if (3 + bytes > size) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            auto table = function == Modbus::FunctionCode::READ_COIL ? unit.coils : unit.discreteInputs;
+            pdu[2] = bytes;
+            memset(pdu + 3, 0, bytes);
+            for (uint16_t i = 0; i < count; i++){
+                uint16_t bit = address + i;
+                if (table[bit / 8] & (1 << (bit % 8))) pdu[3 + i / 8] |= 1 << (i % 8);
+            }
+            responseLen = 3 + bytes;
+            return 0;
+        }
+        case Modbus::FunctionCode::READ_HOLD_REGISTER:
+        case Modbus::FunctionCode::READ_INPUT_REGISTER:{
+            if (count < 1 || count > 125) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            if (address + count > SIM_REGISTERS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            if (3 + count * 2 > size) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            auto table = function == Modbus::FunctionCode::READ_HOLD_REGISTER ? unit.holdingRegisters : unit.inputRegisters;
+            pdu[2] = count * 2;
+            for (uint16_t i = 0; i < count; i++){
+                pdu[3 + i * 2] = table[address + i] >> 8;
+                pdu[4 + i * 2] = table[address + i] & 0xff;
+            }
+            responseLen = 3 + count * 2;
+            return 0;
+        }
+        case Modbus::FunctionCode::WRITE_COIL:
+            if (count != 0xff00 && count != 0) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            if (address >= SIM_BITS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            if (count) unit.coils[address / 8] |= 1 << (address % 8);
+            else unit.coils[address / 8] &= ~(1 << (address % 8));
+            // the response is an echo of the request
+            responseLen = 6;
+            return 0;
+        case Modbus::FunctionCode::WRITE_HOLD_REGISTER:
+            if (address >= SIM_REGISTERS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            unit.holdingRegisters[address] = count;
+            responseLen = 6;
+            return 0;
+        case Modbus::FunctionCode::WRITE_MULT_COILS:{
+            uint8_t bytes = (count + 7) / 8;
+            if (count < 1 || count > 1968 || len < 7 || pdu[6] != bytes || len < 7 + bytes) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            if (address + count > SIM_BITS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            for (uint16_t i = 0; i < count; i++){
+                uint16_t bit = address + i;
+                if (pdu[7 + i / 8] & (1 << (i % 8))) unit.coils[bit / 8] |= 1 << (bit % 8);
+                else unit.coils[bit / 8] &= ~(1 << (bit % 8));
+            }
+            responseLen = 6;
+            return 0;
+        }
+        case Modbus::FunctionCode::WRITE_MULT_REGISTERS:
+            if (count < 1 || count > 123 || len < 7 || pdu[6] != count * 2 || len < 7 + count * 2) return Modbus::Error::ILLEGAL_DATA_VALUE;
+            if (address + count > SIM_REGISTERS) return Modbus::Error::ILLEGAL_DATA_ADDRESS;
+            for (uint16_t i = 0; i < count; i++){
+                unit.holdingRegisters[address + i] = (pdu[7 + i * 2] << 8) | pdu[8 + i * 2];
+            }
+            responseLen = 6;
+            return 0;
+        default:
+            return Modbus::Error::ILLEGAL_FUNCTION;
+    }
+}
+
+uint8_t VirtualSlaves::getUnitCount(){
+    return _count;
+}
+
+uint32_t VirtualSlaves::getRequests(){
+    return _requests;
+}
+
+uint32_t VirtualSlaves::getInjectedErrors(){
+    return _injected;
+}
@@ -0,0 +1,184 @@
+#ifndef USE_ENC28J60
+#include "wifi_supervisor.h"
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <lwip/tcpip.h>
+#include <time.h>
+
+WifiSupervisor::WifiSupervisor()
+    :_task(NULL)
+    ,_channel(0)
+    ,_pinned(false)
+    ,_powerSave(true)
+    ,_connected(false)
+    ,_lostAt(0)
+    ,_attemptAt(0)
+    ,_attempts(0)
+    ,_attemptPinned(false)
+    ,_reconnects(0)
+    ,_scanReconnects(0)
+    ,_lastReconnect(0)
+    ,_maxReconnect(0)
+    ,_downtime(0)
+    ,_config(nullptr)
+    ,_renew(false)
+    ,_leaseKnown(false)
+    ,_leaseUsed(0)
+{}
+
+void WifiSupervisor::setLeaseCache(Config *config, bool renew){
+    _config = config;
+    _renew = renew;
+}
+
+void WifiSupervisor::begin(bool powerSave, int8_t txPower, bool fastReconnect){
+    if (_task) return;
+    _powerSave = powerSave;
+    // modem sleep wakes up for the beacons only, a frame for us waits up to a DTIM interval
+    WiFi.setSleep(powerSave);
+    WiFi.setTxPower((wifi_power_t)txPower);
+    _connected = WiFi.status() == WL_CONNECTED;
+    if (fastReconnect){
+        _ssid = WiFi.SSID();
+        _password = WiFi.psk();
+        WiFi.setAutoReconnect(false);
+    }
+    xTaskCreate(task, "wifi", 3072, this, 1, &_task);
+}
+
+void WifiSupervisor::task(void *arg){
+    auto supervisor = static_cast<WifiSupervisor*>(arg);
+    for (;;){
+        supervisor->run();
+        vTaskDelay(pdMS_TO_TICKS(WIFI_SUPERVISOR_INTERVAL));
+    }
+}
+
+void WifiSupervisor::run(){
+    uint32_t now = millis();
+    if (WiFi.status() == WL_CONNECTED){
+        if (!_connected){
+            _connected = true;
+            uint32_t duration = now - _lostAt;
+            _reconnects++;
+            if (!_attemptPinned) _scanReconnects++;
+            _lastReconnect = duration;
+            _maxReconnect = max(_maxReconnect, duration);
+            _downtime += duration;
+            elog(ELOG_INFO, EV_WIFI_RECONNECTED, duration, _attemptPinned ? "known access point" : "scan");
+        }
+        // the access point to come back to, also after roaming
+        memcpy(_bssid, WiFi.BSSID(), sizeof(_bssid));
+        _channel = WiFi.channel();
+        _pinned = true;
+        if (_config) keepLease();
+        return;
+    }
+    if (_connected){
+        _connected = false;
+        _lostAt = now;
+        _attempts = 0;
+        _attemptPinned = false;
+        elog(ELOG_WARN, EV_WIFI_LOST, _channel);
+        return;
+    }
+    if (_ssid.length() > 0 && (_attempts == 0 || now - _attemptAt >= WIFI_RECONNECT_TIMEOUT)){
+        attempt(now);
+    }
+}
+
+// with the core's auto reconnect off, so the two never race
+void WifiSupervisor::attempt(uint32_t now){
+    _attemptPinned = _pinned && _attempts % WIFI_RECONNECT_SCAN_EVERY != WIFI_RECONNECT_SCAN_EVERY - 1;
+    _attempts++;
+    _attemptAt = now;
+    WiFi.disconnect();
+    // not written to the WiFi NVS: a stored BSSID would pin every later connect
+    WiFi.persistent(false);
+    if (_attemptPinned) WiFi.begin(_ssid.c_str(), _password.c_str(), _channel, _bssid);
+    else WiFi.begin(_ssid.c_str(), _password.c_str());
+    WiFi.persistent(true);
+}
+
+static struct netif *stationNetif(){
+    auto handle = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    return handle ? static_cast<struct netif*>(esp_netif_get_netif_impl(handle)) : nullptr;
+}
+
+// the station's DHCP lease and the s since it was granted or renewed, false
+// with a static address or before the client is bound
+static bool dhcpLease(uint32_t &leaseTime, uint32_t &used){
+    auto netif = stationNetif();
+    if (!netif || !dhcp_supplied_address(netif)) return false;
+    auto dhcp = netif_dhcp_data(netif);
+    leaseTime = dhcp->offered_t0_lease;
+    used = dhcp->lease_used * DHCP_COARSE_TIMER_SECS;
+    return true;
+}
+
+// lwIP's client leaves the netif address alone until it binds a lease;
+// WiFi.config(INADDR_NONE) would clear the cached address first
+static void startDhcp(void *netif){
+    dhcp_start(static_cast<struct netif*>(netif));
+}
+
+void WifiSupervisor::keepLease(){
+    if (_renew){
+        auto netif = stationNetif();
+        if (netif && tcpip_callback(startDhcp, netif) == ERR_OK) _renew = false;
+        return;
+    }
+    uint32_t leaseTime, used;
+    if (!_config->getFastBoot() || !dhcpLease(leaseTime, used)) return;
+    // the time since the lease only goes back when it was granted again
+    bool renewed = !_leaseKnown || used < _leaseUsed;
+    _leaseKnown = true;
+    _leaseUsed = used;
+    if (!renewed) return;
+    NetworkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.subnet = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP();
+    memcpy(cache.bssid, _bssid, sizeof(cache.bssid));
+    cache.channel = _channel;
+    cache.obtained = time(nullptr) - used;
+    cache.leaseTime = leaseTime;
+    _config->setNetworkCache(cache);
+    elog(ELOG_INFO, EV_LEASE, WiFi.localIP(), leaseTime);
+}
+
+bool WifiSupervisor::getPowerSave(){
+    return _powerSave;
+}
+
+float WifiSupervisor::getTxPower(){
+    return WiFi.getTxPower() / 4.0;
+}
+
+bool WifiSupervisor::isFastReconnect(){
+    return _ssid.length() > 0;
+}
+
+uint32_t WifiSupervisor::getReconnects(){
+    return _reconnects;
+}
+
+uint32_t WifiSupervisor::getScanReconnects(){
+    return _scanReconnects;
+}
+
+uint32_t WifiSupervisor::getLastReconnect(){
+    return _lastReconnect;
+}
+
+uint32_t WifiSupervisor::getMaxReconnect(){
+    return _maxReconnect;
+}
+
+uint32_t WifiSupervisor::getDowntime(){
+    return _downtime + (_connected ? 0 : millis() - _lostAt);
+}
+#endif /* USE_ENC28J60 */
@@ -0,0 +1,83 @@
+// Host benchmark: Modbus RTU CRC on typical frame sizes (8 byte request up to
+// a 256 byte maximum frame). Compares the table driven modbusCrc16() used by
+// the RtuClient with the former bitwise loop and with slicing-by-4, which
+// needs four tables (2 KB) instead of one.
+//
+//   make -C tools bench && tools/build/crc_bench [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "modbus_crc.h"
+
+using Clock = std::chrono::steady_clock;
+
+static uint16_t crcBitwise(const uint8_t *data, uint16_t len){
+    uint16_t crc = 0xffff;
+    for (uint16_t i = 0; i < len; i++){
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++){
+            crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t slices[4][256];
+
+static void initSlices(){
+    for (int i = 0; i < 256; i++){
+        uint16_t crc = i;
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        slices[0][i] = crc;
+    }
+    for (int i = 0; i < 256; i++){
+        for (int k = 1; k < 4; k++){
+            slices[k][i] = (slices[k - 1][i] >> 8) ^ slices[0][slices[k - 1][i] & 0xff];
+        }
+    }
+}
+
+static uint16_t crcSlicing4(const uint8_t *data, uint16_t len){
+    uint16_t crc = 0xffff;
+    while (len >= 4){
+        crc = slices[3][(crc ^ data[0]) & 0xff] ^ slices[2][((crc >> 8) ^ data[1]) & 0xff]
+            ^ slices[1][data[2]] ^ slices[0][data[3]];
+        data += 4;
+        len -= 4;
+    }
+    while (len--) crc = (crc >> 8) ^ slices[0][(crc ^ *data++) & 0xff];
+    return crc;
+}
+
+// ns per frame
+template <typename F>
+static double measure(F crc, const std::vector<uint8_t> &frame, long iterations){
+    volatile uint16_t sink = 0;
+    auto start = Clock::now();
+    for (long i = 0; i < iterations; i++){
+        sink = sink + crc(frame.data(), frame.size());
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char **argv){
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    initSlices();
+    printf("%6s %12s %12s %12s %9s\n", "bytes", "bitwise ns", "table ns", "slice4 ns", "speedup");
+    for (uint16_t size : {8, 16, 32, 64, 128, 256}){
+        std::vector<uint8_t> frame(size);
+        for (uint16_t i = 0; i < size; i++) frame[i] = rand();
+        auto expected = crcBitwise(frame.data(), size);
+        if (modbusCrc16(frame.data(), size) != expected || crcSlicing4(frame.data(), size) != expected){
+            fprintf(stderr, "crc mismatch for %u bytes\n", size);
+            return 1;
+        }
+        double bitwise = measure(crcBitwise, frame, iterations);
+        double table = measure(modbusCrc16, frame, iterations);
+        double slicing = measure(crcSlicing4, frame, iterations);
+        printf("%6u %12.1f %12.1f %12.1f %8.1fx\n", size, bitwise, table, slicing, bitwise / table);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Host benchmark: typed decoding of /api/read responses, from a 2 register
+// block up to a full 125 register read of mixed int16/uint16/int32/uint32/
+// float32 tags in all four word/byte orders, half of them scaled. Compares
+// decodeRegister() of the register map with a generic decoder that gathers
+// the bytes through a permutation table per order.
+//
+//   make -C tools bench && tools/build/decode_bench [iterations]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "register_decode.h"
+
+using Clock = std::chrono::steady_clock;
+
+// byte positions of A, B, C, D for ABCD, BADC, CDAB, DCBA
+static const uint8_t permutations[4][4] = {{0, 1, 2, 3}, {1, 0, 3, 2}, {2, 3, 0, 1}, {3, 2, 1, 0}};
+
+static double decodePermuted(const RegisterTag &tag, const uint8_t *data, uint16_t offset){
+    const uint8_t *bytes = data + offset * 2;
+    const uint8_t *order = permutations[tag.order];
+    uint8_t width = registerCount(tag) * 2;
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < width; i++){
+        // a 16 bit value only swaps bytes, CDAB on one register is AB
+        uint8_t index = width == 2 ? order[i] & 1 : order[i];
+        raw = (raw << 8) | bytes[index];
+    }
+    double value;
+    switch (tag.type){
+        case REG_INT16: value = (int16_t)raw; break;
+        case REG_UINT16: value = (uint16_t)raw; break;
+        case REG_INT32: value = (int32_t)raw; break;
+        case REG_UINT32: value = raw; break;
+        case REG_FLOAT32:{
+            float real;
+            memcpy(&real, &raw, sizeof(real));
+            value = real;
+            break;
+        }
+        default: return 0;
+    }
+    return value * tag.scale;
+}
+
+// tags filling registers registers, cycling through types and orders
+static std::vector<RegisterTag> makeTags(uint16_t registers){
+    static const uint8_t types[] = {REG_INT16, REG_UINT16, REG_INT32, REG_UINT32, REG_FLOAT32};
+    std::vector<RegisterTag> tags;
+    uint16_t address = 0;
+    for (uint16_t i = 0; ; i++){
+        RegisterTag tag = {};
+        tag.function = 3;
+        tag.address = address;
+        tag.type = types[i % 5];
+        tag.order = i % 4;
+        tag.scale = i % 2 ? 0.1f : 1.0f;
+        if (address + registerCount(tag) > registers){
+            if (address < registers){
+                tag.type = REG_UINT16;
+                tags.push_back(tag);
+            }
+            break;
+        }
+        tags.push_back(tag);
+        address += registerCount(tag);
+    }
+    return tags;
+}
+
+// ns per block
+template <typename F>
+static double measure(F decode, const std::vector<RegisterTag> &tags, const std::vector<uint8_t> &data, long iterations){
+    volatile double sink = 0;
+    auto start = Clock::now();
+    for (long i = 0; i < iterations; i++){
+        double sum = 0;
+        for (auto &tag : tags) sum += decode(tag, data.data(), tag.address);
+        sink = sink + sum;
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char **argv){
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    printf("%9s %6s %14s %14s %12s %9s\n", "registers", "tags", "permuted ns", "decode ns", "decode MB/s", "speedup");
+    for (uint16_t registers : {2, 16, 64, 125}){
+        auto tags = makeTags(registers);
+        std::vector<uint8_t> data(registers * 2);
+        for (auto &byte : data) byte = rand();
+        for (auto &tag : tags){
+            double expected = decodePermuted(tag, data.data(), tag.address);
+            double value = decodeRegister(tag, data.data(), tag.address);
+            if (value != expected && !(std::isnan(value) && std::isnan(expected))){
+                fprintf(stderr, "mismatch at register %u: %g != %g\n", tag.address, value, expected);
+                return 1;
+            }
+        }
+        double permuted = measure(decodePermuted, tags, data, iterations);
+        double decode = measure(decodeRegister, tags, data, iterations);
+        printf("%9u %6zu %14.1f %14.1f %12.1f %8.1fx\n", registers, tags.size(), permuted, decode,
+            data.size() * 1000.0 / decode, permuted / decode);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Host benchmark: per transaction buffer handling of the old eModbus path
+// (request vector, queued request object, response vector, sync response map
+// entry) against the bridge's MessagePool. Two threads play the network and
+// the rtu engine task, like on the gateway.
+//
+//   make -C tools bench && tools/build/pool_bench [transactions]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "message_pool.h"
+#include "spsc_queue.h"
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size){
+    allocations++;
+    if (void *p = malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept{
+    free(p);
+}
+
+// response sizes of a typical mix: fc03 reads of 1..60 registers and fc06 echoes
+static uint16_t responseSize(size_t i){
+    return (i % 4 == 0) ? 6 : 5 + (i * 7919) % 120;
+}
+
+struct QueuedRequest{
+    std::vector<uint8_t> message;
+    uint32_t token;
+};
+
+static double runVector(size_t transactions){
+    SpscQueue<QueuedRequest*, 64> requests;
+    SpscQueue<std::vector<uint8_t>*, 64> responses;
+    std::map<uint32_t, std::vector<uint8_t>> sync;
+    auto start = Clock::now();
+    std::thread engine([&]{
+        QueuedRequest *request;
+        for (size_t i = 0; i < transactions; i++){
+            while (!requests.pop(request)) std::this_thread::yield();
+            auto response = new std::vector<uint8_t>(responseSize(i));
+            memcpy(response->data(), request->message.data(), 2);
+            delete request;
+            while (!responses.push(response)) std::this_thread::yield();
+        }
+    });
+    std::vector<uint8_t> *response;
+    for (size_t i = 0; i < transactions; i++){
+        std::vector<uint8_t> message = {1, 3, 0, 0, 0, 10};
+        auto request = new QueuedRequest{message, (uint32_t)i};
+        while (!requests.push(request)) std::this_thread::yield();
+        while (!responses.pop(response)) std::this_thread::yield();
+        sync[i] = *response;
+        delete response;
+        sync.erase(i);
+    }
+    engine.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / transactions;
+}
+
+static double runPool(size_t transactions, MessagePool<254, 16> &pool){
+    SpscQueue<uint8_t*, 64> requests;
+    SpscQueue<uint8_t*, 64> responses;
+    auto start = Clock::now();
+    std::thread engine([&]{
+        uint8_t *buffer;
+        for (size_t i = 0; i < transactions; i++){
+            while (!requests.pop(buffer)) std::this_thread::yield();
+            // the response overwrites the request in place
+            memset(buffer + 2, 0, responseSize(i) - 2);
+            while (!responses.push(buffer)) std::this_thread::yield();
+        }
+    });
+    uint8_t *buffer;
+    for (size_t i = 0; i < transactions; i++){
+        auto request = pool.acquire();
+        const uint8_t message[] = {1, 3, 0, 0, 0, 10};
+        memcpy(request, message, sizeof(message));
+        while (!requests.push(request)) std::this_thread::yield();
+        while (!responses.pop(buffer)) std::this_thread::yield();
+        pool.release(buffer);
+    }
+    engine.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / transactions;
+}
+
+int main(int argc, char **argv){
+    size_t transactions = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    auto before = allocations.load();
+    auto vector = runVector(transactions);
+    auto vectorAllocations = allocations.load() - before;
+    static MessagePool<254, 16> pool;
+    before = allocations.load();
+    auto pooled = runPool(transactions, pool);
+    auto poolAllocations = allocations.load() - before;
+    printf("vector   %8.0f ns/transaction  %6.2f heap allocations/transaction\n",
+        vector, (double)vectorAllocations / transactions);
+    printf("pool     %8.0f ns/transaction  %6.2f heap allocations/transaction  (high water %u, fallbacks %u)\n",
+        pooled, (double)(poolAllocations + pool.fallbacks()) / transactions, pool.highWater(), pool.fallbacks());
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Host benchmark: hand-off latency between a "network" and an "rtu engine" thread.
+// Compares the lock-free SpscQueue used by TcpBridge with a mutex/condition
+// variable queue, which behaves like a blocking FreeRTOS queue.
+//
+//   make -C tools bench && tools/build/queue_bench [iterations]
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "spsc_queue.h"
+
+using Clock = std::chrono::steady_clock;
+
+class LockedQueue{
+    private:
+        std::mutex _mutex;
+        std::condition_variable _signal;
+        std::deque<uint8_t> _items;
+    public:
+        void push(uint8_t item){
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _items.push_back(item);
+            }
+            _signal.notify_one();
+        }
+        uint8_t pop(){
+            std::unique_lock<std::mutex> lock(_mutex);
+            _signal.wait(lock, [this]{ return !_items.empty(); });
+            auto item = _items.front();
+            _items.pop_front();
+            return item;
+        }
+};
+
+static void report(const char *name, std::vector<double> &samples){
+    std::sort(samples.begin(), samples.end());
+    auto pick = [&](double p){ return samples[(size_t)(p * (samples.size() - 1))]; };
+    double sum = 0;
+    for (auto s : samples) sum += s;
+    printf("%-8s round trips %zu  mean %8.0f ns  p50 %8.0f ns  p95 %8.0f ns  p99 %8.0f ns\n",
+        name, samples.size(), sum / samples.size(), pick(0.5), pick(0.95), pick(0.99));
+}
+
+static std::vector<double> runSpsc(size_t iterations){
+    SpscQueue<uint8_t, 64> requests, responses;
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    std::thread engine([&]{
+        uint8_t slot;
+        for (size_t i = 0; i < iterations; i++){
+            while (!requests.pop(slot)) std::this_thread::yield();
+            responses.push(slot);
+        }
+    });
+    uint8_t slot;
+    for (size_t i = 0; i < iterations; i++){
+        auto start = Clock::now();
+        requests.push(i & 0x1f);
+        while (!responses.pop(slot)) std::this_thread::yield();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    engine.join();
+    return samples;
+}
+
+static std::vector<double> runLocked(size_t iterations){
+    LockedQueue requests, responses;
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    std::thread engine([&]{
+        for (size_t i = 0; i < iterations; i++){
+            responses.push(requests.pop());
+        }
+    });
+    for (size_t i = 0; i < iterations; i++){
+        auto start = Clock::now();
+        requests.push(i & 0x1f);
+        responses.pop();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    engine.join();
+    return samples;
+}
+
+int main(int argc, char **argv){
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    auto locked = runLocked(iterations);
+    auto spsc = runSpsc(iterations);
+    report("mutex", locked);
+    report("spsc", spsc);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_heap_caps.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include "emu.h"
+
+EspClass ESP;
+UpdateClass Update;
+
+static const auto startTime = std::chrono::steady_clock::now();
+static uint8_t pinLevels[64];
+
+int64_t esp_timer_get_time(){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// 64 bit on the host, so they do not wrap like the 32 bit counters on the device
+uint32_t esp_random(){
+    thread_local std::mt19937 generator(std::random_device{}());
+    return generator();
+}
+
+esp_reset_reason_t esp_reset_reason(){
+    return getenv("EMU_RESTARTED") ? ESP_RST_SW : ESP_RST_POWERON;
+}
+
+unsigned long millis(){
+    return esp_timer_get_time() / 1000;
+}
+
+unsigned long micros(){
+    return esp_timer_get_time();
+}
+
+void delay(uint32_t ms){
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us){
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield(){
+    std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode){
+    if (pin < sizeof(pinLevels)) pinLevels[pin] = (mode & PULLUP) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value){
+    if (pin < sizeof(pinLevels)) pinLevels[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin){
+    return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode){}
+
+void detachInterrupt(uint8_t pin){}
+
+uint32_t EspClass::getHeapSize(){
+    return heap_caps_get_total_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t EspClass::getFreeHeap(){
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t EspClass::getMinFreeHeap(){
+    return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t EspClass::getMaxAllocHeap(){
+    return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+uint64_t EspClass::getEfuseMac(){
+    return 0xeeffbeadde24ULL;
+}
+
+void EspClass::restart(){
+    fprintf(stderr, "[emu] restart\n");
+    // all sockets, the pty and the preferences file are opened close-on-exec
+    setenv("EMU_RESTARTED", "1", 1);
+    execv("/proc/self/exe", emuOptions.argv);
+    perror("[emu] restart failed");
+    exit(1);
+}
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char *label){
+    _size = size;
+    _progress = 0;
+    _running = true;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len){
+    _progress += len;
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining){
+    fprintf(stderr, "[emu] firmware image of %zu bytes received, not flashed\n", _progress);
+    _running = false;
+    return true;
+}
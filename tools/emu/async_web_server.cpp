@@ -0,0 +1,441 @@
+#include <ESPAsyncWebServer.h>
+#include <errno.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "emu.h"
+
+#define WEB_MAX_HEADER 8192
+#define WEB_MAX_BODY (4 * 1024 * 1024)
+#define WEB_TIMEOUT 5000
+
+static String urlDecode(const String &text){
+    String result;
+    result.reserve(text.length());
+    for (unsigned int i = 0; i < text.length(); i++){
+        auto c = text[i];
+        if (c == '+'){
+            result += ' ';
+        }
+        else if (c == '%' && i + 2 < text.length() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])){
+            char hex[3] = {text[i + 1], text[i + 2], 0};
+            result += (char)strtol(hex, NULL, 16);
+            i += 2;
+        }
+        else{
+            result += c;
+        }
+    }
+    return result;
+}
+
+static String base64Decode(const String &text){
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String result;
+    uint32_t bits = 0;
+    int count = 0;
+    for (unsigned int i = 0; i < text.length(); i++){
+        auto position = strchr(alphabet, text[i]);
+        if (!position || !text[i]) break;
+        bits = (bits << 6) | (position - alphabet);
+        count += 6;
+        if (count >= 8){
+            count -= 8;
+            result += (char)((bits >> count) & 0xff);
+        }
+    }
+    return result;
+}
+
+static const char *reason(int code){
+    switch (code){
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        default: return "";
+    }
+}
+
+static bool sendAll(int fd, const char *data, size_t len){
+    while (len > 0){
+        auto sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+AsyncWebServerRequest::AsyncWebServerRequest(int fd)
+    :_fd(fd)
+    ,_method(HTTP_GET)
+    ,_sent(false)
+    ,_tempObject(NULL)
+{}
+
+AsyncWebServerRequest::~AsyncWebServerRequest(){
+    free(_tempObject);
+}
+
+String AsyncWebServerRequest::methodToString() const{
+    switch (_method){
+        case HTTP_GET: return "GET";
+        case HTTP_POST: return "POST";
+        case HTTP_DELETE: return "DELETE";
+        case HTTP_PUT: return "PUT";
+        case HTTP_PATCH: return "PATCH";
+        case HTTP_HEAD: return "HEAD";
+        case HTTP_OPTIONS: return "OPTIONS";
+        default: return "UNKNOWN";
+    }
+}
+
+// "a=1&b=2", from the query string or an urlencoded form body
+void AsyncWebServerRequest::addParams(const String &text, bool post){
+    int start = 0;
+    while (start < (int)text.length()){
+        auto end = text.indexOf('&', start);
+        if (end < 0) end = text.length();
+        auto item = text.substring(start, end);
+        start = end + 1;
+        if (item.isEmpty()) continue;
+        auto equals = item.indexOf('=');
+        auto name = urlDecode(equals < 0 ? item : item.substring(0, equals));
+        auto value = equals < 0 ? String() : urlDecode(item.substring(equals + 1));
+        _params.push_back(AsyncWebParameter(name, value, post));
+    }
+}
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const{
+    return getParam(name, post, file) != NULL;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const{
+    for (auto &param : _params){
+        if (param.name() == name && param.isPost() == post && param.isFile() == file){
+            return const_cast<AsyncWebParameter*>(&param);
+        }
+    }
+    return NULL;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(size_t index) const{
+    return index < _params.size() ? const_cast<AsyncWebParameter*>(&_params[index]) : NULL;
+}
+
+bool AsyncWebServerRequest::hasArg(const char *name) const{
+    for (auto &param : _params){
+        if (param.name() == name) return true;
+    }
+    return false;
+}
+
+const String &AsyncWebServerRequest::arg(const String &name) const{
+    static const String empty;
+    for (auto &param : _params){
+        if (param.name() == name) return param.value();
+    }
+    return empty;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String &name) const{
+    return getHeader(name) != NULL;
+}
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const{
+    for (auto &header : _headers){
+        if (header.name().equalsIgnoreCase(name)) return const_cast<AsyncWebHeader*>(&header);
+    }
+    return NULL;
+}
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(size_t index) const{
+    return index < _headers.size() ? const_cast<AsyncWebHeader*>(&_headers[index]) : NULL;
+}
+
+bool AsyncWebServerRequest::authenticate(const char *username, const char *password, const char *realm, bool passwordIsHash){
+    auto header = getHeader("Authorization");
+    if (!header || !header->value().startsWith("Basic ")) return false;
+    auto credentials = base64Decode(header->value().substring(6));
+    return credentials == String(username) + ":" + password;
+}
+
+void AsyncWebServerRequest::requestAuthentication(const char *realm, bool isDigest){
+    auto response = beginResponse(401);
+    response->addHeader("WWW-Authenticate", String("Basic realm=\"") + (realm ? realm : "Login Required") + "\"");
+    send(response);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content){
+    return new AsyncWebServerResponse(code, contentType, content);
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String &contentType, size_t bufferSize){
+    return new AsyncResponseStream(contentType, bufferSize);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller callback){
+    auto response = new AsyncWebServerResponse(200, contentType);
+    response->_filler = callback;
+    return response;
+}
+
+// a chunked body is pulled in TCP segment sized pieces like AsyncTCP does
+#define WEB_CHUNK_SIZE 536
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
+    if (!_sent){
+        _sent = true;
+        String head = String("HTTP/1.1 ") + String(response->_code) + " " + reason(response->_code) + "\r\n";
+        if (!response->_contentType.isEmpty()) head += "Content-Type: " + response->_contentType + "\r\n";
+        if (response->_filler) head += "Transfer-Encoding: chunked\r\n";
+        else head += "Content-Length: " + String(response->_content.length()) + "\r\n";
+        head += "Connection: close\r\n";
+        for (auto &header : response->_headers){
+            if (header.name().equalsIgnoreCase("Connection")) continue;
+            head += header.name() + ": " + header.value() + "\r\n";
+        }
+        head += "\r\n";
+        if (sendAll(_fd, head.c_str(), head.length()) && _method != HTTP_HEAD){
+            if (response->_filler){
+                uint8_t buffer[WEB_CHUNK_SIZE];
+                size_t index = 0;
+                for (;;){
+                    auto len = response->_filler(buffer, sizeof(buffer), index);
+                    char size[12];
+                    snprintf(size, sizeof(size), "%zx\r\n", len);
+                    if (!sendAll(_fd, size, strlen(size))) break;
+                    if (len == 0){
+                        sendAll(_fd, "\r\n", 2);
+                        break;
+                    }
+                    if (!sendAll(_fd, (const char *)buffer, len) || !sendAll(_fd, "\r\n", 2)) break;
+                    index += len;
+                }
+            }
+            else sendAll(_fd, response->_content.c_str(), response->_content.length());
+        }
+    }
+    delete response;
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content){
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::redirect(const String &url){
+    auto response = beginResponse(302);
+    response->addHeader("Location", url);
+    send(response);
+}
+
+// exact match, sub path ("/status" also serves "/status/x") or prefix with a trailing *
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request){
+    if (!(_method & request->method())) return false;
+    if (_uri.length() && _uri.endsWith("*")){
+        if (!request->url().startsWith(_uri.substring(0, _uri.length() - 1))) return false;
+    }
+    else if (_uri.length() && _uri != request->url() && !request->url().startsWith(_uri + "/")){
+        return false;
+    }
+    return filter(request);
+}
+
+AsyncWebServer::AsyncWebServer(uint16_t port)
+    :_port(port)
+    ,_fd(-1)
+    ,_task(NULL)
+{}
+
+AsyncWebServer::~AsyncWebServer(){
+    end();
+}
+
+void AsyncWebServer::begin(){
+    if (_fd >= 0) return;
+    _fd = emuListen(_port, 8);
+    if (_fd < 0) return;
+    // same name, stack and priority as the AsyncTCP task on the device
+    xTaskCreate(task, "async_tcp", 8192, this, 3, &_task);
+}
+
+void AsyncWebServer::end(){
+    if (_fd >= 0) shutdown(_fd, SHUT_RDWR);
+}
+
+void AsyncWebServer::reset(){
+    _handlers.clear();
+    _notFound = nullptr;
+}
+
+void AsyncWebServer::task(void *arg){
+    auto server = static_cast<AsyncWebServer*>(arg);
+    for (;;){
+        int fd = accept4(server->_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0){
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        struct timeval timeout = {WEB_TIMEOUT / 1000, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        server->serve(fd);
+    }
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, ArRequestHandlerFunction onRequest){
+    return on(uri, HTTP_ANY, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest){
+    return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload){
+    return on(uri, method, onRequest, onUpload, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody){
+    auto handler = new AsyncCallbackWebHandler();
+    handler->_uri = uri;
+    handler->_method = method;
+    handler->_onRequest = onRequest;
+    handler->_onUpload = onUpload;
+    handler->_onBody = onBody;
+    _handlers.push_back(std::unique_ptr<AsyncCallbackWebHandler>(handler));
+    return *handler;
+}
+
+static WebRequestMethodComposite toMethod(const String &name){
+    if (name == "GET") return HTTP_GET;
+    if (name == "POST") return HTTP_POST;
+    if (name == "DELETE") return HTTP_DELETE;
+    if (name == "PUT") return HTTP_PUT;
+    if (name == "PATCH") return HTTP_PATCH;
+    if (name == "HEAD") return HTTP_HEAD;
+    if (name == "OPTIONS") return HTTP_OPTIONS;
+    return 0;
+}
+
+// one request per connection: read it, run the handler, close
+void AsyncWebServer::serve(int fd){
+    AsyncWebServerRequest request(fd);
+    std::string data;
+    size_t headerEnd;
+    char buffer[4096];
+    while ((headerEnd = data.find("\r\n\r\n")) == std::string::npos){
+        auto len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len <= 0 || data.length() > WEB_MAX_HEADER){
+            close(fd);
+            return;
+        }
+        data.append(buffer, len);
+    }
+    String head(data.substr(0, headerEnd));
+    std::string body = data.substr(headerEnd + 4);
+
+    auto lineEnd = head.indexOf("\r\n");
+    auto requestLine = lineEnd < 0 ? head : head.substring(0, lineEnd);
+    auto firstSpace = requestLine.indexOf(' ');
+    auto secondSpace = requestLine.indexOf(' ', firstSpace + 1);
+    if (firstSpace < 0 || secondSpace < 0){
+        request.send(400);
+        close(fd);
+        return;
+    }
+    request._method = toMethod(requestLine.substring(0, firstSpace));
+    auto target = requestLine.substring(firstSpace + 1, secondSpace);
+    auto question = target.indexOf('?');
+    request._url = urlDecode(question < 0 ? target : target.substring(0, question));
+    if (question >= 0) request.addParams(target.substring(question + 1), false);
+
+    size_t contentLength = 0;
+    String contentType;
+    int pos = lineEnd < 0 ? head.length() : lineEnd + 2;
+    while (pos < (int)head.length()){
+        auto end = head.indexOf("\r\n", pos);
+        if (end < 0) end = head.length();
+        auto line = head.substring(pos, end);
+        pos = end + 2;
+        auto colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        auto name = line.substring(0, colon);
+        auto value = line.substring(colon + 1);
+        value.trim();
+        if (name.equalsIgnoreCase("Content-Length")) contentLength = value.toInt();
+        if (name.equalsIgnoreCase("Content-Type")) contentType = value;
+        request._headers.push_back(AsyncWebHeader(name, value));
+    }
+    if (contentLength > WEB_MAX_BODY){
+        request.send(413);
+        close(fd);
+        return;
+    }
+    while (body.length() < contentLength){
+        auto len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len <= 0) break;
+        body.append(buffer, len);
+    }
+    body.resize(min(body.length(), contentLength));
+
+    AsyncCallbackWebHandler *handler = NULL;
+    for (auto &candidate : _handlers){
+        if (candidate->canHandle(&request)){
+            handler = candidate.get();
+            break;
+        }
+    }
+
+    if (contentType.startsWith("application/x-www-form-urlencoded")){
+        request.addParams(String(body), true);
+    }
+    else if (contentType.startsWith("multipart/form-data")){
+        auto boundaryPos = contentType.indexOf("boundary=");
+        std::string boundary = "--" + std::string(contentType.substring(boundaryPos + 9).c_str());
+        size_t part = body.find(boundary);
+        while (boundaryPos >= 0 && part != std::string::npos){
+            part += boundary.length();
+            if (body.compare(part, 2, "--") == 0) break;
+            auto partHeadEnd = body.find("\r\n\r\n", part);
+            auto next = body.find("\r\n" + boundary, part);
+            if (partHeadEnd == std::string::npos || next == std::string::npos) break;
+            String partHead(body.substr(part, partHeadEnd - part));
+            auto dataStart = partHeadEnd + 4;
+            auto extract = [&partHead](const char *key) -> String{
+                auto start = partHead.indexOf(key);
+                if (start < 0) return String();
+                start += strlen(key);
+                return partHead.substring(start, partHead.indexOf('"', start));
+            };
+            auto name = extract(" name=\"");
+            auto filename = extract("filename=\"");
+            if (partHead.indexOf("filename=\"") >= 0){
+                request._params.push_back(AsyncWebParameter(name, filename, true, true, next - dataStart));
+                if (handler && handler->_onUpload){
+                    handler->_onUpload(&request, filename, 0, (uint8_t*)&body[dataStart], next - dataStart, true);
+                }
+            }
+            else{
+                request._params.push_back(AsyncWebParameter(name, String(body.substr(dataStart, next - dataStart)), true));
+            }
+            part = next + 2;
+        }
+    }
+    else if (handler && handler->_onBody && !body.empty()){
+        handler->_onBody(&request, (uint8_t*)&body[0], body.length(), 0, body.length());
+    }
+
+    if (handler && handler->_onRequest) handler->_onRequest(&request);
+    else if (_notFound) _notFound(&request);
+    else request.send(404);
+    close(fd);
+    if (request._onDisconnect) request._onDisconnect();
+}
@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <getopt.h>
+#include <signal.h>
+#include "emu.h"
+
+EmuOptions emuOptions = {"gateway.prefs", NULL, NULL, 0, 320 * 1024, NULL};
+
+static void usage(const char *name){
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -p, --prefs FILE        preferences (NVS) file, default gateway.prefs\n"
+        "  -s, --serial TTY        Modbus RTU port (Serial2), default: a new pty\n"
+        "  -l, --serial-link PATH  symlink to the pty, e.g. /tmp/gateway-rtu\n"
+        "  -o, --port-offset N     add N to every listening port (502 -> 10502 with 10000)\n"
+        "  -m, --heap BYTES        heap size reported to the firmware, default 327680\n",
+        name);
+}
+
+// Arduino-ESP32 runs setup() and then loop() forever in "loopTask" (8 KiB, priority 1).
+// There is no idle task to yield to on the host, so an empty loop() is paced at 1 ms
+// instead of keeping a core busy.
+int main(int argc, char **argv){
+    static const struct option options[] = {
+        {"prefs", required_argument, NULL, 'p'},
+        {"serial", required_argument, NULL, 's'},
+        {"serial-link", required_argument, NULL, 'l'},
+        {"port-offset", required_argument, NULL, 'o'},
+        {"heap", required_argument, NULL, 'm'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    emuHeapStart();
+    int option;
+    while ((option = getopt_long(argc, argv, "p:s:l:o:m:h", options, NULL)) != -1){
+        switch (option){
+            case 'p': emuOptions.prefs = optarg; break;
+            case 's': emuOptions.serial = optarg; break;
+            case 'l': emuOptions.serialLink = optarg; break;
+            case 'o': emuOptions.portOffset = atoi(optarg); break;
+            case 'm': emuOptions.heapSize = strtoul(optarg, NULL, 0); break;
+            default:
+                usage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+    emuOptions.argv = argv;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGUSR1, [](int){ WiFi.emuDropLink(); });
+    setvbuf(stdout, NULL, _IONBF, 0);
+    emuAdoptThread("loopTask", 8192, 1);
+    setup();
+    for (;;){
+        loop();
+        delay(1);
+    }
+}
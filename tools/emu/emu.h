@@ -0,0 +1,23 @@
+#ifndef EMU_H
+    #define EMU_H
+
+    #include <stdint.h>
+
+    // command line of the emulator, shared by the shims
+    struct EmuOptions{
+        const char *prefs;
+        const char *serial;
+        const char *serialLink;
+        uint16_t portOffset;
+        uint32_t heapSize;
+        char **argv;
+    };
+
+    extern EmuOptions emuOptions;
+
+    // registers the calling thread as a FreeRTOS task (main thread, socket tasks)
+    void emuAdoptThread(const char *name, uint32_t stackDepth, unsigned int priority);
+    void emuHeapStart();
+    // listening TCP socket on port + --port-offset, -1 on error
+    int emuListen(uint16_t port, int backlog);
+#endif /* EMU_H */
@@ -0,0 +1,231 @@
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "emu.h"
+
+struct tskTaskControlBlock{
+    char name[configMAX_TASK_NAME_LEN];
+    TaskFunction_t function;
+    void *arg;
+    uint32_t stackDepth;
+    UBaseType_t priority;
+    BaseType_t core;
+    UBaseType_t number;
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifications;
+};
+
+struct QueueDefinition{
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t count;
+};
+
+// task control blocks are never freed: a handle may still be notified after
+// its task was deleted
+static std::mutex registryLock;
+static std::vector<TaskHandle_t> tasks;
+static UBaseType_t taskNumber = 0;
+static thread_local TaskHandle_t currentTask = NULL;
+
+static TaskHandle_t newTask(const char *name, uint32_t stackDepth, UBaseType_t priority, BaseType_t core){
+    auto task = new tskTaskControlBlock();
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    task->name[sizeof(task->name) - 1] = 0;
+    task->function = NULL;
+    task->arg = NULL;
+    task->stackDepth = stackDepth;
+    task->priority = priority;
+    task->core = core;
+    task->notifications = 0;
+    std::lock_guard<std::mutex> guard(registryLock);
+    task->number = ++taskNumber;
+    tasks.push_back(task);
+    return task;
+}
+
+// the thread name shows up in perf, gdb and top -H
+static void enterTask(TaskHandle_t task){
+    currentTask = task;
+    pthread_setname_np(pthread_self(), task->name);
+}
+
+void emuAdoptThread(const char *name, uint32_t stackDepth, unsigned int priority){
+    enterTask(newTask(name, stackDepth, priority, tskNO_AFFINITY));
+}
+
+static TaskHandle_t self(){
+    if (!currentTask){
+        char name[configMAX_TASK_NAME_LEN];
+        if (pthread_getname_np(pthread_self(), name, sizeof(name)) != 0) strcpy(name, "thread");
+        emuAdoptThread(name, 0, 1);
+    }
+    return currentTask;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core){
+    auto task = newTask(name, stackDepth, priority, core);
+    task->function = function;
+    task->arg = arg;
+    if (handle) *handle = task;
+    std::thread([task](){
+        enterTask(task);
+        task->function(task->arg);
+        // a FreeRTOS task must not return
+        fprintf(stderr, "[emu] task %s returned\n", task->name);
+        abort();
+    }).detach();
+    return pdPASS;
+}
+
+// only the calling task can really end, others are just no longer listed
+void vTaskDelete(TaskHandle_t task){
+    auto current = self();
+    if (!task) task = current;
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        for (auto it = tasks.begin(); it != tasks.end(); ++it){
+            if (*it == task){
+                tasks.erase(it);
+                break;
+            }
+        }
+    }
+    if (task == current) pthread_exit(NULL);
+    fprintf(stderr, "[emu] vTaskDelete(%s) from another task: the thread keeps running\n", task->name);
+}
+
+void vTaskDelay(TickType_t ticks){
+    if (ticks == 0) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment){
+    *previousWake += increment;
+    auto remaining = (int32_t)(*previousWake - xTaskGetTickCount());
+    if (remaining > 0) std::this_thread::sleep_for(std::chrono::milliseconds(remaining));
+}
+
+TickType_t xTaskGetTickCount(){
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(){
+    return self();
+}
+
+char *pcTaskGetName(TaskHandle_t task){
+    return (task ? task : self())->name;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(){
+    std::lock_guard<std::mutex> guard(registryLock);
+    return tasks.size();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task){
+    return (task ? task : self())->stackDepth;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *totalRunTime){
+    auto current = self();
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (size < tasks.size()) return 0;
+    for (size_t i = 0; i < tasks.size(); i++){
+        auto task = tasks[i];
+        status[i].xHandle = task;
+        status[i].pcTaskName = task->name;
+        status[i].xTaskNumber = task->number;
+        status[i].eCurrentState = task == current ? eRunning : eBlocked;
+        status[i].uxCurrentPriority = task->priority;
+        status[i].uxBasePriority = task->priority;
+        status[i].ulRunTimeCounter = 0;
+        status[i].pxStackBase = NULL;
+        status[i].usStackHighWaterMark = task->stackDepth;
+        status[i].xCoreID = task->core;
+    }
+    if (totalRunTime) *totalRunTime = 0;
+    return tasks.size();
+}
+
+BaseType_t xPortGetCoreID(){
+    auto core = self()->core;
+    return core == tskNO_AFFINITY ? 0 : core;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks){
+    auto task = self();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto notified = [task](){ return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) task->wake.wait(guard, notified);
+    else task->wake.wait_for(guard, std::chrono::milliseconds(ticks), notified);
+    auto value = task->notifications;
+    if (value) task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task){
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->wake.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken){
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+// no priority inheritance, no recursion: enough for the bus lock
+SemaphoreHandle_t xSemaphoreCreateMutex(){
+    auto semaphore = new QueueDefinition();
+    semaphore->count = 1;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(){
+    auto semaphore = new QueueDefinition();
+    semaphore->count = 0;
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks){
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    auto available = [semaphore](){ return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) semaphore->wake.wait(guard, available);
+    else if (!semaphore->wake.wait_for(guard, std::chrono::milliseconds(ticks), available)) return pdFALSE;
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count > 0) return pdFALSE;
+        semaphore->count = 1;
+    }
+    semaphore->wake.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore){
+    delete semaphore;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux){
+    while (__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE)){
+        sched_yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux){
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "emu.h"
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+static speed_t toSpeed(unsigned long baud){
+    switch (baud){
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default:
+            fprintf(stderr, "[emu] %lu baud not supported by termios, using 9600\n", baud);
+            return B9600;
+    }
+}
+
+// raw mode with the frame format of an ESP32 SERIAL_xxx config value
+static void configure(int fd, unsigned long baud, uint32_t config){
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) return;
+    cfmakeraw(&tty);
+    cfsetspeed(&tty, toSpeed(baud));
+    static const tcflag_t sizes[] = {CS5, CS6, CS7, CS8};
+    tty.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB);
+    tty.c_cflag |= sizes[(config & 0xc) >> 2] | CLOCAL | CREAD;
+    if (config & 0x2) tty.c_cflag |= PARENB;
+    if ((config & 0x3) == 0x3) tty.c_cflag |= PARODD;
+    if (((config & 0x30) >> 4) == 3) tty.c_cflag |= CSTOPB;
+    tcsetattr(fd, TCSANOW, &tty);
+}
+
+HardwareSerial::HardwareSerial(int uart)
+    :_uart(uart)
+    ,_rxFd(-1)
+    ,_txFd(-1)
+    ,_rxBufferSize(256)
+    ,_peeked(-1)
+    ,_watcher(NULL)
+{}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin, bool invert, unsigned long timeout){
+    if (_uart == 0){
+        _rxFd = STDIN_FILENO;
+        _txFd = STDOUT_FILENO;
+        return;
+    }
+    if (_txFd >= 0) end();
+    if (emuOptions.serial){
+        _txFd = open(emuOptions.serial, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (_txFd < 0){
+            fprintf(stderr, "[emu] Serial%d: cannot open %s: %s\n", _uart, emuOptions.serial, strerror(errno));
+            return;
+        }
+        configure(_txFd, baud, config);
+        _rxFd = -1;
+        fprintf(stderr, "[emu] Serial%d on %s\n", _uart, emuOptions.serial);
+        return;
+    }
+    _txFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (_txFd < 0 || grantpt(_txFd) != 0 || unlockpt(_txFd) != 0){
+        fprintf(stderr, "[emu] Serial%d: no pty: %s\n", _uart, strerror(errno));
+        return;
+    }
+    fcntl(_txFd, F_SETFL, O_NONBLOCK);
+    auto slave = ptsname(_txFd);
+    // keep the slave side open ourselves, otherwise the master sees EIO/hang-ups
+    // whenever the attached slave simulator restarts
+    _rxFd = open(slave, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    configure(_rxFd, baud, config);
+    if (emuOptions.serialLink){
+        unlink(emuOptions.serialLink);
+        if (symlink(slave, emuOptions.serialLink) != 0){
+            fprintf(stderr, "[emu] Serial%d: cannot link %s: %s\n", _uart, emuOptions.serialLink, strerror(errno));
+        }
+    }
+    fprintf(stderr, "[emu] Serial%d on %s%s%s\n", _uart, slave, emuOptions.serialLink ? " -> " : "", emuOptions.serialLink ? emuOptions.serialLink : "");
+}
+
+void HardwareSerial::end(){
+    if (_uart == 0) return;
+    if (_txFd >= 0) close(_txFd);
+    if (_rxFd >= 0) close(_rxFd);
+    _txFd = -1;
+    _rxFd = -1;
+    _peeked = -1;
+}
+
+// the tty (or pty) buffer is the rx buffer
+size_t HardwareSerial::setRxBufferSize(size_t size){
+    _rxBufferSize = size;
+    return size;
+}
+
+int HardwareSerial::available(){
+    // the console reads stdin, the other UARTs read from the master/device fd
+    int fd = _uart == 0 ? _rxFd : _txFd;
+    int count = 0;
+    if (fd < 0 || ioctl(fd, FIONREAD, &count) != 0) count = 0;
+    return count + (_peeked >= 0 ? 1 : 0);
+}
+
+int HardwareSerial::peek(){
+    if (_peeked < 0) _peeked = read();
+    return _peeked;
+}
+
+int HardwareSerial::read(){
+    if (_peeked >= 0){
+        auto value = _peeked;
+        _peeked = -1;
+        return value;
+    }
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size){
+    size_t count = 0;
+    if (size > 0 && _peeked >= 0){
+        buffer[count++] = _peeked;
+        _peeked = -1;
+    }
+    int fd = _uart == 0 ? _rxFd : _txFd;
+    // never block, and never switch the shared console to non-blocking mode
+    size_t waiting = available();
+    if (fd < 0 || count >= size || waiting == 0) return count;
+    auto len = ::read(fd, buffer + count, min(size - count, waiting));
+    return len > 0 ? count + len : count;
+}
+
+size_t HardwareSerial::write(uint8_t value){
+    return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size){
+    size_t written = 0;
+    while (_txFd >= 0 && written < size){
+        auto len = ::write(_txFd, buffer + written, size - written);
+        if (len > 0){
+            written += len;
+            continue;
+        }
+        if (len < 0 && errno != EAGAIN && errno != EINTR) break;
+        // nobody reads the pty: drop the rest after a while like a full UART fifo would stall
+        struct pollfd fd = {_txFd, POLLOUT, 0};
+        if (poll(&fd, 1, 100) <= 0) break;
+    }
+    return written;
+}
+
+void HardwareSerial::flush(){
+    if (_uart != 0 && _txFd >= 0) tcdrain(_txFd);
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout){
+    _onReceive = function;
+    if (_onReceive && !_watcher) _watcher = new std::thread(&HardwareSerial::watch, this);
+}
+
+// a tty has no rx timeout: report a byte count that stopped growing for 1 ms
+void HardwareSerial::watch(){
+    int last = 0;
+    bool reported = false;
+    for (;;){
+        usleep(500);
+        int fd = _uart == 0 ? _rxFd : _txFd;
+        int count = 0;
+        if (fd < 0 || ioctl(fd, FIONREAD, &count) != 0) count = 0;
+        if (count != last) reported = false;
+        else if (count > 0 && !reported){
+            usleep(500);
+            _onReceive();
+            reported = true;
+        }
+        last = count;
+    }
+}
@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <malloc.h>
+#include <mutex>
+#include "emu.h"
+
+static size_t baseline = 0;
+static size_t minimumFree = SIZE_MAX;
+static std::mutex heapLock;
+
+// whatever the C++ runtime allocated before main() is not part of the model
+void emuHeapStart(){
+    baseline = mallinfo2().uordblks;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps){
+    return emuOptions.heapSize;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps){
+    size_t used = mallinfo2().uordblks;
+    used = used > baseline ? used - baseline : 0;
+    size_t free = used < emuOptions.heapSize ? emuOptions.heapSize - used : 0;
+    std::lock_guard<std::mutex> guard(heapLock);
+    minimumFree = min(minimumFree, free);
+    return free;
+}
+
+// only as low as seen by the calls above, glibc keeps no low water mark
+size_t heap_caps_get_minimum_free_size(uint32_t caps){
+    auto free = heap_caps_get_free_size(caps);
+    std::lock_guard<std::mutex> guard(heapLock);
+    return min(minimumFree, free);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps){
+    return heap_caps_get_free_size(caps);
+}
+
+esp_err_t heap_caps_register_failed_alloc_callback(esp_alloc_failed_hook_t callback){
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef EMU_ARDUINO_H
+    #define EMU_ARDUINO_H
+
+    // Host emulation of the ESP32 Arduino core, just enough of it to build the
+    // firmware sources unchanged as a Linux process (see "Host emulation" in README.md)
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <stdlib.h>
+    #include <stdio.h>
+    #include <string.h>
+    #include <math.h>
+    #include <algorithm>
+    #include <cmath>
+
+    #include "freertos/FreeRTOS.h"
+    #include "esp_system.h"
+    #include "esp_timer.h"
+    #include "WString.h"
+    #include "Print.h"
+    #include "Stream.h"
+    #include "IPAddress.h"
+    #include "Client.h"
+    #include "HardwareSerial.h"
+    #include "Esp.h"
+
+    using std::abs;
+    using std::max;
+    using std::min;
+
+    #define ARDUINO 10819
+    #define ARDUINO_ARCH_ESP32 1
+    #define ESP32 1
+    #define EMU 1
+
+    #define IRAM_ATTR
+    #define PROGMEM
+    #define F(text) (text)
+    #define PSTR(text) (text)
+    #define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+    #define LOW 0x0
+    #define HIGH 0x1
+    #define INPUT 0x01
+    #define OUTPUT 0x03
+    #define PULLUP 0x04
+    #define INPUT_PULLUP 0x05
+    #define PULLDOWN 0x08
+    #define INPUT_PULLDOWN 0x09
+    #define RISING 0x01
+    #define FALLING 0x02
+    #define CHANGE 0x03
+
+    unsigned long millis();
+    unsigned long micros();
+    void delay(uint32_t ms);
+    void delayMicroseconds(uint32_t us);
+    void yield();
+
+    // pins only keep their level, inputs with pull-up read HIGH
+    void pinMode(uint8_t pin, uint8_t mode);
+    void digitalWrite(uint8_t pin, uint8_t value);
+    int digitalRead(uint8_t pin);
+    #define digitalPinToInterrupt(pin) (pin)
+    void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+    void detachInterrupt(uint8_t pin);
+
+    void setup();
+    void loop();
+#endif /* EMU_ARDUINO_H */
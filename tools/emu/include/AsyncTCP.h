@@ -0,0 +1,6 @@
+#ifndef EMU_ASYNCTCP_H
+    #define EMU_ASYNCTCP_H
+
+    // the web server shim runs its own socket task, nothing to declare here
+    #include <Arduino.h>
+#endif /* EMU_ASYNCTCP_H */
@@ -0,0 +1,189 @@
+#ifndef EMU_ESPASYNCWEBSERVER_H
+    #define EMU_ESPASYNCWEBSERVER_H
+
+    #include <Arduino.h>
+    #include <functional>
+    #include <memory>
+    #include <vector>
+
+    // ESPAsyncWebServer on a POSIX socket. One "async_tcp" task accepts and
+    // serves connections one at a time, handlers run in that task like they run
+    // in the AsyncTCP task on the device. Every response closes the connection,
+    // authentication is HTTP basic only.
+
+    typedef enum{
+        HTTP_GET = 0b00000001,
+        HTTP_POST = 0b00000010,
+        HTTP_DELETE = 0b00000100,
+        HTTP_PUT = 0b00001000,
+        HTTP_PATCH = 0b00010000,
+        HTTP_HEAD = 0b00100000,
+        HTTP_OPTIONS = 0b01000000,
+        HTTP_ANY = 0b01111111
+    } WebRequestMethod;
+    typedef uint8_t WebRequestMethodComposite;
+
+    class AsyncWebServerRequest;
+    class AsyncWebServer;
+
+    typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+    typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+    typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+    typedef std::function<bool(AsyncWebServerRequest *request)> ArRequestFilterFunction;
+    typedef std::function<void(void)> ArDisconnectHandler;
+    // fills up to maxLen bytes at offset index of the body, 0 ends it
+    typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+    class AsyncWebParameter{
+        private:
+            String _name;
+            String _value;
+            size_t _size;
+            bool _isForm;
+            bool _isFile;
+        public:
+            AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false, size_t size = 0)
+                :_name(name)
+                ,_value(value)
+                ,_size(size)
+                ,_isForm(form)
+                ,_isFile(file)
+            {}
+            const String &name() const{ return _name; }
+            const String &value() const{ return _value; }
+            size_t size() const{ return _size; }
+            bool isPost() const{ return _isForm; }
+            bool isFile() const{ return _isFile; }
+    };
+
+    class AsyncWebHeader{
+        private:
+            String _name;
+            String _value;
+        public:
+            AsyncWebHeader(const String &name, const String &value):_name(name), _value(value){}
+            const String &name() const{ return _name; }
+            const String &value() const{ return _value; }
+    };
+
+    class AsyncWebServerResponse{
+        friend class AsyncWebServerRequest;
+        protected:
+            int _code;
+            String _contentType;
+            String _content;
+            std::vector<AsyncWebHeader> _headers;
+            AwsResponseFiller _filler;
+        public:
+            AsyncWebServerResponse(int code = 200, const String &contentType = String(), const String &content = String())
+                :_code(code)
+                ,_contentType(contentType)
+                ,_content(content)
+            {}
+            virtual ~AsyncWebServerResponse(){}
+            void setCode(int code){ _code = code; }
+            void setContentType(const String &type){ _contentType = type; }
+            void addHeader(const String &name, const String &value){ _headers.push_back(AsyncWebHeader(name, value)); }
+    };
+
+    class AsyncResponseStream: public AsyncWebServerResponse, public Print{
+        public:
+            AsyncResponseStream(const String &contentType, size_t bufferSize)
+                :AsyncWebServerResponse(200, contentType)
+            {
+                _content.reserve(bufferSize);
+            }
+            size_t write(uint8_t value) override{ _content.concat((char)value); return 1; }
+            size_t write(const uint8_t *buffer, size_t size) override{ _content.concat((const char*)buffer, size); return size; }
+            using Print::write;
+    };
+
+    class AsyncWebServerRequest{
+        friend class AsyncWebServer;
+        private:
+            int _fd;
+            WebRequestMethodComposite _method;
+            String _url;
+            std::vector<AsyncWebParameter> _params;
+            std::vector<AsyncWebHeader> _headers;
+            ArDisconnectHandler _onDisconnect;
+            bool _sent;
+            void addParams(const String &text, bool post);
+        public:
+            // handler state across body chunks, released with free() like the library does
+            void *_tempObject;
+            AsyncWebServerRequest(int fd);
+            ~AsyncWebServerRequest();
+            WebRequestMethodComposite method() const{ return _method; }
+            const String &url() const{ return _url; }
+            String methodToString() const;
+
+            size_t params() const{ return _params.size(); }
+            bool hasParam(const String &name, bool post = false, bool file = false) const;
+            AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+            AsyncWebParameter *getParam(size_t index) const;
+            bool hasArg(const char *name) const;
+            const String &arg(const String &name) const;
+
+            size_t headers() const{ return _headers.size(); }
+            bool hasHeader(const String &name) const;
+            AsyncWebHeader *getHeader(const String &name) const;
+            AsyncWebHeader *getHeader(size_t index) const;
+
+            bool authenticate(const char *username, const char *password, const char *realm = NULL, bool passwordIsHash = false);
+            void requestAuthentication(const char *realm = NULL, bool isDigest = true);
+
+            AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+            AsyncResponseStream *beginResponseStream(const String &contentType, size_t bufferSize = 1460);
+            AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller callback);
+            // written to the socket right away, so a handler may restart afterwards
+            void send(AsyncWebServerResponse *response);
+            void send(int code, const String &contentType = String(), const String &content = String());
+            void redirect(const String &url);
+            void onDisconnect(ArDisconnectHandler handler){ _onDisconnect = handler; }
+    };
+
+    class AsyncWebHandler{
+        protected:
+            ArRequestFilterFunction _filter;
+        public:
+            virtual ~AsyncWebHandler(){}
+            AsyncWebHandler &setFilter(ArRequestFilterFunction filter){ _filter = filter; return *this; }
+            bool filter(AsyncWebServerRequest *request){ return !_filter || _filter(request); }
+    };
+
+    class AsyncCallbackWebHandler: public AsyncWebHandler{
+        friend class AsyncWebServer;
+        private:
+            String _uri;
+            WebRequestMethodComposite _method;
+            ArRequestHandlerFunction _onRequest;
+            ArUploadHandlerFunction _onUpload;
+            ArBodyHandlerFunction _onBody;
+        public:
+            AsyncCallbackWebHandler():_method(HTTP_ANY){}
+            bool canHandle(AsyncWebServerRequest *request);
+    };
+
+    class AsyncWebServer{
+        private:
+            uint16_t _port;
+            int _fd;
+            TaskHandle_t _task;
+            std::vector<std::unique_ptr<AsyncCallbackWebHandler>> _handlers;
+            ArRequestHandlerFunction _notFound;
+            static void task(void *arg);
+            void serve(int fd);
+        public:
+            AsyncWebServer(uint16_t port);
+            ~AsyncWebServer();
+            void begin();
+            void end();
+            AsyncCallbackWebHandler &on(const char *uri, ArRequestHandlerFunction onRequest);
+            AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+            AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload);
+            AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
+            void onNotFound(ArRequestHandlerFunction handler){ _notFound = handler; }
+            void reset();
+    };
+#endif /* EMU_ESPASYNCWEBSERVER_H */
@@ -0,0 +1,25 @@
+#ifndef EMU_ESP_H
+    #define EMU_ESP_H
+
+    #include <stdint.h>
+
+    class EspClass{
+        public:
+            uint32_t getHeapSize();
+            uint32_t getFreeHeap();
+            uint32_t getMinFreeHeap();
+            uint32_t getMaxAllocHeap();
+            uint8_t getChipRevision(){ return 3; }
+            const char *getChipModel(){ return "ESP32-EMU"; }
+            uint32_t getCpuFreqMHz(){ return 240; }
+            const char *getSdkVersion(){ return "emu"; }
+            uint32_t getSketchSize(){ return 0; }
+            uint32_t getFreeSketchSpace(){ return 0; }
+            uint64_t getEfuseMac();
+            // re-executes the emulator with the same arguments (settings survive
+            // in the preferences file, just like a reboot)
+            [[noreturn]] void restart();
+    };
+
+    extern EspClass ESP;
+#endif /* EMU_ESP_H */
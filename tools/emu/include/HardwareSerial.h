@@ -0,0 +1,70 @@
+#ifndef EMU_HARDWARESERIAL_H
+    #define EMU_HARDWARESERIAL_H
+
+    #include <functional>
+    #include <thread>
+    #include "Stream.h"
+
+    #define SERIAL_5N1 0x8000010
+    #define SERIAL_6N1 0x8000014
+    #define SERIAL_7N1 0x8000018
+    #define SERIAL_8N1 0x800001c
+    #define SERIAL_5N2 0x8000030
+    #define SERIAL_6N2 0x8000034
+    #define SERIAL_7N2 0x8000038
+    #define SERIAL_8N2 0x800003c
+    #define SERIAL_5E1 0x8000012
+    #define SERIAL_6E1 0x8000016
+    #define SERIAL_7E1 0x800001a
+    #define SERIAL_8E1 0x800001e
+    #define SERIAL_5E2 0x8000032
+    #define SERIAL_6E2 0x8000036
+    #define SERIAL_7E2 0x800003a
+    #define SERIAL_8E2 0x800003e
+    #define SERIAL_5O1 0x8000013
+    #define SERIAL_6O1 0x8000017
+    #define SERIAL_7O1 0x800001b
+    #define SERIAL_8O1 0x800001f
+    #define SERIAL_5O2 0x8000033
+    #define SERIAL_6O2 0x8000037
+    #define SERIAL_7O2 0x800003b
+    #define SERIAL_8O2 0x800003f
+
+    // UART0 is the console (stdin/stdout). The other UARTs open the tty given
+    // on the command line or, by default, a new pseudo terminal whose slave
+    // side a Modbus slave (simulator, socat, a real adapter) can attach to.
+    typedef std::function<void(void)> OnReceiveCb;
+
+    class HardwareSerial: public Stream{
+        private:
+            int _uart;
+            int _rxFd;
+            int _txFd;
+            size_t _rxBufferSize;
+            int _peeked;
+            OnReceiveCb _onReceive;
+            std::thread *_watcher;
+            void watch();
+        public:
+            HardwareSerial(int uart);
+            void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false, unsigned long timeout = 20000UL);
+            void end();
+            size_t setRxBufferSize(size_t size);
+            int available() override;
+            int peek() override;
+            int read() override;
+            size_t read(uint8_t *buffer, size_t size);
+            size_t write(uint8_t value) override;
+            size_t write(const uint8_t *buffer, size_t size) override;
+            using Print::write;
+            void flush() override;
+            // called once the line has been idle for a moment after receiving,
+            // like the UART rx timeout (onlyOnTimeout is always true here)
+            void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+            operator bool() const{ return _txFd >= 0; }
+    };
+
+    extern HardwareSerial Serial;
+    extern HardwareSerial Serial1;
+    extern HardwareSerial Serial2;
+#endif /* EMU_HARDWARESERIAL_H */
@@ -0,0 +1,32 @@
+#ifndef EMU_IPADDRESS_H
+    #define EMU_IPADDRESS_H
+
+    #include <stdint.h>
+    #include "Print.h"
+
+    // IPv4 address, stored in network order like the ESP32 core: the uint32_t
+    // value has the first octet in the low byte
+    class IPAddress: public Printable{
+        private:
+            union{
+                uint8_t bytes[4];
+                uint32_t dword;
+            } _address;
+        public:
+            IPAddress(){ _address.dword = 0; }
+            IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+            IPAddress(uint32_t address){ _address.dword = address; }
+            IPAddress(const uint8_t *address);
+            bool fromString(const char *address);
+            bool fromString(const String &address){ return fromString(address.c_str()); }
+            operator uint32_t() const{ return _address.dword; }
+            bool operator==(const IPAddress &other) const{ return _address.dword == other._address.dword; }
+            bool operator!=(const IPAddress &other) const{ return _address.dword != other._address.dword; }
+            uint8_t operator[](int index) const{ return _address.bytes[index]; }
+            uint8_t &operator[](int index){ return _address.bytes[index]; }
+            String toString() const;
+            size_t printTo(Print &out) const override;
+    };
+
+    extern const IPAddress INADDR_NONE;
+#endif /* EMU_IPADDRESS_H */
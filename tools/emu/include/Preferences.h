@@ -0,0 +1,60 @@
+#ifndef EMU_PREFERENCES_H
+    #define EMU_PREFERENCES_H
+
+    #include <Arduino.h>
+
+    // NVS on a text file (--prefs, default gateway.prefs), one "namespace key
+    // type value" line per entry, rewritten on every put. Like NVS, keys are at
+    // most 15 characters and a value read back with another type than it was
+    // stored with returns the default, both reported on stderr. Blobs are
+    // stored as hex.
+    class Preferences{
+        private:
+            String _namespace;
+            bool _readOnly;
+            bool _started;
+            bool get(const char *key, char type, String &value);
+            size_t put(const char *key, char type, const String &value);
+        public:
+            Preferences();
+            bool begin(const char *name, bool readOnly = false, const char *partition = NULL);
+            void end();
+            bool clear();
+            bool remove(const char *key);
+            bool isKey(const char *key);
+
+            size_t putChar(const char *key, int8_t value);
+            size_t putUChar(const char *key, uint8_t value);
+            size_t putShort(const char *key, int16_t value);
+            size_t putUShort(const char *key, uint16_t value);
+            size_t putInt(const char *key, int32_t value);
+            size_t putUInt(const char *key, uint32_t value);
+            size_t putLong(const char *key, int32_t value);
+            size_t putULong(const char *key, uint32_t value);
+            size_t putLong64(const char *key, int64_t value);
+            size_t putULong64(const char *key, uint64_t value);
+            size_t putFloat(const char *key, float value);
+            size_t putDouble(const char *key, double value);
+            size_t putBool(const char *key, bool value);
+            size_t putString(const char *key, const char *value);
+            size_t putString(const char *key, String value);
+            size_t putBytes(const char *key, const void *value, size_t len);
+
+            int8_t getChar(const char *key, int8_t defaultValue = 0);
+            uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+            int16_t getShort(const char *key, int16_t defaultValue = 0);
+            uint16_t getUShort(const char *key, uint16_t defaultValue = 0);
+            int32_t getInt(const char *key, int32_t defaultValue = 0);
+            uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+            int32_t getLong(const char *key, int32_t defaultValue = 0);
+            uint32_t getULong(const char *key, uint32_t defaultValue = 0);
+            int64_t getLong64(const char *key, int64_t defaultValue = 0);
+            uint64_t getULong64(const char *key, uint64_t defaultValue = 0);
+            float getFloat(const char *key, float defaultValue = NAN);
+            double getDouble(const char *key, double defaultValue = NAN);
+            bool getBool(const char *key, bool defaultValue = false);
+            String getString(const char *key, String defaultValue = String());
+            size_t getBytesLength(const char *key);
+            size_t getBytes(const char *key, void *buf, size_t maxLen);
+    };
+#endif /* EMU_PREFERENCES_H */
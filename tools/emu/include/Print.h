@@ -0,0 +1,47 @@
+#ifndef EMU_PRINT_H
+    #define EMU_PRINT_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string.h>
+    #include "WString.h"
+
+    class Print;
+
+    class Printable{
+        public:
+            virtual ~Printable(){}
+            virtual size_t printTo(Print &out) const = 0;
+    };
+
+    class Print{
+        private:
+            size_t printNumber(unsigned long long value, uint8_t base);
+        public:
+            virtual ~Print(){}
+            virtual size_t write(uint8_t value) = 0;
+            virtual size_t write(const uint8_t *buffer, size_t size);
+            size_t write(const char *text){ return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+            size_t write(const char *buffer, size_t size){ return write((const uint8_t*)buffer, size); }
+            virtual int availableForWrite(){ return 0; }
+            virtual void flush(){}
+
+            size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+            size_t print(const String &value){ return write(value.c_str(), value.length()); }
+            size_t print(const char value[]){ return write(value); }
+            size_t print(char value){ return write((uint8_t)value); }
+            size_t print(unsigned char value, int base = DEC){ return print((unsigned long long)value, base); }
+            size_t print(int value, int base = DEC){ return print((long long)value, base); }
+            size_t print(unsigned int value, int base = DEC){ return print((unsigned long long)value, base); }
+            size_t print(long value, int base = DEC){ return print((long long)value, base); }
+            size_t print(unsigned long value, int base = DEC){ return print((unsigned long long)value, base); }
+            size_t print(long long value, int base = DEC);
+            size_t print(unsigned long long value, int base = DEC);
+            size_t print(double value, int digits = 2);
+            size_t print(const Printable &value){ return value.printTo(*this); }
+
+            size_t println(){ return write("\r\n"); }
+            template <typename T> size_t println(const T &value){ auto n = print(value); return n + println(); }
+            template <typename T> size_t println(const T &value, int format){ auto n = print(value, format); return n + println(); }
+    };
+#endif /* EMU_PRINT_H */
@@ -0,0 +1,54 @@
+#ifndef EMU_PUBSUBCLIENT_H
+    #define EMU_PUBSUBCLIENT_H
+
+    #include <Arduino.h>
+    #include <Client.h>
+
+    #define MQTT_KEEPALIVE 15
+    #define MQTT_SOCKET_TIMEOUT 15
+
+    #define MQTT_CONNECTION_TIMEOUT -4
+    #define MQTT_CONNECTION_LOST -3
+    #define MQTT_CONNECT_FAILED -2
+    #define MQTT_DISCONNECTED -1
+    #define MQTT_CONNECTED 0
+    #define MQTT_CONNECT_BAD_PROTOCOL 1
+    #define MQTT_CONNECT_BAD_CLIENT_ID 2
+    #define MQTT_CONNECT_UNAVAILABLE 3
+    #define MQTT_CONNECT_BAD_CREDENTIALS 4
+    #define MQTT_CONNECT_UNAUTHORIZED 5
+
+    // MQTT 3.1.1 publisher with the PubSubClient API the firmware uses:
+    // connect with last will, QoS 0 publish, keepalive. Incoming packets other
+    // than CONNACK are read and dropped (the gateway subscribes to nothing).
+    class PubSubClient{
+        private:
+            Client *_client;
+            // not copied, like the library: the caller keeps the string alive
+            const char *_host;
+            uint16_t _port;
+            uint8_t *_buffer;
+            uint16_t _bufferSize;
+            int _state;
+            unsigned long _lastOutActivity;
+            unsigned long _lastInActivity;
+            bool _pingOutstanding;
+            size_t writeString(const char *text, size_t pos);
+            bool sendPacket(uint8_t header, size_t length);
+            bool readPacket(uint8_t &header, size_t &length, unsigned long timeout);
+        public:
+            PubSubClient(Client &client);
+            ~PubSubClient();
+            PubSubClient &setServer(const char *host, uint16_t port);
+            bool setBufferSize(uint16_t size);
+            uint16_t getBufferSize(){ return _bufferSize; }
+            bool connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession = true);
+            bool connect(const char *id){ return connect(id, NULL, NULL, NULL, 0, false, NULL); }
+            void disconnect();
+            bool publish(const char *topic, const char *payload, bool retained = false);
+            bool publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained = false);
+            bool loop();
+            bool connected();
+            int state(){ return _state; }
+    };
+#endif /* EMU_PUBSUBCLIENT_H */
@@ -0,0 +1,20 @@
+#ifndef EMU_STREAM_H
+    #define EMU_STREAM_H
+
+    #include "Print.h"
+
+    class Stream: public Print{
+        protected:
+            unsigned long _timeout;
+        public:
+            Stream():_timeout(1000){}
+            virtual int available() = 0;
+            virtual int read() = 0;
+            virtual int peek() = 0;
+            void setTimeout(unsigned long timeout){ _timeout = timeout; }
+            // waits up to the timeout for each byte, like the ESP32 core
+            size_t readBytes(char *buffer, size_t length);
+            size_t readBytes(uint8_t *buffer, size_t length){ return readBytes((char*)buffer, length); }
+            String readString();
+    };
+#endif /* EMU_STREAM_H */
@@ -0,0 +1,30 @@
+#ifndef EMU_UPDATE_H
+    #define EMU_UPDATE_H
+
+    #include <Arduino.h>
+
+    #define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+    #define U_FLASH 0
+    #define U_SPIFFS 100
+    #define U_AUTH 200
+
+    // OTA: images are received and counted, there is no flash to write them to
+    class UpdateClass{
+        private:
+            size_t _size;
+            size_t _progress;
+            bool _running;
+        public:
+            UpdateClass():_size(0), _progress(0), _running(false){}
+            bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = LOW, const char *label = NULL);
+            size_t write(uint8_t *data, size_t len);
+            bool end(bool evenIfRemaining = false);
+            bool setMD5(const char *md5){ return true; }
+            bool hasError(){ return false; }
+            bool isRunning(){ return _running; }
+            size_t progress(){ return _progress; }
+            void printError(Print &out){ out.println("No Error"); }
+    };
+
+    extern UpdateClass Update;
+#endif /* EMU_UPDATE_H */
@@ -0,0 +1,93 @@
+#ifndef EMU_WSTRING_H
+    #define EMU_WSTRING_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string>
+    #include <type_traits>
+
+    #define DEC 10
+    #define HEX 16
+    #define OCT 8
+    #define BIN 2
+
+    // Arduino String on top of std::string, same API subset as the ESP32 core
+    class String{
+        private:
+            std::string _buffer;
+        public:
+            String(){}
+            String(const char *value):_buffer(value ? value : ""){}
+            String(const char *value, size_t len):_buffer(value ? value : "", value ? len : 0){}
+            explicit String(const std::string &value):_buffer(value){}
+            explicit String(char value):_buffer(1, value){}
+            explicit String(unsigned char value, unsigned char base = DEC);
+            explicit String(int value, unsigned char base = DEC);
+            explicit String(unsigned int value, unsigned char base = DEC);
+            explicit String(long value, unsigned char base = DEC);
+            explicit String(unsigned long value, unsigned char base = DEC);
+            explicit String(long long value, unsigned char base = DEC);
+            explicit String(unsigned long long value, unsigned char base = DEC);
+            explicit String(float value, unsigned int decimals = 2);
+            explicit String(double value, unsigned int decimals = 2);
+
+            bool reserve(unsigned int size){ _buffer.reserve(size); return true; }
+            unsigned int length() const{ return _buffer.length(); }
+            bool isEmpty() const{ return _buffer.empty(); }
+            const char *c_str() const{ return _buffer.c_str(); }
+            char *begin(){ return &_buffer[0]; }
+            char *end(){ return &_buffer[0] + _buffer.length(); }
+
+            bool concat(const String &value){ _buffer += value._buffer; return true; }
+            bool concat(const char *value){ if (value) _buffer += value; return value != NULL; }
+            bool concat(const char *value, unsigned int len){ if (value) _buffer.append(value, len); return value != NULL; }
+            bool concat(char value){ _buffer += value; return true; }
+            template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+            bool concat(T value){ return concat(String(value)); }
+            template <typename T> String &operator+=(const T &value){ concat(value); return *this; }
+
+            bool equals(const String &other) const{ return _buffer == other._buffer; }
+            bool equals(const char *other) const{ return _buffer == (other ? other : ""); }
+            bool equalsIgnoreCase(const String &other) const;
+            bool startsWith(const String &prefix) const{ return _buffer.compare(0, prefix.length(), prefix._buffer) == 0; }
+            bool endsWith(const String &suffix) const;
+            bool operator==(const String &other) const{ return equals(other); }
+            bool operator==(const char *other) const{ return equals(other); }
+            bool operator!=(const String &other) const{ return !equals(other); }
+            bool operator!=(const char *other) const{ return !equals(other); }
+            bool operator<(const String &other) const{ return _buffer < other._buffer; }
+
+            char charAt(unsigned int index) const{ return index < length() ? _buffer[index] : 0; }
+            void setCharAt(unsigned int index, char value){ if (index < length()) _buffer[index] = value; }
+            char operator[](unsigned int index) const{ return charAt(index); }
+            char &operator[](unsigned int index){ return _buffer[index]; }
+            void getBytes(unsigned char *buffer, unsigned int size, unsigned int index = 0) const;
+            void toCharArray(char *buffer, unsigned int size, unsigned int index = 0) const{ getBytes((unsigned char*)buffer, size, index); }
+
+            int indexOf(char value, unsigned int from = 0) const;
+            int indexOf(const String &value, unsigned int from = 0) const;
+            int lastIndexOf(char value) const;
+            int lastIndexOf(const String &value) const;
+            String substring(unsigned int from) const;
+            String substring(unsigned int from, unsigned int to) const;
+
+            void replace(char find, char replace);
+            void replace(const String &find, const String &replace);
+            void remove(unsigned int index);
+            void remove(unsigned int index, unsigned int count);
+            void toLowerCase();
+            void toUpperCase();
+            void trim();
+
+            long toInt() const;
+            float toFloat() const;
+            double toDouble() const;
+    };
+
+    inline String operator+(const String &left, const String &right){ String result(left); result += right; return result; }
+    inline String operator+(const String &left, const char *right){ String result(left); result += right; return result; }
+    inline String operator+(const char *left, const String &right){ String result(left); result += right; return result; }
+    inline String operator+(const String &left, char right){ String result(left); result += right; return result; }
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    String operator+(const String &left, T right){ String result(left); result += String(right); return result; }
+#endif /* EMU_WSTRING_H */
@@ -0,0 +1,86 @@
+#ifndef EMU_WIFI_H
+    #define EMU_WIFI_H
+
+    #include <Arduino.h>
+    #include "WiFiClient.h"
+    #include "WiFiServer.h"
+
+    typedef enum{
+        WIFI_MODE_NULL = 0,
+        WIFI_MODE_STA,
+        WIFI_MODE_AP,
+        WIFI_MODE_APSTA,
+        WIFI_MODE_MAX
+    } wifi_mode_t;
+    #define WIFI_OFF WIFI_MODE_NULL
+    #define WIFI_STA WIFI_MODE_STA
+    #define WIFI_AP WIFI_MODE_AP
+    #define WIFI_AP_STA WIFI_MODE_APSTA
+
+    typedef enum{
+        WL_IDLE_STATUS = 0,
+        WL_NO_SSID_AVAIL = 1,
+        WL_CONNECTED = 3,
+        WL_CONNECT_FAILED = 4,
+        WL_CONNECTION_LOST = 5,
+        WL_DISCONNECTED = 6
+    } wl_status_t;
+
+    typedef enum{
+        WIFI_POWER_19_5dBm = 78,
+        WIFI_POWER_2dBm = 8,
+        WIFI_POWER_MINUS_1dBm = -4
+    } wifi_power_t;
+
+    typedef enum{
+        WIFI_PS_NONE = 0,
+        WIFI_PS_MIN_MODEM,
+        WIFI_PS_MAX_MODEM
+    } wifi_ps_type_t;
+
+    // the host network is "connected" with a fixed SSID and RSSI until the link
+    // is dropped (SIGUSR1). A connect takes 100 ms to a given BSSID and 1500 ms
+    // with a scan, auto reconnect scans too.
+    class WiFiClass{
+        private:
+            wifi_mode_t _mode;
+            volatile bool _linked;
+            bool _autoReconnect;
+            unsigned long _linkAt;
+            bool _sleep;
+            wifi_power_t _txPower;
+            bool _static;
+        public:
+            WiFiClass();
+            bool mode(wifi_mode_t mode){ _mode = mode; return true; }
+            wifi_mode_t getMode(){ return _mode; }
+            wl_status_t status();
+            bool isConnected(){ return status() == WL_CONNECTED; }
+            // INADDR_NONE for local starts the DHCP client
+            bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0, IPAddress dns2 = (uint32_t)0){ _static = (uint32_t)local != 0; return true; }
+            bool emuStatic(){ return _static; }
+            wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+            bool reconnect(){ return true; }
+            bool disconnect(bool wifiOff = false, bool eraseAp = false);
+            bool setAutoReconnect(bool autoReconnect){ _autoReconnect = autoReconnect; return true; }
+            // SIGUSR1: the access point goes away
+            void emuDropLink();
+            void persistent(bool persistent){}
+            bool setSleep(bool enabled){ _sleep = enabled; return true; }
+            bool getSleep(){ return _sleep; }
+            bool setTxPower(wifi_power_t power){ _txPower = power; return true; }
+            wifi_power_t getTxPower(){ return _txPower; }
+            String SSID(){ return "emu"; }
+            String psk(){ return ""; }
+            int8_t RSSI(){ return -50; }
+            int32_t channel(){ return 1; }
+            uint8_t *BSSID(){ static uint8_t bssid[6] = {0x02, 0, 0, 0, 0, 0x01}; return bssid; }
+            String macAddress();
+            IPAddress localIP();
+            IPAddress gatewayIP(){ return IPAddress(127, 0, 0, 1); }
+            IPAddress subnetMask(){ return IPAddress(255, 0, 0, 0); }
+            IPAddress dnsIP(uint8_t index = 0){ return IPAddress(127, 0, 0, 53); }
+    };
+
+    extern WiFiClass WiFi;
+#endif /* EMU_WIFI_H */
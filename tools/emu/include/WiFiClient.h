@@ -0,0 +1,37 @@
+#ifndef EMU_WIFICLIENT_H
+    #define EMU_WIFICLIENT_H
+
+    #include <Arduino.h>
+    #include <memory>
+
+    struct ClientSocket;
+
+    // TCP socket, copies share the connection like on the ESP32 core
+    class WiFiClient: public Client{
+        private:
+            std::shared_ptr<ClientSocket> _socket;
+        public:
+            WiFiClient();
+            explicit WiFiClient(int fd);
+            int connect(IPAddress ip, uint16_t port) override;
+            int connect(const char *host, uint16_t port) override;
+            size_t write(uint8_t value) override;
+            size_t write(const uint8_t *buffer, size_t size) override;
+            using Print::write;
+            int available() override;
+            int read() override;
+            int read(uint8_t *buffer, size_t size) override;
+            int peek() override;
+            void flush() override;
+            void stop() override;
+            uint8_t connected() override;
+            operator bool() override{ return connected(); }
+            int fd() const;
+            int setNoDelay(bool noDelay);
+            int setSocketOption(int option, char *value, size_t size);
+            IPAddress remoteIP() const;
+            uint16_t remotePort() const;
+            IPAddress localIP() const;
+            uint16_t localPort() const;
+    };
+#endif /* EMU_WIFICLIENT_H */
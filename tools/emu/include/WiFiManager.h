@@ -0,0 +1,19 @@
+#ifndef EMU_WIFIMANAGER_H
+    #define EMU_WIFIMANAGER_H
+
+    #include <WiFi.h>
+    #include <functional>
+
+    // the host is already on a network: never opens the configuration portal
+    class WiFiManager{
+        public:
+            void setClass(String name){}
+            void setAPCallback(std::function<void(WiFiManager*)> callback){}
+            void setConfigPortalTimeout(unsigned long seconds){}
+            bool autoConnect(const char *apName = NULL, const char *apPassword = NULL){ WiFi.mode(WIFI_STA); return true; }
+            String getWiFiSSID(bool persistent = true){ return WiFi.SSID(); }
+            String getWiFiPass(bool persistent = true){ return WiFi.psk(); }
+            void erase(){}
+            void resetSettings(){}
+    };
+#endif /* EMU_WIFIMANAGER_H */
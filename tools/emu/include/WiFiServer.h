@@ -0,0 +1,24 @@
+#ifndef EMU_WIFISERVER_H
+    #define EMU_WIFISERVER_H
+
+    #include "WiFiClient.h"
+
+    // listens on port + --port-offset, so the gateway can run without root
+    class WiFiServer{
+        private:
+            uint16_t _port;
+            uint8_t _maxClients;
+            int _fd;
+            bool _noDelay;
+        public:
+            WiFiServer(uint16_t port = 80, uint8_t maxClients = 4);
+            ~WiFiServer();
+            void begin(uint16_t port = 0);
+            void end();
+            WiFiClient accept();
+            WiFiClient available(){ return accept(); }
+            void setNoDelay(bool noDelay){ _noDelay = noDelay; }
+            bool hasClient();
+            operator bool(){ return _fd >= 0; }
+    };
+#endif /* EMU_WIFISERVER_H */
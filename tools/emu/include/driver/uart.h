@@ -0,0 +1,29 @@
+#ifndef EMU_DRIVER_UART_H
+    #define EMU_DRIVER_UART_H
+
+    #include <stdint.h>
+    #include <esp_heap_caps.h>
+
+    #define ESP_OK 0
+    #define UART_PIN_NO_CHANGE (-1)
+
+    typedef enum{
+        UART_NUM_0 = 0,
+        UART_NUM_1,
+        UART_NUM_2,
+        UART_NUM_MAX
+    } uart_port_t;
+
+    typedef enum{
+        UART_MODE_UART = 0,
+        UART_MODE_RS485_HALF_DUPLEX,
+        UART_MODE_IRDA,
+        UART_MODE_RS485_COLLISION_DETECT,
+        UART_MODE_RS485_APP_CTRL
+    } uart_mode_t;
+
+    // a tty has no RS-485 mode or rx timeout: accepted and ignored
+    static inline esp_err_t uart_set_pin(uart_port_t uart, int tx, int rx, int rts, int cts){ return ESP_OK; }
+    static inline esp_err_t uart_set_mode(uart_port_t uart, uart_mode_t mode){ return ESP_OK; }
+    static inline esp_err_t uart_set_rx_timeout(uart_port_t uart, uint8_t symbols){ return ESP_OK; }
+#endif /* EMU_DRIVER_UART_H */
@@ -0,0 +1,29 @@
+#ifndef EMU_ESP_HEAP_CAPS_H
+    #define EMU_ESP_HEAP_CAPS_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #define MALLOC_CAP_EXEC (1 << 0)
+    #define MALLOC_CAP_32BIT (1 << 1)
+    #define MALLOC_CAP_8BIT (1 << 2)
+    #define MALLOC_CAP_DMA (1 << 3)
+    #define MALLOC_CAP_SPIRAM (1 << 10)
+    #define MALLOC_CAP_INTERNAL (1 << 11)
+    #define MALLOC_CAP_DEFAULT (1 << 12)
+
+    typedef int esp_err_t;
+    typedef void (*esp_alloc_failed_hook_t)(size_t size, uint32_t caps, const char *function);
+
+    // The host heap is modelled as an ESP32 sized heap (--heap, default 320 KiB)
+    // minus what the process allocated since start (glibc mallinfo2), so the
+    // telemetry counters move the same way as on the device. The largest free
+    // block is taken from the same figure: glibc fragmentation says nothing about
+    // the ESP32 allocator. malloc does not fail on the host, the failure hook is
+    // accepted but never called.
+    size_t heap_caps_get_free_size(uint32_t caps);
+    size_t heap_caps_get_minimum_free_size(uint32_t caps);
+    size_t heap_caps_get_largest_free_block(uint32_t caps);
+    size_t heap_caps_get_total_size(uint32_t caps);
+    esp_err_t heap_caps_register_failed_alloc_callback(esp_alloc_failed_hook_t callback);
+#endif /* EMU_ESP_HEAP_CAPS_H */
@@ -0,0 +1,8 @@
+#ifndef EMU_ESP_NETIF_H
+    #define EMU_ESP_NETIF_H
+
+    typedef struct esp_netif_obj esp_netif_t;
+
+    // "WIFI_STA_DEF" is the station, nullptr for any other key
+    esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key);
+#endif /* EMU_ESP_NETIF_H */
@@ -0,0 +1,8 @@
+#ifndef EMU_ESP_NETIF_NET_STACK_H
+    #define EMU_ESP_NETIF_NET_STACK_H
+
+    #include "esp_netif.h"
+
+    // the lwip struct netif of the interface
+    void *esp_netif_get_netif_impl(esp_netif_t *esp_netif);
+#endif /* EMU_ESP_NETIF_NET_STACK_H */
@@ -0,0 +1,25 @@
+#ifndef EMU_ESP_SYSTEM_H
+    #define EMU_ESP_SYSTEM_H
+
+    #include <stdint.h>
+
+    // pseudo random on the host, the device uses its hardware rng
+    uint32_t esp_random();
+
+    typedef enum{
+        ESP_RST_UNKNOWN,
+        ESP_RST_POWERON,
+        ESP_RST_EXT,
+        ESP_RST_SW,
+        ESP_RST_PANIC,
+        ESP_RST_INT_WDT,
+        ESP_RST_TASK_WDT,
+        ESP_RST_WDT,
+        ESP_RST_DEEPSLEEP,
+        ESP_RST_BROWNOUT,
+        ESP_RST_SDIO
+    } esp_reset_reason_t;
+
+    // power-on for the first start, software after ESP.restart()
+    esp_reset_reason_t esp_reset_reason();
+#endif /* EMU_ESP_SYSTEM_H */
@@ -0,0 +1,8 @@
+#ifndef EMU_ESP_TIMER_H
+    #define EMU_ESP_TIMER_H
+
+    #include <stdint.h>
+
+    // microseconds since the emulator started
+    int64_t esp_timer_get_time();
+#endif /* EMU_ESP_TIMER_H */
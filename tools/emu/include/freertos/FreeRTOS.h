@@ -0,0 +1,45 @@
+#ifndef EMU_FREERTOS_H
+    #define EMU_FREERTOS_H
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    // FreeRTOS on top of pthreads: a tick is one millisecond (configTICK_RATE_HZ
+    // 1000 like the ESP32 Arduino core), priorities and core affinity are
+    // recorded but left to the Linux scheduler
+    typedef int BaseType_t;
+    typedef unsigned int UBaseType_t;
+    typedef uint32_t TickType_t;
+    typedef uint32_t StackType_t;
+
+    #define pdTRUE 1
+    #define pdFALSE 0
+    #define pdPASS pdTRUE
+    #define pdFAIL pdFALSE
+    #define configTICK_RATE_HZ 1000
+    #define configMAX_PRIORITIES 25
+    #define configMAX_TASK_NAME_LEN 16
+    #define portMAX_DELAY (TickType_t)0xffffffffUL
+    #define portTICK_PERIOD_MS 1
+    #define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+    #define portNUM_PROCESSORS 2
+
+    // spinlock of the dual core port, a plain test-and-set lock here
+    typedef struct{
+        volatile uint32_t owner;
+    } portMUX_TYPE;
+    #define portMUX_INITIALIZER_UNLOCKED {0}
+
+    void vPortEnterCritical(portMUX_TYPE *mux);
+    void vPortExitCritical(portMUX_TYPE *mux);
+    #define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+    #define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+    #define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+    #define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+    #define portYIELD_FROM_ISR(...) do{}while(0)
+
+    BaseType_t xPortGetCoreID();
+
+    #include "task.h"
+    #include "semphr.h"
+#endif /* EMU_FREERTOS_H */
@@ -0,0 +1,13 @@
+#ifndef EMU_SEMPHR_H
+    #define EMU_SEMPHR_H
+
+    #include "FreeRTOS.h"
+
+    typedef struct QueueDefinition *SemaphoreHandle_t;
+
+    SemaphoreHandle_t xSemaphoreCreateMutex();
+    SemaphoreHandle_t xSemaphoreCreateBinary();
+    BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+    BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+    void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+#endif /* EMU_SEMPHR_H */
@@ -0,0 +1,53 @@
+#ifndef EMU_TASK_H
+    #define EMU_TASK_H
+
+    #include "FreeRTOS.h"
+
+    #define tskNO_AFFINITY 0x7fffffff
+    #define tskIDLE_PRIORITY 0
+
+    typedef struct tskTaskControlBlock *TaskHandle_t;
+    typedef void (*TaskFunction_t)(void *arg);
+
+    typedef enum{
+        eRunning = 0,
+        eReady,
+        eBlocked,
+        eSuspended,
+        eDeleted,
+        eInvalid
+    } eTaskState;
+
+    typedef struct{
+        TaskHandle_t xHandle;
+        const char *pcTaskName;
+        UBaseType_t xTaskNumber;
+        eTaskState eCurrentState;
+        UBaseType_t uxCurrentPriority;
+        UBaseType_t uxBasePriority;
+        uint32_t ulRunTimeCounter;
+        StackType_t *pxStackBase;
+        uint32_t usStackHighWaterMark;
+        BaseType_t xCoreID;
+    } TaskStatus_t;
+
+    BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+    static inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *arg, UBaseType_t priority, TaskHandle_t *handle){
+        return xTaskCreatePinnedToCore(function, name, stackDepth, arg, priority, handle, tskNO_AFFINITY);
+    }
+    void vTaskDelete(TaskHandle_t task);
+    void vTaskDelay(TickType_t ticks);
+    void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+    TickType_t xTaskGetTickCount();
+    TaskHandle_t xTaskGetCurrentTaskHandle();
+    char *pcTaskGetName(TaskHandle_t task);
+    UBaseType_t uxTaskGetNumberOfTasks();
+    // the host cannot measure stack usage: the high-water mark is the stack size
+    // the task was created with
+    UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+    UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *totalRunTime);
+
+    uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+    BaseType_t xTaskNotifyGive(TaskHandle_t task);
+    void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+#endif /* EMU_TASK_H */
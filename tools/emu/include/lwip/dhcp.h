@@ -0,0 +1,24 @@
+#ifndef EMU_LWIP_DHCP_H
+    #define EMU_LWIP_DHCP_H
+
+    #include <stdint.h>
+    #include "lwip/err.h"
+
+    #define DHCP_COARSE_TIMER_SECS 60
+
+    struct netif;
+
+    // the fields of the lwip client the gateway reads
+    struct dhcp{
+        // s
+        uint32_t offered_t0_lease;
+        // coarse timer ticks since the lease was granted or renewed
+        uint16_t lease_used;
+    };
+
+    // binds at once and keeps the station's address
+    err_t dhcp_start(struct netif *netif);
+    // the station is bound as long as it was not given a static address
+    uint8_t dhcp_supplied_address(const struct netif *netif);
+    struct dhcp *netif_dhcp_data(struct netif *netif);
+#endif /* EMU_LWIP_DHCP_H */
@@ -0,0 +1,9 @@
+#ifndef EMU_LWIP_ERR_H
+    #define EMU_LWIP_ERR_H
+
+    #include <stdint.h>
+
+    typedef int8_t err_t;
+
+    #define ERR_OK 0
+#endif /* EMU_LWIP_ERR_H */
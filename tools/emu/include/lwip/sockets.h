@@ -0,0 +1,8 @@
+#ifndef EMU_LWIP_SOCKETS_H
+    #define EMU_LWIP_SOCKETS_H
+
+    // the host socket api has the same calls and option names as lwip
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+#endif /* EMU_LWIP_SOCKETS_H */
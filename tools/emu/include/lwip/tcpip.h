@@ -0,0 +1,10 @@
+#ifndef EMU_LWIP_TCPIP_H
+    #define EMU_LWIP_TCPIP_H
+
+    #include "lwip/err.h"
+
+    typedef void (*tcpip_callback_fn)(void *ctx);
+
+    // runs the function at once, there is no tcpip thread
+    err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+#endif /* EMU_LWIP_TCPIP_H */
@@ -0,0 +1,219 @@
+#include <Preferences.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include "emu.h"
+
+// NVS limits (nvs.h): 15 character keys and namespaces
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+struct PrefsEntry{
+    char type;
+    std::string value;
+};
+
+// "namespace key" -> entry, shared by all Preferences objects like the NVS partition
+static std::map<std::string, PrefsEntry> entries;
+static std::mutex prefsLock;
+static bool loaded = false;
+
+// values are stored as text, strings with \\, \n and \r escaped
+static std::string escape(const std::string &text){
+    std::string result;
+    for (auto c : text){
+        if (c == '\\') result += "\\\\";
+        else if (c == '\n') result += "\\n";
+        else if (c == '\r') result += "\\r";
+        else result += c;
+    }
+    return result;
+}
+
+static std::string unescape(const std::string &text){
+    std::string result;
+    for (size_t i = 0; i < text.length(); i++){
+        if (text[i] == '\\' && i + 1 < text.length()){
+            auto c = text[++i];
+            result += c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+        }
+        else{
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+static void load(){
+    if (loaded) return;
+    loaded = true;
+    auto file = fopen(emuOptions.prefs, "re");
+    if (!file) return;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &size, file)) > 0){
+        if (line[len - 1] == '\n') line[--len] = 0;
+        char name[NVS_KEY_NAME_MAX_SIZE];
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        char type;
+        int offset = 0;
+        if (sscanf(line, "%15s %15s %c %n", name, key, &type, &offset) < 3 || offset == 0) continue;
+        entries[std::string(name) + " " + key] = {type, unescape(line + offset)};
+    }
+    free(line);
+    fclose(file);
+}
+
+// written to a temporary file and renamed, so a crash never leaves half a file
+static bool save(){
+    auto temp = std::string(emuOptions.prefs) + ".tmp";
+    auto file = fopen(temp.c_str(), "we");
+    if (!file){
+        fprintf(stderr, "[emu] cannot write %s: %s\n", temp.c_str(), strerror(errno));
+        return false;
+    }
+    for (auto &entry : entries){
+        fprintf(file, "%s %c %s\n", entry.first.c_str(), entry.second.type, escape(entry.second.value).c_str());
+    }
+    fclose(file);
+    return rename(temp.c_str(), emuOptions.prefs) == 0;
+}
+
+static bool validKey(const char *key){
+    if (key && strlen(key) < NVS_KEY_NAME_MAX_SIZE) return true;
+    fprintf(stderr, "[emu] nvs: key \"%s\" longer than %d characters\n", key ? key : "", NVS_KEY_NAME_MAX_SIZE - 1);
+    return false;
+}
+
+Preferences::Preferences()
+    :_readOnly(false)
+    ,_started(false)
+{}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition){
+    if (!validKey(name)) return false;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    load();
+    _namespace = name;
+    _readOnly = readOnly;
+    _started = true;
+    return true;
+}
+
+void Preferences::end(){
+    _started = false;
+}
+
+bool Preferences::clear(){
+    if (!_started || _readOnly) return false;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    auto prefix = std::string(_namespace.c_str()) + " ";
+    for (auto it = entries.begin(); it != entries.end();){
+        if (it->first.compare(0, prefix.length(), prefix) == 0) it = entries.erase(it);
+        else ++it;
+    }
+    return save();
+}
+
+bool Preferences::remove(const char *key){
+    if (!_started || _readOnly || !validKey(key)) return false;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    if (!entries.erase(std::string(_namespace.c_str()) + " " + key)) return false;
+    return save();
+}
+
+bool Preferences::isKey(const char *key){
+    if (!_started || !validKey(key)) return false;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    return entries.count(std::string(_namespace.c_str()) + " " + key) > 0;
+}
+
+bool Preferences::get(const char *key, char type, String &value){
+    if (!_started || !validKey(key)) return false;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    auto entry = entries.find(std::string(_namespace.c_str()) + " " + key);
+    if (entry == entries.end()) return false;
+    if (entry->second.type != type){
+        fprintf(stderr, "[emu] nvs: key \"%s\" stored as '%c', read as '%c'\n", key, entry->second.type, type);
+        return false;
+    }
+    value = String(entry->second.value);
+    return true;
+}
+
+size_t Preferences::put(const char *key, char type, const String &value){
+    if (!_started || _readOnly || !validKey(key)) return 0;
+    std::lock_guard<std::mutex> guard(prefsLock);
+    entries[std::string(_namespace.c_str()) + " " + key] = {type, value.c_str()};
+    return save() ? value.length() : 0;
+}
+
+// type letters follow the NVS item types: i/u signed/unsigned, then the size in bytes
+size_t Preferences::putChar(const char *key, int8_t value){ return put(key, 'a', String((int)value)) ? 1 : 0; }
+size_t Preferences::putUChar(const char *key, uint8_t value){ return put(key, 'A', String((unsigned int)value)) ? 1 : 0; }
+size_t Preferences::putShort(const char *key, int16_t value){ return put(key, 'b', String((int)value)) ? 2 : 0; }
+size_t Preferences::putUShort(const char *key, uint16_t value){ return put(key, 'B', String((unsigned int)value)) ? 2 : 0; }
+size_t Preferences::putInt(const char *key, int32_t value){ return put(key, 'c', String((long)value)) ? 4 : 0; }
+size_t Preferences::putUInt(const char *key, uint32_t value){ return put(key, 'C', String((unsigned long)value)) ? 4 : 0; }
+size_t Preferences::putLong(const char *key, int32_t value){ return put(key, 'c', String((long)value)) ? 4 : 0; }
+size_t Preferences::putULong(const char *key, uint32_t value){ return put(key, 'C', String((unsigned long)value)) ? 4 : 0; }
+size_t Preferences::putLong64(const char *key, int64_t value){ return put(key, 'd', String((long long)value)) ? 8 : 0; }
+size_t Preferences::putULong64(const char *key, uint64_t value){ return put(key, 'D', String((unsigned long long)value)) ? 8 : 0; }
+size_t Preferences::putFloat(const char *key, float value){ return put(key, 'f', String((double)value, 9)) ? 4 : 0; }
+size_t Preferences::putDouble(const char *key, double value){ return put(key, 'F', String(value, 17)) ? 8 : 0; }
+size_t Preferences::putBool(const char *key, bool value){ return putUChar(key, value ? 1 : 0); }
+size_t Preferences::putString(const char *key, const char *value){ return putString(key, String(value)); }
+
+size_t Preferences::putString(const char *key, String value){
+    if (!validKey(key)) return 0;
+    return put(key, 's', value) ? value.length() : 0;
+}
+
+static long long toSigned(const String &value){ return strtoll(value.c_str(), NULL, 10); }
+static unsigned long long toUnsigned(const String &value){ return strtoull(value.c_str(), NULL, 10); }
+
+int8_t Preferences::getChar(const char *key, int8_t defaultValue){ String value; return get(key, 'a', value) ? toSigned(value) : defaultValue; }
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue){ String value; return get(key, 'A', value) ? toUnsigned(value) : defaultValue; }
+int16_t Preferences::getShort(const char *key, int16_t defaultValue){ String value; return get(key, 'b', value) ? toSigned(value) : defaultValue; }
+uint16_t Preferences::getUShort(const char *key, uint16_t defaultValue){ String value; return get(key, 'B', value) ? toUnsigned(value) : defaultValue; }
+int32_t Preferences::getInt(const char *key, int32_t defaultValue){ String value; return get(key, 'c', value) ? toSigned(value) : defaultValue; }
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue){ String value; return get(key, 'C', value) ? toUnsigned(value) : defaultValue; }
+int32_t Preferences::getLong(const char *key, int32_t defaultValue){ return getInt(key, defaultValue); }
+uint32_t Preferences::getULong(const char *key, uint32_t defaultValue){ return getUInt(key, defaultValue); }
+int64_t Preferences::getLong64(const char *key, int64_t defaultValue){ String value; return get(key, 'd', value) ? toSigned(value) : defaultValue; }
+uint64_t Preferences::getULong64(const char *key, uint64_t defaultValue){ String value; return get(key, 'D', value) ? toUnsigned(value) : defaultValue; }
+float Preferences::getFloat(const char *key, float defaultValue){ String value; return get(key, 'f', value) ? value.toFloat() : defaultValue; }
+double Preferences::getDouble(const char *key, double defaultValue){ String value; return get(key, 'F', value) ? value.toDouble() : defaultValue; }
+bool Preferences::getBool(const char *key, bool defaultValue){ return getUChar(key, defaultValue ? 1 : 0) != 0; }
+String Preferences::getString(const char *key, String defaultValue){ String value; return get(key, 's', value) ? value : defaultValue; }
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len){
+    if (!validKey(key)) return 0;
+    String text;
+    char hex[3];
+    for (size_t i = 0; i < len; i++){
+        snprintf(hex, sizeof(hex), "%02x", ((const uint8_t*)value)[i]);
+        text += hex;
+    }
+    return put(key, 'x', text) ? len : 0;
+}
+
+size_t Preferences::getBytesLength(const char *key){
+    String value;
+    return get(key, 'x', value) ? value.length() / 2 : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen){
+    String value;
+    if (!get(key, 'x', value)) return 0;
+    size_t len = value.length() / 2;
+    // like NVS: nothing is copied when the blob does not fit
+    if (len > maxLen) return 0;
+    for (size_t i = 0; i < len; i++){
+        ((uint8_t*)buf)[i] = strtoul(value.substring(i * 2, i * 2 + 2).c_str(), NULL, 16);
+    }
+    return len;
+}
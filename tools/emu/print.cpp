@@ -0,0 +1,103 @@
+#include <Arduino.h>
+#include <stdarg.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size){
+    size_t n = 0;
+    while (size--){
+        if (!write(*buffer++)) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...){
+    char local[64];
+    char *text = local;
+    va_list args;
+    va_start(args, format);
+    auto len = vsnprintf(local, sizeof(local), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len >= sizeof(local)){
+        text = (char*)malloc(len + 1);
+        if (!text) return 0;
+        va_start(args, format);
+        vsnprintf(text, len + 1, format, args);
+        va_end(args);
+    }
+    len = write((const uint8_t*)text, len);
+    if (text != local) free(text);
+    return len;
+}
+
+size_t Print::printNumber(unsigned long long value, uint8_t base){
+    return print(String(value, base));
+}
+
+size_t Print::print(long long value, int base){
+    if (base == 0) return write((uint8_t)value);
+    if (base == 10 && value < 0) return print('-') + printNumber(-(unsigned long long)value, 10);
+    return printNumber(value, base);
+}
+
+size_t Print::print(unsigned long long value, int base){
+    if (base == 0) return write((uint8_t)value);
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits){
+    return print(String(value, digits));
+}
+
+size_t Stream::readBytes(char *buffer, size_t length){
+    size_t count = 0;
+    while (count < length){
+        auto start = millis();
+        int c;
+        while ((c = read()) < 0 && millis() - start < _timeout) delay(1);
+        if (c < 0) break;
+        buffer[count++] = c;
+    }
+    return count;
+}
+
+String Stream::readString(){
+    String result;
+    char c;
+    while (readBytes(&c, 1) == 1) result += c;
+    return result;
+}
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth){
+    _address.bytes[0] = first;
+    _address.bytes[1] = second;
+    _address.bytes[2] = third;
+    _address.bytes[3] = fourth;
+}
+
+IPAddress::IPAddress(const uint8_t *address){
+    memcpy(_address.bytes, address, 4);
+}
+
+bool IPAddress::fromString(const char *address){
+    unsigned int parts[4];
+    char tail;
+    if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &tail) != 4) return false;
+    for (uint8_t i = 0; i < 4; i++){
+        if (parts[i] > 255) return false;
+        _address.bytes[i] = parts[i];
+    }
+    return true;
+}
+
+String IPAddress::toString() const{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+    return String(text);
+}
+
+size_t IPAddress::printTo(Print &out) const{
+    return out.print(toString());
+}
@@ -0,0 +1,212 @@
+#include <PubSubClient.h>
+
+// fixed header: type byte + up to 4 bytes remaining length
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PINGREQ 0xc0
+#define MQTT_PINGRESP 0xd0
+#define MQTT_DISCONNECT 0xe0
+
+PubSubClient::PubSubClient(Client &client)
+    :_client(&client)
+    ,_host(NULL)
+    ,_port(1883)
+    ,_buffer(NULL)
+    ,_bufferSize(0)
+    ,_state(MQTT_DISCONNECTED)
+    ,_lastOutActivity(0)
+    ,_lastInActivity(0)
+    ,_pingOutstanding(false)
+{
+    setBufferSize(256);
+}
+
+PubSubClient::~PubSubClient(){
+    free(_buffer);
+}
+
+PubSubClient &PubSubClient::setServer(const char *host, uint16_t port){
+    _host = host;
+    _port = port;
+    return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size){
+    if (size == 0) return false;
+    auto buffer = (uint8_t*)realloc(_buffer, size);
+    if (!buffer) return false;
+    _buffer = buffer;
+    _bufferSize = size;
+    return true;
+}
+
+// length prefixed UTF-8 string at pos of the packet body, returns the new position
+size_t PubSubClient::writeString(const char *text, size_t pos){
+    size_t len = strlen(text);
+    if (pos + 2 + len > _bufferSize) return _bufferSize + 1;
+    _buffer[pos++] = len >> 8;
+    _buffer[pos++] = len & 0xff;
+    memcpy(_buffer + pos, text, len);
+    return pos + len;
+}
+
+// the body was built at _buffer + MQTT_MAX_HEADER_SIZE, the header goes right in front of it
+bool PubSubClient::sendPacket(uint8_t header, size_t length){
+    uint8_t encoded[4];
+    uint8_t count = 0;
+    auto remaining = length;
+    do{
+        auto digit = remaining % 128;
+        remaining /= 128;
+        encoded[count++] = remaining > 0 ? digit | 0x80 : digit;
+    } while (remaining > 0 && count < 4);
+    auto start = MQTT_MAX_HEADER_SIZE - 1 - count;
+    _buffer[start] = header;
+    memcpy(_buffer + start + 1, encoded, count);
+    auto total = 1 + count + length;
+    auto written = _client->write(_buffer + start, total);
+    _lastOutActivity = millis();
+    return written == total;
+}
+
+bool PubSubClient::readPacket(uint8_t &header, size_t &length, unsigned long timeout){
+    auto start = millis();
+    auto readByte = [&](uint8_t &value){
+        while (!_client->available()){
+            if (!_client->connected() || millis() - start > timeout) return false;
+            delay(1);
+        }
+        value = _client->read();
+        return true;
+    };
+    if (!readByte(header)) return false;
+    length = 0;
+    uint32_t multiplier = 1;
+    uint8_t digit;
+    do{
+        if (!readByte(digit)) return false;
+        length += (digit & 0x7f) * multiplier;
+        multiplier *= 128;
+    } while ((digit & 0x80) && multiplier <= 128 * 128 * 128);
+    // packets bigger than the buffer are read and dropped
+    for (size_t i = 0; i < length; i++){
+        uint8_t value;
+        if (!readByte(value)) return false;
+        if (i < _bufferSize) _buffer[i] = value;
+    }
+    _lastInActivity = millis();
+    return true;
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession){
+    if (connected()) return true;
+    if (!_client->connect(_host, _port)){
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    size_t pos = MQTT_MAX_HEADER_SIZE;
+    static const uint8_t protocol[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04};
+    memcpy(_buffer + pos, protocol, sizeof(protocol));
+    pos += sizeof(protocol);
+    uint8_t flags = cleanSession ? 0x02 : 0x00;
+    if (willTopic) flags |= 0x04 | (willQos << 3) | (willRetain ? 0x20 : 0x00);
+    if (user){
+        flags |= 0x80;
+        if (pass) flags |= 0x40;
+    }
+    _buffer[pos++] = flags;
+    _buffer[pos++] = MQTT_KEEPALIVE >> 8;
+    _buffer[pos++] = MQTT_KEEPALIVE & 0xff;
+    pos = writeString(id, pos);
+    if (willTopic){
+        pos = writeString(willTopic, pos);
+        pos = writeString(willMessage ? willMessage : "", pos);
+    }
+    if (user){
+        pos = writeString(user, pos);
+        if (pass) pos = writeString(pass, pos);
+    }
+    uint8_t header;
+    size_t length;
+    if (pos > _bufferSize || !sendPacket(MQTT_CONNECT, pos - MQTT_MAX_HEADER_SIZE)){
+        _client->stop();
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    if (!readPacket(header, length, MQTT_SOCKET_TIMEOUT * 1000UL)){
+        _client->stop();
+        _state = MQTT_CONNECTION_TIMEOUT;
+        return false;
+    }
+    if ((header & 0xf0) != MQTT_CONNACK || length < 2 || _buffer[1] != 0){
+        _client->stop();
+        _state = (header & 0xf0) == MQTT_CONNACK && length >= 2 ? _buffer[1] : MQTT_CONNECT_FAILED;
+        return false;
+    }
+    _pingOutstanding = false;
+    _state = MQTT_CONNECTED;
+    return true;
+}
+
+void PubSubClient::disconnect(){
+    if (_client->connected()){
+        uint8_t packet[] = {MQTT_DISCONNECT, 0x00};
+        _client->write(packet, sizeof(packet));
+    }
+    _client->stop();
+    _state = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained){
+    return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained){
+    if (!connected()) return false;
+    auto pos = writeString(topic, MQTT_MAX_HEADER_SIZE);
+    if (pos + length > _bufferSize) return false;
+    memcpy(_buffer + pos, payload, length);
+    pos += length;
+    return sendPacket(MQTT_PUBLISH | (retained ? 0x01 : 0x00), pos - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::loop(){
+    if (!connected()) return false;
+    auto now = millis();
+    if (now - _lastOutActivity > MQTT_KEEPALIVE * 1000UL || now - _lastInActivity > MQTT_KEEPALIVE * 1000UL){
+        if (_pingOutstanding){
+            _state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+            return false;
+        }
+        uint8_t packet[] = {MQTT_PINGREQ, 0x00};
+        _client->write(packet, sizeof(packet));
+        _lastOutActivity = now;
+        _lastInActivity = now;
+        _pingOutstanding = true;
+    }
+    while (_client->available()){
+        uint8_t header;
+        size_t length;
+        if (!readPacket(header, length, MQTT_SOCKET_TIMEOUT * 1000UL)) break;
+        if ((header & 0xf0) == MQTT_PINGRESP){
+            _pingOutstanding = false;
+        }
+        else if ((header & 0xf0) == MQTT_PINGREQ){
+            uint8_t packet[] = {MQTT_PINGRESP, 0x00};
+            _client->write(packet, sizeof(packet));
+        }
+    }
+    return true;
+}
+
+bool PubSubClient::connected(){
+    if (_state != MQTT_CONNECTED) return false;
+    if (_client->connected()) return true;
+    _state = MQTT_CONNECTION_LOST;
+    _client->stop();
+    return false;
+}
@@ -0,0 +1,326 @@
+#include <WiFi.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <lwip/tcpip.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "emu.h"
+
+// like WIFI_CLIENT_DEF_CONN_TIMEOUT_MS of the ESP32 core
+#define CLIENT_WRITE_TIMEOUT 3000
+
+WiFiClass WiFi;
+
+struct ClientSocket{
+    int fd;
+    ClientSocket(int fd):fd(fd){}
+    ~ClientSocket(){ if (fd >= 0) close(fd); }
+};
+
+static IPAddress toIP(const struct sockaddr_in &address){
+    return IPAddress((uint32_t)address.sin_addr.s_addr);
+}
+
+WiFiClient::WiFiClient(){}
+
+WiFiClient::WiFiClient(int fd)
+    :_socket(std::make_shared<ClientSocket>(fd))
+{}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port){
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port){
+    stop();
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+    int fd = -1;
+    for (auto address = result; address; address = address->ai_next){
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) return 0;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    _socket = std::make_shared<ClientSocket>(fd);
+    return 1;
+}
+
+size_t WiFiClient::write(uint8_t value){
+    return write(&value, 1);
+}
+
+// blocks while the send buffer is full, like the lwIP client with its write timeout
+size_t WiFiClient::write(const uint8_t *buffer, size_t size){
+    size_t written = 0;
+    while (_socket && written < size){
+        auto len = send(_socket->fd, buffer + written, size - written, MSG_NOSIGNAL);
+        if (len > 0){
+            written += len;
+            continue;
+        }
+        if (len < 0 && errno != EAGAIN && errno != EINTR){
+            stop();
+            break;
+        }
+        struct pollfd fd = {_socket->fd, POLLOUT, 0};
+        if (poll(&fd, 1, CLIENT_WRITE_TIMEOUT) <= 0) break;
+    }
+    return written;
+}
+
+int WiFiClient::available(){
+    int count = 0;
+    if (!_socket || ioctl(_socket->fd, FIONREAD, &count) != 0) return 0;
+    return count;
+}
+
+int WiFiClient::read(){
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size){
+    if (!_socket) return -1;
+    auto len = recv(_socket->fd, buffer, size, MSG_DONTWAIT);
+    return len > 0 ? len : -1;
+}
+
+int WiFiClient::peek(){
+    uint8_t value;
+    if (!_socket || recv(_socket->fd, &value, 1, MSG_DONTWAIT | MSG_PEEK) != 1) return -1;
+    return value;
+}
+
+void WiFiClient::flush(){}
+
+void WiFiClient::stop(){
+    if (_socket && _socket->fd >= 0){
+        close(_socket->fd);
+        _socket->fd = -1;
+    }
+    _socket.reset();
+}
+
+// still connected while unread data is waiting, even if the peer has closed
+uint8_t WiFiClient::connected(){
+    if (!_socket || _socket->fd < 0) return 0;
+    uint8_t value;
+    auto len = recv(_socket->fd, &value, 1, MSG_DONTWAIT | MSG_PEEK);
+    if (len > 0) return 1;
+    if (len == 0) return 0;
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+int WiFiClient::fd() const{
+    return _socket ? _socket->fd : -1;
+}
+
+int WiFiClient::setNoDelay(bool noDelay){
+    int value = noDelay;
+    return setSocketOption(TCP_NODELAY, (char*)&value, sizeof(value));
+}
+
+int WiFiClient::setSocketOption(int option, char *value, size_t size){
+    if (!_socket) return -1;
+    return setsockopt(_socket->fd, IPPROTO_TCP, option, value, size);
+}
+
+IPAddress WiFiClient::remoteIP() const{
+    struct sockaddr_in address = {};
+    socklen_t len = sizeof(address);
+    if (!_socket || getpeername(_socket->fd, (struct sockaddr*)&address, &len) != 0) return IPAddress();
+    return toIP(address);
+}
+
+uint16_t WiFiClient::remotePort() const{
+    struct sockaddr_in address = {};
+    socklen_t len = sizeof(address);
+    if (!_socket || getpeername(_socket->fd, (struct sockaddr*)&address, &len) != 0) return 0;
+    return ntohs(address.sin_port);
+}
+
+IPAddress WiFiClient::localIP() const{
+    struct sockaddr_in address = {};
+    socklen_t len = sizeof(address);
+    if (!_socket || getsockname(_socket->fd, (struct sockaddr*)&address, &len) != 0) return IPAddress();
+    return toIP(address);
+}
+
+uint16_t WiFiClient::localPort() const{
+    struct sockaddr_in address = {};
+    socklen_t len = sizeof(address);
+    if (!_socket || getsockname(_socket->fd, (struct sockaddr*)&address, &len) != 0) return 0;
+    return ntohs(address.sin_port);
+}
+
+WiFiServer::WiFiServer(uint16_t port, uint8_t maxClients)
+    :_port(port)
+    ,_maxClients(maxClients)
+    ,_fd(-1)
+    ,_noDelay(false)
+{}
+
+WiFiServer::~WiFiServer(){
+    end();
+}
+
+void WiFiServer::begin(uint16_t port){
+    if (port) _port = port;
+    end();
+    _fd = emuListen(_port, _maxClients);
+    if (_fd >= 0) fcntl(_fd, F_SETFL, O_NONBLOCK);
+}
+
+void WiFiServer::end(){
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+}
+
+WiFiClient WiFiServer::accept(){
+    if (_fd < 0) return WiFiClient();
+    int fd = accept4(_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return WiFiClient();
+    WiFiClient client(fd);
+    if (_noDelay) client.setNoDelay(true);
+    return client;
+}
+
+bool WiFiServer::hasClient(){
+    struct pollfd fd = {_fd, POLLIN, 0};
+    return _fd >= 0 && poll(&fd, 1, 0) > 0;
+}
+
+int emuListen(uint16_t port, int backlog){
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port + emuOptions.portOffset);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, max(backlog, 4)) != 0){
+        fprintf(stderr, "[emu] cannot listen on port %u: %s\n", port + emuOptions.portOffset, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fprintf(stderr, "[emu] listening on port %u\n", port + emuOptions.portOffset);
+    return fd;
+}
+
+// connect times with and without a scan of all channels
+#define EMU_CONNECT_PINNED 100
+#define EMU_CONNECT_SCAN 1500
+
+WiFiClass::WiFiClass()
+    :_mode(WIFI_MODE_NULL)
+    ,_linked(true)
+    ,_autoReconnect(true)
+    ,_linkAt(0)
+    ,_sleep(true)
+    ,_txPower(WIFI_POWER_19_5dBm)
+    ,_static(false)
+{}
+
+wl_status_t WiFiClass::status(){
+    if (_mode == WIFI_OFF) return WL_DISCONNECTED;
+    if (!_linked){
+        // the signal handler only clears the flag, the reconnect starts here
+        if (_linkAt == 0 && _autoReconnect) _linkAt = millis() + EMU_CONNECT_SCAN;
+        if (_linkAt == 0 || millis() < _linkAt) return WL_DISCONNECTED;
+        _linked = true;
+    }
+    return WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect){
+    _mode = WIFI_STA;
+    if (!_linked) _linkAt = millis() + (bssid ? EMU_CONNECT_PINNED : EMU_CONNECT_SCAN);
+    return status();
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp){
+    if (_linked) return true;
+    _linkAt = 0;
+    return true;
+}
+
+void WiFiClass::emuDropLink(){
+    _linked = false;
+    _linkAt = 0;
+}
+
+String WiFiClass::macAddress(){
+    char text[18];
+    auto mac = ESP.getEfuseMac();
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+        (unsigned)(mac & 0xff), (unsigned)((mac >> 8) & 0xff), (unsigned)((mac >> 16) & 0xff),
+        (unsigned)((mac >> 24) & 0xff), (unsigned)((mac >> 32) & 0xff), (unsigned)((mac >> 40) & 0xff));
+    return String(text);
+}
+
+// the address other hosts reach us on, found by routing a UDP socket (nothing is sent)
+IPAddress WiFiClass::localIP(){
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(9);
+    inet_pton(AF_INET, "192.0.2.1", &address.sin_addr);
+    IPAddress result(127, 0, 0, 1);
+    socklen_t len = sizeof(address);
+    if (fd >= 0 && ::connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0 && getsockname(fd, (struct sockaddr*)&address, &len) == 0){
+        result = toIP(address);
+    }
+    if (fd >= 0) close(fd);
+    return result;
+}
+
+// the station's lwip interface: a day long lease granted when the client
+// started, bound unless WiFi.config() set a static address
+static struct dhcp stationDhcp = {86400, 0};
+static char stationNetif;
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key){
+    return strcmp(key, "WIFI_STA_DEF") == 0 ? reinterpret_cast<esp_netif_t*>(&stationNetif) : nullptr;
+}
+
+void *esp_netif_get_netif_impl(esp_netif_t *esp_netif){
+    return esp_netif;
+}
+
+err_t dhcp_start(struct netif *netif){
+    // INADDR_NONE is the all-ones address of netinet/in.h in this file
+    WiFi.config((uint32_t)0, (uint32_t)0, (uint32_t)0);
+    return ERR_OK;
+}
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx){
+    function(ctx);
+    return ERR_OK;
+}
+
+uint8_t dhcp_supplied_address(const struct netif *netif){
+    return !WiFi.emuStatic() && WiFi.status() == WL_CONNECTED;
+}
+
+struct dhcp *netif_dhcp_data(struct netif *netif){
+    return &stationDhcp;
+}
@@ -0,0 +1,141 @@
+#include "WString.h"
+#include <ctype.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static std::string toText(unsigned long long value, unsigned char base, bool negative){
+    char digits[66];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = 0;
+    if (base < 2 || base > 36) base = 10;
+    do{
+        auto digit = value % base;
+        digits[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) digits[--pos] = '-';
+    return digits + pos;
+}
+
+// like the ESP32 core only base 10 is signed, other bases print the two's complement
+String::String(unsigned char value, unsigned char base):_buffer(toText(value, base, false)){}
+String::String(int value, unsigned char base):_buffer(base == 10 ? toText(value < 0 ? -(long long)value : value, 10, value < 0) : toText((unsigned int)value, base, false)){}
+String::String(unsigned int value, unsigned char base):_buffer(toText(value, base, false)){}
+String::String(long value, unsigned char base):_buffer(base == 10 ? toText(value < 0 ? -(unsigned long long)value : value, 10, value < 0) : toText((unsigned long)value, base, false)){}
+String::String(unsigned long value, unsigned char base):_buffer(toText(value, base, false)){}
+String::String(long long value, unsigned char base):_buffer(base == 10 ? toText(value < 0 ? -(unsigned long long)value : value, 10, value < 0) : toText((unsigned long long)value, base, false)){}
+String::String(unsigned long long value, unsigned char base):_buffer(toText(value, base, false)){}
+
+String::String(float value, unsigned int decimals):String((double)value, decimals){}
+
+String::String(double value, unsigned int decimals){
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, value);
+    _buffer = text;
+}
+
+bool String::equalsIgnoreCase(const String &other) const{
+    return length() == other.length() && strcasecmp(c_str(), other.c_str()) == 0;
+}
+
+bool String::endsWith(const String &suffix) const{
+    if (suffix.length() > length()) return false;
+    return _buffer.compare(length() - suffix.length(), suffix.length(), suffix._buffer) == 0;
+}
+
+void String::getBytes(unsigned char *buffer, unsigned int size, unsigned int index) const{
+    if (!size || !buffer) return;
+    if (index >= length()){
+        buffer[0] = 0;
+        return;
+    }
+    auto len = std::min((size_t)size - 1, _buffer.length() - index);
+    memcpy(buffer, _buffer.data() + index, len);
+    buffer[len] = 0;
+}
+
+int String::indexOf(char value, unsigned int from) const{
+    auto pos = _buffer.find(value, from);
+    return pos == std::string::npos ? -1 : pos;
+}
+
+int String::indexOf(const String &value, unsigned int from) const{
+    auto pos = _buffer.find(value._buffer, from);
+    return pos == std::string::npos ? -1 : pos;
+}
+
+int String::lastIndexOf(char value) const{
+    auto pos = _buffer.rfind(value);
+    return pos == std::string::npos ? -1 : pos;
+}
+
+int String::lastIndexOf(const String &value) const{
+    auto pos = _buffer.rfind(value._buffer);
+    return pos == std::string::npos ? -1 : pos;
+}
+
+String String::substring(unsigned int from) const{
+    return substring(from, length());
+}
+
+// arguments in the wrong order are swapped, out of range ones clipped
+String String::substring(unsigned int from, unsigned int to) const{
+    if (from > to) std::swap(from, to);
+    if (from >= length()) return String();
+    to = std::min(to, length());
+    return String(_buffer.substr(from, to - from));
+}
+
+void String::replace(char find, char replace){
+    for (auto &c : _buffer){
+        if (c == find) c = replace;
+    }
+}
+
+void String::replace(const String &find, const String &replace){
+    if (find.isEmpty()) return;
+    size_t pos = 0;
+    while ((pos = _buffer.find(find._buffer, pos)) != std::string::npos){
+        _buffer.replace(pos, find.length(), replace._buffer);
+        pos += replace.length();
+    }
+}
+
+void String::remove(unsigned int index){
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count){
+    if (index >= length()) return;
+    _buffer.erase(index, std::min((size_t)count, _buffer.length() - index));
+}
+
+void String::toLowerCase(){
+    for (auto &c : _buffer) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase(){
+    for (auto &c : _buffer) c = toupper((unsigned char)c);
+}
+
+void String::trim(){
+    size_t begin = 0;
+    while (begin < _buffer.length() && isspace((unsigned char)_buffer[begin])) begin++;
+    size_t end = _buffer.length();
+    while (end > begin && isspace((unsigned char)_buffer[end - 1])) end--;
+    _buffer = _buffer.substr(begin, end - begin);
+}
+
+long String::toInt() const{
+    return atol(c_str());
+}
+
+float String::toFloat() const{
+    return atof(c_str());
+}
+
+double String::toDouble() const{
+    return atof(c_str());
+}
@@ -0,0 +1,448 @@
+// Modbus TCP load generator: N concurrent connections, each keeping up to
+// <depth> pipelined requests in flight, drawn from a weighted function code
+// mix, with optional think time between requests. Prints one line per
+// interval and a summary (throughput, latency percentiles, exception and
+// timeout counts) as CSV or JSON lines. Works against the emulated gateway
+// (tools/build/gateway) and real ones.
+//
+//   tools/build/loadgen [-c connections] [-d depth] [-m mix] [-u unit] [-a address] [-n count]
+//                       [-t think ms[-max ms]] [-T timeout ms] [-i interval s] [-p port] [-j]
+//                       <gateway-ip> [seconds]
+//
+// The mix is a comma separated list of fc:weight[:address[:count]], e.g.
+// "3:70,4:10,6:10,16:10". Supported function codes: 1-6, 15 and 16.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// log-linear latency histogram in microseconds: 32 sub buckets per power of
+// two, about 3% resolution up to ~70 minutes
+class Histogram{
+    private:
+        static const int SUB_BITS = 5;
+        static const int SUB = 1 << SUB_BITS;
+        static const int BUCKETS = SUB * 28;
+        std::atomic<uint64_t> _counts[BUCKETS];
+        static int index(uint64_t value){
+            if (value < SUB) return value;
+            int msb = 63 - __builtin_clzll(value);
+            int shift = msb - SUB_BITS;
+            int i = (shift + 1) * SUB + ((value >> shift) & (SUB - 1));
+            return std::min(i, BUCKETS - 1);
+        }
+        static uint64_t upper(int i){
+            if (i < SUB) return i;
+            int shift = i / SUB - 1;
+            return ((uint64_t)(SUB + i % SUB + 1) << shift) - 1;
+        }
+    public:
+        Histogram(){ for (auto &count : _counts) count = 0; }
+        void add(uint64_t value){ _counts[index(value)].fetch_add(1, std::memory_order_relaxed); }
+        // counts since <previous>, which is updated to the current counts
+        std::vector<uint64_t> delta(std::vector<uint64_t> &previous) const{
+            std::vector<uint64_t> result(BUCKETS);
+            previous.resize(BUCKETS);
+            for (int i = 0; i < BUCKETS; i++){
+                auto now = _counts[i].load(std::memory_order_relaxed);
+                result[i] = now - previous[i];
+                previous[i] = now;
+            }
+            return result;
+        }
+        std::vector<uint64_t> snapshot() const{
+            std::vector<uint64_t> none;
+            return delta(none);
+        }
+        // <quantile> of counts in ms, 0 if empty
+        static double percentile(const std::vector<uint64_t> &counts, double quantile){
+            uint64_t total = 0;
+            for (auto count : counts) total += count;
+            if (total == 0) return 0;
+            uint64_t rank = std::max<uint64_t>(1, (uint64_t)(quantile * total + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); i++){
+                seen += counts[i];
+                if (seen >= rank) return upper(i) / 1000.0;
+            }
+            return upper(counts.size() - 1) / 1000.0;
+        }
+        static double max(const std::vector<uint64_t> &counts){
+            for (size_t i = counts.size(); i > 0; i--){
+                if (counts[i - 1]) return upper(i - 1) / 1000.0;
+            }
+            return 0;
+        }
+};
+
+struct Counters{
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> responses{0};
+    std::atomic<uint64_t> exceptions{0};
+    std::atomic<uint64_t> timeouts{0};
+    Histogram latency;
+};
+
+struct MixEntry{
+    uint8_t function;
+    unsigned weight;
+    uint16_t address;
+    uint16_t count;
+    Counters counters;
+};
+
+struct Pending{
+    uint16_t transactionId;
+    MixEntry *entry;
+    Clock::time_point sent;
+};
+
+static std::atomic<bool> running(true);
+static std::atomic<uint64_t> reconnects(0);
+static std::atomic<uint64_t> protocolErrors(0);
+static Counters total;
+static std::vector<MixEntry*> mix;
+static unsigned mixWeight = 0;
+
+static int connectTo(const char *host, uint16_t port){
+    addrinfo hints = {}, *result;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, result->ai_addr, result->ai_addrlen) != 0){
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+// PDU for <entry>, <sequence> varies the written values
+static size_t buildPdu(const MixEntry &entry, uint32_t sequence, uint8_t *pdu){
+    pdu[0] = entry.function;
+    pdu[1] = entry.address >> 8;
+    pdu[2] = entry.address;
+    switch (entry.function){
+        case 5:
+            pdu[3] = sequence & 1 ? 0xff : 0;
+            pdu[4] = 0;
+            return 5;
+        case 6:
+            pdu[3] = sequence >> 8;
+            pdu[4] = sequence;
+            return 5;
+        case 15:{
+            uint8_t bytes = (entry.count + 7) / 8;
+            pdu[3] = entry.count >> 8;
+            pdu[4] = entry.count;
+            pdu[5] = bytes;
+            for (int i = 0; i < bytes; i++) pdu[6 + i] = sequence + i;
+            return 6 + bytes;
+        }
+        case 16:
+            pdu[3] = entry.count >> 8;
+            pdu[4] = entry.count;
+            pdu[5] = entry.count * 2;
+            for (int i = 0; i < entry.count; i++){
+                pdu[6 + i * 2] = (sequence + i) >> 8;
+                pdu[7 + i * 2] = sequence + i;
+            }
+            return 6 + entry.count * 2;
+        default:
+            pdu[3] = entry.count >> 8;
+            pdu[4] = entry.count;
+            return 5;
+    }
+}
+
+static void worker(const char *host, uint16_t port, int depth, uint8_t unit,
+        int thinkMin, int thinkMax, int timeout, unsigned seed){
+    std::mt19937 random(seed);
+    uint16_t transactionId = 0;
+    uint32_t sequence = 0;
+    std::vector<uint8_t> input;
+    while (running){
+        int fd = connectTo(host, port);
+        if (fd < 0){
+            reconnects++;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        std::deque<Pending> pending;
+        input.clear();
+        auto nextSend = Clock::now();
+        uint64_t answered = 0;
+        bool ok = true;
+        while (running && ok){
+            auto now = Clock::now();
+            while ((int)pending.size() < depth && now >= nextSend){
+                unsigned pick = random() % mixWeight;
+                auto entry = mix.front();
+                for (auto candidate : mix){
+                    entry = candidate;
+                    if (pick < candidate->weight) break;
+                    pick -= candidate->weight;
+                }
+                uint8_t frame[7 + 253];
+                auto len = buildPdu(*entry, sequence++, frame + 7);
+                transactionId++;
+                frame[0] = transactionId >> 8;
+                frame[1] = transactionId;
+                frame[2] = 0;
+                frame[3] = 0;
+                frame[4] = (len + 1) >> 8;
+                frame[5] = len + 1;
+                frame[6] = unit;
+                if (send(fd, frame, len + 7, MSG_NOSIGNAL) != (ssize_t)(len + 7)){
+                    ok = false;
+                    break;
+                }
+                pending.push_back({transactionId, entry, now});
+                entry->counters.requests++;
+                total.requests++;
+                if (thinkMax > 0){
+                    nextSend = now + std::chrono::milliseconds(thinkMin + (thinkMax > thinkMin ? random() % (thinkMax - thinkMin + 1) : 0));
+                }
+            }
+            if (!ok) break;
+            // drop requests nobody answered in time, a late answer is ignored
+            while (!pending.empty() && now - pending.front().sent >= std::chrono::milliseconds(timeout)){
+                pending.front().entry->counters.timeouts++;
+                total.timeouts++;
+                pending.pop_front();
+            }
+            auto wait = std::chrono::milliseconds(100);
+            if (!pending.empty()) wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(pending.front().sent + std::chrono::milliseconds(timeout) - now));
+            if ((int)pending.size() < depth) wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(nextSend - now));
+            pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, std::max<int>(0, wait.count())) <= 0) continue;
+            uint8_t buffer[2048];
+            auto n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            input.insert(input.end(), buffer, buffer + n);
+            now = Clock::now();
+            size_t pos = 0;
+            while (input.size() - pos >= 8){
+                auto frame = &input[pos];
+                uint16_t len = (frame[4] << 8) | frame[5];
+                if (frame[2] != 0 || frame[3] != 0 || len < 2 || len > 254){
+                    protocolErrors++;
+                    ok = false;
+                    break;
+                }
+                if (input.size() - pos < 6u + len) break;
+                uint16_t id = (frame[0] << 8) | frame[1];
+                auto match = std::find_if(pending.begin(), pending.end(), [id](const Pending &p){ return p.transactionId == id; });
+                if (match != pending.end()){
+                    auto entry = match->entry;
+                    if ((frame[7] & 0x7f) != entry->function) protocolErrors++;
+                    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(now - match->sent).count();
+                    entry->counters.responses++;
+                    entry->counters.latency.add(latency);
+                    total.responses++;
+                    total.latency.add(latency);
+                    if (frame[7] & 0x80){
+                        entry->counters.exceptions++;
+                        total.exceptions++;
+                    }
+                    pending.erase(match);
+                    answered++;
+                }
+                pos += 6 + len;
+            }
+            input.erase(input.begin(), input.begin() + pos);
+        }
+        close(fd);
+        if (running){
+            reconnects++;
+            // refused by a full gateway (max clients), don't hammer it
+            if (answered == 0) std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+}
+
+static bool parseMix(const char *text, uint16_t address, uint16_t count){
+    std::string spec(text);
+    size_t start = 0;
+    while (start <= spec.size()){
+        auto end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        unsigned values[4] = {0, 1, address, count};
+        int fields = sscanf(spec.substr(start, end - start).c_str(), "%u:%u:%u:%u", &values[0], &values[1], &values[2], &values[3]);
+        auto fc = values[0];
+        if (fields < 1 || !((fc >= 1 && fc <= 6) || fc == 15 || fc == 16)){
+            fprintf(stderr, "invalid mix entry: %s\n", spec.substr(start, end - start).c_str());
+            return false;
+        }
+        // keep the frames within the protocol limits
+        unsigned limit = fc <= 2 ? 2000 : fc <= 4 ? 125 : fc == 15 ? 1968 : fc == 16 ? 123 : 1;
+        auto entry = new MixEntry();
+        entry->function = fc;
+        entry->weight = values[1];
+        entry->address = values[2];
+        entry->count = std::max(1u, std::min(values[3], limit));
+        mix.push_back(entry);
+        mixWeight += entry->weight;
+        start = end + 1;
+    }
+    return mixWeight > 0;
+}
+
+struct Row{
+    double seconds;
+    double elapsed;
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t exceptions;
+    uint64_t timeouts;
+    std::vector<uint64_t> latency;
+};
+
+static void printRow(const char *label, const Row &row, bool json){
+    double rate = row.elapsed > 0 ? row.responses / row.elapsed : 0;
+    if (json){
+        printf("{\"t\":%s,\"requests\":%lu,\"responses\":%lu,\"rps\":%.1f,\"exceptions\":%lu,\"timeouts\":%lu,"
+            "\"reconnects\":%lu,\"protocol_errors\":%lu,\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f",
+            label, (unsigned long)row.requests, (unsigned long)row.responses, rate,
+            (unsigned long)row.exceptions, (unsigned long)row.timeouts,
+            (unsigned long)reconnects, (unsigned long)protocolErrors,
+            Histogram::percentile(row.latency, 0.5), Histogram::percentile(row.latency, 0.9),
+            Histogram::percentile(row.latency, 0.99), Histogram::percentile(row.latency, 0.999),
+            Histogram::max(row.latency));
+    }
+    else{
+        printf("%s,%lu,%lu,%.1f,%lu,%lu,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+            label, (unsigned long)row.requests, (unsigned long)row.responses, rate,
+            (unsigned long)row.exceptions, (unsigned long)row.timeouts,
+            (unsigned long)reconnects, (unsigned long)protocolErrors,
+            Histogram::percentile(row.latency, 0.5), Histogram::percentile(row.latency, 0.9),
+            Histogram::percentile(row.latency, 0.99), Histogram::percentile(row.latency, 0.999),
+            Histogram::max(row.latency));
+    }
+}
+
+int main(int argc, char **argv){
+    int connections = 4, depth = 1, interval = 1;
+    int unit = 1, address = 0, count = 10, port = 502;
+    int thinkMin = 0, thinkMax = 0, timeout = 2000;
+    const char *mixSpec = "3:1";
+    bool json = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:m:u:a:n:t:T:i:p:j")) != -1){
+        switch (opt){
+            case 'c': connections = atoi(optarg); break;
+            case 'd': depth = std::max(1, atoi(optarg)); break;
+            case 'm': mixSpec = optarg; break;
+            case 'u': unit = atoi(optarg); break;
+            case 'a': address = atoi(optarg); break;
+            case 'n': count = atoi(optarg); break;
+            case 't':
+                if (sscanf(optarg, "%d-%d", &thinkMin, &thinkMax) < 2) thinkMax = thinkMin;
+                break;
+            case 'T': timeout = std::max(1, atoi(optarg)); break;
+            case 'i': interval = atoi(optarg); break;
+            case 'p': port = atoi(optarg); break;
+            case 'j': json = true; break;
+            default: return 1;
+        }
+    }
+    if (optind >= argc){
+        fprintf(stderr, "usage: %s [-c connections] [-d depth] [-m fc:weight[:address[:count]],...] [-u unit] [-a address] [-n count]\n"
+            "          [-t think ms[-max ms]] [-T timeout ms] [-i interval s] [-p port] [-j] <gateway-ip> [seconds]\n", argv[0]);
+        return 1;
+    }
+    if (!parseMix(mixSpec, address, count)) return 1;
+    const char *host = argv[optind];
+    double seconds = optind + 1 < argc ? atof(argv[optind + 1]) : 60;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < connections; i++){
+        workers.emplace_back(worker, host, port, depth, unit, thinkMin, thinkMax, timeout, 0x5eed + i);
+    }
+    if (!json) printf("seconds,requests,responses,rps,exceptions,timeouts,reconnects,protocol_errors,p50_ms,p90_ms,p99_ms,p999_ms,max_ms\n");
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    auto last = start;
+    uint64_t lastRequests = 0, lastResponses = 0, lastExceptions = 0, lastTimeouts = 0;
+    std::vector<uint64_t> lastLatency;
+    while (interval > 0 && Clock::now() < end){
+        std::this_thread::sleep_until(std::min(last + std::chrono::seconds(interval), end));
+        auto now = Clock::now();
+        Row row;
+        row.seconds = std::chrono::duration<double>(now - start).count();
+        row.elapsed = std::chrono::duration<double>(now - last).count();
+        row.requests = total.requests - lastRequests;
+        row.responses = total.responses - lastResponses;
+        row.exceptions = total.exceptions - lastExceptions;
+        row.timeouts = total.timeouts - lastTimeouts;
+        row.latency = total.latency.delta(lastLatency);
+        lastRequests += row.requests;
+        lastResponses += row.responses;
+        lastExceptions += row.exceptions;
+        lastTimeouts += row.timeouts;
+        last = now;
+        char label[32];
+        snprintf(label, sizeof(label), "%.0f", row.seconds);
+        printRow(label, row, json);
+        if (json) printf("}\n");
+        fflush(stdout);
+    }
+    if (interval <= 0) std::this_thread::sleep_until(end);
+    running = false;
+    for (auto &worker : workers) worker.join();
+
+    Row summary;
+    summary.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    summary.seconds = summary.elapsed;
+    summary.requests = total.requests;
+    summary.responses = total.responses;
+    summary.exceptions = total.exceptions;
+    summary.timeouts = total.timeouts;
+    summary.latency = total.latency.snapshot();
+    printRow(json ? "\"total\"" : "total", summary, json);
+    if (json){
+        printf(",\"connections\":%d,\"depth\":%d,\"functions\":[", connections, depth);
+        for (size_t i = 0; i < mix.size(); i++){
+            auto &counters = mix[i]->counters;
+            auto latency = counters.latency.snapshot();
+            printf("%s{\"fc\":%u,\"address\":%u,\"count\":%u,\"requests\":%lu,\"responses\":%lu,\"exceptions\":%lu,\"timeouts\":%lu,\"p50_ms\":%.3f,\"p99_ms\":%.3f}",
+                i ? "," : "", mix[i]->function, mix[i]->address, mix[i]->count,
+                (unsigned long)counters.requests, (unsigned long)counters.responses,
+                (unsigned long)counters.exceptions, (unsigned long)counters.timeouts,
+                Histogram::percentile(latency, 0.5), Histogram::percentile(latency, 0.99));
+        }
+        printf("]}\n");
+    }
+    else{
+        for (auto entry : mix){
+            auto &counters = entry->counters;
+            auto latency = counters.latency.snapshot();
+            fprintf(stderr, "fc %2u @%u x%u: %lu requests, %lu responses, %lu exceptions, %lu timeouts, p50 %.3f ms, p99 %.3f ms\n",
+                entry->function, entry->address, entry->count,
+                (unsigned long)counters.requests, (unsigned long)counters.responses,
+                (unsigned long)counters.exceptions, (unsigned long)counters.timeouts,
+                Histogram::percentile(latency, 0.5), Histogram::percentile(latency, 0.99));
+        }
+    }
+    return 0;
+}
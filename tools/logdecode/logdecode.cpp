@@ -0,0 +1,98 @@
+// Host decoder for the binary event log (Config "Binary log" option).
+// Frames are turned back into text lines using the shared event table,
+// any other byte (boot messages printed with dbg) is passed through as is.
+//
+//   stty -F /dev/ttyUSB0 115200 raw && tools/build/logdecode < /dev/ttyUSB0
+//   tools/build/logdecode capture.bin
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "event_log_events.h"
+
+static const char *const eventFormats[] = {
+    EVENT_LOG_EVENTS(EVENT_LOG_FORMAT)
+};
+
+static const char *const levelNames[] = {"-", "E", "W", "I", "D"};
+
+static uint32_t get32(const uint8_t *p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// returns false if the payload does not match the event table
+static bool decode(const uint8_t *payload, size_t len, std::string &line){
+    if (len < 8) return false;
+    uint32_t timestamp = get32(payload);
+    uint16_t event = payload[4] | (payload[5] << 8);
+    uint8_t level = payload[6];
+    uint8_t argc = payload[7];
+    if (event >= EV_COUNT || argc > EVENT_LOG_MAX_ARGS) return false;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%10u %s ", timestamp, level < 5 ? levelNames[level] : "?");
+    line = buf;
+    size_t pos = 8;
+    uint8_t arg = 0;
+    for (auto format = eventFormats[event]; *format; format++){
+        if (*format != '%' || !format[1]){
+            line += *format;
+            continue;
+        }
+        auto kind = *++format;
+        if (kind == '%'){
+            line += '%';
+            continue;
+        }
+        if (arg++ >= argc) continue;
+        if (kind == 's'){
+            if (pos >= len || pos + 1 + payload[pos] > len) return false;
+            line.append((const char*)payload + pos + 1, payload[pos]);
+            pos += 1 + payload[pos];
+            continue;
+        }
+        if (pos + 4 > len) return false;
+        uint32_t value = get32(payload + pos);
+        pos += 4;
+        switch (kind){
+            case 'u': snprintf(buf, sizeof(buf), "%u", value); break;
+            case 'd': snprintf(buf, sizeof(buf), "%d", (int32_t)value); break;
+            case 'x': snprintf(buf, sizeof(buf), "%x", value); break;
+            case 'I': snprintf(buf, sizeof(buf), "%u.%u.%u.%u", value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24); break;
+            default: snprintf(buf, sizeof(buf), "?"); break;
+        }
+        line += buf;
+    }
+    return pos == len;
+}
+
+int main(int argc, char **argv){
+    FILE *in = stdin;
+    if (argc > 1 && !(in = fopen(argv[1], "rb"))){
+        perror(argv[1]);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    int c;
+    while ((c = fgetc(in)) != EOF){
+        if (c != EVENT_LOG_SYNC1){
+            putchar(c);
+            continue;
+        }
+        int sync = fgetc(in);
+        if (sync != EVENT_LOG_SYNC2){
+            putchar(c);
+            if (sync == EOF) break;
+            ungetc(sync, in);
+            continue;
+        }
+        int len = fgetc(in);
+        if (len == EOF) break;
+        uint8_t payload[255];
+        if (fread(payload, 1, len, in) != (size_t)len) break;
+        std::string line;
+        if (decode(payload, len, line)) printf("%s\n", line.c_str());
+        else printf("<bad frame, %d bytes>\n", len);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+# PlatformIO extra script adding a "sizereport" target that builds the debug and
+# release variants and compares their flash/RAM usage:
+#
+#   pio run -e esp32debug -t sizereport
+
+Import("env")
+
+import os
+import subprocess
+
+# (debug, release) environment pairs
+VARIANTS = [
+    ("esp32debug", "esp32release"),
+    ("esp32-enc28j60", "esp32-enc28j60-release"),
+]
+
+# sections loaded from flash and sections occupying internal RAM
+FLASH_SECTIONS = (".flash.text", ".flash.rodata", ".iram0.vectors", ".iram0.text", ".dram0.data")
+RAM_SECTIONS = (".dram0.data", ".dram0.bss")
+
+
+def sections(elf):
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf], universal_newlines=True)
+    result = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            result[fields[0]] = int(fields[1])
+    return result
+
+
+def usage(name):
+    build = os.path.join(env.subst("$PROJECT_BUILD_DIR"), name)
+    sizes = sections(os.path.join(build, "firmware.elf"))
+    return {
+        "image": os.path.getsize(os.path.join(build, "firmware.bin")),
+        "flash": sum(sizes.get(section, 0) for section in FLASH_SECTIONS),
+        "rodata": sizes.get(".flash.rodata", 0),
+        "ram": sum(sizes.get(section, 0) for section in RAM_SECTIONS),
+    }
+
+
+def report(target, source, env):
+    names = [name for pair in VARIANTS for name in pair]
+    command = [env.subst("$PYTHONEXE"), "-m", "platformio", "run", "-d", env.subst("$PROJECT_DIR")]
+    for name in names:
+        command += ["-e", name]
+    subprocess.check_call(command)
+    print("")
+    print("%-24s %10s %10s %10s %10s" % ("environment", "image", "flash", "rodata", "ram"))
+    for debug, release in VARIANTS:
+        before = usage(debug)
+        after = usage(release)
+        for name, values in ((debug, before), (release, after)):
+            print("%-24s %10d %10d %10d %10d" % (name, values["image"], values["flash"], values["rodata"], values["ram"]))
+        print("%-24s %+10d %+10d %+10d %+10d" % ("  difference",
+            after["image"] - before["image"], after["flash"] - before["flash"],
+            after["rodata"] - before["rodata"], after["ram"] - before["ram"]))
+    print("")
+
+
+env.AddCustomTarget(
+    name="sizereport",
+    dependencies=None,
+    actions=[report],
+    title="Size report",
+    description="Build debug and release variants and compare their size",
+)
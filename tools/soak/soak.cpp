@@ -0,0 +1,188 @@
+// Long running soak test against a gateway: keeps Modbus TCP connections busy
+// with pipelined reads and samples heap/fragmentation from /metrics, one CSV
+// line per interval. Run it before and after a firmware change and compare
+// the largest free block and fragmentation columns.
+//
+//   tools/build/soak [-c connections] [-d depth] [-u unit] [-a address] [-n count]
+//                    [-i interval s] [-w user:password] <gateway-ip> [minutes]
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<bool> running(true);
+static std::atomic<uint64_t> responses(0);
+static std::atomic<uint64_t> exceptions(0);
+static std::atomic<uint64_t> reconnects(0);
+
+static int connectTo(const char *host, uint16_t port){
+    addrinfo hints = {}, *result;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, result->ai_addr, result->ai_addrlen) != 0){
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+static bool readFully(int fd, uint8_t *buffer, size_t len){
+    while (len > 0){
+        auto n = recv(fd, buffer, len, 0);
+        if (n <= 0) return false;
+        buffer += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void worker(const char *host, int depth, uint8_t unit, uint16_t address, uint16_t count){
+    uint16_t transactionId = 0;
+    while (running){
+        int fd = connectTo(host, 502);
+        if (fd < 0){
+            reconnects++;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        int outstanding = 0;
+        bool ok = true;
+        while (running && ok){
+            while (outstanding < depth){
+                uint8_t frame[12] = {(uint8_t)(transactionId >> 8), (uint8_t)transactionId, 0, 0, 0, 6,
+                    unit, 3, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(count >> 8), (uint8_t)count};
+                transactionId++;
+                if (send(fd, frame, sizeof(frame), MSG_NOSIGNAL) != sizeof(frame)){
+                    ok = false;
+                    break;
+                }
+                outstanding++;
+            }
+            uint8_t header[7];
+            uint8_t pdu[260];
+            if (!ok || !readFully(fd, header, sizeof(header))) break;
+            uint16_t len = (header[4] << 8) | header[5];
+            if (len < 2 || len > sizeof(pdu) + 1 || !readFully(fd, pdu, len - 1)) break;
+            outstanding--;
+            responses++;
+            if (pdu[0] & 0x80) exceptions++;
+        }
+        close(fd);
+        if (running) reconnects++;
+    }
+}
+
+static std::string base64(const std::string &text){
+    static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    for (size_t i = 0; i < text.size(); i += 3){
+        uint32_t value = (uint8_t)text[i] << 16;
+        if (i + 1 < text.size()) value |= (uint8_t)text[i + 1] << 8;
+        if (i + 2 < text.size()) value |= (uint8_t)text[i + 2];
+        result += alphabet[(value >> 18) & 0x3f];
+        result += alphabet[(value >> 12) & 0x3f];
+        result += i + 1 < text.size() ? alphabet[(value >> 6) & 0x3f] : '=';
+        result += i + 2 < text.size() ? alphabet[value & 0x3f] : '=';
+    }
+    return result;
+}
+
+// fetch /metrics, returns name -> value of all unlabelled metrics
+static std::map<std::string, double> metrics(const char *host, const std::string &auth){
+    std::map<std::string, double> result;
+    int fd = connectTo(host, 80);
+    if (fd < 0) return result;
+    std::string request = std::string("GET /metrics HTTP/1.0\r\nHost: ") + host + "\r\n";
+    if (!auth.empty()) request += "Authorization: Basic " + base64(auth) + "\r\n";
+    request += "\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    std::string body;
+    char buffer[1024];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) body.append(buffer, n);
+    close(fd);
+    size_t pos = body.find("\r\n\r\n");
+    while (pos != std::string::npos && pos < body.size()){
+        auto end = body.find('\n', pos + 1);
+        auto line = body.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        auto space = line.find(' ');
+        auto start = line.find_first_not_of("\r\n");
+        if (start != std::string::npos && space != std::string::npos && line.find('{') == std::string::npos){
+            result[line.substr(start, space - start)] = atof(line.c_str() + space + 1);
+        }
+        pos = end;
+    }
+    return result;
+}
+
+int main(int argc, char **argv){
+    int connections = 2, depth = 4, interval = 60;
+    int unit = 1, address = 0, count = 10;
+    std::string auth;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:u:a:n:i:w:")) != -1){
+        switch (opt){
+            case 'c': connections = atoi(optarg); break;
+            case 'd': depth = atoi(optarg); break;
+            case 'u': unit = atoi(optarg); break;
+            case 'a': address = atoi(optarg); break;
+            case 'n': count = atoi(optarg); break;
+            case 'i': interval = atoi(optarg); break;
+            case 'w': auth = optarg; break;
+            default: return 1;
+        }
+    }
+    if (optind >= argc){
+        fprintf(stderr, "usage: %s [-c connections] [-d depth] [-u unit] [-a address] [-n count] [-i interval] [-w user:password] <gateway-ip> [minutes]\n", argv[0]);
+        return 1;
+    }
+    const char *host = argv[optind];
+    double minutes = optind + 1 < argc ? atof(argv[optind + 1]) : 60;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < connections; i++){
+        workers.emplace_back(worker, host, depth, unit, address, count);
+    }
+    printf("seconds,responses,exceptions,reconnects,heap_free,heap_min_free,largest_block,min_largest_block,fragmentation,buffer_fallbacks,alloc_failures\n");
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(minutes * 60));
+    auto next = start;
+    while (Clock::now() < end){
+        auto values = metrics(host, auth);
+        printf("%.0f,%lu,%lu,%lu,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+            std::chrono::duration<double>(Clock::now() - start).count(),
+            (unsigned long)responses, (unsigned long)exceptions, (unsigned long)reconnects,
+            values["gateway_heap_free_bytes"], values["gateway_heap_min_free_bytes"],
+            values["gateway_heap_largest_block_bytes"], values["gateway_heap_min_largest_block_bytes"],
+            values["gateway_heap_fragmentation_percent"], values["gateway_bridge_buffer_fallbacks_total"],
+            values["gateway_alloc_failures_total"]);
+        fflush(stdout);
+        next += std::chrono::seconds(interval);
+        std::this_thread::sleep_until(std::min(next, end));
+    }
+    running = false;
+    for (auto &worker : workers) worker.join();
+    return 0;
+}
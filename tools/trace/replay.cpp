@@ -0,0 +1,247 @@
+// Replays a bridge trace (Debug page "Download trace") against a gateway:
+// every recorded connection gets its own Modbus TCP connection and its
+// requests are sent at the recorded times, divided by the speed factor
+// (-s 0: each request as soon as the previous answer of its connection is in).
+// Answers are compared with the recorded ones and the latencies reported next
+// to the recorded latencies. Together with slavesim (answers the rtu side from
+// the same trace) this gives a repeatable run for before/after comparisons.
+//
+//   tools/build/replay [-s speed] [-p port] [-T timeout ms] [-o per-request.csv] <trace> <gateway-ip>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "trace_file.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Result{
+    const TraceTransaction *transaction;
+    bool answered;
+    bool match;
+    uint64_t latency;
+};
+
+static std::mutex resultLock;
+static std::vector<Result> results;
+static uint32_t reconnects = 0;
+
+static int connectTo(const char *host, uint16_t port){
+    addrinfo hints = {}, *result;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, result->ai_addr, result->ai_addrlen) != 0){
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+struct Pending{
+    const TraceTransaction *transaction;
+    Clock::time_point sent;
+};
+
+static void record(const TraceTransaction *transaction, bool answered, bool match, uint64_t latency){
+    std::lock_guard<std::mutex> guard(resultLock);
+    results.push_back({transaction, answered, match, latency});
+}
+
+// replays the transactions of one recorded connection
+static void connection(const char *host, uint16_t port, std::vector<const TraceTransaction*> transactions,
+        uint64_t origin, Clock::time_point start, double speed, int timeout){
+    int fd = -1;
+    std::deque<Pending> pending;
+    std::vector<uint8_t> input;
+    size_t next = 0;
+    int failures = 0;
+    while (next < transactions.size() || !pending.empty()){
+        if (fd < 0){
+            fd = connectTo(host, port);
+            if (fd < 0){
+                fprintf(stderr, "connect to %s:%u failed\n", host, port);
+                if (++failures == 3){
+                    // give up, the rest of this connection counts as unanswered
+                    for (; next < transactions.size(); next++) record(transactions[next], false, false, 0);
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+            failures = 0;
+            input.clear();
+        }
+        auto now = Clock::now();
+        Clock::time_point due = now + std::chrono::hours(1);
+        while (next < transactions.size()){
+            auto request = transactions[next]->request;
+            if (speed > 0){
+                due = start + std::chrono::microseconds((uint64_t)((request->time - origin) / speed));
+                if (due > now) break;
+            }
+            else if (!pending.empty()){
+                break;
+            }
+            uint8_t frame[6 + 256];
+            frame[0] = request->transactionId >> 8;
+            frame[1] = request->transactionId;
+            frame[2] = 0;
+            frame[3] = 0;
+            frame[4] = request->pdu.size() >> 8;
+            frame[5] = request->pdu.size();
+            std::copy(request->pdu.begin(), request->pdu.end(), frame + 6);
+            size_t len = 6 + request->pdu.size();
+            if (send(fd, frame, len, MSG_NOSIGNAL) != (ssize_t)len) break;
+            pending.push_back({transactions[next], now});
+            next++;
+        }
+        while (!pending.empty() && now - pending.front().sent >= std::chrono::milliseconds(timeout)){
+            record(pending.front().transaction, false, false, 0);
+            pending.pop_front();
+        }
+        auto wait = std::chrono::milliseconds(100);
+        if (next < transactions.size() && speed > 0){
+            wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(due - now));
+        }
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, std::max<int>(0, wait.count())) <= 0) continue;
+        uint8_t buffer[2048];
+        auto n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0){
+            // what was in flight is lost, go on with a new connection
+            for (auto &p : pending) record(p.transaction, false, false, 0);
+            pending.clear();
+            close(fd);
+            fd = -1;
+            std::lock_guard<std::mutex> guard(resultLock);
+            reconnects++;
+            continue;
+        }
+        input.insert(input.end(), buffer, buffer + n);
+        now = Clock::now();
+        size_t pos = 0;
+        while (input.size() - pos >= 8){
+            uint16_t len = (input[pos + 4] << 8) | input[pos + 5];
+            if (input.size() - pos < 6u + len) break;
+            uint16_t id = (input[pos] << 8) | input[pos + 1];
+            auto match = std::find_if(pending.begin(), pending.end(), [id](const Pending &p){ return p.transaction->request->transactionId == id; });
+            if (match != pending.end()){
+                auto expected = match->transaction->response;
+                bool same = expected && expected->pdu.size() == len && std::equal(expected->pdu.begin(), expected->pdu.end(), input.begin() + pos + 6);
+                record(match->transaction, true, same, std::chrono::duration_cast<std::chrono::microseconds>(now - match->sent).count());
+                pending.erase(match);
+            }
+            pos += 6 + len;
+        }
+        input.erase(input.begin(), input.begin() + pos);
+    }
+    if (fd >= 0) close(fd);
+}
+
+static double percentile(std::vector<uint64_t> values, double quantile){
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(quantile * values.size()));
+    return values[index] / 1000.0;
+}
+
+int main(int argc, char **argv){
+    double speed = 1;
+    int port = 502, timeout = 5000;
+    const char *csv = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:T:o:")) != -1){
+        switch (opt){
+            case 's': speed = atof(optarg); break;
+            case 'p': port = atoi(optarg); break;
+            case 'T': timeout = std::max(1, atoi(optarg)); break;
+            case 'o': csv = optarg; break;
+            default: return 1;
+        }
+    }
+    if (optind + 2 > argc){
+        fprintf(stderr, "usage: %s [-s speed] [-p port] [-T timeout ms] [-o per-request.csv] <trace> <gateway-ip>\n", argv[0]);
+        return 1;
+    }
+    Trace trace;
+    if (!loadTrace(argv[optind], trace)) return 1;
+    const char *host = argv[optind + 1];
+    if (trace.transactions.empty()){
+        fprintf(stderr, "no requests in trace\n");
+        return 1;
+    }
+    if (trace.dropped) fprintf(stderr, "note: %u records were dropped while recording\n", trace.dropped);
+
+    std::map<uint8_t, std::vector<const TraceTransaction*>> connections;
+    for (auto &transaction : trace.transactions){
+        connections[transaction.request->connection].push_back(&transaction);
+    }
+    uint64_t origin = trace.transactions.front().request->time;
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto &entry : connections){
+        threads.emplace_back(connection, host, port, entry.second, origin, start, speed, timeout);
+    }
+    for (auto &thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> replayed, recorded;
+    uint32_t answered = 0, matched = 0, unrecorded = 0;
+    for (auto &result : results){
+        auto response = result.transaction->response;
+        if (response) recorded.push_back(response->time - result.transaction->request->time);
+        if (!result.answered) continue;
+        answered++;
+        replayed.push_back(result.latency);
+        // still in flight when the trace was taken, nothing to compare with
+        if (!response) unrecorded++;
+        else if (result.match) matched++;
+    }
+    printf("requests:   %zu on %zu connections in %.1f s (recorded %.1f s)\n", results.size(), connections.size(), seconds,
+        (trace.records.back().time - origin) / 1e6);
+    printf("answered:   %u, timeouts %zu, reconnects %u\n", answered, results.size() - answered, reconnects);
+    printf("matching:   %u, differing %u, no recorded response %u\n", matched, answered - matched - unrecorded, unrecorded);
+    printf("latency ms  %10s %10s\n", "replay", "recorded");
+    printf("  p50       %10.3f %10.3f\n", percentile(replayed, 0.5), percentile(recorded, 0.5));
+    printf("  p90       %10.3f %10.3f\n", percentile(replayed, 0.9), percentile(recorded, 0.9));
+    printf("  p99       %10.3f %10.3f\n", percentile(replayed, 0.99), percentile(recorded, 0.99));
+    printf("  max       %10.3f %10.3f\n", percentile(replayed, 1), percentile(recorded, 1));
+
+    if (csv){
+        auto file = fopen(csv, "w");
+        if (!file){
+            perror(csv);
+            return 1;
+        }
+        std::sort(results.begin(), results.end(), [](const Result &a, const Result &b){ return a.transaction < b.transaction; });
+        fprintf(file, "index,connection,transaction,unit,fc,recorded_us,replay_us,answered,match\n");
+        for (auto &result : results){
+            auto request = result.transaction->request;
+            auto response = result.transaction->response;
+            fprintf(file, "%zu,%u,%u,%u,%u,%llu,%llu,%d,%d\n", (size_t)(result.transaction - &trace.transactions[0]),
+                request->connection, request->transactionId, request->pdu[0], request->pdu.size() > 1 ? request->pdu[1] : 0,
+                response ? (unsigned long long)(response->time - request->time) : 0ULL,
+                (unsigned long long)result.latency, result.answered, result.match);
+        }
+        fclose(file);
+    }
+    return answered == results.size() && matched + unrecorded == answered ? 0 : 2;
+}
@@ -0,0 +1,162 @@
+// RTU slave simulator answering from a bridge trace: every request the gateway
+// sent to the bus is answered with the response recorded for it, after the
+// recorded bus time (minus the time the frames take on the wire, divided by
+// -x). Repeated requests get their recorded responses in recorded order, then
+// start over. Requests that timed out on the bus stay unanswered. Requests
+// not in the trace (e.g. writes the gateway combines differently) are echoed
+// if they are writes, everything else is left unanswered.
+//
+//   tools/build/slavesim [-b baud] [-x speed] <trace> <tty>
+//
+// <tty> is the emulator's pty (tools/build/gateway -l /tmp/gw-rtu) or a
+// USB RS-485 adapter on the bus of a real gateway.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "modbus_crc.h"
+#include "trace_file.h"
+
+// exception code the bridge answers with when the slave did not respond
+#define GATEWAY_TARGET_NO_RESP 0x0b
+
+struct Answers{
+    std::vector<const TraceRecord*> responses;
+    size_t next;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static speed_t toSpeed(long baud){
+    switch (baud){
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B0;
+    }
+}
+
+int main(int argc, char **argv){
+    long baud = 9600;
+    double speed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:x:")) != -1){
+        switch (opt){
+            case 'b': baud = atol(optarg); break;
+            case 'x': speed = atof(optarg); break;
+            default: return 1;
+        }
+    }
+    if (optind + 2 > argc || toSpeed(baud) == B0 || speed <= 0){
+        fprintf(stderr, "usage: %s [-b baud] [-x speed] <trace> <tty>\n", argv[0]);
+        return 1;
+    }
+    Trace trace;
+    if (!loadTrace(argv[optind], trace)) return 1;
+    // only what went over the bus: the gateway's own answers have no bus time
+    std::map<std::string, Answers> answers;
+    for (auto &transaction : trace.transactions){
+        if (!transaction.response || transaction.response->busTime == 0) continue;
+        auto &pdu = transaction.request->pdu;
+        auto &entry = answers[std::string(pdu.begin(), pdu.end())];
+        entry.responses.push_back(transaction.response);
+        entry.next = 0;
+    }
+    fprintf(stderr, "%zu distinct requests from %zu transactions\n", answers.size(), trace.transactions.size());
+
+    int fd = open(argv[optind + 1], O_RDWR | O_NOCTTY);
+    if (fd < 0){
+        perror(argv[optind + 1]);
+        return 1;
+    }
+    termios tty;
+    if (tcgetattr(fd, &tty) == 0){
+        cfmakeraw(&tty);
+        cfsetspeed(&tty, toSpeed(baud));
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+    signal(SIGINT, [](int){ running = 0; });
+    signal(SIGTERM, [](int){ running = 0; });
+
+    // 11 bit characters, 3.5 characters of silence end a frame
+    double charTime = 11e6 / baud;
+    int gap = std::max(2, (int)(3.5 * charTime / 1000 + 1));
+    uint32_t frames = 0, replayed = 0, silent = 0, echoed = 0, unknown = 0, crcErrors = 0;
+    std::vector<uint8_t> frame;
+    while (running){
+        pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, frame.empty() ? 200 : gap);
+        if (ready > 0){
+            uint8_t buffer[256];
+            auto n = read(fd, buffer, sizeof(buffer));
+            if (n > 0) frame.insert(frame.end(), buffer, buffer + n);
+            continue;
+        }
+        if (frame.empty()) continue;
+        auto received = std::chrono::steady_clock::now();
+        frames++;
+        if (frame.size() < 4 || modbusCrc16(frame.data(), frame.size() - 2) != (frame[frame.size() - 2] | (frame[frame.size() - 1] << 8))){
+            crcErrors++;
+            frame.clear();
+            continue;
+        }
+        std::string key(frame.begin(), frame.end() - 2);
+        std::vector<uint8_t> response;
+        uint32_t busTime = 0;
+        auto found = answers.find(key);
+        if (found != answers.end()){
+            auto &entry = found->second;
+            auto recorded = entry.responses[entry.next];
+            entry.next = (entry.next + 1) % entry.responses.size();
+            auto &pdu = recorded->pdu;
+            if (pdu.size() == 3 && (pdu[1] & 0x80) && pdu[2] == GATEWAY_TARGET_NO_RESP){
+                silent++;
+            }
+            else{
+                response = pdu;
+                busTime = recorded->busTime;
+                replayed++;
+            }
+        }
+        else if (frame.size() >= 8 && (frame[1] == 5 || frame[1] == 6 || frame[1] == 15 || frame[1] == 16) && frame[0] != 0){
+            response.assign(frame.begin(), frame.begin() + 6);
+            echoed++;
+        }
+        else{
+            unknown++;
+        }
+        // the recorded bus time includes both frames on the wire
+        auto wire = (frame.size() + response.size() + 2) * charTime;
+        if (!response.empty()){
+            if (busTime / speed > wire){
+                std::this_thread::sleep_until(received + std::chrono::microseconds((uint64_t)(busTime / speed - wire)));
+            }
+            auto crc = modbusCrc16(response.data(), response.size());
+            response.push_back(crc & 0xff);
+            response.push_back(crc >> 8);
+            if (write(fd, response.data(), response.size()) != (ssize_t)response.size()) perror("write");
+        }
+        frame.clear();
+    }
+    fprintf(stderr, "%u frames: %u replayed, %u left unanswered (recorded timeouts), %u writes echoed, %u unknown, %u crc errors\n",
+        frames, replayed, silent, echoed, unknown, crcErrors);
+    close(fd);
+    return 0;
+}
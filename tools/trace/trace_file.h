@@ -0,0 +1,88 @@
+#ifndef TRACE_FILE_H
+    #define TRACE_FILE_H
+
+    #include <cstdint>
+    #include <cstdio>
+    #include <cstring>
+    #include <vector>
+    #include "trace_format.h"
+
+    struct TraceRecord{
+        uint8_t type;
+        uint8_t connection;
+        uint16_t transactionId;
+        // gateway micros(), unwrapped to 64 bit
+        uint64_t time;
+        uint32_t busTime;
+        std::vector<uint8_t> pdu;
+    };
+
+    // a request with the response the gateway sent for it
+    struct TraceTransaction{
+        const TraceRecord *request;
+        const TraceRecord *response;
+    };
+
+    struct Trace{
+        uint32_t dropped;
+        std::vector<TraceRecord> records;
+        std::vector<TraceTransaction> transactions;
+    };
+
+    // returns false (and prints why) if <path> is not a readable trace
+    static inline bool loadTrace(const char *path, Trace &trace){
+        auto file = fopen(path, "rb");
+        if (!file){
+            perror(path);
+            return false;
+        }
+        uint8_t header[TRACE_FILE_HEADER_SIZE];
+        if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, TRACE_MAGIC, 4) != 0 || header[4] != TRACE_VERSION){
+            fprintf(stderr, "%s: not a version %d trace\n", path, TRACE_VERSION);
+            fclose(file);
+            return false;
+        }
+        trace.dropped = header[8] | (header[9] << 8) | (header[10] << 16) | ((uint32_t)header[11] << 24);
+        trace.records.clear();
+        uint8_t raw[TRACE_RECORD_HEADER_SIZE];
+        uint32_t last = 0;
+        uint64_t time = 0;
+        while (fread(raw, 1, sizeof(raw), file) == sizeof(raw)){
+            TraceRecord record;
+            record.type = raw[0];
+            record.connection = raw[1];
+            record.transactionId = raw[2] | (raw[3] << 8);
+            uint32_t stamp = raw[4] | (raw[5] << 8) | (raw[6] << 16) | ((uint32_t)raw[7] << 24);
+            // micros() wraps after 71 minutes, records are in order
+            time = trace.records.empty() ? stamp : time + (uint32_t)(stamp - last);
+            last = stamp;
+            record.time = time;
+            record.busTime = raw[8] | (raw[9] << 8) | (raw[10] << 16) | ((uint32_t)raw[11] << 24);
+            record.pdu.resize(raw[12]);
+            if (fread(record.pdu.data(), 1, record.pdu.size(), file) != record.pdu.size()){
+                fprintf(stderr, "%s: truncated record\n", path);
+                break;
+            }
+            trace.records.push_back(std::move(record));
+        }
+        fclose(file);
+        // pair every request with the next unclaimed response of the same connection and id
+        trace.transactions.clear();
+        std::vector<bool> claimed(trace.records.size());
+        for (size_t i = 0; i < trace.records.size(); i++){
+            auto &request = trace.records[i];
+            if (request.type != TRACE_REQUEST) continue;
+            TraceTransaction transaction = {&request, nullptr};
+            for (size_t j = i + 1; j < trace.records.size(); j++){
+                auto &response = trace.records[j];
+                if (!claimed[j] && response.type == TRACE_RESPONSE && response.connection == request.connection && response.transactionId == request.transactionId){
+                    claimed[j] = true;
+                    transaction.response = &response;
+                    break;
+                }
+            }
+            trace.transactions.push_back(transaction);
+        }
+        return true;
+    }
+#endif /* TRACE_FILE_H */